@@ -0,0 +1,63 @@
+/**@file bench_dfa.cpp
+ *  Benchmark for DFA matching of a tokenizer style pattern with heavy alternation.
+ *  It compares the standard matcher, the JIT matcher and the DFA matcher
+ *  (RegexMatch::setDfaMatch()) on the same subject with a global match.
+ *
+ *  Usage: bench_dfa [iterations]
+ * @include bench_dfa.cpp
+ * */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+typedef std::chrono::steady_clock Clock;
+
+static double usPerRun(Clock::time_point start, size_t n){
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / n;
+}
+
+int main(int argc, char* argv[]){
+    size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 2000;
+    const char* pattern = "(?:if|else|elif|for|while|return|int|long|float|double|char|struct|"
+                          "[A-Za-z_][A-Za-z_0-9]*|0x[0-9a-fA-F]+|[0-9]+(?:\\.[0-9]+)?|"
+                          "==|!=|<=|>=|&&|\\|\\||[-+*/=<>!&|;,(){}\\[\\]])";
+    jp::String subject;
+    for(int i = 0; i < 200; ++i)
+        subject += "for (int i = 0x1f; i <= count_42; ++i) { total += values[i] * 3.25; if (total != 0) return total; }\n";
+
+    jp::Regex re(pattern);
+    jp::Regex re_jit(pattern, "S");
+    std::vector<jpcre2::MatchSpan> spans(subject.size()); //more than the number of tokens
+    jp::RegexMatch rm(&re), rm_jit(&re_jit), rm_dfa(&re);
+    rm.setSubject(subject).setMatchSpanBuffer(&spans[0], spans.size()).setFindAll();
+    rm_jit.setSubject(subject).setMatchSpanBuffer(&spans[0], spans.size()).setFindAll();
+    rm_dfa.setSubject(subject).setMatchSpanBuffer(&spans[0], spans.size()).setFindAll().setDfaMatch();
+    size_t tokens = 0;
+
+    Clock::time_point t = Clock::now();
+    for(size_t i = 0; i < n; ++i) tokens += rm.match();
+    double t_match = usPerRun(t, n);
+
+    double t_jit = 0;
+    if(re_jit.isJitCompiled()){
+        t = Clock::now();
+        for(size_t i = 0; i < n; ++i) tokens += rm_jit.match();
+        t_jit = usPerRun(t, n);
+    }
+
+    t = Clock::now();
+    for(size_t i = 0; i < n; ++i) tokens += rm_dfa.match();
+    double t_dfa = usPerRun(t, n);
+
+    std::printf("%zu runs over %zu characters (%zu tokens in total)\n", n, subject.size(), tokens);
+    std::printf("pcre2_match:      %10.1f us/run\n", t_match);
+    if(re_jit.isJitCompiled())
+        std::printf("pcre2_jit_match:  %10.1f us/run\n", t_jit);
+    else
+        std::printf("pcre2_jit_match:  JIT is not available\n");
+    std::printf("pcre2_dfa_match:  %10.1f us/run\n", t_dfa);
+    return 0;
+}
@@ -0,0 +1,61 @@
+/**@file bench_jit.cpp
+ *  Benchmark for matching short subjects with a JIT compiled pattern.
+ *  It compares `pcre2_match()` and `pcre2_jit_match()` on the same code
+ *  and reports the time per call of RegexMatch::match(), which uses the latter.
+ *
+ *  Usage: bench_jit [iterations]
+ * @include bench_jit.cpp
+ * */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+typedef std::chrono::steady_clock Clock;
+
+static double nsPerCall(Clock::time_point start, size_t n){
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+}
+
+int main(int argc, char* argv[]){
+    size_t n = argc > 1 ? std::strtoul(argv[1], 0, 10) : 2000000;
+    const char* subjects[] = {"GET /index.html 200", "POST /api/v1/items 201", "GET /favicon.ico 404", "x"};
+    const size_t ns = sizeof(subjects) / sizeof(subjects[0]);
+    jp::Regex re("^(GET|POST) (\\S+) (\\d{3})$", "S");
+    if(!re.isJitCompiled()){
+        std::printf("JIT is not available, nothing to compare.\n");
+        return 0;
+    }
+    jp::MatchData* md = pcre2_match_data_create_from_pattern_8(re.getPcre2Code(), 0);
+    size_t hits = 0;
+
+    Clock::time_point t = Clock::now();
+    for(size_t i = 0; i < n; ++i){
+        const char* s = subjects[i % ns];
+        hits += pcre2_match_8(re.getPcre2Code(), (PCRE2_SPTR8)s, std::strlen(s), 0, 0, md, 0) > 0;
+    }
+    double t_match = nsPerCall(t, n);
+
+    t = Clock::now();
+    for(size_t i = 0; i < n; ++i){
+        const char* s = subjects[i % ns];
+        hits += pcre2_jit_match_8(re.getPcre2Code(), (PCRE2_SPTR8)s, std::strlen(s), 0, 0, md, 0) > 0;
+    }
+    double t_jit_match = nsPerCall(t, n);
+
+    jp::RegexMatch rm(&re);
+    t = Clock::now();
+    for(size_t i = 0; i < n; ++i){
+        hits += rm.setSubject(subjects[i % ns]).match();
+    }
+    double t_rm = nsPerCall(t, n);
+    pcre2_match_data_free_8(md);
+
+    std::printf("%zu calls per run (%zu matches in total)\n", n, hits);
+    std::printf("pcre2_match:          %8.1f ns/call\n", t_match);
+    std::printf("pcre2_jit_match:      %8.1f ns/call\n", t_jit_match);
+    std::printf("RegexMatch::match():  %8.1f ns/call\n", t_rm);
+    return 0;
+}
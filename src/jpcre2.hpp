@@ -69,6 +69,30 @@
 #include <cstdio>       // std::fprintf
 #include <climits>      // CHAR_BIT
 #include <cstdlib>      // std::abort()
+#include <cstring>      // std::memcpy
+#include <algorithm>    // std::lexicographical_compare
+#include <list>         // std::list
+#include <memory>       // std::shared_ptr
+#include <mutex>        // std::mutex
+#include <atomic>       // std::atomic
+#include <iterator>     // std::input_iterator_tag
+#include <thread>       // std::thread
+#if defined(__AVX2__)
+    #include <immintrin.h> // AVX2 literal search
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h> // SSE2 literal search
+#endif
+#ifdef _MSC_VER
+    #include <intrin.h>    // _BitScanForward
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    #define JPCRE2_USE_MMAP 1
+    #include <sys/mman.h>  // mmap, madvise
+    #include <sys/stat.h>  // fstat
+    #include <fcntl.h>     // open
+    #include <unistd.h>    // close, sysconf
+#endif
 
 #if __cplusplus >= 201103L || _MSVC_LANG >= 201103L
     #define JPCRE2_USE_MINIMUM_CXX_11 1
@@ -138,6 +162,12 @@ typedef uint8_t Ush;                                ///< 8 bit unsigned integer.
 typedef std::vector<SIZE_T> VecOff;                 ///< vector of size_t.
 typedef std::vector<Uint> VecOpt;                   ///< vector for Uint option values.
 
+///Start and end offsets of a match in the subject.
+struct MatchSpan {
+    SIZE_T start;                                   ///< Offset where the match starts
+    SIZE_T end;                                     ///< Offset where the match ends
+};
+
 /// @namespace jpcre2::ERROR
 /// Namespace for error codes.
 namespace ERROR {
@@ -147,7 +177,8 @@ namespace ERROR {
      */
     enum {
         INVALID_MODIFIER        = 2,  ///< Invalid modifier was detected
-        INSUFFICIENT_OVECTOR    = 3   ///< Ovector was not big enough during a match
+        INSUFFICIENT_OVECTOR    = 3,  ///< Ovector was not big enough during a match
+        FILE_ERROR              = 4   ///< A file could not be opened, mapped or read
     };
 }
 
@@ -157,7 +188,8 @@ namespace ERROR {
 enum {
     NONE                    = 0x0000000u,           ///< Option 0 (zero)
     FIND_ALL                = 0x0000002u,           ///< Find all during match (global match)
-    JIT_COMPILE             = 0x0000004u            ///< Perform JIT compilation for optimization
+    JIT_COMPILE             = 0x0000004u,           ///< Perform JIT compilation for optimization
+    DFA_MATCH               = 0x1000000u            ///< Match with the DFA algorithm (pcre2_dfa_match); a bit no PCRE2 match option uses
 };
 
 
@@ -204,6 +236,59 @@ static inline std::string _tostdstring(unsigned x){
     return (written > 0) ? std::string(buf, buf + written) : std::string();
 }
 
+//index of the lowest set bit (x must not be 0)
+static inline unsigned _lowbit(uint32_t x){
+    #ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (unsigned)i;
+    #else
+    return (unsigned)__builtin_ctz(x);
+    #endif
+}
+
+///Find the first occurrence of a literal in a subject (memmem).
+///Positions where both the first and the last byte of the literal match are found 32 (AVX2)
+///or 16 (SSE2) at a time when the compiler targets these instruction sets, the rest is compared with memcmp.
+///@param s Subject.
+///@param n Length of the subject.
+///@param lit Literal.
+///@param m Length of the literal.
+///@return Pointer to the first occurrence in the subject or null.
+static inline Ush const* findLiteral(Ush const* s, SIZE_T n, Ush const* lit, SIZE_T m){
+    if(m == 0) return s;
+    if(n < m) return 0;
+    if(m == 1) return (Ush const*) std::memchr(s, lit[0], n);
+    SIZE_T i = 0, end = n - m + 1; //candidate positions are [0, end)
+    #if defined(__AVX2__)
+    __m256i vf = _mm256_set1_epi8((char)lit[0]), vl = _mm256_set1_epi8((char)lit[m-1]);
+    for(; i + 32 <= end; i += 32){
+        __m256i a = _mm256_loadu_si256((__m256i const*)(s + i));
+        __m256i b = _mm256_loadu_si256((__m256i const*)(s + i + m - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, vf), _mm256_cmpeq_epi8(b, vl)));
+        for(; mask; mask &= mask - 1){
+            SIZE_T j = i + _lowbit(mask);
+            if(std::memcmp(s + j + 1, lit + 1, m - 2) == 0) return s + j;
+        }
+    }
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    __m128i xf = _mm_set1_epi8((char)lit[0]), xl = _mm_set1_epi8((char)lit[m-1]);
+    for(; i + 16 <= end; i += 16){
+        __m128i a = _mm_loadu_si128((__m128i const*)(s + i));
+        __m128i b = _mm_loadu_si128((__m128i const*)(s + i + m - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, xf), _mm_cmpeq_epi8(b, xl)));
+        for(; mask; mask &= mask - 1){
+            SIZE_T j = i + _lowbit(mask);
+            if(std::memcmp(s + j + 1, lit + 1, m - 2) == 0) return s + j;
+        }
+    }
+    #endif
+    for(; i < end; ++i)
+        if(s[i] == lit[0] && s[i + m - 1] == lit[m-1] && std::memcmp(s + i + 1, lit + 1, m - 2) == 0) return s + i;
+    return 0;
+}
+
 
 ////////////////////////// The following are type and function mappings from PCRE2 interface to JPCRE2 interface /////////////////////////
 
@@ -227,6 +312,7 @@ template<> struct Pcre2Type<8>{
     typedef pcre2_match_context_8 MatchContext;
     typedef pcre2_jit_callback_8 JitCallback;
     typedef pcre2_jit_stack_8 JitStack;
+    typedef pcre2_callout_block_8 CalloutBlock;
 };
 
 template<> struct Pcre2Type<16>{
@@ -240,6 +326,7 @@ template<> struct Pcre2Type<16>{
     typedef pcre2_match_context_16 MatchContext;
     typedef pcre2_jit_callback_16 JitCallback;
     typedef pcre2_jit_stack_16 JitStack;
+    typedef pcre2_callout_block_16 CalloutBlock;
 };
 
 template<> struct Pcre2Type<32>{
@@ -253,6 +340,7 @@ template<> struct Pcre2Type<32>{
     typedef pcre2_match_context_32 MatchContext;
     typedef pcre2_jit_callback_32 JitCallback;
     typedef pcre2_jit_stack_32 JitStack;
+    typedef pcre2_callout_block_32 CalloutBlock;
 };
 
 //wrappers for PCRE2 functions
@@ -321,6 +409,22 @@ template<> struct Pcre2Func<8> {
     static void code_free(Pcre2Type<8>::Pcre2Code *code){
         pcre2_code_free_8(code);
     }
+    static int32_t serialize_encode(const Pcre2Type<8>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    uint8_t **serialized_bytes,
+                                    PCRE2_SIZE *serialized_size,
+                                    Pcre2Type<8>::GeneralContext *gcontext){
+        return pcre2_serialize_encode_8(codes, number_of_codes, serialized_bytes, serialized_size, gcontext);
+    }
+    static int32_t serialize_decode(Pcre2Type<8>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    const uint8_t *bytes,
+                                    Pcre2Type<8>::GeneralContext *gcontext){
+        return pcre2_serialize_decode_8(codes, number_of_codes, bytes, gcontext);
+    }
+    static void serialize_free(uint8_t *bytes){
+        pcre2_serialize_free_8(bytes);
+    }
     static int get_error_message(  int errorcode,
                             Pcre2Type<8>::Pcre2Uchar *buffer,
                             PCRE2_SIZE bufflen){
@@ -332,6 +436,10 @@ template<> struct Pcre2Func<8> {
         return pcre2_match_data_create_from_pattern_8(code, gcontext);
 
     }
+    static Pcre2Type<8>::MatchData * match_data_create(uint32_t ovecsize,
+                              Pcre2Type<8>::GeneralContext *gcontext){
+        return pcre2_match_data_create_8(ovecsize, gcontext);
+    }
     static int match(  const Pcre2Type<8>::Pcre2Code *code,
                             Pcre2Type<8>::Pcre2Sptr subject,
                             PCRE2_SIZE length,
@@ -341,9 +449,32 @@ template<> struct Pcre2Func<8> {
                             Pcre2Type<8>::MatchContext *mcontext){
         return pcre2_match_8(code, subject, length, startoffset, options, match_data, mcontext);
     }
+    static int jit_match(  const Pcre2Type<8>::Pcre2Code *code,
+                            Pcre2Type<8>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<8>::MatchData *match_data,
+                            Pcre2Type<8>::MatchContext *mcontext){
+        return pcre2_jit_match_8(code, subject, length, startoffset, options, match_data, mcontext);
+    }
+    static int dfa_match(  const Pcre2Type<8>::Pcre2Code *code,
+                            Pcre2Type<8>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<8>::MatchData *match_data,
+                            Pcre2Type<8>::MatchContext *mcontext,
+                            int *workspace,
+                            PCRE2_SIZE wscount){
+        return pcre2_dfa_match_8(code, subject, length, startoffset, options, match_data, mcontext, workspace, wscount);
+    }
     static void match_data_free(Pcre2Type<8>::MatchData *match_data){
         pcre2_match_data_free_8(match_data);
     }
+    static Pcre2Type<8>::Pcre2Sptr get_mark(Pcre2Type<8>::MatchData *match_data){
+        return pcre2_get_mark_8(match_data);
+    }
     static PCRE2_SIZE * get_ovector_pointer(Pcre2Type<8>::MatchData *match_data){
         return pcre2_get_ovector_pointer_8(match_data);
     }
@@ -353,30 +484,35 @@ template<> struct Pcre2Func<8> {
     static int set_newline(Pcre2Type<8>::CompileContext *ccontext, uint32_t value){
         return pcre2_set_newline_8(ccontext, value);
     }
-    //~ static void jit_stack_assign(Pcre2Type<8>::MatchContext *mcontext,
-                                 //~ Pcre2Type<8>::JitCallback callback_function,
-                                 //~ void *callback_data){
-        //~ pcre2_jit_stack_assign_8(mcontext, callback_function, callback_data);
-    //~ }
-    //~ static Pcre2Type<8>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
-                                                             //~ Pcre2Type<8>::GeneralContext *gcontext){
-    //~ return pcre2_jit_stack_create_8(startsize, maxsize, gcontext);
-    //~ }
-    //~ static void jit_stack_free(Pcre2Type<8>::JitStack *jit_stack){
-        //~ pcre2_jit_stack_free_8(jit_stack);
-    //~ }
-    //~ static void jit_free_unused_memory(Pcre2Type<8>::GeneralContext *gcontext){
-        //~ pcre2_jit_free_unused_memory_8(gcontext);
-    //~ }
-    //~ static Pcre2Type<8>::MatchContext *match_context_create(Pcre2Type<8>::GeneralContext *gcontext){
-        //~ return pcre2_match_context_create_8(gcontext);
-    //~ }
-    //~ static Pcre2Type<8>::MatchContext *match_context_copy(Pcre2Type<8>::MatchContext *mcontext){
-        //~ return pcre2_match_context_copy_8(mcontext);
-    //~ }
-    //~ static void match_context_free(Pcre2Type<8>::MatchContext *mcontext){
-        //~ pcre2_match_context_free_8(mcontext);
-    //~ }
+    static void jit_stack_assign(Pcre2Type<8>::MatchContext *mcontext,
+                                 Pcre2Type<8>::JitCallback callback_function,
+                                 void *callback_data){
+        pcre2_jit_stack_assign_8(mcontext, callback_function, callback_data);
+    }
+    static Pcre2Type<8>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
+                                                             Pcre2Type<8>::GeneralContext *gcontext){
+    return pcre2_jit_stack_create_8(startsize, maxsize, gcontext);
+    }
+    static void jit_stack_free(Pcre2Type<8>::JitStack *jit_stack){
+        pcre2_jit_stack_free_8(jit_stack);
+    }
+    static void jit_free_unused_memory(Pcre2Type<8>::GeneralContext *gcontext){
+        pcre2_jit_free_unused_memory_8(gcontext);
+    }
+    static Pcre2Type<8>::MatchContext *match_context_create(Pcre2Type<8>::GeneralContext *gcontext){
+        return pcre2_match_context_create_8(gcontext);
+    }
+    static Pcre2Type<8>::MatchContext *match_context_copy(Pcre2Type<8>::MatchContext *mcontext){
+        return pcre2_match_context_copy_8(mcontext);
+    }
+    static void match_context_free(Pcre2Type<8>::MatchContext *mcontext){
+        pcre2_match_context_free_8(mcontext);
+    }
+    static int set_callout(Pcre2Type<8>::MatchContext *mcontext,
+                           int (*callout_function)(Pcre2Type<8>::CalloutBlock *, void *),
+                           void *callout_data){
+        return pcre2_set_callout_8(mcontext, callout_function, callout_data);
+    }
     static uint32_t get_ovector_count(Pcre2Type<8>::MatchData *match_data){
         return pcre2_get_ovector_count_8(match_data);
     }
@@ -445,6 +581,22 @@ template<> struct Pcre2Func<16> {
     static void code_free(Pcre2Type<16>::Pcre2Code *code){
         pcre2_code_free_16(code);
     }
+    static int32_t serialize_encode(const Pcre2Type<16>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    uint8_t **serialized_bytes,
+                                    PCRE2_SIZE *serialized_size,
+                                    Pcre2Type<16>::GeneralContext *gcontext){
+        return pcre2_serialize_encode_16(codes, number_of_codes, serialized_bytes, serialized_size, gcontext);
+    }
+    static int32_t serialize_decode(Pcre2Type<16>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    const uint8_t *bytes,
+                                    Pcre2Type<16>::GeneralContext *gcontext){
+        return pcre2_serialize_decode_16(codes, number_of_codes, bytes, gcontext);
+    }
+    static void serialize_free(uint8_t *bytes){
+        pcre2_serialize_free_16(bytes);
+    }
     static int get_error_message(  int errorcode,
                             Pcre2Type<16>::Pcre2Uchar *buffer,
                             PCRE2_SIZE bufflen){
@@ -456,6 +608,10 @@ template<> struct Pcre2Func<16> {
         return pcre2_match_data_create_from_pattern_16(code, gcontext);
 
     }
+    static Pcre2Type<16>::MatchData * match_data_create(uint32_t ovecsize,
+                              Pcre2Type<16>::GeneralContext *gcontext){
+        return pcre2_match_data_create_16(ovecsize, gcontext);
+    }
     static int match(  const Pcre2Type<16>::Pcre2Code *code,
                             Pcre2Type<16>::Pcre2Sptr subject,
                             PCRE2_SIZE length,
@@ -465,9 +621,32 @@ template<> struct Pcre2Func<16> {
                             Pcre2Type<16>::MatchContext *mcontext){
         return pcre2_match_16(code, subject, length, startoffset, options, match_data, mcontext);
     }
+    static int jit_match(  const Pcre2Type<16>::Pcre2Code *code,
+                            Pcre2Type<16>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<16>::MatchData *match_data,
+                            Pcre2Type<16>::MatchContext *mcontext){
+        return pcre2_jit_match_16(code, subject, length, startoffset, options, match_data, mcontext);
+    }
+    static int dfa_match(  const Pcre2Type<16>::Pcre2Code *code,
+                            Pcre2Type<16>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<16>::MatchData *match_data,
+                            Pcre2Type<16>::MatchContext *mcontext,
+                            int *workspace,
+                            PCRE2_SIZE wscount){
+        return pcre2_dfa_match_16(code, subject, length, startoffset, options, match_data, mcontext, workspace, wscount);
+    }
     static void match_data_free(Pcre2Type<16>::MatchData *match_data){
         pcre2_match_data_free_16(match_data);
     }
+    static Pcre2Type<16>::Pcre2Sptr get_mark(Pcre2Type<16>::MatchData *match_data){
+        return pcre2_get_mark_16(match_data);
+    }
     static PCRE2_SIZE * get_ovector_pointer(Pcre2Type<16>::MatchData *match_data){
         return pcre2_get_ovector_pointer_16(match_data);
     }
@@ -477,30 +656,35 @@ template<> struct Pcre2Func<16> {
     static int set_newline(Pcre2Type<16>::CompileContext *ccontext, uint32_t value){
         return pcre2_set_newline_16(ccontext, value);
     }
-    //~ static void jit_stack_assign(Pcre2Type<16>::MatchContext *mcontext,
-                                 //~ Pcre2Type<16>::JitCallback callback_function,
-                                 //~ void *callback_data){
-        //~ pcre2_jit_stack_assign_16(mcontext, callback_function, callback_data);
-    //~ }
-    //~ static Pcre2Type<16>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
-                                                             //~ Pcre2Type<16>::GeneralContext *gcontext){
-    //~ return pcre2_jit_stack_create_16(startsize, maxsize, gcontext);
-    //~ }
-    //~ static void jit_stack_free(Pcre2Type<16>::JitStack *jit_stack){
-        //~ pcre2_jit_stack_free_16(jit_stack);
-    //~ }
-    //~ static void jit_free_unused_memory(Pcre2Type<16>::GeneralContext *gcontext){
-        //~ pcre2_jit_free_unused_memory_16(gcontext);
-    //~ }
-    //~ static Pcre2Type<16>::MatchContext *match_context_create(Pcre2Type<16>::GeneralContext *gcontext){
-        //~ return pcre2_match_context_create_16(gcontext);
-    //~ }
-    //~ static Pcre2Type<16>::MatchContext *match_context_copy(Pcre2Type<16>::MatchContext *mcontext){
-        //~ return pcre2_match_context_copy_16(mcontext);
-    //~ }
-    //~ static void match_context_free(Pcre2Type<16>::MatchContext *mcontext){
-        //~ pcre2_match_context_free_16(mcontext);
-    //~ }
+    static void jit_stack_assign(Pcre2Type<16>::MatchContext *mcontext,
+                                 Pcre2Type<16>::JitCallback callback_function,
+                                 void *callback_data){
+        pcre2_jit_stack_assign_16(mcontext, callback_function, callback_data);
+    }
+    static Pcre2Type<16>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
+                                                             Pcre2Type<16>::GeneralContext *gcontext){
+    return pcre2_jit_stack_create_16(startsize, maxsize, gcontext);
+    }
+    static void jit_stack_free(Pcre2Type<16>::JitStack *jit_stack){
+        pcre2_jit_stack_free_16(jit_stack);
+    }
+    static void jit_free_unused_memory(Pcre2Type<16>::GeneralContext *gcontext){
+        pcre2_jit_free_unused_memory_16(gcontext);
+    }
+    static Pcre2Type<16>::MatchContext *match_context_create(Pcre2Type<16>::GeneralContext *gcontext){
+        return pcre2_match_context_create_16(gcontext);
+    }
+    static Pcre2Type<16>::MatchContext *match_context_copy(Pcre2Type<16>::MatchContext *mcontext){
+        return pcre2_match_context_copy_16(mcontext);
+    }
+    static void match_context_free(Pcre2Type<16>::MatchContext *mcontext){
+        pcre2_match_context_free_16(mcontext);
+    }
+    static int set_callout(Pcre2Type<16>::MatchContext *mcontext,
+                           int (*callout_function)(Pcre2Type<16>::CalloutBlock *, void *),
+                           void *callout_data){
+        return pcre2_set_callout_16(mcontext, callout_function, callout_data);
+    }
     static uint32_t get_ovector_count(Pcre2Type<16>::MatchData *match_data){
         return pcre2_get_ovector_count_16(match_data);
     }
@@ -569,6 +753,22 @@ template<> struct Pcre2Func<32> {
     static void code_free(Pcre2Type<32>::Pcre2Code *code){
         pcre2_code_free_32(code);
     }
+    static int32_t serialize_encode(const Pcre2Type<32>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    uint8_t **serialized_bytes,
+                                    PCRE2_SIZE *serialized_size,
+                                    Pcre2Type<32>::GeneralContext *gcontext){
+        return pcre2_serialize_encode_32(codes, number_of_codes, serialized_bytes, serialized_size, gcontext);
+    }
+    static int32_t serialize_decode(Pcre2Type<32>::Pcre2Code **codes,
+                                    int32_t number_of_codes,
+                                    const uint8_t *bytes,
+                                    Pcre2Type<32>::GeneralContext *gcontext){
+        return pcre2_serialize_decode_32(codes, number_of_codes, bytes, gcontext);
+    }
+    static void serialize_free(uint8_t *bytes){
+        pcre2_serialize_free_32(bytes);
+    }
     static int get_error_message(  int errorcode,
                             Pcre2Type<32>::Pcre2Uchar *buffer,
                             PCRE2_SIZE bufflen){
@@ -580,6 +780,10 @@ template<> struct Pcre2Func<32> {
         return pcre2_match_data_create_from_pattern_32(code, gcontext);
 
     }
+    static Pcre2Type<32>::MatchData * match_data_create(uint32_t ovecsize,
+                              Pcre2Type<32>::GeneralContext *gcontext){
+        return pcre2_match_data_create_32(ovecsize, gcontext);
+    }
     static int match(  const Pcre2Type<32>::Pcre2Code *code,
                             Pcre2Type<32>::Pcre2Sptr subject,
                             PCRE2_SIZE length,
@@ -589,9 +793,32 @@ template<> struct Pcre2Func<32> {
                             Pcre2Type<32>::MatchContext *mcontext){
         return pcre2_match_32(code, subject, length, startoffset, options, match_data, mcontext);
     }
+    static int jit_match(  const Pcre2Type<32>::Pcre2Code *code,
+                            Pcre2Type<32>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<32>::MatchData *match_data,
+                            Pcre2Type<32>::MatchContext *mcontext){
+        return pcre2_jit_match_32(code, subject, length, startoffset, options, match_data, mcontext);
+    }
+    static int dfa_match(  const Pcre2Type<32>::Pcre2Code *code,
+                            Pcre2Type<32>::Pcre2Sptr subject,
+                            PCRE2_SIZE length,
+                            PCRE2_SIZE startoffset,
+                            uint32_t options,
+                            Pcre2Type<32>::MatchData *match_data,
+                            Pcre2Type<32>::MatchContext *mcontext,
+                            int *workspace,
+                            PCRE2_SIZE wscount){
+        return pcre2_dfa_match_32(code, subject, length, startoffset, options, match_data, mcontext, workspace, wscount);
+    }
     static void match_data_free(Pcre2Type<32>::MatchData *match_data){
         pcre2_match_data_free_32(match_data);
     }
+    static Pcre2Type<32>::Pcre2Sptr get_mark(Pcre2Type<32>::MatchData *match_data){
+        return pcre2_get_mark_32(match_data);
+    }
     static PCRE2_SIZE * get_ovector_pointer(Pcre2Type<32>::MatchData *match_data){
         return pcre2_get_ovector_pointer_32(match_data);
     }
@@ -601,30 +828,35 @@ template<> struct Pcre2Func<32> {
     static int set_newline(Pcre2Type<32>::CompileContext *ccontext, uint32_t value){
         return pcre2_set_newline_32(ccontext, value);
     }
-    //~ static void jit_stack_assign(Pcre2Type<32>::MatchContext *mcontext,
-                                 //~ Pcre2Type<32>::JitCallback callback_function,
-                                 //~ void *callback_data){
-        //~ pcre2_jit_stack_assign_32(mcontext, callback_function, callback_data);
-    //~ }
-    //~ static Pcre2Type<32>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
-                                                             //~ Pcre2Type<32>::GeneralContext *gcontext){
-    //~ return pcre2_jit_stack_create_32(startsize, maxsize, gcontext);
-    //~ }
-    //~ static void jit_stack_free(Pcre2Type<32>::JitStack *jit_stack){
-        //~ pcre2_jit_stack_free_32(jit_stack);
-    //~ }
-    //~ static void jit_free_unused_memory(Pcre2Type<32>::GeneralContext *gcontext){
-        //~ pcre2_jit_free_unused_memory_32(gcontext);
-    //~ }
-    //~ static Pcre2Type<32>::MatchContext *match_context_create(Pcre2Type<32>::GeneralContext *gcontext){
-        //~ return pcre2_match_context_create_32(gcontext);
-    //~ }
-    //~ static Pcre2Type<32>::MatchContext *match_context_copy(Pcre2Type<32>::MatchContext *mcontext){
-        //~ return pcre2_match_context_copy_32(mcontext);
-    //~ }
-    //~ static void match_context_free(Pcre2Type<32>::MatchContext *mcontext){
-        //~ pcre2_match_context_free_32(mcontext);
-    //~ }
+    static void jit_stack_assign(Pcre2Type<32>::MatchContext *mcontext,
+                                 Pcre2Type<32>::JitCallback callback_function,
+                                 void *callback_data){
+        pcre2_jit_stack_assign_32(mcontext, callback_function, callback_data);
+    }
+    static Pcre2Type<32>::JitStack *jit_stack_create(PCRE2_SIZE startsize, PCRE2_SIZE maxsize,
+                                                             Pcre2Type<32>::GeneralContext *gcontext){
+    return pcre2_jit_stack_create_32(startsize, maxsize, gcontext);
+    }
+    static void jit_stack_free(Pcre2Type<32>::JitStack *jit_stack){
+        pcre2_jit_stack_free_32(jit_stack);
+    }
+    static void jit_free_unused_memory(Pcre2Type<32>::GeneralContext *gcontext){
+        pcre2_jit_free_unused_memory_32(gcontext);
+    }
+    static Pcre2Type<32>::MatchContext *match_context_create(Pcre2Type<32>::GeneralContext *gcontext){
+        return pcre2_match_context_create_32(gcontext);
+    }
+    static Pcre2Type<32>::MatchContext *match_context_copy(Pcre2Type<32>::MatchContext *mcontext){
+        return pcre2_match_context_copy_32(mcontext);
+    }
+    static void match_context_free(Pcre2Type<32>::MatchContext *mcontext){
+        pcre2_match_context_free_32(mcontext);
+    }
+    static int set_callout(Pcre2Type<32>::MatchContext *mcontext,
+                           int (*callout_function)(Pcre2Type<32>::CalloutBlock *, void *),
+                           void *callout_data){
+        return pcre2_set_callout_32(mcontext, callout_function, callout_data);
+    }
     static uint32_t get_ovector_count(Pcre2Type<32>::MatchData *match_data){
         return pcre2_get_ovector_count_32(match_data);
     }
@@ -731,65 +963,103 @@ namespace MOD {
 
 
     // String of action (match) modifier characters for JPCRE2 options
-    static const char MJ_N[] = "g";
+    static const char MJ_N[] = "dg";
     // Array of action (match) modifier values for JPCRE2 options
-    static const jpcre2::Uint MJ_V[1] = { FIND_ALL,                                   // Modifier  g
+    static const jpcre2::Uint MJ_V[2] = { DFA_MATCH,                                  // Modifier  d
+                                          FIND_ALL,                                   // Modifier  g
                                         };
 
-    static inline void toOption(Modifier const& mod, bool x,
-                                Uint const * J_V, char const * J_N, SIZE_T SJ,
-                                Uint const * V, char const * N, SIZE_T S,
+    // Lookup table built from a modifier table: the options each modifier character sets, so that
+    // a modifier string is parsed with one table access per character.
+    // A character that is in both tables is a JPCRE2 modifier, and the first occurrence in a table wins.
+    struct Lookup {
+        Uint jv[256]; // JPCRE2 option of each character
+        Uint pv[256]; // PCRE2 option of each character
+        bool valid[256]; // whether the character is a modifier
+
+        Lookup(){ clear(); }
+
+        Lookup(Uint const * J_V, char const * J_N, SIZE_T SJ,
+               Uint const * V, char const * N, SIZE_T S){
+            set(J_V, J_N, SJ, V, N, S);
+        }
+
+        void clear(){
+            std::fill(jv, jv + 256, Uint(0));
+            std::fill(pv, pv + 256, Uint(0));
+            std::fill(valid, valid + 256, false);
+        }
+
+        void set(Uint const * J_V, char const * J_N, SIZE_T SJ,
+                 Uint const * V, char const * N, SIZE_T S){
+            clear();
+            //backwards so that the first occurrence is the one kept
+            for(SIZE_T j = S; j-- > 0;){
+                unsigned char c = (unsigned char) N[j];
+                pv[c] = V[j];
+                valid[c] = true;
+            }
+            for(SIZE_T j = SJ; j-- > 0;){
+                unsigned char c = (unsigned char) J_N[j];
+                jv[c] = J_V[j];
+                pv[c] = 0;
+                valid[c] = true;
+            }
+        }
+    };
+
+    static inline void toOption(Modifier const& mod, bool x, Lookup const& t,
                                 Uint* po, Uint* jo,
                                 int* en, SIZE_T* eo
                                 ){
-        //loop through mod
+        char const *m = mod.c_str();
         SIZE_T n = mod.length();
         for (SIZE_T i = 0; i < n; ++i) {
-            //First check for JPCRE2 mods
-            for(SIZE_T j = 0; j < SJ; ++j){
-                if(J_N[j] == mod[i]) {
-                    if(x) *jo |= J_V[j];
-                    else  *jo &= ~J_V[j];
-                    goto endfor;
-                }
+            unsigned char c = (unsigned char) m[i];
+            if(!t.valid[c]){
+                //Modifier didn't match, invalid modifier
+                *en = (int)ERROR::INVALID_MODIFIER;
+                *eo = (int)m[i];
+                continue;
             }
-
-            //Now check for PCRE2 mods
-            for(SIZE_T j = 0; j< S; ++j){
-                if(N[j] == mod[i]){
-                    if(x) *po |= V[j];
-                    else  *po &= ~V[j];
-                    goto endfor;
-                }
+            if(x){
+                *jo |= t.jv[c];
+                *po |= t.pv[c];
+            } else {
+                *jo &= ~t.jv[c];
+                *po &= ~t.pv[c];
             }
+        }
+    }
 
-            //Modifier didn't match, invalid modifier
-            *en = (int)ERROR::INVALID_MODIFIER;
-            *eo = (int)mod[i];
+    static inline Lookup const& matchLookup(){
+        static const Lookup t(MJ_V, MJ_N, sizeof(MJ_V)/sizeof(Uint),
+                              M_V, M_N, sizeof(M_V)/sizeof(Uint));
+        return t;
+    }
 
-            endfor:;
-        }
+    static inline Lookup const& replaceLookup(){
+        static const Lookup t(RJ_V, RJ_N, sizeof(RJ_V)/sizeof(Uint),
+                              R_V, R_N, sizeof(R_V)/sizeof(Uint));
+        return t;
+    }
+
+    static inline Lookup const& compileLookup(){
+        static const Lookup t(CJ_V, CJ_N, sizeof(CJ_V)/sizeof(Uint),
+                              C_V, C_N, sizeof(C_V)/sizeof(Uint));
+        return t;
     }
 
     static inline void toMatchOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo){
-        toOption(mod, x,
-                 MJ_V, MJ_N, sizeof(MJ_V)/sizeof(Uint),
-                 M_V, M_N, sizeof(M_V)/sizeof(Uint),
-                 po, jo, en, eo);
+        toOption(mod, x, matchLookup(), po, jo, en, eo);
     }
 
     static inline void toReplaceOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo){
-        toOption(mod, x,
-                 RJ_V, RJ_N, sizeof(RJ_V)/sizeof(Uint),
-                 R_V, R_N, sizeof(R_V)/sizeof(Uint),
-                 po, jo, en, eo);
+        toOption(mod, x, replaceLookup(), po, jo, en, eo);
     }
 
     static inline void toCompileOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo){
-        toOption(mod, x,
-                 CJ_V, CJ_N, sizeof(CJ_V)/sizeof(Uint),
-                 C_V, C_N, sizeof(C_V)/sizeof(Uint),
-                 po, jo, en, eo);
+        toOption(mod, x, compileLookup(), po, jo, en, eo);
     }
 
     static inline std::string fromOption(Uint const * J_V, char const * J_N, SIZE_T SJ,
@@ -849,21 +1119,20 @@ class ModifierTable{
     VecOpt tabrv;
     VecOpt tabjcv;
     VecOpt tabcv;
-
-    void toOption(Modifier const& mod, bool x,
-                  VecOpt const& J_V, std::string const& J_N,
-                  VecOpt const& V, std::string const& N,
-                  Uint* po, Uint* jo, int* en, SIZE_T* eo
-                  ) const{
+    //lookup tables built from the tables above, used to parse modifier strings
+    MOD::Lookup tabml;
+    MOD::Lookup tabrl;
+    MOD::Lookup tabcl;
+
+    void setLookup(MOD::Lookup& t,
+                   VecOpt const& J_V, std::string const& J_N,
+                   VecOpt const& V, std::string const& N){
         SIZE_T SJ = J_V.size();
         SIZE_T S = V.size();
         JPCRE2_ASSERT(SJ == J_N.length(), ("ValueError: Modifier character and value table must be of the same size (" + _tostdstring(SJ) + " == " + _tostdstring(J_N.length()) + ").").c_str());
         JPCRE2_ASSERT(S == N.length(), ("ValueError: Modifier character and value table must be of the same size (" + _tostdstring(S) + " == " + _tostdstring(N.length()) + ").").c_str());
-        MOD::toOption(mod, x,
-                     J_V.empty()?0:&J_V[0], J_N.c_str(), SJ,
-                     V.empty()?0:&V[0], N.c_str(), S,
-                     po, jo, en, eo
-                     );
+        t.set(J_V.empty()?0:&J_V[0], J_N.c_str(), SJ,
+              V.empty()?0:&V[0], N.c_str(), S);
     }
 
     std::string fromOption(VecOpt const& J_V, std::string const& J_N,
@@ -878,9 +1147,10 @@ class ModifierTable{
                      po, jo);
     }
 
+    // jopts are the JPCRE2 options of the table being parsed; any other value is a PCRE2 option.
     void parseModifierTable(std::string& tabjs, VecOpt& tabjv,
                             std::string& tab_s, VecOpt& tab_v,
-                            std::string const& tabs, VecOpt const& tabv);
+                            std::string const& tabs, VecOpt const& tabv, Uint jopts);
     public:
 
     ///Default constructor that creates an empty modifier table.
@@ -899,6 +1169,7 @@ class ModifierTable{
         std::string().swap(tabms);
         VecOpt().swap(tabjmv);
         VecOpt().swap(tabmv);
+        tabml.clear();
         return *this;
     }
 
@@ -909,6 +1180,7 @@ class ModifierTable{
         std::string().swap(tabrs);
         VecOpt().swap(tabjrv);
         VecOpt().swap(tabrv);
+        tabrl.clear();
         return *this;
     }
 
@@ -919,6 +1191,7 @@ class ModifierTable{
         std::string().swap(tabcs);
         VecOpt().swap(tabjcv);
         VecOpt().swap(tabcv);
+        tabcl.clear();
         return *this;
     }
 
@@ -939,6 +1212,7 @@ class ModifierTable{
         tabms.clear();
         tabjmv.clear();
         tabmv.clear();
+        tabml.clear();
         return *this;
     }
 
@@ -950,6 +1224,7 @@ class ModifierTable{
         tabrs.clear();
         tabjrv.clear();
         tabrv.clear();
+        tabrl.clear();
         return *this;
     }
 
@@ -961,6 +1236,7 @@ class ModifierTable{
         tabcs.clear();
         tabjcv.clear();
         tabcv.clear();
+        tabcl.clear();
         return *this;
     }
 
@@ -982,7 +1258,7 @@ class ModifierTable{
     ///@param en where to put the error number.
     ///@param eo where to put the error offset.
     void toMatchOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo) const {
-        toOption(mod, x,tabjmv,tabjms,tabmv, tabms,po,jo,en,eo);
+        MOD::toOption(mod, x, tabml, po, jo, en, eo);
     }
 
     ///Modifier parser for replace related options.
@@ -993,7 +1269,7 @@ class ModifierTable{
     ///@param en where to put the error number.
     ///@param eo where to put the error offset.
     void toReplaceOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo) const {
-        return toOption(mod, x,tabjrv,tabjrs,tabrv,tabrs,po,jo,en,eo);
+        MOD::toOption(mod, x, tabrl, po, jo, en, eo);
     }
 
     ///Modifier parser for compile related options.
@@ -1004,7 +1280,7 @@ class ModifierTable{
     ///@param en where to put the error number.
     ///@param eo where to put the error offset.
     void toCompileOption(Modifier const& mod, bool x, Uint* po, Uint* jo, int* en, SIZE_T* eo) const {
-        return toOption(mod, x,tabjcv,tabjcs,tabcv,tabcs,po,jo,en,eo);
+        MOD::toOption(mod, x, tabcl, po, jo, en, eo);
     }
 
     ///Take match related option value and convert to modifier string.
@@ -1037,7 +1313,8 @@ class ModifierTable{
     ///@param tabv vector of Uint (options).
     ///@return A reference to the calling ModifierTable object.
     ModifierTable& setMatchModifierTable(std::string const& tabs, VecOpt const& tabv){
-        parseModifierTable(tabjms, tabjmv, tabms, tabmv, tabs, tabv);
+        parseModifierTable(tabjms, tabjmv, tabms, tabmv, tabs, tabv, FIND_ALL | DFA_MATCH);
+        setLookup(tabml, tabjmv, tabjms, tabmv, tabms);
         return *this;
     }
 
@@ -1077,7 +1354,8 @@ class ModifierTable{
     ///@param tabv vector of Uint (options).
     ///@return A reference to the calling ModifierTable object.
     ModifierTable& setReplaceModifierTable(std::string const& tabs, VecOpt const& tabv){
-        parseModifierTable(tabjrs, tabjrv, tabrs, tabrv, tabs, tabv);
+        parseModifierTable(tabjrs, tabjrv, tabrs, tabrv, tabs, tabv, NONE);
+        setLookup(tabrl, tabjrv, tabjrs, tabrv, tabrs);
         return *this;
     }
 
@@ -1117,7 +1395,8 @@ class ModifierTable{
     ///@param tabv vector of Uint (options).
     ///@return A reference to the calling ModifierTable object.
     ModifierTable& setCompileModifierTable(std::string const& tabs, VecOpt const& tabv){
-        parseModifierTable(tabjcs, tabjcv, tabcs, tabcv, tabs, tabv);
+        parseModifierTable(tabjcs, tabjcv, tabcs, tabcv, tabs, tabv, JIT_COMPILE);
+        setLookup(tabcl, tabjcv, tabjcs, tabcv, tabcs);
         return *this;
     }
 
@@ -1158,6 +1437,7 @@ class ModifierTable{
         tabms = std::string(MOD::M_N, MOD::M_N  + sizeof(MOD::M_V)/sizeof(Uint));
         tabjmv = VecOpt(MOD::MJ_V, MOD::MJ_V + sizeof(MOD::MJ_V)/sizeof(Uint));
         tabmv = VecOpt(MOD::M_V, MOD::M_V + sizeof(MOD::M_V)/sizeof(Uint));
+        setLookup(tabml, tabjmv, tabjms, tabmv, tabms);
         return *this;
     }
 
@@ -1168,6 +1448,7 @@ class ModifierTable{
         tabrs = std::string(MOD::R_N, MOD::R_N  + sizeof(MOD::R_V)/sizeof(Uint));
         tabjrv = VecOpt(MOD::RJ_V, MOD::RJ_V + sizeof(MOD::RJ_V)/sizeof(Uint));
         tabrv = VecOpt(MOD::R_V, MOD::R_V + sizeof(MOD::R_V)/sizeof(Uint));
+        setLookup(tabrl, tabjrv, tabjrs, tabrv, tabrs);
         return *this;
     }
 
@@ -1178,6 +1459,7 @@ class ModifierTable{
         tabcs = std::string(MOD::C_N, MOD::C_N  + sizeof(MOD::C_V)/sizeof(Uint));
         tabjcv = VecOpt(MOD::CJ_V, MOD::CJ_V + sizeof(MOD::CJ_V)/sizeof(Uint));
         tabcv = VecOpt(MOD::C_V, MOD::C_V + sizeof(MOD::C_V)/sizeof(Uint));
+        setLookup(tabcl, tabjcv, tabjcs, tabcv, tabcs);
         return *this;
     }
 
@@ -1197,17 +1479,22 @@ class ModifierTable{
 template<typename Char_T> struct MSG{
     static std::basic_string<Char_T> INVALID_MODIFIER(void);
     static std::basic_string<Char_T> INSUFFICIENT_OVECTOR(void);
+    static std::basic_string<Char_T> FILE_ERROR(void);
 };
 //specialization
 template<> inline std::basic_string<char> MSG<char>::INVALID_MODIFIER(){ return "Invalid modifier: "; }
 template<> inline std::basic_string<wchar_t> MSG<wchar_t>::INVALID_MODIFIER(){ return L"Invalid modifier: "; }
 template<> inline std::basic_string<char> MSG<char>::INSUFFICIENT_OVECTOR(){ return "ovector wasn't big enough"; }
 template<> inline std::basic_string<wchar_t> MSG<wchar_t>::INSUFFICIENT_OVECTOR(){ return L"ovector wasn't big enough"; }
+template<> inline std::basic_string<char> MSG<char>::FILE_ERROR(){ return "could not open, map or read the file"; }
+template<> inline std::basic_string<wchar_t> MSG<wchar_t>::FILE_ERROR(){ return L"could not open, map or read the file"; }
 #ifdef JPCRE2_USE_MINIMUM_CXX_11
 template<> inline std::basic_string<char16_t> MSG<char16_t>::INVALID_MODIFIER(){ return u"Invalid modifier: "; }
 template<> inline std::basic_string<char32_t> MSG<char32_t>::INVALID_MODIFIER(){ return U"Invalid modifier: "; }
 template<> inline std::basic_string<char16_t> MSG<char16_t>::INSUFFICIENT_OVECTOR(){ return u"ovector wasn't big enough"; }
 template<> inline std::basic_string<char32_t> MSG<char32_t>::INSUFFICIENT_OVECTOR(){ return U"ovector wasn't big enough"; }
+template<> inline std::basic_string<char16_t> MSG<char16_t>::FILE_ERROR(){ return u"could not open, map or read the file"; }
+template<> inline std::basic_string<char32_t> MSG<char32_t>::FILE_ERROR(){ return U"could not open, map or read the file"; }
 #endif
 
 ///struct to select the types.
@@ -1299,6 +1586,7 @@ struct select{
     typedef typename Pcre2Type<sizeof( Char_T ) * CHAR_BIT>::MatchContext MatchContext;
     typedef typename Pcre2Type<sizeof( Char_T ) * CHAR_BIT>::JitCallback JitCallback;
     typedef typename Pcre2Type<sizeof( Char_T ) * CHAR_BIT>::JitStack JitStack;
+    typedef typename Pcre2Type<sizeof( Char_T ) * CHAR_BIT>::CalloutBlock CalloutBlock;
 
     template<typename T>
     static String toString(T); //prevent implicit type conversion of T
@@ -1355,597 +1643,2125 @@ struct select{
             return MSG<Char>::INVALID_MODIFIER() + toString((Char)err_off);
         } else if(err_num == (int)ERROR::INSUFFICIENT_OVECTOR){
             return MSG<Char>::INSUFFICIENT_OVECTOR();
+        } else if(err_num == (int)ERROR::FILE_ERROR){
+            return MSG<Char>::FILE_ERROR();
         } else if(err_num != 0) {
             return getPcre2ErrorMessage((int) err_num);
         } else return String();
     }
 
+    //Resizes s to n characters for pcre2_substitute() to write into.
+    //With resize_and_overwrite() (C++23) the new characters are left uninitialized,
+    //otherwise resize() zero-fills them.
+    static void resizeForOverwrite(String& s, SIZE_T n){
+        #ifdef __cpp_lib_string_resize_and_overwrite
+        s.resize_and_overwrite(n, [](Char_T*, SIZE_T k){ return k; });
+        #else
+        s.resize(n);
+        #endif
+    }
+
     //forward declaration
     class Regex;
     class RegexMatch;
     class RegexReplace;
     class MatchEvaluator;
-
-    /** Provides public constructors to create RegexMatch objects.
-     * Every RegexMatch object should be associated with a Regex object.
-     * This class stores a pointer to its' associated Regex object, thus when
-     * the content of the associated Regex object is changed, there will be no need to
-     * set the pointer again.
+    class MatchRange;
+    class MatchView;
+    class MatchTable;
+    class RegexSet;
+    class StreamMatcher;
+    class ReplacementTemplate;
+    class RewriteSet;
+
+    /** Thread local pool of match data blocks.
      *
-     * Examples:
+     * Match data blocks are kept in buckets keyed by their ovector size (number of pairs).
+     * RegexMatch::match(), MatchEvaluator and RegexReplace take a block from the pool of the
+     * calling thread when no match data block was set with setMatchDataBlock() and put it back
+     * when they are done, thus repeated matches don't pay a malloc/free pair for each call.
+     *
+     * Each thread gets its own pool (no locking), the blocks are freed when the thread exits
+     * or when clear() is called. Blocks may retain memory for the heap frames of the largest
+     * match they were used for, call clear() if you want to give that memory back.
      *
      * ```cpp
-     * jp::Regex re;
-     * jp::RegexMatch rm;
-     * rm.setRegexObject(&re);
-     * rm.match("subject", "g");  // 0 match
-     * re.compile("\\w");
-     * rm.match();  // 7 matches
+     * jp::Regex re("\\d+");
+     * re.match("123");
+     * re.match("456");
+     * jp::MatchDataPool& pool = jp::MatchDataPool::getLocal();
+     * size_t hits = pool.getHitCount();     // 1
+     * size_t misses = pool.getMissCount();  // 1
      * ```
      */
-    class RegexMatch {
-
-    private:
-
-        friend class MatchEvaluator;
-
-        Regex const *re;
+    class MatchDataPool {
 
-        StringView m_subject;
-        Uint match_opts;
-        Uint jpcre2_match_opts;
-        MatchContext *mcontext;
-        ModifierTable const * modtab;
-        MatchData * mdata;
+        struct Bucket {
+            uint32_t size;
+            std::vector<MatchData*> blocks;
+        };
 
-        PCRE2_SIZE _start_offset; //name collision, use _ at start
+        std::vector<Bucket> buckets;
+        SIZE_T max_per_size;
+        SIZE_T hit_count;
+        SIZE_T miss_count;
 
-        VecNum* vec_num;
-        VecNas* vec_nas;
-        VecNtN* vec_ntn;
+        MatchDataPool():max_per_size(8), hit_count(0), miss_count(0){}
 
-        VecOff* vec_soff;
-        VecOff* vec_eoff;
+        //not copyable
+        MatchDataPool(MatchDataPool const &);
+        MatchDataPool& operator=(MatchDataPool const &);
 
-        bool getNumberedSubstrings(int, Pcre2Sptr, PCRE2_SIZE*, uint32_t);
+        Bucket& getBucket(uint32_t size){
+            for(SIZE_T i = 0; i < buckets.size(); ++i)
+                if(buckets[i].size == size) return buckets[i];
+            buckets.push_back(Bucket());
+            buckets.back().size = size;
+            return buckets.back();
+        }
 
-        bool getNamedSubstrings(int, int, Pcre2Sptr, Pcre2Sptr, PCRE2_SIZE*);
+        public:
 
-        void init_vars() {
-            re = 0;
-            vec_num = 0;
-            vec_nas = 0;
-            vec_ntn = 0;
-            vec_soff = 0;
-            vec_eoff = 0;
-            match_opts = 0;
-            jpcre2_match_opts = 0;
-            error_number = 0;
-            error_offset = 0;
-            _start_offset = 0;
-            m_subject = {};
-            mcontext = 0;
-            modtab = 0;
-            mdata = 0;
+        ///Destructor.
+        ///Frees all pooled match data blocks.
+        ~MatchDataPool(){
+            clear();
+        }
+
+        ///Get the pool of the calling thread.
+        ///@return Reference to the thread local MatchDataPool object.
+        static MatchDataPool& getLocal(){
+            static thread_local MatchDataPool pool;
+            return pool;
+        }
+
+        ///Get a match data block with exactly `size` ovector pairs.
+        ///A new block is created if the pool doesn't have a free one.
+        ///@param size Number of ovector pairs.
+        ///@return Pointer to a match data block, it must be given back with release().
+        MatchData* acquire(uint32_t size){
+            Bucket& b = getBucket(size);
+            if(!b.blocks.empty()){
+                MatchData* md = b.blocks.back();
+                b.blocks.pop_back();
+                ++hit_count;
+                return md;
+            }
+            ++miss_count;
+            return Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_create(size, 0);
         }
 
-        void onlyCopy(RegexMatch const &rm){
-            re = rm.re; //only pointer should be copied
+        ///@overload
+        ///...
+        ///Get a match data block big enough for all the captures of a compiled pattern
+        ///(same size that `pcre2_match_data_create_from_pattern()` would create).
+        ///@param code Pointer to compiled code.
+        ///@return Pointer to a match data block, it must be given back with release().
+        MatchData* acquire(Pcre2Code const *code){
+            uint32_t capture_count = 0;
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_CAPTURECOUNT, &capture_count);
+            return acquire(capture_count + 1);
+        }
 
-            m_subject = rm.m_subject;
+        ///Give back a match data block taken with acquire().
+        ///The block is freed if the bucket for its size is already full.
+        ///@param md Pointer to match data block (null is ignored).
+        void release(MatchData* md){
+            if(!md) return;
+            Bucket& b = getBucket(Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_count(md));
+            if(b.blocks.size() < max_per_size) b.blocks.push_back(md);
+            else Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(md);
+        }
 
-            //underlying data of vectors are not handled by RegexMatch
-            //thus it's safe to just copy the pointers.
-            vec_num = rm.vec_num;
-            vec_nas = rm.vec_nas;
-            vec_ntn = rm.vec_ntn;
-            vec_soff = rm.vec_soff;
-            vec_eoff = rm.vec_eoff;
+        ///Free all pooled match data blocks.
+        ///Counters are not reset.
+        void clear(){
+            for(SIZE_T i = 0; i < buckets.size(); ++i)
+                for(SIZE_T j = 0; j < buckets[i].blocks.size(); ++j)
+                    Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(buckets[i].blocks[j]);
+            buckets.clear();
+        }
 
-            match_opts = rm.match_opts;
-            jpcre2_match_opts = rm.jpcre2_match_opts;
-            error_number = rm.error_number;
-            error_offset = rm.error_offset;
-            _start_offset = rm._start_offset;
-            mcontext = rm.mcontext;
-            modtab = rm.modtab;
-            mdata = rm.mdata;
+        ///Set the maximum number of free blocks kept for each ovector size (default 8).
+        ///@param n Maximum number of blocks per size.
+        void setMaxBlocksPerSize(SIZE_T n){
+            max_per_size = n;
         }
 
-        void deepCopy(RegexMatch const &rm){
-            onlyCopy(rm);
+        ///Get the maximum number of free blocks kept for each ovector size.
+        ///@return Maximum number of blocks per size.
+        SIZE_T getMaxBlocksPerSize() const {
+            return max_per_size;
         }
 
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-        void deepMove(RegexMatch& rm){
-            onlyCopy(rm);
+        ///Get the number of acquire() calls that were served from the pool.
+        ///@return Hit count.
+        SIZE_T getHitCount() const {
+            return hit_count;
         }
-        #endif
 
-        friend class Regex;
+        ///Get the number of acquire() calls that had to create a new block.
+        ///@return Miss count.
+        SIZE_T getMissCount() const {
+            return miss_count;
+        }
 
-        protected:
+        ///Reset hit and miss counters to zero.
+        void resetCounters(){
+            hit_count = 0;
+            miss_count = 0;
+        }
+    };
 
-        int error_number;
-        PCRE2_SIZE error_offset;
+    /** Compiled pattern that can be shared between Regex objects.
+     *
+     * It owns the PCRE2 compiled code and a copy of the character tables the code points to,
+     * thus it stays valid no matter which Regex object created it. Regex objects hold it through
+     * a reference counted pointer (CodePtr) and the code is freed when the last reference goes away.
+     * The compiled code is not modified after compilation, so it can be used by several threads at
+     * the same time.
+     */
+    class CompiledCode {
 
-    public:
+        friend class Regex;
+        friend class RegexCache;
+        friend class RegexMatch;
+        friend class RegexReplace;
+        friend class MatchEvaluator;
+        friend class MatchRange;
+        friend class MatchView;
+        friend class MatchTable;
+        friend class RegexSet;
+        friend class StreamMatcher;
+        friend class ReplacementTemplate;
+        friend class RewriteSet;
+
+        //Entry of the decoded name table.
+        struct NameEntry {
+            StringView name; //points into the name table of the compiled code
+            uint32_t number;
+        };
 
-        ///Default constructor.
-        RegexMatch(){
-            init_vars();
+        Pcre2Code *code;
+        std::vector<unsigned char> tables;
+        mutable int jit_error;
+        mutable bool jit_compiled; //JIT compilation succeeded
+        bool jit_pending; //JIT compile on first use (deserialized code)
+        mutable std::once_flag jit_once;
+
+        //Pattern information used by every match, read once by loadInfo().
+        Uint all_options;
+        Uint newline;
+        bool utf;
+        bool crlf_is_newline;
+        uint32_t capture_count;
+        std::vector<NameEntry> names; //in name table order (sorted by name)
+
+        //Literal that every match contains, subjects without it are rejected before pcre2_match.
+        String literal;
+        //Counters are written only when enabled, so that threads matching with the same code
+        //don't contend for their cache line.
+        mutable std::atomic<bool> prefilter_counting;
+        mutable std::atomic<SIZE_T> prefilter_checks;
+        mutable std::atomic<SIZE_T> prefilter_rejects;
+
+        CompiledCode():code(0), jit_error(0), jit_compiled(false), jit_pending(false),
+                       all_options(0), newline(0), utf(false), crlf_is_newline(false), capture_count(0),
+                       prefilter_counting(false), prefilter_checks(0), prefilter_rejects(0){}
+
+        static bool nameLess(NameEntry const& e, StringView name){
+            return e.name < name;
+        }
+
+        //Returns the first entry for a name, or names.end().
+        typename std::vector<NameEntry>::const_iterator findName(StringView name) const {
+            typename std::vector<NameEntry>::const_iterator it = std::lower_bound(names.begin(), names.end(), name, nameLess);
+            return (it != names.end() && it->name == name) ? it : names.end();
+        }
+
+        //Returns the group for a name in a match: the first of its groups that is set
+        //(more than one with PCRE2_DUPNAMES), or a negative error number.
+        int getSetGroupNumber(StringView name, PCRE2_SIZE const *ovector, SIZE_T count) const {
+            typename std::vector<NameEntry>::const_iterator it = findName(name);
+            if(it == names.end()) return PCRE2_ERROR_NOSUBSTRING;
+            int first = it->number;
+            for(; it != names.end() && it->name == name; ++it)
+                if(it->number < count && ovector[2*it->number] != PCRE2_UNSET) return it->number;
+            return first;
+        }
+
+        //Reads the pattern information and decodes the name table.
+        void loadInfo(){
+            uint32_t name_count = 0, name_entry_size = 0;
+            Pcre2Sptr tabptr = 0;
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_ALLOPTIONS, &all_options);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_NEWLINE, &newline);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_CAPTURECOUNT, &capture_count);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_NAMECOUNT, &name_count);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_NAMEENTRYSIZE, &name_entry_size);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_NAMETABLE, &tabptr);
+            utf = (all_options & PCRE2_UTF) != 0;
+            crlf_is_newline = newline == PCRE2_NEWLINE_ANY
+                    || newline == PCRE2_NEWLINE_CRLF
+                    || newline == PCRE2_NEWLINE_ANYCRLF;
+            //In the 8-bit library the number is held in two bytes, most significant first.
+            names.resize(name_count);
+            for(uint32_t i = 0; i < name_count; ++i, tabptr += name_entry_size){
+                if(sizeof( Char_T ) * CHAR_BIT == 8){
+                    names[i].number = (tabptr[0] << 8) | tabptr[1];
+                    names[i].name = StringView((Char_T const*)(tabptr + 2));
+                } else {
+                    names[i].number = tabptr[0];
+                    names[i].name = StringView((Char_T const*)(tabptr + 1));
+                }
+            }
         }
 
-        ///@overload
-        ///...
-        ///Creates a RegexMatch object associating a Regex object.
-        ///Underlying data is not modified.
-        ///@param r pointer to a Regex object
-        RegexMatch(Regex const *r) {
-            init_vars();
-            re = r;
+        //Skips the group or character class that starts at i, returns the index after it.
+        static SIZE_T skipItem(StringView p, SIZE_T i){
+            SIZE_T n = p.size();
+            int depth = 0;
+            bool in_class = false;
+            while(i < n){
+                Char_T c = p[i];
+                if(c == '\\'){
+                    if(i + 1 < n && p[i+1] == 'Q'){
+                        //quoted until \E
+                        for(i += 2; i + 1 < n && !(p[i] == '\\' && p[i+1] == 'E'); ++i);
+                    }
+                    i += 2;
+                } else if(in_class){
+                    if(c == '[' && i + 1 < n && (p[i+1] == ':' || p[i+1] == '.' || p[i+1] == '=')){
+                        //[:alpha:], [.x.] and [=x=] are single items of the class, their ] doesn't end it
+                        Char_T kind = p[i+1];
+                        SIZE_T j = i + 2;
+                        while(j + 1 < n && !(p[j] == kind && p[j+1] == ']')) ++j;
+                        if(j + 1 < n){
+                            i = j + 2;
+                            continue;
+                        }
+                    }
+                    if(c == ']'){
+                        in_class = false;
+                        if(depth == 0) return i + 1;
+                    }
+                    ++i;
+                } else if(c == '['){
+                    in_class = true;
+                    ++i;
+                    if(i < n && p[i] == '^') ++i;
+                    if(i < n && p[i] == ']') ++i; //literal ] at the start of a class
+                } else {
+                    if(c == '(') ++depth;
+                    else if(c == ')' && --depth <= 0) return i + 1;
+                    ++i;
+                }
+            }
+            return n;
+        }
+
+        //Returns the index after the {n}, {n,} or {n,m} quantifier that starts at i, or 0 if the
+        //brace doesn't start one (it's then a literal).
+        static SIZE_T skipQuantifier(StringView p, SIZE_T i){
+            SIZE_T n = p.size(), j = i + 1, digits = 0;
+            for(; j < n && p[j] >= '0' && p[j] <= '9'; ++j) ++digits;
+            if(digits == 0) return 0;
+            if(j < n && p[j] == ',') for(++j; j < n && p[j] >= '0' && p[j] <= '9'; ++j);
+            return (j < n && p[j] == '}') ? j + 1 : 0;
+        }
+
+        //Finds the longest run of literal ASCII characters at the top level of the pattern,
+        //every match must contain it. Groups, classes, escapes other than escaped punctuation
+        //and quantified characters end a run. Returns false if the pattern can't be analyzed safely:
+        //caseless or extended matching (also set inside the pattern), top level alternation, (*ACCEPT) or callouts
+        //(they must be called even when the subject can't match), \Q..\E quoting, and braces that aren't
+        //a quantifier (PCRE2 versions differ on what they are).
+        static bool extractLiteral(StringView p, Uint opts, String& best){
+            best.clear();
+            Uint unsafe = PCRE2_CASELESS | PCRE2_EXTENDED | PCRE2_ALLOW_EMPTY_CLASS;
+            #ifdef PCRE2_EXTENDED_MORE
+            unsafe |= PCRE2_EXTENDED_MORE;
+            #endif
+            if(p.empty() || (opts & unsafe) != 0) return false;
+            #ifdef PCRE2_LITERAL
+            if(opts & PCRE2_LITERAL){
+                best = String(p);
+                return true;
+            }
+            #endif
+            SIZE_T n = p.size();
+            //option settings and (*ACCEPT) anywhere in the pattern
+            for(SIZE_T i = 0; i + 1 < n; ++i){
+                if(p[i] == '\\'){
+                    if(p[i+1] == 'Q') return false;
+                    ++i;
+                } else if(i + 2 < n && p[i] == '(' && ((p[i+1] == '*' && p[i+2] == 'A') || (p[i+1] == '?' && p[i+2] == 'C'))){
+                    return false; //(*ACCEPT) and callouts
+                } else if(p[i] == '(' && p[i+1] == '?'){
+                    for(SIZE_T j = i + 2; j < n && ((p[j] >= 'a' && p[j] <= 'z') || p[j] == '-' || p[j] == '^'); ++j)
+                        if(p[j] == 'i' || p[j] == 'x') return false;
+                }
+            }
+            String run;
+            SIZE_T i = 0;
+            while(i < n){
+                Char_T c = p[i];
+                bool quantifier = c == '*' || c == '?' || c == '{' || c == '+';
+                if(c == '|') {
+                    best.clear();
+                    return false;
+                } else if(quantifier){
+                    SIZE_T end = c == '{' ? skipQuantifier(p, i) : i + 1;
+                    if(end == 0){
+                        best.clear();
+                        return false;
+                    }
+                    //the quantified character is optional unless it's +
+                    if(c != '+' && !run.empty()) run.erase(run.size() - 1);
+                    if(run.size() > best.size()) best = run;
+                    run.clear();
+                    i = end;
+                    if(i < n && (p[i] == '+' || p[i] == '?')) ++i; //possessive or lazy
+                    continue;
+                }
+                bool literal = false;
+                Char_T lit = c;
+                SIZE_T next = i + 1;
+                if(c == '\\'){
+                    if(i + 1 >= n) break;
+                    lit = p[i+1];
+                    next = i + 2;
+                    bool word = (lit >= '0' && lit <= '9') || (lit >= 'a' && lit <= 'z') || (lit >= 'A' && lit <= 'Z');
+                    if(word){
+                        if(next < n && (p[next] == '{' || p[next] == '<' || p[next] == '\'')){
+                            //\x{..}, \p{..}, \k<..>, \g{..} etc.
+                            while(next < n && p[next] != '}' && p[next] != '>' && (p[next] != '\'' || next == i + 2)) ++next;
+                            if(next < n) ++next;
+                        } else if(lit == 'c' || lit == 'p' || lit == 'P'){
+                            ++next; //\cX, \pL
+                        } else if(lit == 'x'){
+                            for(SIZE_T k = 0; k < 2 && next < n && ((p[next] >= '0' && p[next] <= '9') || (p[next] >= 'a' && p[next] <= 'f') || (p[next] >= 'A' && p[next] <= 'F')); ++k) ++next;
+                        } else if((lit >= '0' && lit <= '9') || lit == 'g'){
+                            //back references, octal characters, \g-1
+                            if(lit == 'g' && next < n && (p[next] == '-' || p[next] == '+')) ++next;
+                            while(next < n && p[next] >= '0' && p[next] <= '9') ++next;
+                        }
+                    } else {
+                        literal = (Uint)lit > 0x20 && (Uint)lit < 0x7f;
+                    }
+                } else if(c == '(' || c == '['){
+                    next = skipItem(p, i);
+                } else {
+                    literal = (Uint)c >= 0x20 && (Uint)c < 0x7f && c != '.' && c != '^' && c != '$' && c != ')';
+                }
+                if(literal){
+                    run += lit;
+                } else {
+                    if(run.size() > best.size()) best = run;
+                    run.clear();
+                }
+                i = next;
+            }
+            if(run.size() > best.size()) best = run;
+            return true;
+        }
+
+        //Sets the prefilter literal from the pattern, or from the first/last code unit PCRE2 found.
+        //A literal found in the pattern is kept only if it contains the first or the last code unit
+        //PCRE2 requires, otherwise that code unit is used: a pattern the parser misreads must not
+        //make the prefilter stricter than PCRE2.
+        void loadLiteral(StringView pattern){
+            literal.clear();
+            if(!extractLiteral(pattern, all_options, literal)) return;
+            uint32_t first = 0, last = 0, type = 0;
+            bool has_first = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_FIRSTCODETYPE, &type) == 0 && type == 1;
+            if(has_first) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_FIRSTCODEUNIT, &first);
+            bool has_last = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_LASTCODETYPE, &type) == 0 && type == 1;
+            if(has_last) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_LASTCODEUNIT, &last);
+            if((has_last && literal.find((Char_T) last) != String::npos)
+               || (has_first && literal.find((Char_T) first) != String::npos)) return;
+            if(has_last) literal.assign(1, (Char_T) last);
+            else if(has_first) literal.assign(1, (Char_T) first);
+            else literal.clear();
+        }
+
+        //Returns false if the subject (from offset) can't contain a match.
+        bool prefilter(StringView subject, SIZE_T offset, Uint opts) const {
+            if(literal.empty() || (opts & (PCRE2_PARTIAL_SOFT | PCRE2_PARTIAL_HARD)) != 0 || offset > subject.size())
+                return true;
+            bool found;
+            if(sizeof( Char_T ) == 1){
+                found = findLiteral((Ush const*) subject.data() + offset, subject.size() - offset,
+                                    (Ush const*) literal.data(), literal.size()) != 0;
+            } else {
+                found = subject.find(literal, offset) != StringView::npos;
+            }
+            if(prefilter_counting.load(std::memory_order_relaxed)){
+                prefilter_checks.fetch_add(1, std::memory_order_relaxed);
+                if(!found) prefilter_rejects.fetch_add(1, std::memory_order_relaxed);
+            }
+            return found;
         }
 
-        ///@overload
-        ///...
-        ///Copy constructor.
-        ///@param rm Reference to RegexMatch object
-        RegexMatch(RegexMatch const &rm){
-            init_vars();
-            deepCopy(rm);
+        //Performs the JIT compilation that was deferred, only once.
+        void lazyJit() const {
+            if(!jit_pending) return;
+            std::call_once(jit_once, [this](){
+                int ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_compile(code, PCRE2_JIT_COMPLETE);
+                if(ret < 0) jit_error = ret;
+                else jit_compiled = true;
+            });
         }
 
-        ///Overloaded copy-assignment operator.
-        ///@param rm RegexMatch object
-        ///@return A reference to the calling RegexMatch object.
-        virtual RegexMatch& operator=(RegexMatch const &rm){
-            if(this == &rm) return *this;
-            deepCopy(rm);
-            return *this;
+        //not copyable
+        CompiledCode(CompiledCode const &);
+        CompiledCode& operator=(CompiledCode const &);
+
+        public:
+
+        ///Destructor.
+        ///Frees the compiled code.
+        ~CompiledCode(){
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::code_free(code);
         }
 
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-        ///@overload
-        ///...
-        ///Move constructor.
-        ///This constructor steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param rm rvalue reference to a RegexMatch object
-        RegexMatch(RegexMatch&& rm){
-            init_vars();
-            deepMove(rm);
+        ///Get Pcre2 raw compiled code pointer.
+        ///@return pointer to constant pcre2_code or null.
+        Pcre2Code const* getPcre2Code() const {
+            return code;
         }
 
-        ///@overload
-        ///...
-        ///Overloaded move-assignment operator.
-        ///This constructor steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param rm rvalue reference to a RegexMatch object
-        ///@return A reference to the calling RegexMatch object.
-        virtual RegexMatch& operator=(RegexMatch&& rm){
-            if(this == &rm) return *this;
-            deepMove(rm);
-            return *this;
+        ///Get the memory used by the compiled code, its JIT code and character tables.
+        ///@return size in bytes.
+        SIZE_T getMemorySize() const {
+            size_t size = 0, jit_size = 0;
+            if(code){
+                Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_SIZE, &size);
+                Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_JITSIZE, &jit_size);
+            }
+            return size + jit_size + tables.size();
         }
-        #endif
 
-        ///Destructor
-        ///Frees all internal memories that were used.
-        virtual ~RegexMatch() {}
+        ///Get the group number of a named group.
+        ///The name table is decoded at compile time, the lookup is a binary search.
+        ///With PCRE2_DUPNAMES the lowest group number of the name is returned.
+        ///@param name Group name.
+        ///@return Group number, or PCRE2_ERROR_NOSUBSTRING if there is no such name.
+        int getGroupNumber(StringView name) const {
+            typename std::vector<NameEntry>::const_iterator it = findName(name);
+            return it == names.end() ? PCRE2_ERROR_NOSUBSTRING : (int) it->number;
+        }
 
-        ///Reset all class variables to its default (initial) state including memory.
-        ///Data in the vectors will retain (as it's external)
-        ///You will need to pass vector pointers again after calling this function to get match results.
-        ///@return Reference to the calling RegexMatch object.
-        virtual RegexMatch& reset() {
-            init_vars();
-            return *this;
+        ///Get the number of named groups (entries in the name table).
+        ///@return Name count.
+        SIZE_T getNameCount() const {
+            return names.size();
         }
 
-        ///Clear all class variables (may retain some memory for further use).
-        ///Data in the vectors will retain (as it's external)
-        ///You will need to pass vector pointers again after calling this function to get match results.
-        ///@return Reference to the calling RegexMatch object.
-        virtual RegexMatch& clear(){
-            init_vars();
-            return *this;
+        ///Get the literal used to reject subjects before matching.
+        ///It's the longest literal every match must contain, found when the pattern is compiled,
+        ///or the first or last code unit reported by PCRE2. Patterns with caseless or extended matching,
+        ///top level alternation, (*ACCEPT), callouts, \\Q..\\E quoting or braces that aren't a quantifier
+        ///have no prefilter literal.
+        ///@return Literal, empty if there's no prefilter.
+        StringView getPrefilterLiteral() const {
+            return literal;
         }
 
-        ///reset match related errors to zero.
-        ///If you want to examine the error status of a function call in the method chain,
-        ///add this function just before your target function so that the error is set to zero
-        ///before that target function is called, and leave everything out after the target
-        ///function so that there will be no additional errors from other function calls.
-        ///@return A reference to the RegexMatch object
-        ///@see Regex::resetErrors()
-        ///@see RegexReplace::resetErrors()
-        virtual RegexMatch& resetErrors(){
-            error_number = 0;
-            error_offset = 0;
-            return *this;
+        ///Enable or disable counting the subjects checked and rejected by the prefilter.
+        ///Counting is off by default: the counters are shared by every thread that matches
+        ///with this code, and writing them on each match slows down concurrent matching.
+        ///@param x True to count, false to stop counting.
+        void setPrefilterCounting(bool x) const {
+            prefilter_counting.store(x, std::memory_order_relaxed);
         }
 
-        /// Returns the last error number
-        ///@return Last error number
-        virtual int getErrorNumber() const {
-            return error_number;
+        ///Get the number of subjects checked by the prefilter while counting was enabled.
+        ///@return Check count.
+        ///@see setPrefilterCounting()
+        SIZE_T getPrefilterCheckCount() const {
+            return prefilter_checks.load(std::memory_order_relaxed);
         }
 
-        /// Returns the last error offset
-        ///@return Last error offset
-        virtual int getErrorOffset() const  {
-            return (int)error_offset;
+        ///Get the number of subjects rejected by the prefilter without calling PCRE2
+        ///while counting was enabled.
+        ///@return Reject count.
+        ///@see setPrefilterCounting()
+        SIZE_T getPrefilterRejectCount() const {
+            return prefilter_rejects.load(std::memory_order_relaxed);
         }
 
-        /// Returns the last error message
-        ///@return Last error message
-        virtual String getErrorMessage() const  {
-            #ifdef JPCRE2_USE_MINIMUM_CXX_11
-            return select<Char, Map>::getErrorMessage(error_number, error_offset);
-            #else
-            return select<Char>::getErrorMessage(error_number, error_offset);
-            #endif
+        ///Reset the prefilter counters.
+        void resetPrefilterCounters() const {
+            prefilter_checks.store(0, std::memory_order_relaxed);
+            prefilter_rejects.store(0, std::memory_order_relaxed);
         }
+    };
 
-        ///Get subject string (by value).
-        ///@return subject string
-        ///@see RegexReplace::getSubject()
-        virtual StringView getSubject() const  {
-            return m_subject;
+    ///Reference counted pointer to a CompiledCode object.
+    typedef std::shared_ptr<CompiledCode const> CodePtr;
+
+    /** Thread safe cache of compiled patterns.
+     *
+     * Regex objects that have a cache set with Regex::setRegexCache() look up their
+     * (pattern, PCRE2 options, JPCRE2 options, newline, character tables) in the cache
+     * when compile() is called. On a hit, the compiled (and JIT compiled) code is shared
+     * with the other Regex objects that compiled the same key and no pcre2_compile is performed.
+     *
+     * The cache keeps compiled code up to a byte budget (code, JIT code and tables, see setMaxBytes()),
+     * least recently used entries are evicted first. Evicting an entry doesn't affect the Regex objects
+     * that are using it, the code is freed when the last of them releases it.
+     *
+     * ```cpp
+     * jp::RegexCache& cache = jp::RegexCache::getGlobal();
+     * jp::Regex re;
+     * re.setRegexCache(&cache).compile("\\d+", "S");
+     * jp::Regex re2;
+     * re2.setRegexCache(&cache).compile("\\d+", "S"); // cache hit, no compile
+     * ```
+     */
+    class RegexCache {
+
+        friend class Regex;
+
+        struct KeyRef {
+            StringView pattern;
+            Uint po;
+            Uint jo;
+            Uint newline;
+            unsigned char const* tables;
+            SIZE_T tables_size;
+        };
+
+        struct Key {
+            String pattern;
+            Uint po;
+            Uint jo;
+            Uint newline;
+            std::vector<unsigned char> tables;
+
+            KeyRef ref() const {
+                KeyRef k = {pattern, po, jo, newline, tables.data(), tables.size()};
+                return k;
+            }
+        };
+
+        struct KeyLess {
+            typedef void is_transparent;
+            static bool less(KeyRef const& a, KeyRef const& b){
+                if(a.po != b.po) return a.po < b.po;
+                if(a.jo != b.jo) return a.jo < b.jo;
+                if(a.newline != b.newline) return a.newline < b.newline;
+                int c = a.pattern.compare(b.pattern);
+                if(c != 0) return c < 0;
+                return std::lexicographical_compare(a.tables, a.tables + a.tables_size,
+                                                    b.tables, b.tables + b.tables_size);
+            }
+            bool operator()(Key const& a, Key const& b) const { return less(a.ref(), b.ref()); }
+            bool operator()(Key const& a, KeyRef const& b) const { return less(a.ref(), b); }
+            bool operator()(KeyRef const& a, Key const& b) const { return less(a, b.ref()); }
+        };
+
+        struct Entry;
+        typedef typename std::list<Entry>::iterator EntryIterator;
+        typedef std::map<Key, EntryIterator, KeyLess> Index;
+
+        struct Entry {
+            typename Index::iterator key;
+            CodePtr code;
+            SIZE_T size;
+        };
+
+        std::list<Entry> lru; //most recently used at front
+        Index index;
+        mutable std::mutex mtx;
+        SIZE_T max_bytes;
+        SIZE_T bytes;
+        SIZE_T hit_count;
+        SIZE_T miss_count;
+        SIZE_T eviction_count;
+
+        //not copyable
+        RegexCache(RegexCache const &);
+        RegexCache& operator=(RegexCache const &);
+
+        //must be called with the lock held.
+        void evict(SIZE_T limit){
+            while(bytes > limit && !lru.empty()){
+                Entry& e = lru.back();
+                bytes -= e.size;
+                index.erase(e.key);
+                lru.pop_back();
+                ++eviction_count;
+            }
         }
 
+        CodePtr find(KeyRef const& k){
+            std::lock_guard<std::mutex> lock(mtx);
+            typename Index::iterator it = index.find(k);
+            if(it == index.end()){
+                ++miss_count;
+                return CodePtr();
+            }
+            ++hit_count;
+            lru.splice(lru.begin(), lru, it->second);
+            return it->second->code;
+        }
+
+        //returns the code that is in the cache for the key,
+        //which is not the same as the argument if another thread inserted it first.
+        CodePtr insert(KeyRef const& k, CodePtr const& code){
+            SIZE_T size = code->getMemorySize() + k.pattern.size() * sizeof(Char_T);
+            std::lock_guard<std::mutex> lock(mtx);
+            typename Index::iterator it = index.find(k);
+            if(it != index.end()) return it->second->code;
+            if(size > max_bytes) return code; //would never fit
+            evict(max_bytes - size);
+            Key key = {String(k.pattern), k.po, k.jo, k.newline,
+                       std::vector<unsigned char>(k.tables, k.tables + k.tables_size)};
+            it = index.insert(std::make_pair(key, lru.end())).first;
+            Entry e = {it, code, size};
+            lru.push_front(e);
+            it->second = lru.begin();
+            bytes += size;
+            return code;
+        }
 
-        /// Calculate modifier string from PCRE2 and JPCRE2 options and return it.
-        ///
-        /// Do remember that modifiers (or PCRE2 and JPCRE2 options) do not change or get initialized
-        /// as long as you don't do that explicitly. Calling RegexMatch::setModifier() will re-set them.
-        ///
-        /// **Mixed or combined modifier**.
-        ///
-        /// Some modifier may include other modifiers i.e they have the same meaning of some modifiers
-        /// combined together. For example, the 'n' modifier includes the 'u' modifier and together they
-        /// are equivalent to `PCRE2_UTF | PCRE2_UCP`. When you set a modifier like this, both options
-        /// get set, and when you remove the 'n' modifier (with `RegexMatch::changeModifier()`), both will get removed.
-        ///@return Calculated modifier string (std::string)
-        ///@see Regex::getModifier()
-        ///@see RegexReplace::getModifier()
-        virtual std::string getModifier() const {
-            return modtab ? modtab->fromMatchOption(match_opts, jpcre2_match_opts)
-                          : MOD::fromMatchOption(match_opts, jpcre2_match_opts);
+        public:
+
+        ///Constructor.
+        ///@param max Maximum number of bytes of compiled code to keep in the cache.
+        explicit RegexCache(SIZE_T max = 32*1024*1024)
+        :max_bytes(max), bytes(0), hit_count(0), miss_count(0), eviction_count(0){}
+
+        ///Get the process wide cache.
+        ///@return Reference to the global RegexCache object.
+        static RegexCache& getGlobal(){
+            static RegexCache cache;
+            return cache;
+        }
+
+        ///Set the byte budget, evicting entries if the cache is already bigger.
+        ///@param max Maximum number of bytes.
+        ///@return Reference to the calling RegexCache object.
+        RegexCache& setMaxBytes(SIZE_T max){
+            std::lock_guard<std::mutex> lock(mtx);
+            max_bytes = max;
+            evict(max_bytes);
+            return *this;
         }
 
-        ///Get the modifier table that is set,
-        ///@return pointer to constant ModifierTable.
-        virtual ModifierTable const* getModifierTable(){
-            return modtab;
+        ///Get the byte budget.
+        ///@return Maximum number of bytes.
+        SIZE_T getMaxBytes() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return max_bytes;
         }
 
+        ///Get the number of bytes used by the cached entries.
+        ///@return size in bytes.
+        SIZE_T getBytes() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return bytes;
+        }
 
-        ///Get PCRE2 option
-        ///@return PCRE2 option for match operation
-        ///@see Regex::getPcre2Option()
-        ///@see RegexReplace::getPcre2Option()
-        virtual Uint getPcre2Option() const  {
-            return match_opts;
+        ///Get the number of cached entries.
+        ///@return entry count.
+        SIZE_T getCount() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return lru.size();
         }
 
-        /// Get JPCRE2 option
-        ///@return JPCRE2 options for math operation
-        ///@see Regex::getJpcre2Option()
-        ///@see RegexReplace::getJpcre2Option()
-        virtual Uint getJpcre2Option() const  {
-            return jpcre2_match_opts;
+        ///Get the number of compiles that were served from the cache.
+        ///@return hit count.
+        SIZE_T getHitCount() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return hit_count;
         }
 
-        /// Get offset from where match will start in the subject.
-        /// @return Start offset
-        virtual PCRE2_SIZE getStartOffset() const  {
-            return _start_offset;
+        ///Get the number of compiles that were not found in the cache.
+        ///@return miss count.
+        SIZE_T getMissCount() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return miss_count;
         }
 
-        ///Get pre-set match start offset vector pointer.
-        ///The pointer must be set with RegexMatch::setMatchStartOffsetVector() beforehand
-        ///for this to work i.e it is just a convenience method to get the pre-set vector pointer.
-        ///@return pointer to the const match start offset vector
-        virtual VecOff const* getMatchStartOffsetVector() const {
-            return vec_soff;
+        ///Get the number of entries evicted to stay within the byte budget.
+        ///@return eviction count.
+        SIZE_T getEvictionCount() const {
+            std::lock_guard<std::mutex> lock(mtx);
+            return eviction_count;
         }
 
-        ///Get pre-set match end offset vector pointer.
-        ///The pointer must be set with RegexMatch::setMatchEndOffsetVector() beforehand
-        ///for this to work i.e it is just a convenience method to get the pre-set vector pointer.
-        ///@return pointer to the const end offset vector
-        virtual VecOff const* getMatchEndOffsetVector() const {
-            return vec_eoff;
+        ///Reset hit, miss and eviction counters to zero.
+        ///@return Reference to the calling RegexCache object.
+        RegexCache& resetCounters(){
+            std::lock_guard<std::mutex> lock(mtx);
+            hit_count = miss_count = eviction_count = 0;
+            return *this;
         }
 
-        ///Get a pointer to the associated Regex object.
-        ///If no actual Regex object is associated, null is returned.
-        ///@return A pointer to the associated constant Regex object or null.
-        virtual Regex const * getRegexObject() const {
-            return re;
+        ///Remove all entries.
+        ///Regex objects that are using cached code are not affected.
+        ///@return Reference to the calling RegexCache object.
+        RegexCache& clear(){
+            std::lock_guard<std::mutex> lock(mtx);
+            lru.clear();
+            index.clear();
+            bytes = 0;
+            return *this;
         }
+    };
 
-        ///Get pointer to numbered substring vector.
-        ///@return Pointer to const numbered substring vector.
-        virtual VecNum const* getNumberedSubstringVector() const {
-            return vec_num;
+    /** Hands out JIT stacks to the threads that match with JIT compiled patterns.
+     *
+     * By default the JIT code runs on a 32K stack on the machine stack and patterns that need
+     * more fail with PCRE2_ERROR_JIT_STACKLIMIT. A RegexMatch, MatchEvaluator or RegexReplace object
+     * with a JitStackManager set (and no match context of its own) gets a match context from the manager
+     * whose JIT callback returns the JIT stack of the calling thread. The stack is created once with
+     * the start and maximum sizes (see setStartSize() and setMaxSize()) and PCRE2 grows it as needed,
+     * up to the maximum size, without performing the match again; a match that needs more fails with
+     * PCRE2_ERROR_JIT_STACKLIMIT.
+     *
+     * PCRE2 doesn't tell how much of a stack a match used, so the usage report is what the manager
+     * can see: the largest stack it reserved for a thread (getHighWaterMark()) and the number of matches
+     * that needed more than the maximum size (getStackLimitCount()). A nonzero limit count means
+     * setMaxSize() is too small for the patterns and subjects in use.
+     *
+     * Each thread gets its own stack and match context for each manager (no locking), they are created
+     * on first use and freed when the thread exits. The manager must outlive the objects that use it.
+     * Destroying the manager frees the stack of the calling thread only: the other threads keep theirs
+     * until they exit.
+     *
+     * ```cpp
+     * jp::JitStackManager& jsm = jp::JitStackManager::getGlobal();
+     * jp::Regex re("(a|b)*c", "S");
+     * jp::RegexMatch rm(&re);
+     * rm.setJitStackManager(&jsm).setSubject(long_subject).match();
+     * size_t failed = jsm.getStackLimitCount(); //matches that ran out of stack
+     * ```
+     */
+    class JitStackManager {
+
+        friend class RegexMatch;
+        friend class RegexReplace;
+
+        struct ThreadState {
+            JitStack *stack;
+            MatchContext *mcontext;
+            SIZE_T size; //maximum size of the stack
+
+            ThreadState():stack(0), mcontext(0), size(0){}
+
+            ~ThreadState(){
+                if(mcontext) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_context_free(mcontext);
+                if(stack) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_stack_free(stack);
+            }
+        };
+
+        //States of the calling thread, keyed by manager id.
+        //The last looked up state is remembered, as it's usually the one needed next.
+        struct Local {
+            std::map<SIZE_T, ThreadState> states;
+            SIZE_T last_id;
+            ThreadState *last;
+            Local():last_id(0), last(0){}
+        };
+
+        SIZE_T id;
+        std::atomic<SIZE_T> start_size;
+        std::atomic<SIZE_T> max_size;
+        std::atomic<SIZE_T> high_water;
+        std::atomic<SIZE_T> limit_count;
+
+        static Local& getLocal(){
+            static thread_local Local local;
+            return local;
+        }
+
+        static SIZE_T nextId(){
+            static std::atomic<SIZE_T> counter(0);
+            return ++counter;
+        }
+
+        static JitStack* getStack(void *data){
+            return static_cast<ThreadState*>(data)->stack;
+        }
+
+        ThreadState& getState(){
+            Local& local = getLocal();
+            if(local.last_id == id) return *local.last;
+            ThreadState& st = local.states[id];
+            if(!st.mcontext){
+                st.mcontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_context_create(0);
+                SIZE_T start = start_size, max = max_size;
+                st.stack = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_stack_create(start, max < start ? start : max, 0);
+                st.size = st.stack ? (max < start ? start : max) : 0;
+                SIZE_T hw = high_water;
+                while(st.size > hw && !high_water.compare_exchange_weak(hw, st.size));
+                //without a stack, the JIT code uses the default 32K machine stack
+                if(st.stack) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_stack_assign(st.mcontext, getStack, &st);
+            }
+            local.last_id = id;
+            local.last = &st;
+            return st;
         }
 
-        ///Get pointer to named substring vector.
-        ///@return Pointer to const named substring vector.
-        virtual VecNas const* getNamedSubstringVector() const {
-            return vec_nas;
+        //Counts a match that failed with PCRE2_ERROR_JIT_STACKLIMIT on a stack of this manager.
+        void countStackLimit(){
+            limit_count.fetch_add(1, std::memory_order_relaxed);
         }
 
-        ///Get pointer to name to number map vector.
-        ///@return Pointer to const name to number map vector.
-        virtual VecNtN const* getNameToNumberMapVector() const {
-            return vec_ntn;
+        //not copyable
+        JitStackManager(JitStackManager const &);
+        JitStackManager& operator=(JitStackManager const &);
+
+        public:
+
+        ///Constructor.
+        ///@param start Size of the stack a thread gets on its first match (default 32K).
+        ///@param max Maximum stack size a thread can grow to (default 8M).
+        JitStackManager(SIZE_T start = 32 * 1024, SIZE_T max = 8 * 1024 * 1024)
+        :id(nextId()), start_size(start), max_size(max < start ? start : max), high_water(0), limit_count(0){}
+
+        ///Destructor.
+        ///Frees the stack of the calling thread, stacks of other threads are freed when they exit.
+        ~JitStackManager(){
+            Local& local = getLocal();
+            local.states.erase(id);
+            if(local.last_id == id) local.last_id = 0;
         }
 
-        ///Set the associated regex object.
-        ///Null pointer unsets it.
-        ///Underlying data is not modified.
-        ///@param r Pointer to a Regex object.
-        ///@return Reference to the calling RegexMatch object.
-        virtual RegexMatch& setRegexObject(Regex const *r){
-            re = r;
-            return *this;
+        ///Get the global JitStackManager object.
+        ///@return Reference to the global JitStackManager object.
+        static JitStackManager& getGlobal(){
+            static JitStackManager jsm;
+            return jsm;
         }
 
-        /// Set a pointer to the numbered substring vector.
-        /// Null pointer unsets it.
-        ///
-        /// This vector will be filled with numbered (indexed) captured groups.
-        /// @param v pointer to the numbered substring vector
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setNumberedSubstringVector(VecNum* v) {
-            vec_num = v;
-            return *this;
+        ///Get the match context of the calling thread.
+        ///Its JIT callback returns the stack of the calling thread, it must not be used by other threads.
+        ///The memory is handled by the JitStackManager object.
+        ///@return Pointer to match context.
+        MatchContext* getMatchContext(){
+            return getState().mcontext;
         }
 
-        /// Set a pointer to the named substring vector.
-        /// Null pointer unsets it.
-        ///
-        /// This vector will be populated with named captured groups.
-        /// @param v pointer to the named substring vector
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setNamedSubstringVector(VecNas* v) {
-            vec_nas = v;
+        ///Set the size of the stack a thread gets on its first match.
+        ///Threads that already have a stack keep it.
+        ///@param size Stack size in bytes.
+        ///@return Reference to the calling JitStackManager object.
+        JitStackManager& setStartSize(SIZE_T size){
+            start_size = size;
             return *this;
         }
 
-        /// Set a pointer to the name to number map vector.
-        /// Null pointer unsets it.
-        ///
-        /// This vector will be populated with name to number map for captured groups.
-        /// @param v pointer to the name to number map vector
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setNameToNumberMapVector(VecNtN* v) {
-            vec_ntn = v;
-            return *this;
+        ///Get the size of the stack a thread gets on its first match.
+        ///@return Stack size in bytes.
+        SIZE_T getStartSize() const {
+            return start_size;
         }
 
-        /// Set the pointer to a vector to store the offsets where matches
-        /// start in the subject.
-        /// Null pointer unsets it.
-        /// @param v Pointer to a jpcre2::VecOff vector (std::vector<size_t>)
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setMatchStartOffsetVector(VecOff* v){
-            vec_soff = v;
+        ///Set the maximum size a stack can grow to.
+        ///Threads that already have a stack keep it.
+        ///@param size Stack size in bytes.
+        ///@return Reference to the calling JitStackManager object.
+        JitStackManager& setMaxSize(SIZE_T size){
+            max_size = size;
             return *this;
         }
 
-        /// Set the pointer to a vector to store the offsets where matches
-        /// end in the subject.
-        /// Null pointer unsets it.
-        /// @param v Pointer to a VecOff vector (std::vector<size_t>)
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setMatchEndOffsetVector(VecOff* v){
-            vec_eoff = v;
-            return *this;
+        ///Get the maximum size a stack can grow to.
+        ///@return Stack size in bytes.
+        SIZE_T getMaxSize() const {
+            return max_size;
         }
 
-        ///Set the subject string for match.
-        ///This makes a copy of the subject string.
-        /// @param s Subject string
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::setSubject()
-        virtual RegexMatch& setSubject(StringView s) {
-            m_subject = s;
-            return *this;
+        ///Get the maximum size of the stack of the calling thread.
+        ///@return Stack size in bytes (0 if the thread didn't use this manager yet).
+        SIZE_T getStackSize() const {
+            Local& local = getLocal();
+            typename std::map<SIZE_T, ThreadState>::const_iterator it = local.states.find(id);
+            return it == local.states.end() ? 0 : it->second.size;
         }
 
-        /// Set the modifier (resets all JPCRE2 and PCRE2 options) by calling RegexMatch::changeModifier().
-        /// Re-initializes the option bits for PCRE2 and JPCRE2 options, then parses the modifier to set their equivalent options.
-        /// @param s Modifier string.
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::setModifier()
-        /// @see Regex::setModifier()
-        virtual RegexMatch& setModifier(Modifier const& s) {
-            match_opts = 0;
-            jpcre2_match_opts = 0;
-            changeModifier(s, true);
-            return *this;
+        ///Get the size of the largest stack created for any thread.
+        ///This is the maximum size the stack was created with, not the memory a match used:
+        ///PCRE2 grows the stack on its own and doesn't report how much of it was used.
+        ///@return Stack size in bytes (0 if no thread used this manager yet).
+        SIZE_T getHighWaterMark() const {
+            return high_water;
         }
 
-        ///Set a custom modifier table to be used.
-        ///@param mdt pointer to ModifierTable object.
-        ///@return Reference to the calling RegexMatch object.
-        virtual RegexMatch& setModifierTable(ModifierTable const * mdt){
-            modtab = mdt;
-            return *this;
+        ///Get the number of matches that failed with PCRE2_ERROR_JIT_STACKLIMIT on a stack of this manager,
+        ///that is matches that needed a stack bigger than the maximum size.
+        ///Matches with a match context set by the user are not counted.
+        ///@return Stack limit count.
+        SIZE_T getStackLimitCount() const {
+            return limit_count.load(std::memory_order_relaxed);
         }
 
-        /// Set JPCRE2 option for match (resets all)
-        /// @param x Option value
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::setJpcre2Option()
-        /// @see Regex::setJpcre2Option()
-        virtual RegexMatch& setJpcre2Option(Uint x) {
-            jpcre2_match_opts = x;
+        ///Reset the high water mark and the stack limit count to zero.
+        ///The high water mark is then updated by the stacks created afterwards.
+        ///@return Reference to the calling JitStackManager object.
+        JitStackManager& resetCounters(){
+            high_water = 0;
+            limit_count = 0;
             return *this;
         }
+    };
 
-        ///Set PCRE2 option match (overwrite existing option)
-        /// @param x Option value
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::setPcre2Option()
-        /// @see Regex::setPcre2Option()
-        virtual RegexMatch& setPcre2Option(Uint x) {
-            match_opts = x;
-            return *this;
-        }
+    /** Provides public constructors to create RegexMatch objects.
+     * Every RegexMatch object should be associated with a Regex object.
+     * This class stores a pointer to its' associated Regex object, thus when
+     * the content of the associated Regex object is changed, there will be no need to
+     * set the pointer again.
+     *
+     * Examples:
+     *
+     * ```cpp
+     * jp::Regex re;
+     * jp::RegexMatch rm;
+     * rm.setRegexObject(&re);
+     * rm.match("subject", "g");  // 0 match
+     * re.compile("\\w");
+     * rm.match();  // 7 matches
+     * ```
+     */
+    class RegexMatch {
 
-        /// Set whether to perform global match
-        /// @param x True or False
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setFindAll(bool x) {
-            jpcre2_match_opts = x?jpcre2_match_opts | FIND_ALL:jpcre2_match_opts & ~FIND_ALL;
-            return *this;
-        }
+    private:
 
-        ///@overload
-        ///...
-        ///This function just calls RegexMatch::setFindAll(bool x) with `true` as the parameter
-        ///@return Reference to the calling RegexMatch object
-        virtual RegexMatch& setFindAll() {
-            return setFindAll(true);
-        }
+        friend class MatchEvaluator;
+        friend class MatchRange;
+        friend class RegexReplace;
 
-        /// Set offset from where match starts.
-        /// When FIND_ALL is set, a global match would not be performed on all positions on the subject,
-        /// rather it will be performed from the start offset and onwards.
-        /// @param offset Start offset
-        /// @return Reference to the calling RegexMatch object
-        virtual RegexMatch& setStartOffset(PCRE2_SIZE offset) {
-            _start_offset = offset;
-            return *this;
-        }
+        Regex const *re;
 
-        ///Set the match context.
-        ///You can create match context using the native PCRE2 API.
-        ///The memory is not handled by RegexMatch object and not freed.
-        ///User will be responsible for freeing the memory of the match context.
-        ///@param match_context Pointer to the match context.
-        ///@return Reference to the calling RegexMatch object
-        virtual RegexMatch& setMatchContext(MatchContext *match_context){
-            mcontext = match_context;
-            return *this;
-        }
+        StringView m_subject;
+        Uint match_opts;
+        Uint jpcre2_match_opts;
+        MatchContext *mcontext;
+        JitStackManager *jit_stack_manager;
+        ModifierTable const * modtab;
+        MatchData * mdata;
 
-        ///Return pointer to the match context that was previously set with setMatchContext().
-        ///Handling memory is the callers' responsibility.
-        ///@return pointer to the match context (default: null).
-        virtual MatchContext* getMatchContext(){
-            return mcontext;
-        }
+        PCRE2_SIZE _start_offset; //name collision, use _ at start
 
-        ///Set the match data block to be used.
-        ///The memory is not handled by RegexMatch object and not freed.
-        ///User will be responsible for freeing the memory of the match data block.
-        ///@param madt Pointer to a match data block.
-        ///@return Reference to the calling RegexMatch object
-        virtual RegexMatch& setMatchDataBlock(MatchData* madt){
-            mdata = madt;
-            return *this;
-        }
+        VecNum* vec_num;
+        VecNas* vec_nas;
+        VecNtN* vec_ntn;
 
-        ///Get the pointer to the match data block that was set previously with setMatchData()
-        ///Handling memory is the callers' responsibility.
-        ///@return pointer to the match data (default: null).
-        virtual MatchData* getMatchDataBlock(){
-            return mdata;
-        }
+        VecOff* vec_soff;
+        VecOff* vec_eoff;
 
-        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
-        /// This function does not initialize or re-initialize options.
-        /// If you want to set options from scratch, initialize them to 0 before calling this function.
-        /// If invalid modifier is detected, then the error number for the RegexMatch
-        /// object will be jpcre2::ERROR::INVALID_MODIFIER and error offset will be the modifier character.
-        /// You can get the message with RegexMatch::getErrorMessage() function.
-        ///
-        /// @param mod Modifier string.
-        /// @param x Whether to add or remove option
-        /// @return Reference to the RegexMatch object
-        /// @see Regex::changeModifier()
-        /// @see RegexReplace::changeModifier()
-        virtual RegexMatch& changeModifier(Modifier const& mod, bool x){
-            modtab ? modtab->toMatchOption(mod, x, &match_opts, &jpcre2_match_opts, &error_number, &error_offset)
-                   : MOD::toMatchOption(mod, x, &match_opts, &jpcre2_match_opts, &error_number, &error_offset);
-            return *this;
+        MatchSpan* span_buf;
+        SIZE_T span_cap;
+        bool span_more;
+
+        MatchTable* match_table;
+
+        //Called by match() after each match has been stored in the vectors, with the match data block
+        //that holds the match, matching stops if it returns false.
+        //Set by MatchEvaluator for the duration of a replace that performs a new match.
+        bool (*match_hook)(void*, MatchData*);
+        void* match_hook_data;
+
+        bool getNumberedSubstrings(int, Pcre2Sptr, PCRE2_SIZE*, uint32_t);
+
+        bool getNamedSubstrings(Pcre2Sptr, PCRE2_SIZE*);
+
+        //Match options that pcre2_jit_match() doesn't handle the way pcre2_match() does.
+        static Uint jitIncompatibleOptions(){
+            Uint opts = PCRE2_ANCHORED | PCRE2_PARTIAL_HARD | PCRE2_PARTIAL_SOFT;
+            #ifdef PCRE2_ENDANCHORED
+            opts |= PCRE2_ENDANCHORED;
+            #endif
+            #ifdef PCRE2_NO_JIT
+            opts |= PCRE2_NO_JIT;
+            #endif
+            #ifdef PCRE2_COPY_MATCHED_SUBJECT
+            opts |= PCRE2_COPY_MATCHED_SUBJECT;
+            #endif
+            return opts;
         }
 
-        /// Add or remove a JPCRE2 option
-        /// @param opt JPCRE2 option value
-        /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::changeJpcre2Option()
-        /// @see Regex::changeJpcre2Option()
-        virtual RegexMatch& changeJpcre2Option(Uint opt, bool x) {
-            jpcre2_match_opts = x ? jpcre2_match_opts | opt : jpcre2_match_opts & ~opt;
-            return *this;
+        //Match context passed to PCRE2: the one set by the user, or the one of the JitStackManager for the calling thread.
+        MatchContext* getActiveMatchContext() const {
+            if(mcontext || !jit_stack_manager) return mcontext;
+            return jit_stack_manager->getMatchContext();
         }
 
-        /// Add or remove a PCRE2 option
-        /// @param opt PCRE2 option value
-        /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::changePcre2Option()
-        /// @see Regex::changePcre2Option()
-        virtual RegexMatch& changePcre2Option(Uint opt, bool x) {
-            match_opts = x ? match_opts | opt : match_opts & ~opt;
-            return *this;
+        //Reports a match that ran out of the stack of the JitStackManager to it.
+        void countJitStackLimit(int rc) const {
+            if(rc == PCRE2_ERROR_JIT_STACKLIMIT && !mcontext && jit_stack_manager) jit_stack_manager->countStackLimit();
         }
 
-        /// Parse modifier string and add equivalent PCRE2 and JPCRE2 options.
-        /// This is just a wrapper of the original function RegexMatch::changeModifier()
-        /// @param mod Modifier string.
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::addModifier()
-        /// @see Regex::addModifier()
-        virtual RegexMatch& addModifier(Modifier const& mod){
-            return changeModifier(mod, true);
+        //Workspace of pcre2_dfa_match() for the calling thread, grown when a match runs out of it.
+        static std::vector<int>& dfaWorkspace(){
+            static thread_local std::vector<int> ws(1024);
+            return ws;
         }
 
-        /// Add option to existing JPCRE2 options for match
-        /// @param x Option value
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::addJpcre2Option()
-        /// @see Regex::addJpcre2Option()
-        virtual RegexMatch& addJpcre2Option(Uint x) {
-            jpcre2_match_opts |= x;
-            return *this;
+        //DFA matching: the longest match at the first matching position is left in the first pair
+        //of the ovector, the other pairs are unset as there are no captures.
+        int dfaMatch(Pcre2Sptr subject, PCRE2_SIZE length, PCRE2_SIZE offset, Uint options, MatchData* md) const {
+            std::vector<int>& ws = dfaWorkspace();
+            int rc;
+            for(;;){
+                rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::dfa_match(re->code, subject, length, offset, options, md,
+                                                                       getActiveMatchContext(), &ws[0], ws.size());
+                if(rc != PCRE2_ERROR_DFA_WSSIZE || ws.size() >= ((SIZE_T)1 << 24)) break; //64MB of ints at most
+                ws.resize(ws.size() * 2);
+            }
+            if(rc < 0) return rc;
+            PCRE2_SIZE *ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(md);
+            uint32_t count = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_count(md);
+            for(uint32_t i = 2; i < 2 * count; ++i) ovector[i] = PCRE2_UNSET;
+            return 1; //0 means the ovector couldn't hold all the (shorter) alternative matches
+        }
+
+        //Calls pcre2_jit_match() if jit is true and the options allow it, pcre2_match() otherwise.
+        //pcre2_jit_match() skips the option and UTF checks of pcre2_match().
+        //With DFA_MATCH pcre2_dfa_match() is used instead.
+        int pcre2Match(bool jit, Pcre2Sptr subject, PCRE2_SIZE length, PCRE2_SIZE offset, Uint options, MatchData* md) const {
+            if((jpcre2_match_opts & DFA_MATCH) != 0) return dfaMatch(subject, length, offset, options, md);
+            MatchContext *mc = getActiveMatchContext();
+            int rc;
+            if(jit && (options & jitIncompatibleOptions()) == 0)
+                rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_match(re->code, subject, length, offset, options, md, mc);
+            else
+                rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match(re->code, subject, length, offset, options, md, mc);
+            countJitStackLimit(rc);
+            return rc;
         }
 
-        /// Add option to existing PCRE2 options for match
-        /// @param x Option value
-        /// @return Reference to the calling RegexMatch object
-        /// @see RegexReplace::addPcre2Option()
-        /// @see Regex::addPcre2Option()
-        virtual RegexMatch& addPcre2Option(Uint x) {
-            match_opts |= x;
-            return *this;
+        void init_vars() {
+            re = 0;
+            vec_num = 0;
+            vec_nas = 0;
+            vec_ntn = 0;
+            vec_soff = 0;
+            vec_eoff = 0;
+            span_buf = 0;
+            span_cap = 0;
+            span_more = false;
+            match_table = 0;
+            match_hook = 0;
+            match_hook_data = 0;
+            match_opts = 0;
+            jpcre2_match_opts = 0;
+            error_number = 0;
+            error_offset = 0;
+            _start_offset = 0;
+            m_subject = {};
+            mcontext = 0;
+            jit_stack_manager = 0;
+            modtab = 0;
+            mdata = 0;
         }
 
+        void onlyCopy(RegexMatch const &rm){
+            re = rm.re; //only pointer should be copied
 
-        /// Perform match operation using info from class variables and return the match count and
-        /// store the results in specified vectors.
-        ///
-        /// Note: This function uses pcre2_match() function to do the match.
-        ///@return Match count
-        virtual SIZE_T match(void);
-    };
+            m_subject = rm.m_subject;
 
+            //underlying data of vectors are not handled by RegexMatch
+            //thus it's safe to just copy the pointers.
+            vec_num = rm.vec_num;
+            vec_nas = rm.vec_nas;
+            vec_ntn = rm.vec_ntn;
+            vec_soff = rm.vec_soff;
+            vec_eoff = rm.vec_eoff;
+            span_buf = rm.span_buf;
+            span_cap = rm.span_cap;
+            span_more = rm.span_more;
+            match_table = rm.match_table;
+            //the hook is bound to the object that runs the match.
+            match_hook = 0;
+            match_hook_data = 0;
 
-    ///This class contains a typedef of a function pointer or a templated function wrapper (`std::function`)
-    ///to provide callback function to the `MatchEvaluator`.
-    ///`std::function` is used when `>=C++11` is being used , otherwise function pointer is used.
-    ///You can force using function pointer instead of `std::function` when `>=C++11` is used by defining  the macro
+            match_opts = rm.match_opts;
+            jpcre2_match_opts = rm.jpcre2_match_opts;
+            error_number = rm.error_number;
+            error_offset = rm.error_offset;
+            _start_offset = rm._start_offset;
+            mcontext = rm.mcontext;
+            jit_stack_manager = rm.jit_stack_manager;
+            modtab = rm.modtab;
+            mdata = rm.mdata;
+        }
+
+        void deepCopy(RegexMatch const &rm){
+            onlyCopy(rm);
+        }
+
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+        void deepMove(RegexMatch& rm){
+            onlyCopy(rm);
+        }
+        #endif
+
+        friend class Regex;
+
+        protected:
+
+        int error_number;
+        PCRE2_SIZE error_offset;
+
+    public:
+
+        ///Default constructor.
+        RegexMatch(){
+            init_vars();
+        }
+
+        ///@overload
+        ///...
+        ///Creates a RegexMatch object associating a Regex object.
+        ///Underlying data is not modified.
+        ///@param r pointer to a Regex object
+        RegexMatch(Regex const *r) {
+            init_vars();
+            re = r;
+        }
+
+        ///@overload
+        ///...
+        ///Copy constructor.
+        ///@param rm Reference to RegexMatch object
+        RegexMatch(RegexMatch const &rm){
+            init_vars();
+            deepCopy(rm);
+        }
+
+        ///Overloaded copy-assignment operator.
+        ///@param rm RegexMatch object
+        ///@return A reference to the calling RegexMatch object.
+        virtual RegexMatch& operator=(RegexMatch const &rm){
+            if(this == &rm) return *this;
+            deepCopy(rm);
+            return *this;
+        }
+
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+        ///@overload
+        ///...
+        ///Move constructor.
+        ///This constructor steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param rm rvalue reference to a RegexMatch object
+        RegexMatch(RegexMatch&& rm){
+            init_vars();
+            deepMove(rm);
+        }
+
+        ///@overload
+        ///...
+        ///Overloaded move-assignment operator.
+        ///This constructor steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param rm rvalue reference to a RegexMatch object
+        ///@return A reference to the calling RegexMatch object.
+        virtual RegexMatch& operator=(RegexMatch&& rm){
+            if(this == &rm) return *this;
+            deepMove(rm);
+            return *this;
+        }
+        #endif
+
+        ///Destructor
+        ///Frees all internal memories that were used.
+        virtual ~RegexMatch() {}
+
+        ///Reset all class variables to its default (initial) state including memory.
+        ///Data in the vectors will retain (as it's external)
+        ///You will need to pass vector pointers again after calling this function to get match results.
+        ///@return Reference to the calling RegexMatch object.
+        virtual RegexMatch& reset() {
+            init_vars();
+            return *this;
+        }
+
+        ///Clear all class variables (may retain some memory for further use).
+        ///Data in the vectors will retain (as it's external)
+        ///You will need to pass vector pointers again after calling this function to get match results.
+        ///@return Reference to the calling RegexMatch object.
+        virtual RegexMatch& clear(){
+            init_vars();
+            return *this;
+        }
+
+        ///reset match related errors to zero.
+        ///If you want to examine the error status of a function call in the method chain,
+        ///add this function just before your target function so that the error is set to zero
+        ///before that target function is called, and leave everything out after the target
+        ///function so that there will be no additional errors from other function calls.
+        ///@return A reference to the RegexMatch object
+        ///@see Regex::resetErrors()
+        ///@see RegexReplace::resetErrors()
+        virtual RegexMatch& resetErrors(){
+            error_number = 0;
+            error_offset = 0;
+            return *this;
+        }
+
+        /// Returns the last error number
+        ///@return Last error number
+        virtual int getErrorNumber() const {
+            return error_number;
+        }
+
+        /// Returns the last error offset
+        ///@return Last error offset
+        virtual int getErrorOffset() const  {
+            return (int)error_offset;
+        }
+
+        /// Returns the last error message
+        ///@return Last error message
+        virtual String getErrorMessage() const  {
+            #ifdef JPCRE2_USE_MINIMUM_CXX_11
+            return select<Char, Map>::getErrorMessage(error_number, error_offset);
+            #else
+            return select<Char>::getErrorMessage(error_number, error_offset);
+            #endif
+        }
+
+        ///Get subject string (by value).
+        ///@return subject string
+        ///@see RegexReplace::getSubject()
+        virtual StringView getSubject() const  {
+            return m_subject;
+        }
+
+
+        /// Calculate modifier string from PCRE2 and JPCRE2 options and return it.
+        ///
+        /// Do remember that modifiers (or PCRE2 and JPCRE2 options) do not change or get initialized
+        /// as long as you don't do that explicitly. Calling RegexMatch::setModifier() will re-set them.
+        ///
+        /// **Mixed or combined modifier**.
+        ///
+        /// Some modifier may include other modifiers i.e they have the same meaning of some modifiers
+        /// combined together. For example, the 'n' modifier includes the 'u' modifier and together they
+        /// are equivalent to `PCRE2_UTF | PCRE2_UCP`. When you set a modifier like this, both options
+        /// get set, and when you remove the 'n' modifier (with `RegexMatch::changeModifier()`), both will get removed.
+        ///@return Calculated modifier string (std::string)
+        ///@see Regex::getModifier()
+        ///@see RegexReplace::getModifier()
+        virtual std::string getModifier() const {
+            return modtab ? modtab->fromMatchOption(match_opts, jpcre2_match_opts)
+                          : MOD::fromMatchOption(match_opts, jpcre2_match_opts);
+        }
+
+        ///Get the modifier table that is set,
+        ///@return pointer to constant ModifierTable.
+        virtual ModifierTable const* getModifierTable(){
+            return modtab;
+        }
+
+
+        ///Get PCRE2 option
+        ///@return PCRE2 option for match operation
+        ///@see Regex::getPcre2Option()
+        ///@see RegexReplace::getPcre2Option()
+        virtual Uint getPcre2Option() const  {
+            return match_opts;
+        }
+
+        /// Get JPCRE2 option
+        ///@return JPCRE2 options for math operation
+        ///@see Regex::getJpcre2Option()
+        ///@see RegexReplace::getJpcre2Option()
+        virtual Uint getJpcre2Option() const  {
+            return jpcre2_match_opts;
+        }
+
+        /// Get offset from where match will start in the subject.
+        /// @return Start offset
+        virtual PCRE2_SIZE getStartOffset() const  {
+            return _start_offset;
+        }
+
+        ///Get pre-set match start offset vector pointer.
+        ///The pointer must be set with RegexMatch::setMatchStartOffsetVector() beforehand
+        ///for this to work i.e it is just a convenience method to get the pre-set vector pointer.
+        ///@return pointer to the const match start offset vector
+        virtual VecOff const* getMatchStartOffsetVector() const {
+            return vec_soff;
+        }
+
+        ///Get pre-set match end offset vector pointer.
+        ///The pointer must be set with RegexMatch::setMatchEndOffsetVector() beforehand
+        ///for this to work i.e it is just a convenience method to get the pre-set vector pointer.
+        ///@return pointer to the const end offset vector
+        virtual VecOff const* getMatchEndOffsetVector() const {
+            return vec_eoff;
+        }
+
+        ///Get the buffer set with setMatchSpanBuffer().
+        ///@return pointer to the match span buffer or null.
+        MatchSpan const* getMatchSpanBuffer() const {
+            return span_buf;
+        }
+
+        ///Check whether the last match() stopped because the match span buffer was full.
+        ///@return true if there are more matches than the buffer could hold.
+        bool hasMoreMatches() const {
+            return span_more;
+        }
+
+        ///Get pre-set match table pointer.
+        ///@return pointer to the match table or null.
+        MatchTable* getMatchTable() const {
+            return match_table;
+        }
+
+        ///Get a pointer to the associated Regex object.
+        ///If no actual Regex object is associated, null is returned.
+        ///@return A pointer to the associated constant Regex object or null.
+        virtual Regex const * getRegexObject() const {
+            return re;
+        }
+
+        ///Get pointer to numbered substring vector.
+        ///@return Pointer to const numbered substring vector.
+        virtual VecNum const* getNumberedSubstringVector() const {
+            return vec_num;
+        }
+
+        ///Get pointer to named substring vector.
+        ///@return Pointer to const named substring vector.
+        virtual VecNas const* getNamedSubstringVector() const {
+            return vec_nas;
+        }
+
+        ///Get pointer to name to number map vector.
+        ///@return Pointer to const name to number map vector.
+        virtual VecNtN const* getNameToNumberMapVector() const {
+            return vec_ntn;
+        }
+
+        ///Set the associated regex object.
+        ///Null pointer unsets it.
+        ///Underlying data is not modified.
+        ///@param r Pointer to a Regex object.
+        ///@return Reference to the calling RegexMatch object.
+        virtual RegexMatch& setRegexObject(Regex const *r){
+            re = r;
+            return *this;
+        }
+
+        /// Set a pointer to the numbered substring vector.
+        /// Null pointer unsets it.
+        ///
+        /// This vector will be filled with numbered (indexed) captured groups.
+        /// @param v pointer to the numbered substring vector
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setNumberedSubstringVector(VecNum* v) {
+            vec_num = v;
+            return *this;
+        }
+
+        /// Set a pointer to the named substring vector.
+        /// Null pointer unsets it.
+        ///
+        /// This vector will be populated with named captured groups.
+        /// @param v pointer to the named substring vector
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setNamedSubstringVector(VecNas* v) {
+            vec_nas = v;
+            return *this;
+        }
+
+        /// Set a pointer to the name to number map vector.
+        /// Null pointer unsets it.
+        ///
+        /// This vector will be populated with name to number map for captured groups.
+        /// @param v pointer to the name to number map vector
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setNameToNumberMapVector(VecNtN* v) {
+            vec_ntn = v;
+            return *this;
+        }
+
+        /// Set the pointer to a vector to store the offsets where matches
+        /// start in the subject.
+        /// Null pointer unsets it.
+        /// @param v Pointer to a jpcre2::VecOff vector (std::vector<size_t>)
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setMatchStartOffsetVector(VecOff* v){
+            vec_soff = v;
+            return *this;
+        }
+
+        /// Set the pointer to a vector to store the offsets where matches
+        /// end in the subject.
+        /// Null pointer unsets it.
+        /// @param v Pointer to a VecOff vector (std::vector<size_t>)
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setMatchEndOffsetVector(VecOff* v){
+            vec_eoff = v;
+            return *this;
+        }
+
+        /// Set a caller owned buffer to store the start and end offsets of the matches.
+        /// match() writes one MatchSpan per match and stops when the buffer is full
+        /// (the return value is then the number of spans written), hasMoreMatches()
+        /// tells whether matching stopped early. When no substring vector is set,
+        /// the match data block taken from the pool only holds the overall match,
+        /// thus a global match doesn't allocate anything once the pool is warm.
+        ///
+        /// ```cpp
+        /// jpcre2::MatchSpan spans[16];
+        /// jpcre2::SIZE_T n = rm.setMatchSpanBuffer(spans, 16).setFindAll().match();
+        /// if(rm.hasMoreMatches()) ... // more than 16 matches
+        /// ```
+        /// Null pointer unsets it.
+        /// @param buf Pointer to an array of MatchSpan
+        /// @param capacity Number of elements in the array
+        /// @return Reference to the calling RegexMatch object
+        RegexMatch& setMatchSpanBuffer(MatchSpan* buf, SIZE_T capacity){
+            span_buf = buf;
+            span_cap = buf ? capacity : 0;
+            return *this;
+        }
+
+        /// Set a MatchTable to store the offsets of all captured groups of all matches.
+        /// It is a flat alternative to the numbered substring vector: no allocation per match.
+        /// Null pointer unsets it.
+        /// @param table Pointer to a MatchTable object
+        /// @return Reference to the calling RegexMatch object
+        /// @see MatchTable
+        RegexMatch& setMatchTable(MatchTable* table){
+            match_table = table;
+            return *this;
+        }
+
+        ///Set the subject string for match.
+        ///This makes a copy of the subject string.
+        /// @param s Subject string
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::setSubject()
+        virtual RegexMatch& setSubject(StringView s) {
+            m_subject = s;
+            return *this;
+        }
+
+        /// Set the modifier (resets all JPCRE2 and PCRE2 options) by calling RegexMatch::changeModifier().
+        /// Re-initializes the option bits for PCRE2 and JPCRE2 options, then parses the modifier to set their equivalent options.
+        /// @param s Modifier string.
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::setModifier()
+        /// @see Regex::setModifier()
+        virtual RegexMatch& setModifier(Modifier const& s) {
+            match_opts = 0;
+            jpcre2_match_opts = 0;
+            changeModifier(s, true);
+            return *this;
+        }
+
+        ///Set a custom modifier table to be used.
+        ///@param mdt pointer to ModifierTable object.
+        ///@return Reference to the calling RegexMatch object.
+        virtual RegexMatch& setModifierTable(ModifierTable const * mdt){
+            modtab = mdt;
+            return *this;
+        }
+
+        /// Set JPCRE2 option for match (resets all)
+        /// @param x Option value
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::setJpcre2Option()
+        /// @see Regex::setJpcre2Option()
+        virtual RegexMatch& setJpcre2Option(Uint x) {
+            jpcre2_match_opts = x;
+            return *this;
+        }
+
+        ///Set PCRE2 option match (overwrite existing option)
+        /// @param x Option value
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::setPcre2Option()
+        /// @see Regex::setPcre2Option()
+        virtual RegexMatch& setPcre2Option(Uint x) {
+            match_opts = x;
+            return *this;
+        }
+
+        /// Set whether to perform global match
+        /// @param x True or False
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setFindAll(bool x) {
+            jpcre2_match_opts = x?jpcre2_match_opts | FIND_ALL:jpcre2_match_opts & ~FIND_ALL;
+            return *this;
+        }
+
+        ///@overload
+        ///...
+        ///This function just calls RegexMatch::setFindAll(bool x) with `true` as the parameter
+        ///@return Reference to the calling RegexMatch object
+        virtual RegexMatch& setFindAll() {
+            return setFindAll(true);
+        }
+
+        /// Set whether to match with the DFA algorithm (`pcre2_dfa_match()`).
+        /// The DFA matcher doesn't backtrack, its running time doesn't blow up on patterns with
+        /// heavy alternation. It finds the longest match at the first position where there is one and
+        /// doesn't set captures: only the whole match (group 0) is set in the result vectors.
+        /// Patterns with back references, recursion, conditions on groups and some other items can't
+        /// be matched this way, the match fails with `PCRE2_ERROR_DFA_UITEM` (or a similar error number).
+        /// The workspace is kept per thread and grows on `PCRE2_ERROR_DFA_WSSIZE`.
+        /// Equivalent to the `d` modifier or the jpcre2::DFA_MATCH option.
+        /// @param x True or False
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setDfaMatch(bool x) {
+            jpcre2_match_opts = x?jpcre2_match_opts | DFA_MATCH:jpcre2_match_opts & ~DFA_MATCH;
+            return *this;
+        }
+
+        ///@overload
+        ///...
+        ///This function just calls RegexMatch::setDfaMatch(bool x) with `true` as the parameter
+        ///@return Reference to the calling RegexMatch object
+        virtual RegexMatch& setDfaMatch() {
+            return setDfaMatch(true);
+        }
+
+        /// Get the size of the DFA workspace of the calling thread.
+        /// @return Number of ints.
+        static SIZE_T getDfaWorkspaceSize(){
+            return dfaWorkspace().size();
+        }
+
+        /// Set offset from where match starts.
+        /// When FIND_ALL is set, a global match would not be performed on all positions on the subject,
+        /// rather it will be performed from the start offset and onwards.
+        /// @param offset Start offset
+        /// @return Reference to the calling RegexMatch object
+        virtual RegexMatch& setStartOffset(PCRE2_SIZE offset) {
+            _start_offset = offset;
+            return *this;
+        }
+
+        ///Set the match context.
+        ///You can create match context using the native PCRE2 API.
+        ///The memory is not handled by RegexMatch object and not freed.
+        ///User will be responsible for freeing the memory of the match context.
+        ///@param match_context Pointer to the match context.
+        ///@return Reference to the calling RegexMatch object
+        virtual RegexMatch& setMatchContext(MatchContext *match_context){
+            mcontext = match_context;
+            return *this;
+        }
+
+        ///Return pointer to the match context that was previously set with setMatchContext().
+        ///Handling memory is the callers' responsibility.
+        ///@return pointer to the match context (default: null).
+        virtual MatchContext* getMatchContext(){
+            return mcontext;
+        }
+
+        ///Set the JitStackManager that provides JIT stacks for the matches.
+        ///It is used only when no match context is set with setMatchContext().
+        ///The JitStackManager object must outlive the RegexMatch object.
+        ///@param jsm Pointer to JitStackManager object (null to not use one).
+        ///@return Reference to the calling RegexMatch object
+        ///@see JitStackManager
+        virtual RegexMatch& setJitStackManager(JitStackManager *jsm){
+            jit_stack_manager = jsm;
+            return *this;
+        }
+
+        ///Get the JitStackManager that was set with setJitStackManager().
+        ///@return Pointer to JitStackManager object (default: null).
+        JitStackManager* getJitStackManager() const {
+            return jit_stack_manager;
+        }
+
+        ///Set the match data block to be used.
+        ///The memory is not handled by RegexMatch object and not freed.
+        ///User will be responsible for freeing the memory of the match data block.
+        ///If no match data block is set, a block from the thread local MatchDataPool is used.
+        ///@param madt Pointer to a match data block.
+        ///@return Reference to the calling RegexMatch object
+        virtual RegexMatch& setMatchDataBlock(MatchData* madt){
+            mdata = madt;
+            return *this;
+        }
+
+        ///Get the pointer to the match data block that was set previously with setMatchData()
+        ///Handling memory is the callers' responsibility.
+        ///@return pointer to the match data (default: null).
+        virtual MatchData* getMatchDataBlock(){
+            return mdata;
+        }
+
+        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
+        /// This function does not initialize or re-initialize options.
+        /// If you want to set options from scratch, initialize them to 0 before calling this function.
+        /// If invalid modifier is detected, then the error number for the RegexMatch
+        /// object will be jpcre2::ERROR::INVALID_MODIFIER and error offset will be the modifier character.
+        /// You can get the message with RegexMatch::getErrorMessage() function.
+        ///
+        /// @param mod Modifier string.
+        /// @param x Whether to add or remove option
+        /// @return Reference to the RegexMatch object
+        /// @see Regex::changeModifier()
+        /// @see RegexReplace::changeModifier()
+        virtual RegexMatch& changeModifier(Modifier const& mod, bool x){
+            modtab ? modtab->toMatchOption(mod, x, &match_opts, &jpcre2_match_opts, &error_number, &error_offset)
+                   : MOD::toMatchOption(mod, x, &match_opts, &jpcre2_match_opts, &error_number, &error_offset);
+            return *this;
+        }
+
+        /// Add or remove a JPCRE2 option
+        /// @param opt JPCRE2 option value
+        /// @param x Add the option if it's true, remove otherwise.
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::changeJpcre2Option()
+        /// @see Regex::changeJpcre2Option()
+        virtual RegexMatch& changeJpcre2Option(Uint opt, bool x) {
+            jpcre2_match_opts = x ? jpcre2_match_opts | opt : jpcre2_match_opts & ~opt;
+            return *this;
+        }
+
+        /// Add or remove a PCRE2 option
+        /// @param opt PCRE2 option value
+        /// @param x Add the option if it's true, remove otherwise.
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::changePcre2Option()
+        /// @see Regex::changePcre2Option()
+        virtual RegexMatch& changePcre2Option(Uint opt, bool x) {
+            match_opts = x ? match_opts | opt : match_opts & ~opt;
+            return *this;
+        }
+
+        /// Parse modifier string and add equivalent PCRE2 and JPCRE2 options.
+        /// This is just a wrapper of the original function RegexMatch::changeModifier()
+        /// @param mod Modifier string.
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::addModifier()
+        /// @see Regex::addModifier()
+        virtual RegexMatch& addModifier(Modifier const& mod){
+            return changeModifier(mod, true);
+        }
+
+        /// Add option to existing JPCRE2 options for match
+        /// @param x Option value
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::addJpcre2Option()
+        /// @see Regex::addJpcre2Option()
+        virtual RegexMatch& addJpcre2Option(Uint x) {
+            jpcre2_match_opts |= x;
+            return *this;
+        }
+
+        /// Add option to existing PCRE2 options for match
+        /// @param x Option value
+        /// @return Reference to the calling RegexMatch object
+        /// @see RegexReplace::addPcre2Option()
+        /// @see Regex::addPcre2Option()
+        virtual RegexMatch& addPcre2Option(Uint x) {
+            match_opts |= x;
+            return *this;
+        }
+
+
+        /// Perform match operation using info from class variables and return the match count and
+        /// store the results in specified vectors.
+        ///
+        /// Note: This function uses pcre2_match() function to do the match, or pcre2_jit_match()
+        /// when the pattern is JIT compiled (see Regex::isJitCompiled()).
+        ///@return Match count
+        virtual SIZE_T match(void);
+
+        /// Perform a global match on several threads.
+        /// The subject (from the start offset) is cut into chunks that start right after a `separator`
+        /// character, the chunks are matched with FIND_ALL on a pool of threads that take the next
+        /// chunk as soon as they're done with one, and the results are merged in subject order into the
+        /// vectors, span buffer and match table set on this object.
+        ///
+        /// Each chunk is matched against the whole subject from its start, up to the first match that
+        /// starts in the next chunk, so lookbehinds, lookaheads, `^`, `$` and `\Z` see the text around it
+        /// and the result is the same as match() with FIND_ALL. A match that runs past the end of its chunk
+        /// makes the next chunk be matched again from the end of that match, on the calling thread:
+        /// this is meant for patterns whose matches don't cross a separator (e.g lines of a log).
+        /// The search for the last match of a chunk may look past its end, up to the next match.
+        /// Subjects shorter than two chunks are matched by match() on the calling thread.
+        ///
+        /// The match data block set with setMatchDataBlock() is not used, a match context set with
+        /// setMatchContext() is shared by the threads: it must not have a JIT stack assigned
+        /// (use a JitStackManager instead).
+        /// @param threads Number of threads, 0 for std::thread::hardware_concurrency().
+        /// @param separator Character after which a chunk may start.
+        /// @param min_chunk Minimum chunk size in code units.
+        /// @return Match count
+        SIZE_T parallelMatch(SIZE_T threads = 0, Char_T separator = '\n', SIZE_T min_chunk = 65536);
+
+        /// @overload
+        /// ...
+        /// The chunks start at the offsets given by the caller (safe boundaries: no match crosses them).
+        /// @param boundaries Offsets in the subject where a chunk may start, in ascending order.
+        /// Offsets outside of (start offset, subject length) are ignored.
+        /// @param threads Number of threads, 0 for std::thread::hardware_concurrency().
+        /// @return Match count
+        SIZE_T parallelMatch(VecOff const& boundaries, SIZE_T threads = 0);
+
+        /// Get a range that performs the matches lazily, one at a time while it is iterated.
+        /// The range copies the settings of this object, vectors and match data block are not used.
+        /// @return MatchRange object.
+        /// @see MatchRange
+        MatchRange matches() const;
+    };
+
+    /** Read only view of the ovector of one match, as yielded by MatchRange.
+     * It points into the match data block of the range and the subject string,
+     * thus it is valid only until the iterator is advanced.
+     *
+     * Group 0 is the whole match, groups that did not participate in the match are unset
+     * and yield an empty StringView.
+     */
+    class MatchView {
+
+        friend class MatchRange;
+
+        Char_T const *subject;
+        PCRE2_SIZE const *ovector;
+        SIZE_T count;
+        CompiledCode const *cc;
+
+        MatchView():subject(0), ovector(0), count(0), cc(0){}
+
+        public:
+
+        ///Get the number of groups in the ovector (highest group that was set + 1).
+        ///@return Group count.
+        SIZE_T size() const {
+            return count;
+        }
+
+        ///Check whether a group participated in the match.
+        ///@param i Group number.
+        ///@return true if the group is set.
+        bool isSet(SIZE_T i) const {
+            return i < count && ovector[2*i] != PCRE2_UNSET;
+        }
+
+        ///Get the offset where a group starts in the subject.
+        ///@param i Group number (default 0: whole match).
+        ///@return Start offset, PCRE2_UNSET if the group is not set.
+        SIZE_T start(SIZE_T i = 0) const {
+            return i < count ? ovector[2*i] : PCRE2_UNSET;
+        }
+
+        ///Get the offset where a group ends in the subject.
+        ///@param i Group number (default 0: whole match).
+        ///@return End offset, PCRE2_UNSET if the group is not set.
+        SIZE_T end(SIZE_T i = 0) const {
+            return i < count ? ovector[2*i+1] : PCRE2_UNSET;
+        }
+
+        ///Get the substring of a group.
+        ///@param i Group number.
+        ///@return View of the subject string, empty if the group is not set.
+        StringView operator[](SIZE_T i) const {
+            if(!isSet(i) || ovector[2*i+1] < ovector[2*i]) return StringView();
+            return StringView(subject + ovector[2*i], ovector[2*i+1] - ovector[2*i]);
+        }
+
+        ///Get the substring of a named group.
+        ///The name is looked up in the name table of the compiled code, with PCRE2_DUPNAMES
+        ///the first group of the name that is set is used.
+        ///@param name Group name.
+        ///@return View of the subject string, empty if the group is not set or doesn't exist.
+        StringView operator[](StringView name) const {
+            int n = cc ? cc->getSetGroupNumber(name, ovector, count) : PCRE2_ERROR_NOSUBSTRING;
+            return n < 0 ? StringView() : (*this)[(SIZE_T) n];
+        }
+    };
+
+    /** Lazily evaluated sequence of matches.
+     * Matching is performed one match at a time while the range is iterated, with the same
+     * rules for empty matches, CRLF newlines and UTF characters as RegexMatch::match(), thus
+     * nothing is stored and iteration can stop at any point without matching the rest of the subject.
+     * Without FIND_ALL the range has at most one match.
+     *
+     * The range takes the Regex object, subject, options, start offset, match context and
+     * JitStackManager of the RegexMatch object it was created from. The Regex object and the subject
+     * string must outlive the range. A match data block is taken from the thread local MatchDataPool
+     * for the lifetime of the range.
+     *
+     * ```cpp
+     * jp::Regex re("(\\w+)@(\\w+)");
+     * std::string subject = "a@b c@d e@f";
+     * for(jp::MatchView const& m : re.matches(subject)){
+     *     if(m[2] == "d") break; //the rest is not matched
+     * }
+     * ```
+     */
+    class MatchRange {
+
+        RegexMatch rm;
+        MatchData *match_data;
+        PCRE2_SIZE *ovector;
+        uint32_t ovector_count;
+        MatchView view;
+        bool started;
+        bool done;
+        bool jit;
+        bool utf;
+        bool crlf_is_newline;
+        int error_number;
+
+        //Performs the next match and updates the view.
+        void next();
+
+        //not copyable
+        MatchRange(MatchRange const &);
+        MatchRange& operator=(MatchRange const &);
+
+        public:
+
+        ///Input iterator over the matches of a MatchRange.
+        ///All iterators of a range share its state, incrementing one advances the range.
+        class iterator {
+
+            MatchRange *range;
+
+            bool atEnd() const {
+                return !range || range->done;
+            }
+
+            public:
+
+            typedef std::input_iterator_tag iterator_category;
+            typedef MatchView value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef MatchView const* pointer;
+            typedef MatchView const& reference;
+
+            ///Constructor.
+            ///@param r Pointer to the range, null creates an end iterator.
+            explicit iterator(MatchRange *r = 0):range(r){}
+
+            ///Get the view of the current match.
+            ///@return Reference to MatchView.
+            reference operator*() const {
+                return range->view;
+            }
+
+            ///Get the view of the current match.
+            ///@return Pointer to MatchView.
+            pointer operator->() const {
+                return &range->view;
+            }
+
+            ///Perform the next match.
+            ///@return Reference to the iterator.
+            iterator& operator++(){
+                range->next();
+                return *this;
+            }
+
+            ///Perform the next match.
+            ///@return Copy of the iterator (it shares the state of the range).
+            iterator operator++(int){
+                range->next();
+                return *this;
+            }
+
+            ///Iterators are equal if both are at the end or both are not.
+            ///@param it Another iterator.
+            ///@return true if equal.
+            bool operator==(iterator const& it) const {
+                return atEnd() == it.atEnd();
+            }
+
+            ///@param it Another iterator.
+            ///@return true if not equal.
+            bool operator!=(iterator const& it) const {
+                return atEnd() != it.atEnd();
+            }
+        };
+
+        ///Constructor.
+        ///Copies the settings of a RegexMatch object, no match is performed until begin() is called.
+        ///@param m RegexMatch object.
+        explicit MatchRange(RegexMatch const& m)
+        :rm(m), match_data(0), ovector(0), ovector_count(0), started(false), done(false),
+         jit(false), utf(false), crlf_is_newline(false), error_number(0){}
+
+        ///Move constructor.
+        ///@param mr rvalue reference to a MatchRange object.
+        MatchRange(MatchRange&& mr)
+        :rm(mr.rm), match_data(mr.match_data), ovector(mr.ovector), ovector_count(mr.ovector_count),
+         view(mr.view), started(mr.started), done(mr.done), jit(mr.jit), utf(mr.utf),
+         crlf_is_newline(mr.crlf_is_newline), error_number(mr.error_number){
+            mr.match_data = 0;
+            mr.done = true;
+        }
+
+        ///Destructor.
+        ///Gives the match data block back to the pool.
+        ~MatchRange(){
+            if(match_data) MatchDataPool::getLocal().release(match_data);
+        }
+
+        ///Get an iterator to the first match.
+        ///The first call performs the first match, subsequent calls return the current position.
+        ///@return Iterator.
+        iterator begin(){
+            if(!started){
+                started = true;
+                next();
+            }
+            return iterator(this);
+        }
+
+        ///Get the end iterator.
+        ///@return Iterator.
+        iterator end(){
+            return iterator();
+        }
+
+        ///Get the error number of the match that ended the iteration.
+        ///Errors are the same as RegexMatch::getErrorNumber() would report.
+        ///@return Error number (0 if iteration ended normally).
+        int getErrorNumber() const {
+            return error_number;
+        }
+    };
+
+
+    /** Offsets of the captured groups of all matches in one contiguous array.
+     * Each match is a row and each group a column (group 0 is the whole match),
+     * the row stride is the number of groups (capture count + 1).
+     * Substrings are returned as StringView into the subject, so the subject must outlive the table.
+     *
+     * A table set with RegexMatch::setMatchTable() is cleared at the start of each match() call,
+     * its memory is kept, thus repeated global matches don't allocate once it is big enough.
+     *
+     * ```cpp
+     * jp::MatchTable table;
+     * jp::Regex re("(\\w+)@(\\w+)");
+     * re.initMatch().setSubject("a@b c@d").setMatchTable(&table).setFindAll().match();
+     * for(size_t i = 0; i < table.size(); ++i)
+     *     std::cout << table.get(i, 1) << " at " << table.get(i, 2) << "\n";
+     * ```
+     */
+    class MatchTable {
+
+        friend class RegexMatch;
+
+        Char_T const *subject;
+        std::vector<PCRE2_SIZE> offsets;
+        SIZE_T stride;
+        CodePtr code_ref; //for the name table
+
+        //Starts a new set of results.
+        void reset(Char_T const *s, SIZE_T groups, CodePtr const& cc){
+            subject = s;
+            stride = groups;
+            offsets.clear();
+            code_ref = cc;
+        }
+
+        //Appends a row from an ovector with `stride` pairs.
+        void push(PCRE2_SIZE const *ovector){
+            offsets.insert(offsets.end(), ovector, ovector + 2*stride);
+        }
+
+        public:
+
+        ///Default constructor.
+        MatchTable():subject(0), stride(0){}
+
+        ///Get the number of rows (matches).
+        ///@return Row count.
+        SIZE_T size() const {
+            return stride ? offsets.size() / (2*stride) : 0;
+        }
+
+        ///Check whether the table has no rows.
+        ///@return true if empty.
+        bool empty() const {
+            return offsets.empty();
+        }
+
+        ///Get the number of columns (groups) of each row.
+        ///@return Group count (capture count + 1).
+        SIZE_T getGroupCount() const {
+            return stride;
+        }
+
+        ///Check whether a group participated in a match.
+        ///@param row Row (match) index.
+        ///@param col Column (group number).
+        ///@return true if the group is set.
+        bool isSet(SIZE_T row, SIZE_T col) const {
+            return offsets[2*(row*stride + col)] != PCRE2_UNSET;
+        }
+
+        ///Get the offset where a group starts in the subject.
+        ///@param row Row (match) index.
+        ///@param col Column (group number, default 0: whole match).
+        ///@return Start offset, PCRE2_UNSET if the group is not set.
+        SIZE_T start(SIZE_T row, SIZE_T col = 0) const {
+            return offsets[2*(row*stride + col)];
+        }
+
+        ///Get the offset where a group ends in the subject.
+        ///@param row Row (match) index.
+        ///@param col Column (group number, default 0: whole match).
+        ///@return End offset, PCRE2_UNSET if the group is not set.
+        SIZE_T end(SIZE_T row, SIZE_T col = 0) const {
+            return offsets[2*(row*stride + col) + 1];
+        }
+
+        ///Get the substring of a group.
+        ///@param row Row (match) index.
+        ///@param col Column (group number).
+        ///@return View of the subject string, empty if the group is not set.
+        StringView get(SIZE_T row, SIZE_T col) const {
+            PCRE2_SIZE const *p = &offsets[2*(row*stride + col)];
+            if(p[0] == PCRE2_UNSET || p[1] < p[0]) return StringView();
+            return StringView(subject + p[0], p[1] - p[0]);
+        }
+
+        ///Get the substring of a named group.
+        ///The name is looked up in the name table of the compiled code for each call,
+        ///use Regex::getGroupNumber() and get(row, col) to look it up only once.
+        ///With PCRE2_DUPNAMES the first group of the name that is set is used.
+        ///@param row Row (match) index.
+        ///@param name Group name.
+        ///@return View of the subject string, empty if the group is not set or doesn't exist.
+        StringView get(SIZE_T row, StringView name) const {
+            int n = code_ref ? code_ref->getSetGroupNumber(name, &offsets[2*row*stride], stride) : PCRE2_ERROR_NOSUBSTRING;
+            return n < 0 ? StringView() : get(row, (SIZE_T) n);
+        }
+
+        ///Reserve memory for a number of rows.
+        ///@param rows Row count.
+        ///@param groups Group count of the pattern (capture count + 1).
+        void reserve(SIZE_T rows, SIZE_T groups){
+            offsets.reserve(2*rows*groups);
+        }
+
+        ///Remove all rows, the memory is kept.
+        void clear(){
+            offsets.clear();
+        }
+    };
+
+
+    ///This class contains a typedef of a function pointer or a templated function wrapper (`std::function`)
+    ///to provide callback function to the `MatchEvaluator`.
+    ///`std::function` is used when `>=C++11` is being used , otherwise function pointer is used.
+    ///You can force using function pointer instead of `std::function` when `>=C++11` is used by defining  the macro
     ///`JPCRE2_USE_FUNCTION_POINTER_CALLBACK` before including jpcre2.hpp.
     ///If you are using lambda function with capture, you must use the `std::function` approach.
     ///
@@ -1983,950 +3799,2016 @@ struct select{
         #endif
     };
 
-    ///Provides some default static callback functions.
-    ///The primary goal of this class is to provide default
-    ///callback function to MatchEvaluator default constructor which is
-    ///essentially callback::erase.
-    ///This class does not allow object instantiation.
-    struct callback{
-        ///Callback function that removes the matched part/s in the subject string
-        /// and takes all match vectors as argument.
-        ///Even though this function itself does not use the vectors, it still takes them
-        ///so that the caller can perform a match and populate all the match data to perform
-        ///further evaluation of other callback functions without doing the match again.
-        ///@param num jp::NumSub vector.
-        ///@param nas jp::MapNas map.
-        ///@param ntn jp::MapNtN map.
-        ///@return empty string.
-        static String eraseFill(NumSub const &num, MapNas const &nas, MapNtN const &ntn){
-            return String();
+    ///Provides some default static callback functions.
+    ///The primary goal of this class is to provide default
+    ///callback function to MatchEvaluator default constructor which is
+    ///essentially callback::erase.
+    ///This class does not allow object instantiation.
+    struct callback{
+        ///Callback function that removes the matched part/s in the subject string
+        /// and takes all match vectors as argument.
+        ///Even though this function itself does not use the vectors, it still takes them
+        ///so that the caller can perform a match and populate all the match data to perform
+        ///further evaluation of other callback functions without doing the match again.
+        ///@param num jp::NumSub vector.
+        ///@param nas jp::MapNas map.
+        ///@param ntn jp::MapNtN map.
+        ///@return empty string.
+        static String eraseFill(NumSub const &num, MapNas const &nas, MapNtN const &ntn){
+            return String();
+        }
+
+        ///Callback function that removes the matched part/s in the subject string
+        ///and does not take any match vector.
+        ///This is a minimum cost pattern deleting callback function.
+        ///
+        ///It's the default callback function when you Instantiate
+        ///a MatchEvaluator object with its default constructor:
+        ///```cpp
+        ///MatchEvaluator me;
+        ///```
+        ///@return empty string.
+        static String erase(void*, void*, void*){
+            return String();
+        }
+
+        ///Callback function for populating match vectors that does not modify the subject string.
+        ///It always returns the total matched part and thus the subject string remains the same.
+        ///@param num jp::NumSub vector.
+        ///@param nas jp::MapNas map.
+        ///@param ntn jp::MapNtN map.
+        ///@return total match (group 0) of current match.
+        static String fill(NumSub const &num, MapNas const &nas, MapNtn const &ntn){
+            #ifdef JPCRE2_UNSET_CAPTURES_NULL
+            return String(*num[0]);
+            #else
+            return String(num[0]);
+            #endif
+        }
+
+        private:
+        //prevent object instantiation.
+        callback();
+        callback(callback const &);
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+        callback(callback&&);
+        #endif
+        ~callback();
+    };
+
+    ///This class inherits RegexMatch and provides a similar functionality.
+    ///All public member functions from RegexMatch class are publicly available except the following:
+    ///* setNumberedSubstringVector
+    ///* setNamedSubstringVector
+    ///* setNameToNumberMapVector
+    ///* setMatchStartOffsetVector
+    ///* setMatchEndOffsetVector
+    ///
+    ///The use of above functions is not allowed as the vectors are created according to the callback function you pass.
+    ///
+    ///Each constructor of this class takes a callback function as argument (see `MatchEvaluatorCallback`).
+    ///
+    ///It provides a MatchEvaluator::nreplace() function to perform replace operation using native JPCRE2 approach
+    ///and `MatchEvaluator::replace()` function for PCRE2 compatible replace operation.
+    ///
+    ///An instance of this class can also be passed with `RegexReplace::nreplace()` or `RegexReplace::replace()` function to perform replacement
+    ///according to this match evaluator.
+    ///
+    ///Match data is stored in vectors, and the vectors are populated according to the callback functions.
+    ///Populated vector data is never deleted but they get overwritten. Vector data can be manually zeroed out
+    ///by calling `MatchEvaluator::clearMatchData()`. If the capacities of those match vectors are desired to
+    ///to be shrinked too instead of just clearing them, use `MatchEvaluator::resetMatchData()` instead.
+    ///
+    /// # Re-usability of Match Data
+    /// A match data populated with a callback function that takes only a jp::NumSub vector is not compatible
+    /// with the data created according to callback function with a jp::MapNas vector.
+    /// Because, for this later callback, jp::MapNas data is required but is not available (only jp::NumSub is available).
+    /// In such cases, previous Match data can not be used to perform a new replacment operation with this second callback function.
+    ///
+    /// To populate the match vectors, one must call the `MatchEvaluator::match()` or `MatchEvaluator::nreplace()` function, they will populate
+    /// vectors with match data according to call back function.
+    ///
+    /// ## Example:
+    ///
+    /// ```cpp
+    /// jp::String callback5(NumSub const &m, void*, MapNtn const &n){
+    ///     return m[0];
+    /// }
+    /// jp::String callback4(void*, void*, MapNtn const &n){
+    ///     return std::to_string(n.at("name")); //position of group 'name'.
+    /// }
+    /// jp::String callback2(void*, MapNas const &m, void*){
+    ///     return m.at('name'); //substring by name
+    /// }
+    ///
+    /// jp::MatchEvaluator me;
+    /// me.setRegexObject(&re).setSubject("string").setCallback(callback5).nreplace();
+    /// //In above, nreplace() populates jp::NumSub and jp::MapNtn with match data.
+    ///
+    /// me.setCallback(callback4).nreplace(false);
+    /// //the above uses previous match result (note the 'false') which is OK,
+    /// //because, callback4 requires jp::MapNtn which was made available in the previous operation.
+    ///
+    /// //but the following is not OK: (assertion failure)
+    /// me.setCallback(callback2).nreplace(false);
+    /// //because, callback2 requires jp::MapNas data which is not available.
+    /// //now, this is OK:
+    /// me.setCallback(callback2).nreplace();
+    /// //because, it will recreate those match data including this one (jp::MapNas).
+    /// ```
+    ///
+    /// # Replace options
+    /// MatchEvaluator can not take replace options.
+    /// Replace options are taken directly by the replace functions: `nreplace()` and `replace()`.
+    ///
+    /// # Using as a match object
+    /// As it's just a subclass of RegexMatch, it can do all the things that RegexMatch can do, with some restrictions:
+    /// * matching options are modified to strip off bad options according to replacement (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT).
+    /// * match depends on the callback function. Only those vectors will be populated that are implemented by the callback functions so far
+    ///   (multiple callback function will set multiple match data vectors.)
+    /// * match vectors are internal to this class, you can not set them manually (without callback function). (you can get pointers to these vectors
+    ///   with `getNumberedSubstringVector()` and related functions).
+    ///
+    ///@see MatchEvaluatorCallback
+    ///@see RegexReplace::nreplace()
+    class MatchEvaluator: virtual public RegexMatch{
+        private:
+        friend class RegexReplace;
+
+        VecNum vec_num;
+        VecNas vec_nas;
+        VecNtN vec_ntn;
+        VecOff vec_soff;
+        VecOff vec_eoff;
+        int callbackn;
+        typename MatchEvaluatorCallback<void*, void*, void*>::Callback callback0;
+        typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback callback1;
+        typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback callback2;
+        typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback callback3;
+        typename MatchEvaluatorCallback<void*, void*, MapNtN const &>::Callback callback4;
+        typename MatchEvaluatorCallback<NumSub const &, void*, MapNtN const &>::Callback callback5;
+        typename MatchEvaluatorCallback<void*, MapNas const &, MapNtN const &>::Callback callback6;
+        typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback callback7;
+        //Q: Why the callback names seem random? is it random?
+        //A: No, it's not random, NumSub = 1, MapNas = 2, MapNtn = 4, thus:
+        //     NumSub + MapNas = 3
+        //     NumSub + MapNtn = 5
+        //     MapNas + MapNtn = 6
+        //     NumSub + MapNas + MapNtn = 7
+        //Q: Why is it like this?
+        //A: It's historical. Once, there was not this many callback declaration, there was only one (a templated one).
+        //   The nreplace function itself used to calculate a mode value according to available vectors
+        //   and determine what kind of callback function needed to be called.
+        //Q: Why the history changed?
+        //A: We had some compatibility issues with the single templated callback.
+        //   Also, this approach proved to be more readable and robust.
+
+        PCRE2_SIZE buffer_size;
+        bool streaming;
+
+        //State of a replace that is done while matching, see streamStep().
+        struct StreamState {
+            String* out;
+            StringView subject;
+            SIZE_T offset; //end of the previous match
+            SIZE_T count;
+            Uint replace_opts;
+            bool substitute; //replace() or nreplace()
+            MatchData* md; //for pcre2_substitute to match again, null if it uses the block of the match
+            bool keep; //keep the vectors (not streaming)
+            bool failed;
+        };
+        StreamState* stream;
+
+        //Result of the callback for the i'th of mcount matches in the vectors.
+        String evaluate(SIZE_T i, SIZE_T mcount);
+
+        //Appends the result of pcre2_substitute on the subject, with the result
+        //of the callback as replacement string. False on error, with error_number set.
+        bool substituteInto(String& out, StringView subject, String const& repl, Uint replace_opts, MatchData* md, int& ret);
+
+        //Match hook of replace() and nreplace(): replaces the match that is in the vectors,
+        //and clears them in streaming mode.
+        static bool streamStep(void* me, MatchData* md);
+
+        SIZE_T streamReplace(String& out, Uint replace_opts, bool substitute, bool keep);
+
+        void init(){
+            callbackn = 0;
+            callback0 = callback::erase;
+            callback1 = 0;
+            callback2 = 0;
+            callback3 = 0;
+            callback4 = 0;
+            callback5 = 0;
+            callback6 = 0;
+            callback7 = 0;
+            setMatchStartOffsetVector(&vec_soff);
+            setMatchEndOffsetVector(&vec_eoff);
+            buffer_size = 0;
+            streaming = false;
+            stream = 0;
+        }
+
+        void setVectorPointersAccordingToCallback(){
+            switch(callbackn){
+                case 0: break;
+                case 1: setNumberedSubstringVector(&vec_num);break;
+                case 2: setNamedSubstringVector(&vec_nas);break;
+                case 3: setNumberedSubstringVector(&vec_num).setNamedSubstringVector(&vec_nas);break;
+                case 4: setNameToNumberMapVector(&vec_ntn);break;
+                case 5: setNumberedSubstringVector(&vec_num).setNameToNumberMapVector(&vec_ntn);break;
+                case 6: setNamedSubstringVector(&vec_nas).setNameToNumberMapVector(&vec_ntn);break;
+                case 7: setNumberedSubstringVector(&vec_num).setNamedSubstringVector(&vec_nas).setNameToNumberMapVector(&vec_ntn);break;
+            }
+        }
+
+        void onlyCopy(MatchEvaluator const &me){
+            callbackn = me.callbackn;
+            callback0 = me.callback0;
+            callback1 = me.callback1;
+            callback2 = me.callback2;
+            callback3 = me.callback3;
+            callback4 = me.callback4;
+            callback5 = me.callback5;
+            callback6 = me.callback6;
+            callback7 = me.callback7;
+            //must update the pointers to point to this class vectors.
+            setVectorPointersAccordingToCallback();
+            buffer_size = me.buffer_size;
+            streaming = me.streaming;
+        }
+
+        void deepCopy(MatchEvaluator const &me) {
+            vec_num = me.vec_num;
+            vec_nas = me.vec_nas;
+            vec_ntn = me.vec_ntn;
+            vec_soff = me.vec_soff;
+            vec_eoff = me.vec_eoff;
+            onlyCopy(me);
+        }
+
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+        void deepMove(MatchEvaluator& me){
+            vec_num = std::move_if_noexcept(me.vec_num);
+            vec_nas = std::move_if_noexcept(me.vec_nas);
+            vec_ntn = std::move_if_noexcept(me.vec_ntn);
+            vec_soff = std::move_if_noexcept(me.vec_soff);
+            vec_eoff = std::move_if_noexcept(me.vec_eoff);
+            onlyCopy(me);
+        }
+        #endif
+
+        //prevent public access to some funcitons
+        MatchEvaluator& setNumberedSubstringVector(VecNum* v){
+            RegexMatch::setNumberedSubstringVector(v);
+            return *this;
+        }
+        MatchEvaluator& setNamedSubstringVector(VecNas* v){
+            RegexMatch::setNamedSubstringVector(v);
+            return *this;
+        }
+        MatchEvaluator& setNameToNumberMapVector(VecNtN* v){
+            RegexMatch::setNameToNumberMapVector(v);
+            return *this;
+        }
+        MatchEvaluator& setMatchStartOffsetVector(VecOff* v){
+            RegexMatch::setMatchStartOffsetVector(v);
+            return *this;
+        }
+        MatchEvaluator& setMatchEndOffsetVector(VecOff* v){
+            RegexMatch::setMatchEndOffsetVector(v);
+            return *this;
+        }
+
+        public:
+
+        ///Default constructor.
+        ///Sets callback::erase as the callback function.
+        ///Removes matched part/s from the subject string if the callback is not
+        ///changed.
+        /// ```cpp
+        /// jp::Regex re("\s*string");
+        /// jp::MatchEvaluator me;
+        /// std::cout<<
+        /// me.setRegexObject(&re);
+        ///   .setSubject("I am a   string");
+        ///   .nreplace();
+        /// //The above will delete '   string' from the subject
+        /// //thus the result will be 'I am a'
+        /// ```
+        explicit
+        MatchEvaluator():RegexMatch(){
+            init();
+        }
+
+        ///@overload
+        ///...
+        ///Constructor taking a Regex object pointer.
+        ///It sets the associated Regex object and
+        ///initializes the MatchEvaluator object with
+        ///callback::erase callback function.
+        ///Underlying data is not modified.
+        ///@param r constant Regex pointer.
+        explicit
+        MatchEvaluator(Regex const *r):RegexMatch(r){
+            init();
+        }
+
+        ///@overload
+        ///...
+        ///Constructor taking a callback function.
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<void*, void*, void*>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, void*,  MapNtN const &>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<void*, MapNas const &,  MapNtN const &>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+
+
+        ///@overload
+        /// ...
+        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
+        ///@param mef Callback function.
+        explicit
+        MatchEvaluator(typename MatchEvaluatorCallback<void*, void*,  MapNtN const &>::Callback mef): RegexMatch(){
+            init();
+            setCallback(mef);
+        }
+
+
+
+        ///@overload
+        /// ...
+        ///Copy constructor.
+        ///@param me Reference to MatchEvaluator object
+        MatchEvaluator(MatchEvaluator const &me): RegexMatch(me){
+            init();
+            deepCopy(me);
+        }
+
+        ///Overloaded copy-assignment operator
+        ///@param me MatchEvaluator object
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& operator=(MatchEvaluator const &me){
+            if(this == &me) return *this;
+            RegexMatch::operator=(me);
+            deepCopy(me);
+            return *this;
+        }
+
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+
+        ///@overload
+        /// ...
+        ///Move constructor.
+        ///This constructor steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param me rvalue reference to a MatchEvaluator object
+        MatchEvaluator(MatchEvaluator&& me): RegexMatch(me){
+            init();
+            deepMove(me);
+        }
+
+        ///@overload
+        ///...
+        ///Overloaded move-assignment operator.
+        ///It steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param me rvalue reference to a MatchEvaluator object
+        ///@return A reference to the calling MatchEvaluator object.
+        ///@see MatchEvaluator(MatchEvaluator&& me)
+        MatchEvaluator& operator=(MatchEvaluator&& me){
+            if(this == &me) return *this;
+            RegexMatch::operator=(me);
+            deepMove(me);
+            return *this;
+        }
+
+        #endif
+
+        virtual ~MatchEvaluator(){}
+
+        ///Member function to set a callback function with no vector reference.
+        ///Callback function is always overwritten. The implemented vectors are set to be filled with match data.
+        ///Other vectors that were set previously, are not unset and thus they will be filled with match data too
+        ///when `match()` or `nreplace()` is called.
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, void*, void*>::Callback mef){
+            callback0 = mef;
+            callbackn = 0;
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::NumSub vector.
+        ///You will be working with a reference to the constant vector.
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback mef){
+            callback1 = mef;
+            callbackn = 1;
+            setNumberedSubstringVector(&vec_num);
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::NumSub and jp::MapNas.
+        ///You will be working with references of the constant vectors.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_nas["word"]; //wrong
+        ///map_nas.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNas mn = map_nas;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback mef){
+            callback3 = mef;
+            callbackn = 3;
+            setNumberedSubstringVector(&vec_num);
+            setNamedSubstringVector(&vec_nas);
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::NumSub and jp::MapNtN.
+        ///You will be working with references of the constant vectors.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_ntn["word"]; //wrong
+        ///map_ntn.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNtN mn = map_ntn;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, void*,  MapNtN const &>::Callback mef){
+            callback5 = mef;
+            callbackn = 5;
+            setNumberedSubstringVector(&vec_num);
+            setNameToNumberMapVector(&vec_ntn);
+            return *this;
+        }
+
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::NumSub, jp::MapNas, jp::MapNtN.
+        ///You will be working with references of the constant vectors.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_nas["word"]; //wrong
+        ///map_nas.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNas mn = map_nas;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback mef){
+            callback7 = mef;
+            callbackn = 7;
+            setNumberedSubstringVector(&vec_num);
+            setNamedSubstringVector(&vec_nas);
+            setNameToNumberMapVector(&vec_ntn);
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::MapNas.
+        ///You will be working with reference of the constant vector.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_nas["word"]; //wrong
+        ///map_nas.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNas mn = map_nas;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback mef){
+            callback2 = mef;
+            callbackn = 2;
+            setNamedSubstringVector(&vec_nas);
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::MapNas, jp::MapNtN.
+        ///You will be working with reference of the constant vector.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_nas["word"]; //wrong
+        ///map_nas.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNas mn = map_nas;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, MapNas const &,  MapNtN const &>::Callback mef){
+            callback6 = mef;
+            callbackn = 6;
+            setNamedSubstringVector(&vec_nas);
+            setNameToNumberMapVector(&vec_ntn);
+            return *this;
+        }
+
+        ///@overload
+        /// ...
+        ///Sets a callback function with a jp::MapNtN.
+        ///You will be working with references of the constant vectors.
+        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
+        ///```cpp
+        ///map_ntn["word"]; //wrong
+        ///map_ntn.at("word"); //ok
+        ///```
+        ///If you want to use `[]` operator with maps, make a copy:
+        ///```cpp
+        ///jp::MapNtN mn = map_ntn;
+        ///mn["word"]; //ok
+        ///```
+        ///@param mef Callback function.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, void*,  MapNtN const &>::Callback mef){
+            callback4 = mef;
+            callbackn = 4;
+            setNameToNumberMapVector(&vec_ntn);
+            return *this;
+        }
+
+        ///Clear match data.
+        ///It clears all match data from all vectors (without shrinking).
+        ///For shrinking the vectors, use `resetMatchData()`
+        ///A call to `match()`  or nreplace() will be required to produce match data again.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& clearMatchData(){
+            vec_num.clear();
+            vec_nas.clear();
+            vec_ntn.clear();
+            vec_soff.clear();
+            vec_eoff.clear();
+            return *this;
+        }
+
+        ///Reset match data to initial state.
+        ///It deletes all match data from all vectors shrinking their capacity.
+        ///A call to `match()`  or nreplace() will be required to produce match data again.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& resetMatchData(){
+            VecNum().swap(vec_num);
+            VecNas().swap(vec_nas);
+            VecNtN().swap(vec_ntn);
+            VecOff().swap(vec_soff);
+            VecOff().swap(vec_eoff);
+            return *this;
+        }
+
+
+        ///Reset MatchEvaluator to initial state including memory.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& reset(){
+            RegexMatch::reset();
+            resetMatchData();
+            init();
+            return *this;
+        }
+
+        ///Clears MatchEvaluator.
+        ///Returns everything to initial state (some memory may retain for further and faster use).
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& clear(){
+            RegexMatch::clear();
+            clearMatchData();
+            init();
+            return *this;
+        }
+
+        ///Call RegexMatch::resetErrors().
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& resetErrors(){
+            RegexMatch::resetErrors();
+            return *this;
+        }
+
+        ///Call RegexMatch::setRegexObject(r).
+        ///@param r constant Regex object pointer
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setRegexObject (Regex const *r){
+            RegexMatch::setRegexObject(r);
+            return *this;
+        }
+
+        ///Call RegexMatch::setSubject(StringView s).
+        ///@param s subject string.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setSubject (StringView s){
+            RegexMatch::setSubject(s);
+            return *this;
+        }
+
+        ///Call RegexMatch::setModifier(Modifier const& s).
+        ///@param s modifier string.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setModifier (Modifier const& s){
+            RegexMatch::setModifier(s);
+            return *this;
+        }
+
+        ///Call RegexMatch::setModifierTable(ModifierTable const * s).
+        ///@param mdt pointer to ModifierTable object.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setModifierTable (ModifierTable const * mdt){
+            RegexMatch::setModifierTable(mdt);
+            return *this;
+        }
+
+        ///Call RegexMatch::setJpcre2Option(Uint x).
+        ///@param x JPCRE2 option value.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setJpcre2Option (Uint x){
+            RegexMatch::setJpcre2Option(x);
+            return *this;
+        }
+
+        ///Call RegexMatch::setPcre2Option (Uint x).
+        ///@param x PCRE2 option value.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setPcre2Option (Uint x){
+            RegexMatch::setPcre2Option(x);
+            return *this;
+        }
+
+        ///Call RegexMatch::setFindAll(bool x).
+        ///@param x true if global match, false otherwise.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setFindAll (bool x){
+            RegexMatch::setFindAll(x);
+            return *this;
+        }
+
+        ///Call RegexMatch::setFindAll().
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setFindAll(){
+            RegexMatch::setFindAll();
+            return *this;
+        }
+
+        ///Call RegexMatch::setDfaMatch(bool x).
+        ///The callback gets the whole match only, DFA matching doesn't set captures.
+        ///@param x true to match with the DFA algorithm, false otherwise.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setDfaMatch (bool x){
+            RegexMatch::setDfaMatch(x);
+            return *this;
+        }
+
+        ///Call RegexMatch::setDfaMatch().
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setDfaMatch(){
+            RegexMatch::setDfaMatch();
+            return *this;
+        }
+
+        ///Call RegexMatch::setStartOffset (PCRE2_SIZE offset).
+        ///@param offset match start offset in the subject.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setStartOffset (PCRE2_SIZE offset){
+            RegexMatch::setStartOffset(offset);
+            return *this;
+        }
+
+        ///Call RegexMatch::setMatchContext(MatchContext *match_context).
+        ///@param match_context pointer to match context.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setMatchContext (MatchContext *match_context){
+            RegexMatch::setMatchContext(match_context);
+            return *this;
+        }
+
+        ///Call RegexMatch::setJitStackManager(JitStackManager *jsm).
+        ///@param jsm Pointer to JitStackManager object.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setJitStackManager (JitStackManager *jsm){
+            RegexMatch::setJitStackManager(jsm);
+            return *this;
+        }
+
+        ///Call RegexMatch::setMatchDataBlock(MatchContext * mdt);
+        ///@param mdt pointer to match data block
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setMatchDataBlock(MatchData* mdt){
+            RegexMatch::setMatchDataBlock(mdt);
+            return *this;
+        }
+
+        ///Set the buffer size that will be used by pcre2_substitute (replace()).
+        ///If buffer size proves to be enough to fit the resultant string
+        ///from each match (not the total resultant string), it will yield one less call
+        ///to pcre2_substitute for each match.
+        ///@param x buffer size.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setBufferSize(PCRE2_SIZE x){
+            buffer_size = x;
+            return *this;
+        }
+
+        ///Get the initial buffer size that is being used by internal function pcre2_substitute
+        ///@return buffer_size
+        PCRE2_SIZE getBufferSize(){
+            return buffer_size;
+        }
+
+        ///Set streaming mode for replace() and nreplace().
+        ///In streaming mode, the callback is called as soon as each match is found and its
+        ///result is appended to the output right away, the vectors hold one match at a time.
+        ///Memory use thus depends on the output only, not on the number of matches and captures.
+        ///It applies when a new match is performed (`do_match` is true); the vectors are empty afterwards.
+        ///@param x true to enable streaming mode, false to disable.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& setStreaming(bool x){
+            streaming = x;
+            return *this;
+        }
+
+        ///Enable streaming mode.
+        ///@return A reference to the calling MatchEvaluator object.
+        ///@see setStreaming(bool)
+        MatchEvaluator& setStreaming(){
+            return setStreaming(true);
+        }
+
+        ///Call RegexMatch::changeModifier(Modifier const& mod, bool x).
+        ///@param mod modifier string.
+        ///@param x true (add) or false (remove).
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& changeModifier (Modifier const& mod, bool x){
+            RegexMatch::changeModifier(mod, x);
+            return *this;
+        }
+
+        ///Call RegexMatch::changeJpcre2Option(Uint opt, bool x).
+        ///@param opt JPCRE2 option
+        ///@param x true (add) or false (remove).
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& changeJpcre2Option (Uint opt, bool x){
+            RegexMatch::changeJpcre2Option(opt, x);
+            return *this;
+        }
+
+        ///Call RegexMatch::changePcre2Option(Uint opt, bool x).
+        ///@param opt PCRE2 option.
+        ///@param x true (add) or false (remove).
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& changePcre2Option (Uint opt, bool x){
+            RegexMatch::changePcre2Option(opt, x);
+            return *this;
+        }
+
+        ///Call RegexMatch::addModifier(Modifier const& mod).
+        ///@param mod modifier string.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& addModifier (Modifier const& mod){
+            RegexMatch::addModifier(mod);
+            return *this;
+        }
+
+        ///Call RegexMatch::addJpcre2Option(Uint x).
+        ///@param x JPCRE2 option.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& addJpcre2Option (Uint x){
+            RegexMatch::addJpcre2Option(x);
+            return *this;
+        }
+
+        ///Call RegexMatch::addPcre2Option(Uint x).
+        ///@param x PCRE2 option.
+        ///@return A reference to the calling MatchEvaluator object.
+        MatchEvaluator& addPcre2Option (Uint x){
+            RegexMatch::addPcre2Option(x);
+            return *this;
+        }
+
+        ///Perform match and return the match count.
+        ///This function strips off matching options (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT) that are considered
+        ///bad options for replacement operation and then calls
+        ///RegexMatch::match() to perform the match.
+        ///@return match count.
+        SIZE_T match(void){
+            //remove bad matching options
+            RegexMatch::changePcre2Option(PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT, false);
+            return RegexMatch::match();
+        }
+
+        ///Perform regex replace with this match evaluator.
+        ///This is a JPCRE2 native replace function (thus the name nreplace).
+        ///It uses the `MatchEvaluatorCallback` function that was set with a constructor or `MatchEvaluator::setCallback()` function
+        ///to generate the replacement strings on the fly.
+        ///The string returned by the callback function will be treated as literal and will
+        ///not go through any further processing.
+        ///
+        ///This function performs a new match everytime it is called unless it is passed with a boolean `false` as the first argument.
+        ///To use existing match data that was created by a previous `MatchEvaluator::nreplace()` or `MatchEvaluator::match()`, call this
+        ///function with boolean `false` as the first argument.
+        ///
+        ///## Complexity
+        /// 1. Changes in replace related option takes effect without a re-match.
+        /// 2. Changes in match related option (e.g start offset) needs a re-match to take effect.
+        /// 3. To re-use existing match data, callback function must be compatible with the data, otherwise assertion error.
+        /// 4. If the associated Regex object or subject string changes, a new match must be performed,
+        ///    trying to use the existing match data in such cases is undefined behavior.
+        ///
+        ///@param do_match Perform a new matching operation if true, otherwise use existing match data.
+        ///@param jro JPCRE2 replace options.
+        ///@param counter Pointer to a counter to store the number of replacement done.
+        ///@return resultant string after replace.
+        ///@see MatchEvaluator.
+        ///@see MatchEvaluatorCallback.
+        String nreplace(bool do_match=true, Uint jro=0, SIZE_T* counter=0){
+            String res;
+            SIZE_T count = nreplace(res, do_match, jro);
+            if(counter) *counter = count;
+            return res;
+        }
+
+        ///Same as `nreplace(bool, Uint, SIZE_T*)` but appends the resultant string to `out`.
+        ///Passing the same string over and over (after a `clear()`) reuses its storage.
+        ///On error, the subject string is appended in place of the result.
+        ///`out` must not be the subject string.
+        ///@param out String the result is appended to.
+        ///@param do_match Perform a new matching operation if true, otherwise use existing match data.
+        ///@param jro JPCRE2 replace options.
+        ///@return Number of replacement done.
+        SIZE_T nreplace(String& out, bool do_match=true, Uint jro=0);
+
+        ///PCRE2 compatible replace function that uses this MatchEvaluator.
+        ///Performs regex replace with pcre2_substitute function
+        ///by generating the replacement strings dynamically with MatchEvaluator callback.
+        ///The string returned by callback function is processed by internal pcre2_substitute, thus allowing
+        ///all options that are provided by PCRE2 itself.
+        ///
+        ///This function performs a new match everytime it is called unless it is passed with a boolean `false` as the first argument.
+        ///
+        ///## Complexity
+        /// 1. Changes in replace related option takes effect without a re-match.
+        /// 2. Changes in match related option (e.g start offset) needs a re-match to take effect.
+        /// 3. To re-use existing match data, callback function must be compatible with the data, otherwise assertion error.
+        /// 4. If the associated Regex object or subject string changes, a new match must be performed,
+        ///    trying to use the existing match data in such cases is undefined behavior.
+        ///
+        ///@param do_match perform a new match if true, otherwise use existing data.
+        ///@param ro replace related PCRE2 options.
+        ///@param counter Pointer to a counter to store the number of replacement done.
+        ///@return resultant string after replacement.
+        String replace(bool do_match=true, Uint ro=0, SIZE_T* counter=0){
+            String res;
+            SIZE_T count = replace(res, do_match, ro);
+            if(counter) *counter = count;
+            return res;
+        }
+
+        ///Same as `replace(bool, Uint, SIZE_T*)` but appends the resultant string to `out`.
+        ///The result of each match is written by pcre2_substitute straight into `out`,
+        ///there's no temporary buffer.
+        ///Passing the same string over and over (after a `clear()`) reuses its storage.
+        ///On error, the subject string is appended in place of the result.
+        ///`out` must not be the subject string.
+        ///@param out String the result is appended to.
+        ///@param do_match perform a new match if true, otherwise use existing data.
+        ///@param ro replace related PCRE2 options.
+        ///@return Number of replacement done.
+        SIZE_T replace(String& out, bool do_match=true, Uint ro=0);
+    };
+
+    /** Replacement string compiled once against a Regex object.
+     * RegexReplace::replace() hands its replacement string to pcre2_substitute(), which parses it again
+     * on every call. A ReplacementTemplate parses it once: group names are resolved to group numbers
+     * and literal runs are kept apart from the references, each match is then expanded straight
+     * from the ovector without calling pcre2_substitute().
+     *
+     * The syntax is the one of pcre2_substitute() without PCRE2_SUBSTITUTE_EXTENDED:
+     * `$n`, `${n}`, `$name`, `${name}`, `$*MARK`, `${*MARK}` and `$$` for a literal `$`.
+     * References to groups that don't exist or aren't set give the same errors as pcre2_substitute(),
+     * or are taken as unset or empty with the `E` and `e` replace modifiers.
+     *
+     * A RegexReplace object that is given a template falls back to pcre2_substitute() with the string
+     * of the template if the template couldn't be compiled, if the Regex object was compiled
+     * again since, or if PCRE2_SUBSTITUTE_EXTENDED or PCRE2_SUBSTITUTE_LITERAL is set.
+     *
+     * ```cpp
+     * jp::Regex re("(?<key>\\w+)=(?<value>\\w+)");
+     * jp::ReplacementTemplate rt(re, "${value}=$key");
+     * jp::RegexReplace rr(&re);
+     * rr.setReplacementTemplate(&rt).setModifier("g");
+     * for(auto const& line : lines) out.push_back(rr.setSubject(line).replace());
+     * ```
+     *
+     * A template is not modified by expansion, it can be shared by many threads.
+     */
+    class ReplacementTemplate {
+
+        friend class RegexReplace;
+
+        enum { LITERAL, GROUP, MARK };
+
+        //A literal run, a group reference or a mark reference.
+        struct Part {
+            int kind;
+            SIZE_T begin, end; //range in #literals (LITERAL) or #groups (GROUP, empty if the group doesn't exist)
+        };
+
+        String source;
+        String literals;
+        std::vector<Part> parts;
+        std::vector<uint32_t> groups; //group numbers of the references, all groups of a name with PCRE2_DUPNAMES
+        CodePtr code_ref;
+        int error_number;
+        PCRE2_SIZE error_offset;
+
+        static bool isDigit(Char_T c){
+            return c >= Char_T('0') && c <= Char_T('9');
         }
 
-        ///Callback function that removes the matched part/s in the subject string
-        ///and does not take any match vector.
-        ///This is a minimum cost pattern deleting callback function.
-        ///
-        ///It's the default callback function when you Instantiate
-        ///a MatchEvaluator object with its default constructor:
-        ///```cpp
-        ///MatchEvaluator me;
-        ///```
-        ///@return empty string.
-        static String erase(void*, void*, void*){
-            return String();
+        static bool isWord(Char_T c){
+            return isDigit(c) || c == Char_T('_') || (c >= Char_T('a') && c <= Char_T('z')) || (c >= Char_T('A') && c <= Char_T('Z'));
         }
 
-        ///Callback function for populating match vectors that does not modify the subject string.
-        ///It always returns the total matched part and thus the subject string remains the same.
-        ///@param num jp::NumSub vector.
-        ///@param nas jp::MapNas map.
-        ///@param ntn jp::MapNtN map.
-        ///@return total match (group 0) of current match.
-        static String fill(NumSub const &num, MapNas const &nas, MapNtn const &ntn){
-            #ifdef JPCRE2_UNSET_CAPTURES_NULL
-            return String(*num[0]);
+        void addLiteral(Char_T const *s, SIZE_T n){
+            if(!n) return;
+            if(parts.empty() || parts.back().kind != LITERAL){
+                Part p = {LITERAL, literals.size(), literals.size()};
+                parts.push_back(p);
+            }
+            literals.append(s, n);
+            parts.back().end = literals.size();
+        }
+
+        void addGroups(uint32_t const *g, SIZE_T n){
+            Part p = {GROUP, groups.size(), groups.size() + n};
+            groups.insert(groups.end(), g, g + n);
+            parts.push_back(p);
+        }
+
+        void addMark(){
+            Part p = {MARK, 0, 0};
+            parts.push_back(p);
+        }
+
+        ReplacementTemplate& fail(SIZE_T offset, int err = PCRE2_ERROR_BADREPLACEMENT){
+            error_number = err;
+            error_offset = offset;
+            parts.clear();
+            return *this;
+        }
+
+        //True if the template can be expanded for matches of re with the replace options ro.
+        bool isUsable(Regex const *re, Uint ro) const {
+            Uint fallback = PCRE2_SUBSTITUTE_EXTENDED;
+            #ifdef PCRE2_SUBSTITUTE_LITERAL
+            fallback |= PCRE2_SUBSTITUTE_LITERAL;
+            #endif
+            return error_number == 0 && code_ref && re->code_ref == code_ref && (ro & fallback) == 0;
+        }
+
+    public:
+
+        ///Default constructor.
+        ///The template is empty until compile() is called.
+        ReplacementTemplate():error_number(0), error_offset(0){}
+
+        ///@overload
+        ///...
+        ///Compiles a replacement string against a Regex object.
+        ///@param re Compiled Regex object.
+        ///@param repl Replacement string.
+        ///@see compile()
+        ReplacementTemplate(Regex const& re, StringView repl):error_number(0), error_offset(0){
+            compile(re, repl);
+        }
+
+        ///Compile a replacement string against a Regex object.
+        ///On error, getErrorNumber() returns PCRE2_ERROR_BADREPLACEMENT or PCRE2_ERROR_REPMISSINGBRACE
+        ///(PCRE2_ERROR_NULL if the Regex object is not compiled) and getErrorOffset() the offset
+        ///in the replacement string. References to groups that don't exist are not an error here,
+        ///they are reported by expand() unless PCRE2_SUBSTITUTE_UNKNOWN_UNSET is given.
+        ///@param re Compiled Regex object, the template keeps a reference to its compiled code.
+        ///@param repl Replacement string.
+        ///@return Reference to the calling ReplacementTemplate object.
+        ReplacementTemplate& compile(Regex const& re, StringView repl);
+
+        ///Get the replacement string the template was compiled from.
+        ///@return Replacement string.
+        StringView getReplacement() const {
+            return source;
+        }
+
+        ///Get the number of parts (literal runs and references) of the template.
+        ///@return Part count.
+        SIZE_T getPartCount() const {
+            return parts.size();
+        }
+
+        ///Get the error number of the last compile().
+        ///@return Error number, 0 if the template compiled.
+        int getErrorNumber() const {
+            return error_number;
+        }
+
+        ///Get the offset in the replacement string where compile() failed.
+        ///@return Error offset.
+        PCRE2_SIZE getErrorOffset() const {
+            return error_offset;
+        }
+
+        ///Get the message for the error of the last compile().
+        ///@return Error message.
+        String getErrorMessage() const {
+            #ifdef JPCRE2_USE_MINIMUM_CXX_11
+            return select<Char, Map>::getErrorMessage(error_number, error_offset);
             #else
-            return String(num[0]);
+            return select<Char>::getErrorMessage(error_number, error_offset);
             #endif
         }
 
-        private:
-        //prevent object instantiation.
-        callback();
-        callback(callback const &);
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-        callback(callback&&);
-        #endif
-        ~callback();
+        ///Expand the template for one match and append the result to `out`.
+        ///@param out String the result is appended to.
+        ///@param subject Subject string of the match.
+        ///@param ovector Ovector of the match.
+        ///@param count Number of pairs in the ovector.
+        ///@param mark Mark of the match (pcre2_get_mark()), null if none.
+        ///@param ro Replace options, PCRE2_SUBSTITUTE_UNSET_EMPTY and PCRE2_SUBSTITUTE_UNKNOWN_UNSET are used.
+        ///@return 0 on success, otherwise a negative PCRE2 error number (`out` is left partially written).
+        int expand(String& out, StringView subject, PCRE2_SIZE const *ovector, SIZE_T count,
+                   Char_T const *mark = 0, Uint ro = 0) const {
+            for(SIZE_T i = 0; i < parts.size(); ++i){
+                Part const& p = parts[i];
+                if(p.kind == LITERAL){
+                    out.append(literals.data() + p.begin, p.end - p.begin);
+                } else if(p.kind == MARK){
+                    if(mark) out += mark;
+                } else {
+                    if(p.begin == p.end && (ro & PCRE2_SUBSTITUTE_UNKNOWN_UNSET) == 0) return PCRE2_ERROR_NOSUBSTRING;
+                    SIZE_T j = p.begin;
+                    //the first group that is set
+                    while(j < p.end && (groups[j] >= count || ovector[2*groups[j]] == PCRE2_UNSET)) ++j;
+                    if(j == p.end){
+                        if((ro & PCRE2_SUBSTITUTE_UNSET_EMPTY) == 0) return PCRE2_ERROR_UNSET;
+                        continue;
+                    }
+                    PCRE2_SIZE s = ovector[2*groups[j]], e = ovector[2*groups[j]+1];
+                    if(e > s) out.append(subject.data() + s, e - s);
+                }
+            }
+            return 0;
+        }
     };
 
-    ///This class inherits RegexMatch and provides a similar functionality.
-    ///All public member functions from RegexMatch class are publicly available except the following:
-    ///* setNumberedSubstringVector
-    ///* setNamedSubstringVector
-    ///* setNameToNumberMapVector
-    ///* setMatchStartOffsetVector
-    ///* setMatchEndOffsetVector
-    ///
-    ///The use of above functions is not allowed as the vectors are created according to the callback function you pass.
-    ///
-    ///Each constructor of this class takes a callback function as argument (see `MatchEvaluatorCallback`).
-    ///
-    ///It provides a MatchEvaluator::nreplace() function to perform replace operation using native JPCRE2 approach
-    ///and `MatchEvaluator::replace()` function for PCRE2 compatible replace operation.
-    ///
-    ///An instance of this class can also be passed with `RegexReplace::nreplace()` or `RegexReplace::replace()` function to perform replacement
-    ///according to this match evaluator.
-    ///
-    ///Match data is stored in vectors, and the vectors are populated according to the callback functions.
-    ///Populated vector data is never deleted but they get overwritten. Vector data can be manually zeroed out
-    ///by calling `MatchEvaluator::clearMatchData()`. If the capacities of those match vectors are desired to
-    ///to be shrinked too instead of just clearing them, use `MatchEvaluator::resetMatchData()` instead.
-    ///
-    /// # Re-usability of Match Data
-    /// A match data populated with a callback function that takes only a jp::NumSub vector is not compatible
-    /// with the data created according to callback function with a jp::MapNas vector.
-    /// Because, for this later callback, jp::MapNas data is required but is not available (only jp::NumSub is available).
-    /// In such cases, previous Match data can not be used to perform a new replacment operation with this second callback function.
-    ///
-    /// To populate the match vectors, one must call the `MatchEvaluator::match()` or `MatchEvaluator::nreplace()` function, they will populate
-    /// vectors with match data according to call back function.
-    ///
-    /// ## Example:
-    ///
-    /// ```cpp
-    /// jp::String callback5(NumSub const &m, void*, MapNtn const &n){
-    ///     return m[0];
-    /// }
-    /// jp::String callback4(void*, void*, MapNtn const &n){
-    ///     return std::to_string(n.at("name")); //position of group 'name'.
-    /// }
-    /// jp::String callback2(void*, MapNas const &m, void*){
-    ///     return m.at('name'); //substring by name
-    /// }
-    ///
-    /// jp::MatchEvaluator me;
-    /// me.setRegexObject(&re).setSubject("string").setCallback(callback5).nreplace();
-    /// //In above, nreplace() populates jp::NumSub and jp::MapNtn with match data.
-    ///
-    /// me.setCallback(callback4).nreplace(false);
-    /// //the above uses previous match result (note the 'false') which is OK,
-    /// //because, callback4 requires jp::MapNtn which was made available in the previous operation.
-    ///
-    /// //but the following is not OK: (assertion failure)
-    /// me.setCallback(callback2).nreplace(false);
-    /// //because, callback2 requires jp::MapNas data which is not available.
-    /// //now, this is OK:
-    /// me.setCallback(callback2).nreplace();
-    /// //because, it will recreate those match data including this one (jp::MapNas).
-    /// ```
-    ///
-    /// # Replace options
-    /// MatchEvaluator can not take replace options.
-    /// Replace options are taken directly by the replace functions: `nreplace()` and `replace()`.
-    ///
-    /// # Using as a match object
-    /// As it's just a subclass of RegexMatch, it can do all the things that RegexMatch can do, with some restrictions:
-    /// * matching options are modified to strip off bad options according to replacement (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT).
-    /// * match depends on the callback function. Only those vectors will be populated that are implemented by the callback functions so far
-    ///   (multiple callback function will set multiple match data vectors.)
-    /// * match vectors are internal to this class, you can not set them manually (without callback function). (you can get pointers to these vectors
-    ///   with `getNumberedSubstringVector()` and related functions).
-    ///
-    ///@see MatchEvaluatorCallback
-    ///@see RegexReplace::nreplace()
-    class MatchEvaluator: virtual public RegexMatch{
-        private:
-        friend class RegexReplace;
+    /** Provides public constructors to create RegexReplace objects.
+     * Every RegexReplace object should be associated with a Regex object.
+     * This class stores a pointer to its' associated Regex object, thus when
+     * the content of the associated Regex object is changed, there's no need to
+     * set the pointer again.
+     *
+     * Examples:
+     *
+     * ```cpp
+     * jp::Regex re;
+     * jp::RegexReplace rr;
+     * rr.setRegexObject(&re);
+     * rr.replace("subject", "me");  // returns 'subject'
+     * re.compile("\\w+");
+     * rr.replace();  // replaces 'subject' with 'me' i.e returns 'me'
+     * ```
+     */
+    class RegexReplace {
 
-        VecNum vec_num;
-        VecNas vec_nas;
-        VecNtN vec_ntn;
-        VecOff vec_soff;
-        VecOff vec_eoff;
-        int callbackn;
-        typename MatchEvaluatorCallback<void*, void*, void*>::Callback callback0;
-        typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback callback1;
-        typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback callback2;
-        typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback callback3;
-        typename MatchEvaluatorCallback<void*, void*, MapNtN const &>::Callback callback4;
-        typename MatchEvaluatorCallback<NumSub const &, void*, MapNtN const &>::Callback callback5;
-        typename MatchEvaluatorCallback<void*, MapNas const &, MapNtN const &>::Callback callback6;
-        typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback callback7;
-        //Q: Why the callback names seem random? is it random?
-        //A: No, it's not random, NumSub = 1, MapNas = 2, MapNtn = 4, thus:
-        //     NumSub + MapNas = 3
-        //     NumSub + MapNtn = 5
-        //     MapNas + MapNtn = 6
-        //     NumSub + MapNas + MapNtn = 7
-        //Q: Why is it like this?
-        //A: It's historical. Once, there was not this many callback declaration, there was only one (a templated one).
-        //   The nreplace function itself used to calculate a mode value according to available vectors
-        //   and determine what kind of callback function needed to be called.
-        //Q: Why the history changed?
-        //A: We had some compatibility issues with the single templated callback.
-        //   Also, this approach proved to be more readable and robust.
+    private:
 
-        PCRE2_SIZE buffer_size;
+        friend class Regex;
 
+        Regex const *re;
 
-        void init(){
-            callbackn = 0;
-            callback0 = callback::erase;
-            callback1 = 0;
-            callback2 = 0;
-            callback3 = 0;
-            callback4 = 0;
-            callback5 = 0;
-            callback6 = 0;
-            callback7 = 0;
-            setMatchStartOffsetVector(&vec_soff);
-            setMatchEndOffsetVector(&vec_eoff);
+        StringView r_subject;
+        StringView r_replw;
+        Uint replace_opts;
+        Uint jpcre2_replace_opts;
+        PCRE2_SIZE buffer_size;
+        PCRE2_SIZE _start_offset;
+        MatchData *mdata;
+        MatchContext *mcontext;
+        JitStackManager *jit_stack_manager;
+        ModifierTable const * modtab;
+        SIZE_T last_replace_count;
+        SIZE_T* last_replace_counter;
+        String out_buffer; //reused across calls of replaceBuffered() and replaceTo()
+        double size_ratio; //estimated ratio of output to subject length, learned from past calls
+        SIZE_T substitute_calls;
+        SIZE_T substitute_retries;
+        ReplacementTemplate const *rtemplate;
+
+        //State of a replace with a ReplacementTemplate, see templateStep().
+        struct TemplateState {
+            String* out;
+            StringView subject;
+            SIZE_T offset; //end of the previous match
+            SIZE_T count;
+            ReplacementTemplate const *rt;
+            Uint replace_opts;
+            int error;
+        };
+
+        //Match hook of replaceWithTemplate(): expands the template for the match in the match data block.
+        static bool templateStep(void* st, MatchData* md);
+
+        SIZE_T replaceWithTemplate(String& out);
+
+        void init_vars() {
+            re = 0;
+            r_subject = {};
+            r_replw = {};
+            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
+            jpcre2_replace_opts = 0;
             buffer_size = 0;
+            error_number = 0;
+            error_offset = 0;
+            _start_offset = 0;
+            mdata = 0;
+            mcontext = 0;
+            jit_stack_manager = 0;
+            modtab = 0;
+            last_replace_count = 0;
+            last_replace_counter = &last_replace_count;
+            size_ratio = 1.0;
+            substitute_calls = 0;
+            substitute_retries = 0;
+            rtemplate = 0;
         }
 
-        void setVectorPointersAccordingToCallback(){
-            switch(callbackn){
-                case 0: break;
-                case 1: setNumberedSubstringVector(&vec_num);break;
-                case 2: setNamedSubstringVector(&vec_nas);break;
-                case 3: setNumberedSubstringVector(&vec_num).setNamedSubstringVector(&vec_nas);break;
-                case 4: setNameToNumberMapVector(&vec_ntn);break;
-                case 5: setNumberedSubstringVector(&vec_num).setNameToNumberMapVector(&vec_ntn);break;
-                case 6: setNamedSubstringVector(&vec_nas).setNameToNumberMapVector(&vec_ntn);break;
-                case 7: setNumberedSubstringVector(&vec_num).setNamedSubstringVector(&vec_nas).setNameToNumberMapVector(&vec_ntn);break;
-            }
+        //Room for the output of pcre2_substitute (terminating zero included):
+        //#buffer_size if it was set, otherwise a guess from the learned ratio with some slack.
+        PCRE2_SIZE predictSize(PCRE2_SIZE subject_length) const {
+            if(buffer_size) return buffer_size + 1;
+            PCRE2_SIZE predicted = (PCRE2_SIZE)(subject_length * size_ratio);
+            return predicted + predicted / 8 + 16;
         }
 
-        void onlyCopy(MatchEvaluator const &me){
-            callbackn = me.callbackn;
-            callback0 = me.callback0;
-            callback1 = me.callback1;
-            callback2 = me.callback2;
-            callback3 = me.callback3;
-            callback4 = me.callback4;
-            callback5 = me.callback5;
-            callback6 = me.callback6;
-            callback7 = me.callback7;
-            //must update the pointers to point to this class vectors.
-            setVectorPointersAccordingToCallback();
-            buffer_size = me.buffer_size;
+        //An output longer than expected raises the ratio at once so the next call on a similar
+        //subject fits in one go, a shorter one lowers it slowly.
+        void learnSize(PCRE2_SIZE subject_length, PCRE2_SIZE output_length){
+            if(!subject_length) return;
+            double ratio = (double) output_length / subject_length;
+            if(ratio > size_ratio) size_ratio = ratio;
+            else size_ratio += (ratio - size_ratio) / 8;
         }
 
-        void deepCopy(MatchEvaluator const &me) {
-            vec_num = me.vec_num;
-            vec_nas = me.vec_nas;
-            vec_ntn = me.vec_ntn;
-            vec_soff = me.vec_soff;
-            vec_eoff = me.vec_eoff;
-            onlyCopy(me);
+        void onlyCopy(RegexReplace const &rr){
+            re = rr.re; //only pointer should be copied.
+            r_subject = rr.r_subject;
+            r_replw = rr.r_replw;
+            replace_opts = rr.replace_opts;
+            jpcre2_replace_opts = rr.jpcre2_replace_opts;
+            buffer_size = rr.buffer_size;
+            error_number = rr.error_number;
+            error_offset = rr.error_offset;
+            _start_offset = rr._start_offset;
+            mdata = rr.mdata;
+            mcontext = rr.mcontext;
+            jit_stack_manager = rr.jit_stack_manager;
+            modtab = rr.modtab;
+            last_replace_count = rr.last_replace_count;
+            last_replace_counter = (rr.last_replace_counter == &rr.last_replace_count) ? &last_replace_count
+                                                                                       : rr.last_replace_counter;
+            //the buffer is scratch memory, only the learned size is copied.
+            size_ratio = rr.size_ratio;
+            substitute_calls = rr.substitute_calls;
+            substitute_retries = rr.substitute_retries;
+            rtemplate = rr.rtemplate;
+        }
+
+        void deepCopy(RegexReplace const &rr){
+            onlyCopy(rr);
         }
 
         #ifdef JPCRE2_USE_MINIMUM_CXX_11
-        void deepMove(MatchEvaluator& me){
-            vec_num = std::move_if_noexcept(me.vec_num);
-            vec_nas = std::move_if_noexcept(me.vec_nas);
-            vec_ntn = std::move_if_noexcept(me.vec_ntn);
-            vec_soff = std::move_if_noexcept(me.vec_soff);
-            vec_eoff = std::move_if_noexcept(me.vec_eoff);
-            onlyCopy(me);
+        void deepMove(RegexReplace& rr){
+            onlyCopy(rr);
         }
         #endif
 
-        //prevent public access to some funcitons
-        MatchEvaluator& setNumberedSubstringVector(VecNum* v){
-            RegexMatch::setNumberedSubstringVector(v);
-            return *this;
-        }
-        MatchEvaluator& setNamedSubstringVector(VecNas* v){
-            RegexMatch::setNamedSubstringVector(v);
-            return *this;
-        }
-        MatchEvaluator& setNameToNumberMapVector(VecNtN* v){
-            RegexMatch::setNameToNumberMapVector(v);
-            return *this;
-        }
-        MatchEvaluator& setMatchStartOffsetVector(VecOff* v){
-            RegexMatch::setMatchStartOffsetVector(v);
-            return *this;
-        }
-        MatchEvaluator& setMatchEndOffsetVector(VecOff* v){
-            RegexMatch::setMatchEndOffsetVector(v);
-            return *this;
-        }
 
-        public:
+        protected:
 
-        ///Default constructor.
-        ///Sets callback::erase as the callback function.
-        ///Removes matched part/s from the subject string if the callback is not
-        ///changed.
-        /// ```cpp
-        /// jp::Regex re("\s*string");
-        /// jp::MatchEvaluator me;
-        /// std::cout<<
-        /// me.setRegexObject(&re);
-        ///   .setSubject("I am a   string");
-        ///   .nreplace();
-        /// //The above will delete '   string' from the subject
-        /// //thus the result will be 'I am a'
-        /// ```
-        explicit
-        MatchEvaluator():RegexMatch(){
-            init();
-        }
+        int error_number;
+        PCRE2_SIZE error_offset;
 
-        ///@overload
-        ///...
-        ///Constructor taking a Regex object pointer.
-        ///It sets the associated Regex object and
-        ///initializes the MatchEvaluator object with
-        ///callback::erase callback function.
-        ///Underlying data is not modified.
-        ///@param r constant Regex pointer.
-        explicit
-        MatchEvaluator(Regex const *r):RegexMatch(r){
-            init();
-        }
+    public:
 
-        ///@overload
-        ///...
-        ///Constructor taking a callback function.
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<void*, void*, void*>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///Default constructor
+        RegexReplace(){
+            init_vars();
         }
 
         ///@overload
         /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///Creates a RegexReplace object associating a Regex object.
+        ///Regex object is not modified.
+        ///@param r pointer to a Regex object
+        RegexReplace(Regex const *r) {
+            init_vars();
+            re = r;
         }
 
         ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///...
+        ///Copy constructor.
+        ///@param rr RegexReplace object reference
+        RegexReplace(RegexReplace const &rr){
+            init_vars();
+            deepCopy(rr);
         }
 
-        ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, void*,  MapNtN const &>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///Overloaded Copy assignment operator.
+        ///@param rr RegexReplace object reference
+        ///@return A reference to the calling RegexReplace object
+        RegexReplace& operator=(RegexReplace const &rr){
+            if(this == &rr) return *this;
+            deepCopy(rr);
+            return *this;
         }
 
+        #ifdef JPCRE2_USE_MINIMUM_CXX_11
+
         ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///...
+        ///Move constructor.
+        ///This constructor steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param rr rvalue reference to a RegexReplace object reference
+        RegexReplace(RegexReplace&& rr){
+            init_vars();
+            deepMove(rr);
         }
 
         ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///...
+        ///Overloaded move assignment operator.
+        ///This constructor steals resources from the argument.
+        ///It leaves the argument in a valid but indeterminate sate.
+        ///The indeterminate state can be returned to normal by calling reset() on that object.
+        ///@param rr rvalue reference to a RegexReplace object reference
+        ///@return A reference to the calling RegexReplace object
+        RegexReplace& operator=(RegexReplace&& rr){
+            if(this == &rr) return *this;
+            deepMove(rr);
+            return *this;
         }
 
+        #endif
 
-        ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<void*, MapNas const &,  MapNtN const &>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
-        }
+        virtual ~RegexReplace() {}
 
+        ///Reset all class variables to its default (initial) state including memory.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& reset() {
+            init_vars();
+            String().swap(out_buffer);
+            return *this;
+        }
 
+        ///Clear all class variables to its default (initial) state (some memory may retain for further use).
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& clear() {
+            init_vars();
+            out_buffer.clear();
+            return *this;
+        }
 
-        ///@overload
-        /// ...
-        ///It calls a corresponding MatchEvaluator::setCallback() function to set the callback function.
-        ///@param mef Callback function.
-        explicit
-        MatchEvaluator(typename MatchEvaluatorCallback<void*, void*,  MapNtN const &>::Callback mef): RegexMatch(){
-            init();
-            setCallback(mef);
+        ///Reset replace related errors to zero.
+        ///@return Reference to the calling RegexReplace object
+        ///@see Regex::resetErrors()
+        ///@see RegexMatch::resetErrors()
+        RegexReplace& resetErrors(){
+            error_number = 0;
+            error_offset = 0;
+            return *this;
         }
 
+        /// Returns the last error number
+        ///@return Last error number
+        int getErrorNumber() const {
+            return error_number;
+        }
 
+        /// Returns the last error offset
+        ///@return Last error offset
+        int getErrorOffset() const  {
+            return (int)error_offset;
+        }
 
-        ///@overload
-        /// ...
-        ///Copy constructor.
-        ///@param me Reference to MatchEvaluator object
-        MatchEvaluator(MatchEvaluator const &me): RegexMatch(me){
-            init();
-            deepCopy(me);
+        /// Returns the last error message
+        ///@return Last error message
+        String getErrorMessage() const  {
+            #ifdef JPCRE2_USE_MINIMUM_CXX_11
+            return select<Char, Map>::getErrorMessage(error_number, error_offset);
+            #else
+            return select<Char>::getErrorMessage(error_number, error_offset);
+            #endif
         }
 
-        ///Overloaded copy-assignment operator
-        ///@param me MatchEvaluator object
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& operator=(MatchEvaluator const &me){
-            if(this == &me) return *this;
-            RegexMatch::operator=(me);
-            deepCopy(me);
-            return *this;
+        /// Get replacement string
+        ///@return replacement string
+        StringView getReplaceWith() const  {
+            return r_replw;
         }
 
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-
-        ///@overload
-        /// ...
-        ///Move constructor.
-        ///This constructor steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param me rvalue reference to a MatchEvaluator object
-        MatchEvaluator(MatchEvaluator&& me): RegexMatch(me){
-            init();
-            deepMove(me);
+        /// Get the replacement template
+        ///@return Pointer to the ReplacementTemplate, null if none is set.
+        ReplacementTemplate const * getReplacementTemplate() const {
+            return rtemplate;
         }
 
-        ///@overload
-        ///...
-        ///Overloaded move-assignment operator.
-        ///It steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param me rvalue reference to a MatchEvaluator object
-        ///@return A reference to the calling MatchEvaluator object.
-        ///@see MatchEvaluator(MatchEvaluator&& me)
-        MatchEvaluator& operator=(MatchEvaluator&& me){
-            if(this == &me) return *this;
-            RegexMatch::operator=(me);
-            deepMove(me);
-            return *this;
+        /// Get subject string
+        ///@return subject string
+        ///@see RegexMatch::getSubject()
+        StringView getSubject() const  {
+            return r_subject;
         }
 
-        #endif
 
-        virtual ~MatchEvaluator(){}
+        /// Calculate modifier string from PCRE2 and JPCRE2 options and return it.
+        ///
+        /// Do remember that modifiers (or PCRE2 and JPCRE2 options) do not change or get initialized
+        /// as long as you don't do that explicitly. Calling RegexReplace::setModifier() will re-set them.
+        ///
+        /// **Mixed or combined modifier**.
+        ///
+        /// Some modifier may include other modifiers i.e they have the same meaning of some modifiers
+        /// combined together. For example, the 'n' modifier includes the 'u' modifier and together they
+        /// are equivalent to `PCRE2_UTF | PCRE2_UCP`. When you set a modifier like this, both options
+        /// get set, and when you remove the 'n' modifier (with `RegexReplace::changeModifier()`), both will get removed.
+        /// @return Calculated modifier string (std::string)
+        ///@see RegexMatch::getModifier()
+        ///@see Regex::getModifier()
+        std::string getModifier() const {
+            return modtab ? modtab->fromReplaceOption(replace_opts, jpcre2_replace_opts)
+                          : MOD::fromReplaceOption(replace_opts, jpcre2_replace_opts);
+        }
 
-        ///Member function to set a callback function with no vector reference.
-        ///Callback function is always overwritten. The implemented vectors are set to be filled with match data.
-        ///Other vectors that were set previously, are not unset and thus they will be filled with match data too
-        ///when `match()` or `nreplace()` is called.
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, void*, void*>::Callback mef){
-            callback0 = mef;
-            callbackn = 0;
-            return *this;
+        ///Get the modifier table that is set,
+        ///@return constant ModifierTable pointer.
+        ModifierTable const* getModifierTable(){
+            return modtab;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::NumSub vector.
-        ///You will be working with a reference to the constant vector.
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, void*, void*>::Callback mef){
-            callback1 = mef;
-            callbackn = 1;
-            setNumberedSubstringVector(&vec_num);
-            return *this;
+        ///Get start offset.
+        ///@return the start offset where matching starts for replace operation
+        PCRE2_SIZE getStartOffset() const {
+            return _start_offset;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::NumSub and jp::MapNas.
-        ///You will be working with references of the constant vectors.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_nas["word"]; //wrong
-        ///map_nas.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNas mn = map_nas;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, void*>::Callback mef){
-            callback3 = mef;
-            callbackn = 3;
-            setNumberedSubstringVector(&vec_num);
-            setNamedSubstringVector(&vec_nas);
-            return *this;
+        /// Get PCRE2 option
+        ///@return PCRE2 option for replace
+        ///@see Regex::getPcre2Option()
+        ///@see RegexMatch::getPcre2Option()
+        Uint getPcre2Option() const  {
+            return replace_opts;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::NumSub and jp::MapNtN.
-        ///You will be working with references of the constant vectors.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_ntn["word"]; //wrong
-        ///map_ntn.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNtN mn = map_ntn;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, void*,  MapNtN const &>::Callback mef){
-            callback5 = mef;
-            callbackn = 5;
-            setNumberedSubstringVector(&vec_num);
-            setNameToNumberMapVector(&vec_ntn);
-            return *this;
+        /// Get JPCRE2 option
+        ///@return JPCRE2 option  for replace
+        ///@see Regex::getJpcre2Option()
+        ///@see RegexMatch::getJpcre2Option()
+        Uint getJpcre2Option() const  {
+            return jpcre2_replace_opts;
         }
 
+        ///Get a pointer to the associated Regex object.
+        ///If no actual Regex object is associated, null is returned
+        ///@return A pointer to the associated constant Regex object or null
+        Regex const * getRegexObject() const {
+            return re;
+        }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::NumSub, jp::MapNas, jp::MapNtN.
-        ///You will be working with references of the constant vectors.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_nas["word"]; //wrong
-        ///map_nas.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNas mn = map_nas;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<NumSub const &, MapNas const &, MapNtN const &>::Callback mef){
-            callback7 = mef;
-            callbackn = 7;
-            setNumberedSubstringVector(&vec_num);
-            setNamedSubstringVector(&vec_nas);
-            setNameToNumberMapVector(&vec_ntn);
-            return *this;
+        ///Return pointer to the match context that was previously set with setMatchContext().
+        ///Handling memory is the callers' responsibility.
+        ///@return pointer to the match context (default: null).
+        MatchContext* getMatchContext(){
+            return mcontext;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::MapNas.
-        ///You will be working with reference of the constant vector.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_nas["word"]; //wrong
-        ///map_nas.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNas mn = map_nas;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, MapNas const &, void*>::Callback mef){
-            callback2 = mef;
-            callbackn = 2;
-            setNamedSubstringVector(&vec_nas);
-            return *this;
+        ///Get the JitStackManager that was set with setJitStackManager().
+        ///@return Pointer to JitStackManager object (default: null).
+        JitStackManager* getJitStackManager() const {
+            return jit_stack_manager;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::MapNas, jp::MapNtN.
-        ///You will be working with reference of the constant vector.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_nas["word"]; //wrong
-        ///map_nas.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNas mn = map_nas;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, MapNas const &,  MapNtN const &>::Callback mef){
-            callback6 = mef;
-            callbackn = 6;
-            setNamedSubstringVector(&vec_nas);
-            setNameToNumberMapVector(&vec_ntn);
-            return *this;
+        ///Get the pointer to the match data block that was set previously with setMatchData()
+        ///Handling memory is the callers' responsibility.
+        ///@return pointer to the match data (default: null).
+        virtual MatchData* getMatchDataBlock(){
+            return mdata;
         }
 
-        ///@overload
-        /// ...
-        ///Sets a callback function with a jp::MapNtN.
-        ///You will be working with references of the constant vectors.
-        ///For maps, you won't be able to use `[]` operator with reference to constant map, use at() instead:
-        ///```cpp
-        ///map_ntn["word"]; //wrong
-        ///map_ntn.at("word"); //ok
-        ///```
-        ///If you want to use `[]` operator with maps, make a copy:
-        ///```cpp
-        ///jp::MapNtN mn = map_ntn;
-        ///mn["word"]; //ok
-        ///```
-        ///@param mef Callback function.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setCallback(typename MatchEvaluatorCallback<void*, void*,  MapNtN const &>::Callback mef){
-            callback4 = mef;
-            callbackn = 4;
-            setNameToNumberMapVector(&vec_ntn);
-            return *this;
+        ///Get the initial buffer size that is being used by internal function pcre2_substitute
+        ///@return buffer_size
+        PCRE2_SIZE getBufferSize(){
+            return buffer_size;
         }
 
-        ///Clear match data.
-        ///It clears all match data from all vectors (without shrinking).
-        ///For shrinking the vectors, use `resetMatchData()`
-        ///A call to `match()`  or nreplace() will be required to produce match data again.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& clearMatchData(){
-            vec_num.clear();
-            vec_nas.clear();
-            vec_ntn.clear();
-            vec_soff.clear();
-            vec_eoff.clear();
-            return *this;
+        ///Get the number of replacement in last replace operation.
+        ///If you set an external counter with RegexReplace::setReplaceCounter(),
+        ///a call to this getter method will dereference the pointer to the external counter
+        ///and return the value.
+        ///@return Last replace count
+        SIZE_T getLastReplaceCount(){
+            return *last_replace_counter;
         }
 
-        ///Reset match data to initial state.
-        ///It deletes all match data from all vectors shrinking their capacity.
-        ///A call to `match()`  or nreplace() will be required to produce match data again.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& resetMatchData(){
-            VecNum().swap(vec_num);
-            VecNas().swap(vec_nas);
-            VecNtN().swap(vec_ntn);
-            VecOff().swap(vec_soff);
-            VecOff().swap(vec_eoff);
-            return *this;
+        ///Get the number of pcre2_substitute calls made by this object.
+        ///@return Number of substitute calls, retries included.
+        ///@see getSubstituteRetryCount()
+        SIZE_T getSubstituteCallCount() const {
+            return substitute_calls;
         }
 
-
-        ///Reset MatchEvaluator to initial state including memory.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& reset(){
-            RegexMatch::reset();
-            resetMatchData();
-            init();
-            return *this;
+        ///Get the number of pcre2_substitute calls that had to be made again because
+        ///the output didn't fit in the room given to it.
+        ///The room comes from RegexReplace::setBufferSize() if it was set, otherwise it is predicted
+        ///from the output to subject length ratio of previous calls, thus repeated replaces
+        ///on similar subjects should call pcre2_substitute only once.
+        ///@return Number of substitute retries.
+        SIZE_T getSubstituteRetryCount() const {
+            return substitute_retries;
         }
 
-        ///Clears MatchEvaluator.
-        ///Returns everything to initial state (some memory may retain for further and faster use).
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& clear(){
-            RegexMatch::clear();
-            clearMatchData();
-            init();
+        ///Reset the substitute call and retry counters to zero.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& resetSubstituteCounters(){
+            substitute_calls = 0;
+            substitute_retries = 0;
             return *this;
         }
 
-        ///Call RegexMatch::resetErrors().
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& resetErrors(){
-            RegexMatch::resetErrors();
+        ///Set an external counter variable to store the replacement count.
+        ///This counter will be updated after each replacement operation on this object.
+        ///A call to this method will reset the internal counter to 0, thus when you reset the counter
+        ///to internal counter (by giving null as param), the previous replace count won't be available.
+        ///@param counter Pointer to a counter variable. Null sets the counter to default internal counter.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& setReplaceCounter(SIZE_T* counter){
+            last_replace_count = 0;
+            last_replace_counter = counter ? counter : &last_replace_count;
             return *this;
         }
 
-        ///Call RegexMatch::setRegexObject(r).
-        ///@param r constant Regex object pointer
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setRegexObject (Regex const *r){
-            RegexMatch::setRegexObject(r);
+        ///Set the associated Regex object.
+        ///Regex object is not modified.
+        ///@param r Pointer to a Regex object.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& setRegexObject(Regex const *r){
+            re = r;
             return *this;
         }
 
-        ///Call RegexMatch::setSubject(StringView s).
-        ///@param s subject string.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setSubject (StringView s){
-            RegexMatch::setSubject(s);
+        /// Set the subject string for replace.
+        ///This makes a copy of the string. If no copy is desired or you are working
+        ///with big text, consider passing by pointer.
+        ///@param s Subject string
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::setSubject()
+        RegexReplace& setSubject(StringView s) {
+            r_subject = s;
             return *this;
         }
 
-        ///Call RegexMatch::setModifier(Modifier const& s).
-        ///@param s modifier string.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setModifier (Modifier const& s){
-            RegexMatch::setModifier(s);
+        /// Set the replacement string.
+        ///`$` is a special character which implies captured group.
+        ///
+        ///1. A numbered substring can be referenced with `$n` or `${n}` where n is the group number.
+        ///2. A named substring can be referenced with `${name}`, where 'name' is the group name.
+        ///3. A literal `$` can be given as `$$`.
+        ///
+        ///**Note:** This function makes a copy of the string. If no copy is desired or
+        ///you are working with big text, consider passing the string with pointer.
+        ///
+        ///@param s String to replace with
+        ///@return Reference to the calling RegexReplace object
+        RegexReplace& setReplaceWith(StringView s) {
+            r_replw = s;
             return *this;
         }
 
-        ///Call RegexMatch::setModifierTable(ModifierTable const * s).
-        ///@param mdt pointer to ModifierTable object.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setModifierTable (ModifierTable const * mdt){
-            RegexMatch::setModifierTable(mdt);
+        ///Set a compiled replacement template, it is used instead of the replacement string.
+        ///Matches are expanded straight from the ovector, the template is not parsed again.
+        ///pcre2_substitute() is used with the string of the template when the template can't be used
+        ///(see ReplacementTemplate).
+        ///The template is not copied, it must outlive its use by this object.
+        ///@param rt Pointer to a ReplacementTemplate, null to use the replacement string again.
+        ///@return Reference to the calling RegexReplace object
+        RegexReplace& setReplacementTemplate(ReplacementTemplate const *rt) {
+            rtemplate = rt;
             return *this;
         }
 
-        ///Call RegexMatch::setJpcre2Option(Uint x).
-        ///@param x JPCRE2 option value.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setJpcre2Option (Uint x){
-            RegexMatch::setJpcre2Option(x);
-            return *this;
+        /// Set the modifier string (resets all JPCRE2 and PCRE2 options) by calling RegexReplace::changeModifier().
+        ///@param s Modifier string.
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::setModifier()
+        ///@see Regex::setModifier()
+        RegexReplace& setModifier(Modifier const& s) {
+            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH; /* must not be initialized to 0 */
+            jpcre2_replace_opts = 0;
+            return changeModifier(s, true);
         }
 
-        ///Call RegexMatch::setPcre2Option (Uint x).
-        ///@param x PCRE2 option value.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setPcre2Option (Uint x){
-            RegexMatch::setPcre2Option(x);
+        ///Set a custom modifier table to be used.
+        ///@param mdt pointer to ModifierTable object.
+        /// @return Reference to the calling RegexReplace object.
+        RegexReplace& setModifierTable(ModifierTable const * mdt){
+            modtab = mdt;
             return *this;
         }
 
-        ///Call RegexMatch::setFindAll(bool x).
-        ///@param x true if global match, false otherwise.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setFindAll (bool x){
-            RegexMatch::setFindAll(x);
+        /// Set the initial buffer size to be allocated for replaced string (used by PCRE2)
+        /// When it is 0 (default), the size is predicted from the output to subject length
+        /// ratio of previous calls on this object.
+        ///@param x Buffer size
+        ///@return Reference to the calling RegexReplace object
+        ///@see getSubstituteRetryCount()
+        RegexReplace& setBufferSize(PCRE2_SIZE x) {
+            buffer_size = x;
             return *this;
         }
 
-        ///Call RegexMatch::setFindAll().
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setFindAll(){
-            RegexMatch::setFindAll();
+        ///Set start offset.
+        ///Set the offset where matching starts for replace operation
+        ///@param start_offset The offset where matching starts for replace operation
+        ///@return Reference to the calling RegexReplace object
+        RegexReplace& setStartOffset(PCRE2_SIZE start_offset){
+            _start_offset = start_offset;
             return *this;
         }
 
-        ///Call RegexMatch::setStartOffset (PCRE2_SIZE offset).
-        ///@param offset match start offset in the subject.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setStartOffset (PCRE2_SIZE offset){
-            RegexMatch::setStartOffset(offset);
+        /// Set JPCRE2 option for replace (overwrite existing option)
+        ///@param x Option value
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::setJpcre2Option()
+        ///@see Regex::setJpcre2Option()
+
+        RegexReplace& setJpcre2Option(Uint x) {
+            jpcre2_replace_opts = x;
             return *this;
         }
 
-        ///Call RegexMatch::setMatchContext(MatchContext *match_context).
-        ///@param match_context pointer to match context.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setMatchContext (MatchContext *match_context){
-            RegexMatch::setMatchContext(match_context);
+        /// Set PCRE2 option replace (overwrite existing option)
+        ///@param x Option value
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::setPcre2Option()
+        ///@see Regex::setPcre2Option()
+
+        RegexReplace& setPcre2Option(Uint x) {
+            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH | x;
             return *this;
         }
 
-        ///Call RegexMatch::setMatchDataBlock(MatchContext * mdt);
-        ///@param mdt pointer to match data block
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setMatchDataBlock(MatchData* mdt){
-            RegexMatch::setMatchDataBlock(mdt);
+        ///Set the match context to be used.
+        ///Native PCRE2 API may be used to create match context.
+        ///The memory of the match context is not handled by RegexReplace object and not freed.
+        ///User will be responsible for freeing memory.
+        ///@param match_context Pointer to match context.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& setMatchContext(MatchContext * match_context){
+            mcontext = match_context;
             return *this;
         }
 
-        ///Set the buffer size that will be used by pcre2_substitute (replace()).
-        ///If buffer size proves to be enough to fit the resultant string
-        ///from each match (not the total resultant string), it will yield one less call
-        ///to pcre2_substitute for each match.
-        ///@param x buffer size.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& setBufferSize(PCRE2_SIZE x){
-            buffer_size = x;
+        ///Set the JitStackManager that provides JIT stacks for the matches.
+        ///It is used only when no match context is set with setMatchContext().
+        ///The JitStackManager object must outlive the RegexReplace object.
+        ///@param jsm Pointer to JitStackManager object (null to not use one).
+        ///@return Reference to the calling RegexReplace object.
+        ///@see JitStackManager
+        RegexReplace& setJitStackManager(JitStackManager *jsm){
+            jit_stack_manager = jsm;
             return *this;
         }
 
-        ///Get the initial buffer size that is being used by internal function pcre2_substitute
-        ///@return buffer_size
-        PCRE2_SIZE getBufferSize(){
-            return buffer_size;
+        ///Set the match data block to be used.
+        ///Native PCRE2 API may be used to create match data block.
+        ///The memory of the match data is not handled by RegexReplace object and not freed.
+        ///User will be responsible for creating/freeing memory.
+        ///@param match_data Pointer to match data.
+        ///@return Reference to the calling RegexReplace object.
+        RegexReplace& setMatchDataBlock(MatchData *match_data){
+            mdata = match_data;
+            return *this;
         }
 
-        ///Call RegexMatch::changeModifier(Modifier const& mod, bool x).
-        ///@param mod modifier string.
-        ///@param x true (add) or false (remove).
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& changeModifier (Modifier const& mod, bool x){
-            RegexMatch::changeModifier(mod, x);
+        /// After a call to this function PCRE2 and JPCRE2 options will be properly set.
+        /// This function does not initialize or re-initialize options.
+        /// If you want to set options from scratch, initialize them to 0 before calling this function.
+        ///
+        /// If invalid modifier is detected, then the error number for the RegexReplace
+        /// object will be jpcre2::ERROR::INVALID_MODIFIER and error offset will be the modifier character.
+        /// You can get the message with RegexReplace::getErrorMessage() function.
+        /// @param mod Modifier string.
+        /// @param x Whether to add or remove option
+        /// @return Reference to the RegexReplace object
+        /// @see Regex::changeModifier()
+        /// @see RegexMatch::changeModifier()
+        RegexReplace& changeModifier(Modifier const& mod, bool x){
+            modtab ? modtab->toReplaceOption(mod, x, &replace_opts, &jpcre2_replace_opts, &error_number, &error_offset)
+                   : MOD::toReplaceOption(mod, x, &replace_opts, &jpcre2_replace_opts, &error_number, &error_offset);
             return *this;
         }
 
-        ///Call RegexMatch::changeJpcre2Option(Uint opt, bool x).
-        ///@param opt JPCRE2 option
-        ///@param x true (add) or false (remove).
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& changeJpcre2Option (Uint opt, bool x){
-            RegexMatch::changeJpcre2Option(opt, x);
+        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
+        /// Add or remove a JPCRE2 option
+        /// @param opt JPCRE2 option value
+        /// @param x Add the option if it's true, remove otherwise.
+        /// @return Reference to the calling RegexReplace object
+        /// @see RegexMatch::changeJpcre2Option()
+        /// @see Regex::changeJpcre2Option()
+        RegexReplace& changeJpcre2Option(Uint opt, bool x) {
+            jpcre2_replace_opts = x ? jpcre2_replace_opts | opt : jpcre2_replace_opts & ~opt;
             return *this;
         }
 
-        ///Call RegexMatch::changePcre2Option(Uint opt, bool x).
-        ///@param opt PCRE2 option.
-        ///@param x true (add) or false (remove).
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& changePcre2Option (Uint opt, bool x){
-            RegexMatch::changePcre2Option(opt, x);
+        /// Add or remove a PCRE2 option
+        /// @param opt PCRE2 option value
+        /// @param x Add the option if it's true, remove otherwise.
+        /// @return Reference to the calling RegexReplace object
+        /// @see RegexMatch::changePcre2Option()
+        /// @see Regex::changePcre2Option()
+        RegexReplace& changePcre2Option(Uint opt, bool x) {
+            replace_opts = x ? replace_opts | opt : replace_opts & ~opt;
+            //replace_opts |= PCRE2_SUBSTITUTE_OVERFLOW_LENGTH; /* It's important, but let user override it. */
             return *this;
         }
 
-        ///Call RegexMatch::addModifier(Modifier const& mod).
-        ///@param mod modifier string.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& addModifier (Modifier const& mod){
-            RegexMatch::addModifier(mod);
-            return *this;
+        /// Parse modifier string and add equivalent PCRE2 and JPCRE2 options.
+        /// This is just a wrapper of the original function RegexReplace::changeModifier()
+        /// provided for convenience.
+        /// @param mod Modifier string.
+        /// @return Reference to the calling RegexReplace object
+        /// @see RegexMatch::addModifier()
+        /// @see Regex::addModifier()
+        RegexReplace& addModifier(Modifier const& mod){
+            return changeModifier(mod, true);
         }
 
-        ///Call RegexMatch::addJpcre2Option(Uint x).
-        ///@param x JPCRE2 option.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& addJpcre2Option (Uint x){
-            RegexMatch::addJpcre2Option(x);
+        /// Add specified JPCRE2 option to existing options for replace.
+        ///@param x Option value
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::addJpcre2Option()
+        ///@see Regex::addJpcre2Option()
+        RegexReplace& addJpcre2Option(Uint x) {
+            jpcre2_replace_opts |= x;
             return *this;
         }
 
-        ///Call RegexMatch::addPcre2Option(Uint x).
-        ///@param x PCRE2 option.
-        ///@return A reference to the calling MatchEvaluator object.
-        MatchEvaluator& addPcre2Option (Uint x){
-            RegexMatch::addPcre2Option(x);
+        /// Add specified PCRE2 option to existing options for replace
+        ///@param x Option value
+        ///@return Reference to the calling RegexReplace object
+        ///@see RegexMatch::addPcre2Option()
+        ///@see Regex::addPcre2Option()
+        RegexReplace& addPcre2Option(Uint x) {
+            replace_opts |= x;
             return *this;
         }
 
-        ///Perform match and return the match count.
-        ///This function strips off matching options (PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT) that are considered
-        ///bad options for replacement operation and then calls
-        ///RegexMatch::match() to perform the match.
-        ///@return match count.
-        SIZE_T match(void){
-            //remove bad matching options
-            RegexMatch::changePcre2Option(PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT, false);
-            return RegexMatch::match();
+        /// Perform regex replace by retrieving subject string, replacement string, modifier and other options from class variables.
+        /// In the replacement string (see RegexReplace::setReplaceWith()) `$` is a special character which implies captured group.
+        /// 1. A numbered substring can be referenced with `$n` or `${n}` where n is the group number.
+        /// 2. A named substring can be referenced with `${name}`, where 'name' is the group name.
+        /// 3. A literal `$` can be given as `$$`.
+        /// 4. Bash like features: ${<n>:-<string>} and ${<n>:+<string1>:<string2>}, where <n> is a group number or name.
+        ///
+        ///All options supported by pcre2_substitute is available.
+        ///
+        /// Note: This function calls pcre2_substitute() to do the replacement.
+        ///@return Replaced string
+        String replace(void){
+            String res;
+            replace(res);
+            return res;
+        }
+
+        /// Perform regex replace and append the replaced string to `out`.
+        /// pcre2_substitute() writes straight into `out`, so passing the same string
+        /// over and over (after a `clear()`) reuses its storage and no temporary buffer is allocated.
+        /// The room given to pcre2_substitute() is zero-filled by `std::basic_string::resize()`
+        /// before each call, unless the standard library has `resize_and_overwrite()` (C++23).
+        /// On error, the subject string is appended in place of the result.
+        /// `out` must not be the subject string.
+        ///@param out String the result is appended to.
+        ///@return Number of replacement done.
+        ///@see replace()
+        SIZE_T replace(String& out);
+
+        /// Perform regex replace into the internal buffer of this object.
+        /// The buffer is kept across calls, so once it has grown big enough
+        /// no memory is allocated.
+        ///@return View of the replaced string, valid until the next call that modifies this object.
+        ///@see replace(String&)
+        StringView replaceBuffered(){
+            out_buffer.clear();
+            replace(out_buffer);
+            return StringView(out_buffer);
+        }
+
+        /// Perform regex replace and write the replaced string to an output iterator.
+        /// pcre2_substitute() needs contiguous memory, the result goes through
+        /// the internal buffer (see replaceBuffered()).
+        ///@param it Output iterator, e.g `std::back_inserter(vec)`.
+        ///@return The output iterator past the last character written.
+        ///@see replace(String&)
+        template<typename OutputIterator>
+        OutputIterator replaceTo(OutputIterator it){
+            StringView res = replaceBuffered();
+            return std::copy(res.begin(), res.end(), it);
         }
 
-        ///Perform regex replace with this match evaluator.
-        ///This is a JPCRE2 native replace function (thus the name nreplace).
-        ///It uses the `MatchEvaluatorCallback` function that was set with a constructor or `MatchEvaluator::setCallback()` function
-        ///to generate the replacement strings on the fly.
+        ///JPCRE2 native replace function.
+        ///A different name is adopted to
+        ///distinguish itself from the regular replace() function which
+        ///uses pcre2_substitute() to do the replacement; contrary to that,
+        ///it will provide a JPCRE2 native way of replacement operation.
+        ///It takes a MatchEvaluator object which provides a callback function that is used
+        ///to generate replacement string on the fly. Any replacement string set with
+        ///`RegexReplace::setReplaceWith()` function will have no effect.
         ///The string returned by the callback function will be treated as literal and will
         ///not go through any further processing.
         ///
-        ///This function performs a new match everytime it is called unless it is passed with a boolean `false` as the first argument.
-        ///To use existing match data that was created by a previous `MatchEvaluator::nreplace()` or `MatchEvaluator::match()`, call this
-        ///function with boolean `false` as the first argument.
-        ///
-        ///## Complexity
-        /// 1. Changes in replace related option takes effect without a re-match.
-        /// 2. Changes in match related option (e.g start offset) needs a re-match to take effect.
-        /// 3. To re-use existing match data, callback function must be compatible with the data, otherwise assertion error.
-        /// 4. If the associated Regex object or subject string changes, a new match must be performed,
-        ///    trying to use the existing match data in such cases is undefined behavior.
+        ///This function works on a copy of the MatchEvaluator, and thus makes no changes
+        ///to the original. The copy is modified as below:
         ///
-        ///@param do_match Perform a new matching operation if true, otherwise use existing match data.
-        ///@param jro JPCRE2 replace options.
-        ///@param counter Pointer to a counter to store the number of replacement done.
-        ///@return resultant string after replace.
-        ///@see MatchEvaluator.
-        ///@see MatchEvaluatorCallback.
-        String nreplace(bool do_match=true, Uint jro=0, SIZE_T* counter=0);
-
-        ///PCRE2 compatible replace function that uses this MatchEvaluator.
-        ///Performs regex replace with pcre2_substitute function
-        ///by generating the replacement strings dynamically with MatchEvaluator callback.
-        ///The string returned by callback function is processed by internal pcre2_substitute, thus allowing
-        ///all options that are provided by PCRE2 itself.
+        ///1. Global replacement will set FIND_ALL for match, unset otherwise.
+        ///2. Bad matching options such as `PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT` will be removed.
+        ///3. subject, start_offset and Regex object will change according to the RegexReplace object.
+        ///4. match context, and match data block will be changed according to the RegexReplace object.
         ///
-        ///This function performs a new match everytime it is called unless it is passed with a boolean `false` as the first argument.
+        ///It calls MatchEvaluator::nreplace() on the MatchEvaluator object to perform the replacement.
         ///
-        ///## Complexity
-        /// 1. Changes in replace related option takes effect without a re-match.
-        /// 2. Changes in match related option (e.g start offset) needs a re-match to take effect.
-        /// 3. To re-use existing match data, callback function must be compatible with the data, otherwise assertion error.
-        /// 4. If the associated Regex object or subject string changes, a new match must be performed,
-        ///    trying to use the existing match data in such cases is undefined behavior.
+        ///It always performs a new match.
+        ///@param me A MatchEvaluator object.
+        ///@return The resultant string after replacement.
+        ///@see MatchEvaluator::nreplace()
+        ///@see MatchEvaluator
+        ///@see MatchEvaluatorCallback
+        String nreplace(MatchEvaluator me){
+            return me.setRegexObject(getRegexObject())
+                     .setSubject(getSubject())
+                     .setFindAll((getPcre2Option() & PCRE2_SUBSTITUTE_GLOBAL)!=0)
+                     .setMatchContext(getMatchContext())
+                     .setJitStackManager(getJitStackManager())
+                     .setMatchDataBlock(getMatchDataBlock())
+                     .setStartOffset(getStartOffset())
+                     .nreplace(true, getJpcre2Option(), last_replace_counter);
+        }
+
+        ///PCRE2 compatible replace function that takes a MatchEvaluator.
+        ///String returned by callback function is processed by pcre2_substitute,
+        ///thus all PCRE2 substitute options are supported by this replace function.
         ///
-        ///@param do_match perform a new match if true, otherwise use existing data.
-        ///@param ro replace related PCRE2 options.
-        ///@param counter Pointer to a counter to store the number of replacement done.
-        ///@return resultant string after replacement.
-        String replace(bool do_match=true, Uint ro=0, SIZE_T* counter=0);
+        ///It always performs a new match.
+        ///@param me MatchEvaluator instance, (copied and modified according to this object).
+        ///@return resultant string.
+        ///@see replace()
+        String replace(MatchEvaluator me){
+            return me.setRegexObject(getRegexObject())
+                     .setSubject(getSubject())
+                     .setFindAll((getPcre2Option() & PCRE2_SUBSTITUTE_GLOBAL)!=0)
+                     .setMatchContext(getMatchContext())
+                     .setJitStackManager(getJitStackManager())
+                     .setMatchDataBlock(getMatchDataBlock())
+                     .setBufferSize(getBufferSize())
+                     .setStartOffset(getStartOffset())
+                     .replace(true, getPcre2Option(), last_replace_counter);
+        }
     };
 
-    /** Provides public constructors to create RegexReplace objects.
-     * Every RegexReplace object should be associated with a Regex object.
-     * This class stores a pointer to its' associated Regex object, thus when
-     * the content of the associated Regex object is changed, there's no need to
-     * set the pointer again.
+
+    /** Provides public constructors to create Regex object.
+     * Each regex pattern needs an object of this class and each pattern needs to be compiled.
+     * Pattern compilation can be done using one of its' overloaded constructors or the `Regex::compile()`
+     * member function.
      *
      * Examples:
      *
      * ```cpp
-     * jp::Regex re;
-     * jp::RegexReplace rr;
-     * rr.setRegexObject(&re);
-     * rr.replace("subject", "me");  // returns 'subject'
-     * re.compile("\\w+");
-     * rr.replace();  // replaces 'subject' with 'me' i.e returns 'me'
+     * jp::Regex re; //does not perform a compile
+     * re.compile("pattern", "modifier");
+     * jp::Regex re2("pattern", "modifier"); //performs a compile
      * ```
+     *
      */
-    class RegexReplace {
+    class Regex {
 
     private:
 
-        friend class Regex;
-
-        Regex const *re;
+        friend class RegexMatch;
+        friend class RegexReplace;
+        friend class MatchEvaluator;
+        friend class MatchRange;
+        friend class RegexSet;
+        friend class StreamMatcher;
+        friend class ReplacementTemplate;
+        friend class RewriteSet;
 
-        StringView r_subject;
-        StringView r_replw;
-        Uint replace_opts;
-        Uint jpcre2_replace_opts;
-        PCRE2_SIZE buffer_size;
-        PCRE2_SIZE _start_offset;
-        MatchData *mdata;
-        MatchContext *mcontext;
+        StringView pat_str;
+        Pcre2Code *code;
+        CodePtr code_ref; //owns code
+        Uint compile_opts;
+        Uint jpcre2_compile_opts;
+        Uint newline;
         ModifierTable const * modtab;
-        SIZE_T last_replace_count;
-        SIZE_T* last_replace_counter;
+        RegexCache * regex_cache;
 
-        void init_vars() {
-            re = 0;
-            r_subject = {};
-            r_replw = {};
-            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
-            jpcre2_replace_opts = 0;
-            buffer_size = 0;
+        CompileContext *ccontext;
+        std::vector<unsigned char> tabv;
+
+
+        constexpr void init_vars() {
+            jpcre2_compile_opts = 0;
+            compile_opts = 0;
+            newline = 0;
             error_number = 0;
             error_offset = 0;
-            _start_offset = 0;
-            mdata = 0;
-            mcontext = 0;
+            code = 0;
+            pat_str = {};
+            ccontext = 0;
             modtab = 0;
-            last_replace_count = 0;
-            last_replace_counter = &last_replace_count;
+            regex_cache = 0;
         }
 
-        void onlyCopy(RegexReplace const &rr){
-            re = rr.re; //only pointer should be copied.
-            r_subject = rr.r_subject;
-            r_replw = rr.r_replw;
-            replace_opts = rr.replace_opts;
-            jpcre2_replace_opts = rr.jpcre2_replace_opts;
-            buffer_size = rr.buffer_size;
-            error_number = rr.error_number;
-            error_offset = rr.error_offset;
-            _start_offset = rr._start_offset;
-            mdata = rr.mdata;
-            mcontext = rr.mcontext;
-            modtab = rr.modtab;
-            last_replace_count = rr.last_replace_count;
-            last_replace_counter = (rr.last_replace_counter == &rr.last_replace_count) ? &last_replace_count
-                                                                                       : rr.last_replace_counter;
+        void freeRegexMemory(void) {
+            code_ref.reset(); //frees the code if we were the last user
+            code = 0; //we may use it again
+        }
+
+        CodePtr compileCode(int*, PCRE2_SIZE*);
+
+        //Performs deferred JIT compilation (deserialized code) before a match.
+        void lazyJit() const {
+            if(code_ref) code_ref->lazyJit();
+        }
+
+        //Header of a serialized Regex, followed by the pattern (padded to 8 bytes)
+        //and the data from pcre2_serialize_encode().
+        struct SerializedHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t width;
+            uint32_t po;
+            uint32_t jo;
+            uint32_t newline;
+            uint64_t pattern_length;
+            uint64_t code_size;
+        };
+
+        void freeCompileContext(){
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_free(ccontext);
+            ccontext = 0;
+        }
+
+        void onlyCopy(Regex const &r){
+            pat_str = r.pat_str;
+            compile_opts = r.compile_opts;
+            jpcre2_compile_opts = r.jpcre2_compile_opts;
+            newline = r.newline;
+            error_number = r.error_number;
+            error_offset = r.error_offset;
+            modtab = r.modtab;
+            regex_cache = r.regex_cache;
         }
 
-        void deepCopy(RegexReplace const &rr){
-            onlyCopy(rr);
+        void deepCopy(Regex const &r) {
+            onlyCopy(r);
+
+            //copy tables
+            tabv = r.tabv;
+            //copy ccontext if it's not null
+            freeCompileContext();
+            ccontext = (r.ccontext) ? Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_copy(r.ccontext) : 0;
+            //if tabv is not empty and ccontext is ok (not null) set the table pointer to ccontext
+            if(ccontext  && !tabv.empty()) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+
+            //The compiled code is immutable and owns the tables it points to,
+            //so it can be shared instead of being recompiled (JIT code included).
+            //A later compile() on either object only replaces its own reference.
+            freeRegexMemory();
+            code_ref = r.code_ref;
+            code = r.code;
         }
 
         #ifdef JPCRE2_USE_MINIMUM_CXX_11
-        void deepMove(RegexReplace& rr){
-            onlyCopy(rr);
+
+        void deepMove(Regex& r) {
+            onlyCopy(r);
+
+            //steal tables
+            tabv = std::move_if_noexcept(r.tabv);
+
+            //steal ccontext
+            freeCompileContext();
+            ccontext = r.ccontext; r.ccontext = 0; //must set this to 0
+            if(ccontext && !tabv.empty()) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+
+            //steal the code
+            freeRegexMemory();
+            code_ref = std::move(r.code_ref);
+            code = r.code; r.code = 0; //must set this to 0
         }
-        #endif
 
+        #endif
 
         protected:
 
@@ -2935,1136 +5817,1654 @@ struct select{
 
     public:
 
-        ///Default constructor
-        RegexReplace(){
+        /// Default Constructor.
+        /// Initializes all class variables to defaults.
+        /// Does not perform any pattern compilation.
+        Regex() {
+            init_vars();
+        }
+
+        ///Compile pattern with initialization.
+        /// @param re Pattern string
+        Regex(StringView re) {
             init_vars();
+            compile(re);
         }
 
         ///@overload
-        /// ...
-        ///Creates a RegexReplace object associating a Regex object.
-        ///Regex object is not modified.
-        ///@param r pointer to a Regex object
-        RegexReplace(Regex const *r) {
+        /// @param re Pattern string .
+        /// @param mod Modifier string.
+        Regex(StringView re, Modifier const& mod) {
             init_vars();
-            re = r;
+            compile(re, mod);
+        }
+
+        ///@overload
+        /// @param re Pattern string .
+        /// @param po PCRE2 option value
+        Regex(StringView re, Uint po) {
+            init_vars();
+            compile(re, po);
         }
 
         ///@overload
+        /// @param re Pattern string .
+        /// @param po    PCRE2 option value
+        /// @param jo    JPCRE2 option value
+        Regex(StringView re, Uint po, Uint jo) {
+            init_vars();
+            compile(re, po, jo);
+        }
+
+        /// @overload
         ///...
-        ///Copy constructor.
-        ///@param rr RegexReplace object reference
-        RegexReplace(RegexReplace const &rr){
+        /// Copy constructor.
+        /// The compiled code (including JIT code) is shared with `r` through reference counting,
+        /// no compilation is performed. The copy gets its own code when it's compiled again.
+        ///
+        /// @param r Constant Regex object reference.
+        Regex(Regex const &r) {
             init_vars();
-            deepCopy(rr);
+            deepCopy(r);
         }
 
-        ///Overloaded Copy assignment operator.
-        ///@param rr RegexReplace object reference
-        ///@return A reference to the calling RegexReplace object
-        RegexReplace& operator=(RegexReplace const &rr){
-            if(this == &rr) return *this;
-            deepCopy(rr);
+        /// Overloaded assignment operator.
+        /// @param r Regex const &
+        /// @return *this
+        Regex& operator=(Regex const &r) {
+            if (this == &r) return *this;
+            deepCopy(r);
             return *this;
         }
 
+
         #ifdef JPCRE2_USE_MINIMUM_CXX_11
 
-        ///@overload
+
+        /// @overload
         ///...
-        ///Move constructor.
+        /// Move constructor.
         ///This constructor steals resources from the argument.
         ///It leaves the argument in a valid but indeterminate sate.
         ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param rr rvalue reference to a RegexReplace object reference
-        RegexReplace(RegexReplace&& rr){
+        /// @param r rvalue reference to a Regex object.
+        Regex(Regex&& r) noexcept {
             init_vars();
-            deepMove(rr);
+            deepMove(r);
         }
 
         ///@overload
         ///...
-        ///Overloaded move assignment operator.
+        /// Overloaded move-assignment operator.
         ///This constructor steals resources from the argument.
         ///It leaves the argument in a valid but indeterminate sate.
         ///The indeterminate state can be returned to normal by calling reset() on that object.
-        ///@param rr rvalue reference to a RegexReplace object reference
-        ///@return A reference to the calling RegexReplace object
-        RegexReplace& operator=(RegexReplace&& rr){
-            if(this == &rr) return *this;
-            deepMove(rr);
+        /// @param r Regex&&
+        /// @return *this
+        Regex& operator=(Regex&& r) noexcept {
+            if (this == &r) return *this;
+            deepMove(r);
             return *this;
         }
 
+        /// Provides boolean check for the status of the object.
+        /// This overloaded boolean operator needs to be declared
+        /// explicit to prevent implicit conversion and overloading issues.
+        ///
+        /// We will only enable it if >=C++11 is being used, as the explicit keyword
+        /// for a function other than constructor is not supported in older compilers.
+        ///
+        /// If you are dealing with legacy code/compilers use the Double bang trick mentioned
+        /// in Regex::operator!().
+        ///
+        /// This helps us to check the status of the compiled regex like this:
+        ///
+        /// ```
+        /// jpcre2::select<char>::Regex re("pat", "mod");
+        /// if(re) {
+        ///     std::cout<<"Compile success";
+        /// } else {
+        ///     std::cout<<"Compile failed";
+        /// }
+        /// ```
+        ///@return true if regex compiled successfully, false otherwise.
+        ///
+        explicit operator bool() const {
+            return (code != 0);
+        }
         #endif
 
-        virtual ~RegexReplace() {}
+        /// Provides boolean check for the status of the object.
+        /// This is a safe boolean approach (no implicit conversion  or overloading).
+        /// We don't need the explicit keyword here and thus it's the preferable method
+        /// to check for object status that will work well with older compilers.
+        /// e.g:
+        ///
+        /// ```
+        /// jpcre2::select<char>::Regex re("pat","mod");
+        /// if(!re) {
+        ///     std::cout<<"Compile failed";
+        /// } else {
+        ///     std::cout<<"Compiled successfully";
+        /// }
+        /// ```
+        /// Double bang trick:
+        ///
+        /// ```
+        /// jpcre2::select<char>::Regex re("pat","mod");
+        /// if(!!re) {
+        ///     std::cout<<"Compiled successfully";
+        /// } else {
+        ///     std::cout<<"Compile failed";
+        /// }
+        /// ```
+        /// @return true if regex compile failed, false otherwise.
+        bool operator!() const {
+            return (code == 0);
+        }
+
+        virtual ~Regex() {
+            freeRegexMemory();
+            freeCompileContext();
+        }
 
         ///Reset all class variables to its default (initial) state including memory.
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& reset() {
+        ///@return Reference to the calling Regex object.
+        Regex& reset() {
+            freeRegexMemory();
+            freeCompileContext();
             init_vars();
             return *this;
         }
 
         ///Clear all class variables to its default (initial) state (some memory may retain for further use).
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& clear() {
+        ///@return Reference to the calling Regex object.
+        Regex& clear() {
+            freeRegexMemory();
+            freeCompileContext();
             init_vars();
             return *this;
         }
 
-        ///Reset replace related errors to zero.
-        ///@return Reference to the calling RegexReplace object
-        ///@see Regex::resetErrors()
-        ///@see RegexMatch::resetErrors()
-        RegexReplace& resetErrors(){
+        ///Reset regex compile related errors to zero.
+        ///@return A reference to the Regex object
+        ///@see  RegexReplace::resetErrors()
+        ///@see  RegexMatch::resetErrors()
+        Regex& resetErrors() {
             error_number = 0;
             error_offset = 0;
             return *this;
         }
 
-        /// Returns the last error number
-        ///@return Last error number
-        int getErrorNumber() const {
-            return error_number;
+        /// Recreate character tables used by PCRE2.
+        /// You should call this function after changing the locale to remake the
+        /// character tables according to the new locale.
+        /// These character tables are used to compile the regex and used by match
+        /// and replace operation. A separate call to compile() will be required
+        /// to apply the new character tables.
+        /// @return Reference to the calling Regex object.
+        Regex& resetCharacterTables() {
+            const unsigned char* tables = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::maketables(0); //must pass 0, we are using free() to free the tables.
+            tabv = std::vector<unsigned char>(tables, tables+1088);
+            ::free((void*)tables); //must free memory
+            if(!ccontext)
+                ccontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_create(0);
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+            return *this;
         }
 
-        /// Returns the last error offset
-        ///@return Last error offset
-        int getErrorOffset() const  {
-            return (int)error_offset;
+        ///Get Pcre2 raw compiled code pointer.
+        ///@return pointer to constant pcre2_code or null.
+        Pcre2Code const* getPcre2Code() const{
+            return code;
         }
 
-        /// Returns the last error message
-        ///@return Last error message
-        String getErrorMessage() const  {
-            #ifdef JPCRE2_USE_MINIMUM_CXX_11
-            return select<Char, Map>::getErrorMessage(error_number, error_offset);
-            #else
-            return select<Char>::getErrorMessage(error_number, error_offset);
-            #endif
+        ///Check whether the compiled code is JIT compiled.
+        ///Matches use `pcre2_jit_match()` directly when it is.
+        ///Deferred JIT compilation (see deserialize()) is performed by this call.
+        ///@return true if JIT compilation succeeded, false otherwise.
+        bool isJitCompiled() const {
+            lazyJit();
+            return code_ref && code_ref->jit_compiled;
         }
 
-        /// Get replacement string
-        ///@return replacement string
-        StringView getReplaceWith() const  {
-            return r_replw;
+        ///Get the reference counted compiled code.
+        ///The compiled code may be shared with other Regex objects (see RegexCache).
+        ///@return CodePtr (null if not compiled).
+        CodePtr getCompiledCode() const {
+            return code_ref;
         }
 
-        /// Get subject string
-        ///@return subject string
-        ///@see RegexMatch::getSubject()
-        StringView getSubject() const  {
-            return r_subject;
+        ///Serialize the compiled code with pcre2_serialize_encode().
+        ///The result contains the pattern, the options and the compiled code (without JIT code)
+        ///and can be turned into a Regex again with deserialize() by a program that uses the same
+        ///PCRE2 version, code unit width and architecture.
+        ///On failure, an empty vector is returned and the error number is set.
+        ///@return serialized bytes.
+        ///@see RegexBundleWriter
+        std::vector<Ush> serialize();
+
+        ///Load compiled code from bytes created by serialize().
+        ///Only a copy of the compiled code is made, the pattern is not parsed. If the Regex was compiled
+        ///with JIT_COMPILE, JIT compilation is performed on the first match.
+        ///
+        ///getPattern() refers to the pattern inside `bytes`, thus `bytes` must outlive the Regex object
+        ///if you want to use the pattern (e.g to call compile() again).
+        ///
+        ///On failure, the Regex is left uncompiled and the error number is set to a PCRE2 error
+        ///(e.g `PCRE2_ERROR_BADMAGIC`, `PCRE2_ERROR_BADMODE`, `PCRE2_ERROR_BADSERIALIZEDDATA`).
+        ///@param bytes pointer to serialized data (should be aligned to 8 bytes).
+        ///@param size size of the data.
+        ///@return Reference to the calling Regex object.
+        Regex& deserialize(Ush const* bytes, SIZE_T size);
+
+        ///@overload
+        ///@param bytes serialized data.
+        ///@return Reference to the calling Regex object.
+        Regex& deserialize(std::vector<Ush> const& bytes){
+            return deserialize(bytes.data(), bytes.size());
+        }
+
+        /// Get pattern string
+        ///@return pattern string of type jpcre2::select::String
+        StringView getPattern() const  {
+            return pat_str;
+        }
+
+        ///Get the group number of a named group from the name table of the compiled code.
+        ///Look the number up once and use it to index the captures of each match
+        ///(e.g MatchTable::get(), MatchView::operator[]), no per match map is needed.
+        ///With PCRE2_DUPNAMES the lowest group number of the name is returned.
+        ///@param name Group name.
+        ///@return Group number, or PCRE2_ERROR_NOSUBSTRING if there is no such name or no compiled code.
+        int getGroupNumber(StringView name) const {
+            if(!code) return PCRE2_ERROR_NOSUBSTRING;
+            return code_ref->getGroupNumber(name);
         }
 
+        ///Get number of captures from compiled code.
+        ///@return New line option value or 0.
+        Uint getNumCaptures() {
+            if(!code) return 0;
+            return code_ref->capture_count;
+        }
 
         /// Calculate modifier string from PCRE2 and JPCRE2 options and return it.
         ///
-        /// Do remember that modifiers (or PCRE2 and JPCRE2 options) do not change or get initialized
-        /// as long as you don't do that explicitly. Calling RegexReplace::setModifier() will re-set them.
-        ///
         /// **Mixed or combined modifier**.
         ///
         /// Some modifier may include other modifiers i.e they have the same meaning of some modifiers
         /// combined together. For example, the 'n' modifier includes the 'u' modifier and together they
         /// are equivalent to `PCRE2_UTF | PCRE2_UCP`. When you set a modifier like this, both options
-        /// get set, and when you remove the 'n' modifier (with `RegexReplace::changeModifier()`), both will get removed.
-        /// @return Calculated modifier string (std::string)
+        /// get set, and when you remove the 'n' modifier (with `Regex::changeModifier()`), both will get removed.
+        ///@tparam Char_T Character type
+        ///@return Calculated modifier string (std::string)
         ///@see RegexMatch::getModifier()
-        ///@see Regex::getModifier()
+        ///@see RegexReplace::getModifier()
         std::string getModifier() const {
-            return modtab ? modtab->fromReplaceOption(replace_opts, jpcre2_replace_opts)
-                          : MOD::fromReplaceOption(replace_opts, jpcre2_replace_opts);
-        }
-
-        ///Get the modifier table that is set,
-        ///@return constant ModifierTable pointer.
-        ModifierTable const* getModifierTable(){
-            return modtab;
-        }
-
-        ///Get start offset.
-        ///@return the start offset where matching starts for replace operation
-        PCRE2_SIZE getStartOffset() const {
-            return _start_offset;
+            return modtab ? modtab->fromCompileOption(compile_opts, jpcre2_compile_opts)
+                          : MOD::fromCompileOption(compile_opts, jpcre2_compile_opts);
         }
 
         /// Get PCRE2 option
-        ///@return PCRE2 option for replace
-        ///@see Regex::getPcre2Option()
+        /// @return Compile time PCRE2 option value
+        ///@see RegexReplace::getPcre2Option()
         ///@see RegexMatch::getPcre2Option()
         Uint getPcre2Option() const  {
-            return replace_opts;
+            return compile_opts;
         }
 
         /// Get JPCRE2 option
-        ///@return JPCRE2 option  for replace
-        ///@see Regex::getJpcre2Option()
+        /// @return Compile time JPCRE2 option value
+        ///@see RegexReplace::getJpcre2Option()
         ///@see RegexMatch::getJpcre2Option()
         Uint getJpcre2Option() const  {
-            return jpcre2_replace_opts;
-        }
-
-        ///Get a pointer to the associated Regex object.
-        ///If no actual Regex object is associated, null is returned
-        ///@return A pointer to the associated constant Regex object or null
-        Regex const * getRegexObject() const {
-            return re;
+            return jpcre2_compile_opts;
         }
 
-        ///Return pointer to the match context that was previously set with setMatchContext().
-        ///Handling memory is the callers' responsibility.
-        ///@return pointer to the match context (default: null).
-        MatchContext* getMatchContext(){
-            return mcontext;
+        /// Returns the last error number
+        ///@return Last error number
+        int getErrorNumber() const {
+            return error_number;
         }
 
-        ///Get the pointer to the match data block that was set previously with setMatchData()
-        ///Handling memory is the callers' responsibility.
-        ///@return pointer to the match data (default: null).
-        virtual MatchData* getMatchDataBlock(){
-            return mdata;
+        /// Returns the last error offset
+        ///@return Last error offset
+        int getErrorOffset() const  {
+            return (int)error_offset;
         }
 
-        ///Get the initial buffer size that is being used by internal function pcre2_substitute
-        ///@return buffer_size
-        PCRE2_SIZE getBufferSize(){
-            return buffer_size;
+        /// Returns the last error message
+        ///@return Last error message
+        String getErrorMessage() const  {
+            #ifdef JPCRE2_USE_MINIMUM_CXX_11
+            return select<Char, Map>::getErrorMessage(error_number, error_offset);
+            #else
+            return select<Char>::getErrorMessage(error_number, error_offset);
+            #endif
         }
 
-        ///Get the number of replacement in last replace operation.
-        ///If you set an external counter with RegexReplace::setReplaceCounter(),
-        ///a call to this getter method will dereference the pointer to the external counter
-        ///and return the value.
-        ///@return Last replace count
-        SIZE_T getLastReplaceCount(){
-            return *last_replace_counter;
+        ///Get new line convention from compiled code.
+        ///@return New line option value or 0.
+        ///```
+        ///PCRE2_NEWLINE_CR        Carriage return only
+        ///PCRE2_NEWLINE_LF        Linefeed only
+        ///PCRE2_NEWLINE_CRLF      CR followed by LF only
+        ///PCRE2_NEWLINE_ANYCRLF   Any of the above
+        ///PCRE2_NEWLINE_ANY       Any Unicode newline sequence
+        ///```
+        Uint getNewLine() {
+            if(!code) return 0;
+            return code_ref->newline;
         }
 
-        ///Set an external counter variable to store the replacement count.
-        ///This counter will be updated after each replacement operation on this object.
-        ///A call to this method will reset the internal counter to 0, thus when you reset the counter
-        ///to internal counter (by giving null as param), the previous replace count won't be available.
-        ///@param counter Pointer to a counter variable. Null sets the counter to default internal counter.
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& setReplaceCounter(SIZE_T* counter){
-            last_replace_count = 0;
-            last_replace_counter = counter ? counter : &last_replace_count;
-            return *this;
+        ///Get the modifier table that is set,
+        ///@return constant ModifierTable pointer.
+        ModifierTable const* getModifierTable(){
+            return modtab;
         }
 
-        ///Set the associated Regex object.
-        ///Regex object is not modified.
-        ///@param r Pointer to a Regex object.
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& setRegexObject(Regex const *r){
-            re = r;
-            return *this;
-        }
 
-        /// Set the subject string for replace.
-        ///This makes a copy of the string. If no copy is desired or you are working
-        ///with big text, consider passing by pointer.
-        ///@param s Subject string
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::setSubject()
-        RegexReplace& setSubject(StringView s) {
-            r_subject = s;
+        ///Set new line convention.
+        ///@param value New line option value.
+        ///```
+        ///PCRE2_NEWLINE_CR        Carriage return only
+        ///PCRE2_NEWLINE_LF        Linefeed only
+        ///PCRE2_NEWLINE_CRLF      CR followed by LF only
+        ///PCRE2_NEWLINE_ANYCRLF   Any of the above
+        ///PCRE2_NEWLINE_ANY       Any Unicode newline sequence
+        ///```
+        ///@return Reference to the calling Regex object
+        Regex& setNewLine(Uint value){
+            if(!ccontext)
+                ccontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_create(0);
+            int ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_newline(ccontext, value);
+            if(ret < 0) error_number = ret;
+            else newline = value;
             return *this;
         }
 
-        /// Set the replacement string.
-        ///`$` is a special character which implies captured group.
-        ///
-        ///1. A numbered substring can be referenced with `$n` or `${n}` where n is the group number.
-        ///2. A named substring can be referenced with `${name}`, where 'name' is the group name.
-        ///3. A literal `$` can be given as `$$`.
-        ///
-        ///**Note:** This function makes a copy of the string. If no copy is desired or
-        ///you are working with big text, consider passing the string with pointer.
-        ///
-        ///@param s String to replace with
-        ///@return Reference to the calling RegexReplace object
-        RegexReplace& setReplaceWith(StringView s) {
-            r_replw = s;
+        /// Set the pattern string to compile
+        /// @param re Pattern string
+        /// @return Reference to the calling Regex object.
+        Regex& setPattern(StringView re) {
+            pat_str = re;
             return *this;
         }
 
-        /// Set the modifier string (resets all JPCRE2 and PCRE2 options) by calling RegexReplace::changeModifier().
-        ///@param s Modifier string.
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::setModifier()
-        ///@see Regex::setModifier()
-        RegexReplace& setModifier(Modifier const& s) {
-            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH; /* must not be initialized to 0 */
-            jpcre2_replace_opts = 0;
-            return changeModifier(s, true);
+        /// set the modifier (resets all JPCRE2 and PCRE2 options) by calling Regex::changeModifier().
+        /// Re-initializes the option bits for PCRE2 and JPCRE2 options, then parses the modifier and sets
+        /// equivalent PCRE2 and JPCRE2 options.
+        /// @param x Modifier string.
+        /// @return Reference to the calling Regex object.
+        /// @see RegexMatch::setModifier()
+        /// @see RegexReplace::setModifier()
+        Regex& setModifier(Modifier const& x) {
+            compile_opts = 0;
+            jpcre2_compile_opts = 0;
+            return changeModifier(x, true);
         }
 
         ///Set a custom modifier table to be used.
         ///@param mdt pointer to ModifierTable object.
-        /// @return Reference to the calling RegexReplace object.
-        RegexReplace& setModifierTable(ModifierTable const * mdt){
+        /// @return Reference to the calling Regex object.
+        Regex& setModifierTable(ModifierTable const * mdt){
             modtab = mdt;
             return *this;
         }
 
-        /// Set the initial buffer size to be allocated for replaced string (used by PCRE2)
-        ///@param x Buffer size
-        ///@return Reference to the calling RegexReplace object
-        RegexReplace& setBufferSize(PCRE2_SIZE x) {
-            buffer_size = x;
-            return *this;
-        }
-
-        ///Set start offset.
-        ///Set the offset where matching starts for replace operation
-        ///@param start_offset The offset where matching starts for replace operation
-        ///@return Reference to the calling RegexReplace object
-        RegexReplace& setStartOffset(PCRE2_SIZE start_offset){
-            _start_offset = start_offset;
-            return *this;
-        }
-
-        /// Set JPCRE2 option for replace (overwrite existing option)
-        ///@param x Option value
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::setJpcre2Option()
-        ///@see Regex::setJpcre2Option()
-
-        RegexReplace& setJpcre2Option(Uint x) {
-            jpcre2_replace_opts = x;
+        ///Set a cache of compiled patterns to be used by compile().
+        ///Null pointer unsets it.
+        ///The memory is not handled by the Regex object.
+        ///@param cache pointer to RegexCache object (e.g RegexCache::getGlobal()).
+        /// @return Reference to the calling Regex object.
+        Regex& setRegexCache(RegexCache * cache){
+            regex_cache = cache;
             return *this;
         }
 
-        /// Set PCRE2 option replace (overwrite existing option)
-        ///@param x Option value
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::setPcre2Option()
-        ///@see Regex::setPcre2Option()
-
-        RegexReplace& setPcre2Option(Uint x) {
-            replace_opts = PCRE2_SUBSTITUTE_OVERFLOW_LENGTH | x;
-            return *this;
+        ///Get the cache of compiled patterns that is set.
+        ///@return pointer to RegexCache object or null.
+        RegexCache* getRegexCache() const {
+            return regex_cache;
         }
 
-        ///Set the match context to be used.
-        ///Native PCRE2 API may be used to create match context.
-        ///The memory of the match context is not handled by RegexReplace object and not freed.
-        ///User will be responsible for freeing memory.
-        ///@param match_context Pointer to match context.
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& setMatchContext(MatchContext * match_context){
-            mcontext = match_context;
+        /// Set JPCRE2 option for compile (overwrites existing option)
+        /// @param x Option value
+        /// @return Reference to the calling Regex object.
+        /// @see RegexMatch::setJpcre2Option()
+        /// @see RegexReplace::setJpcre2Option()
+        Regex& setJpcre2Option(Uint x) {
+            jpcre2_compile_opts = x;
             return *this;
         }
 
-        ///Set the match data block to be used.
-        ///Native PCRE2 API may be used to create match data block.
-        ///The memory of the match data is not handled by RegexReplace object and not freed.
-        ///User will be responsible for creating/freeing memory.
-        ///@param match_data Pointer to match data.
-        ///@return Reference to the calling RegexReplace object.
-        RegexReplace& setMatchDataBlock(MatchData *match_data){
-            mdata = match_data;
+        ///  Set PCRE2 option for compile (overwrites existing option)
+        /// @param x Option value
+        /// @return Reference to the calling Regex object.
+        /// @see RegexMatch::setPcre2Option()
+        /// @see RegexReplace::setPcre2Option()
+        Regex& setPcre2Option(Uint x) {
+            compile_opts = x;
             return *this;
         }
 
-        /// After a call to this function PCRE2 and JPCRE2 options will be properly set.
+        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
         /// This function does not initialize or re-initialize options.
         /// If you want to set options from scratch, initialize them to 0 before calling this function.
         ///
-        /// If invalid modifier is detected, then the error number for the RegexReplace
+        /// If invalid modifier is detected, then the error number for the Regex
         /// object will be jpcre2::ERROR::INVALID_MODIFIER and error offset will be the modifier character.
-        /// You can get the message with RegexReplace::getErrorMessage() function.
+        /// You can get the message with Regex::getErrorMessage() function.
         /// @param mod Modifier string.
         /// @param x Whether to add or remove option
-        /// @return Reference to the RegexReplace object
-        /// @see Regex::changeModifier()
+        /// @return Reference to the calling Regex object
         /// @see RegexMatch::changeModifier()
-        RegexReplace& changeModifier(Modifier const& mod, bool x){
-            modtab ? modtab->toReplaceOption(mod, x, &replace_opts, &jpcre2_replace_opts, &error_number, &error_offset)
-                   : MOD::toReplaceOption(mod, x, &replace_opts, &jpcre2_replace_opts, &error_number, &error_offset);
+        /// @see RegexReplace::changeModifier()
+        Regex& changeModifier(Modifier const& mod, bool x){
+            modtab ? modtab->toCompileOption(mod, x, &compile_opts, &jpcre2_compile_opts, &error_number, &error_offset)
+                   : MOD::toCompileOption(mod, x, &compile_opts, &jpcre2_compile_opts, &error_number, &error_offset);
             return *this;
         }
 
-        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
-        /// Add or remove a JPCRE2 option
+        ///  Add or remove a JPCRE2 option
         /// @param opt JPCRE2 option value
         /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling RegexReplace object
+        /// @return Reference to the calling Regex object
         /// @see RegexMatch::changeJpcre2Option()
-        /// @see Regex::changeJpcre2Option()
-        RegexReplace& changeJpcre2Option(Uint opt, bool x) {
-            jpcre2_replace_opts = x ? jpcre2_replace_opts | opt : jpcre2_replace_opts & ~opt;
+        /// @see RegexReplace::changeJpcre2Option()
+        Regex& changeJpcre2Option(Uint opt, bool x) {
+            jpcre2_compile_opts = x ? jpcre2_compile_opts | opt : jpcre2_compile_opts & ~opt;
             return *this;
         }
 
         /// Add or remove a PCRE2 option
         /// @param opt PCRE2 option value
         /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling RegexReplace object
+        /// @return Reference to the calling Regex object
         /// @see RegexMatch::changePcre2Option()
-        /// @see Regex::changePcre2Option()
-        RegexReplace& changePcre2Option(Uint opt, bool x) {
-            replace_opts = x ? replace_opts | opt : replace_opts & ~opt;
-            //replace_opts |= PCRE2_SUBSTITUTE_OVERFLOW_LENGTH; /* It's important, but let user override it. */
+        /// @see RegexReplace::changePcre2Option()
+        Regex& changePcre2Option(Uint opt, bool x) {
+            compile_opts = x ? compile_opts | opt : compile_opts & ~opt;
             return *this;
         }
 
         /// Parse modifier string and add equivalent PCRE2 and JPCRE2 options.
-        /// This is just a wrapper of the original function RegexReplace::changeModifier()
+        /// This is just a wrapper of the original function Regex::changeModifier()
         /// provided for convenience.
         /// @param mod Modifier string.
-        /// @return Reference to the calling RegexReplace object
+        /// @return Reference to the calling Regex object
         /// @see RegexMatch::addModifier()
-        /// @see Regex::addModifier()
-        RegexReplace& addModifier(Modifier const& mod){
+        /// @see RegexReplace::addModifier()
+        Regex& addModifier(Modifier const& mod){
             return changeModifier(mod, true);
         }
 
-        /// Add specified JPCRE2 option to existing options for replace.
-        ///@param x Option value
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::addJpcre2Option()
-        ///@see Regex::addJpcre2Option()
-        RegexReplace& addJpcre2Option(Uint x) {
-            jpcre2_replace_opts |= x;
+        /// Add option to existing JPCRE2 options for compile
+        /// @param x Option value
+        /// @return Reference to the calling Regex object
+        /// @see RegexMatch::addJpcre2Option()
+        /// @see RegexReplace::addJpcre2Option()
+        Regex& addJpcre2Option(Uint x) {
+            jpcre2_compile_opts |= x;
             return *this;
         }
 
-        /// Add specified PCRE2 option to existing options for replace
-        ///@param x Option value
-        ///@return Reference to the calling RegexReplace object
-        ///@see RegexMatch::addPcre2Option()
-        ///@see Regex::addPcre2Option()
-        RegexReplace& addPcre2Option(Uint x) {
-            replace_opts |= x;
+        ///  Add option to existing PCRE2 options for compile
+        /// @param x Option value
+        /// @return Reference to the calling Regex object
+        /// @see RegexMatch::addPcre2Option()
+        /// @see RegexReplace::addPcre2Option()
+        Regex& addPcre2Option(Uint x) {
+            compile_opts |= x;
             return *this;
         }
 
-        /// Perform regex replace by retrieving subject string, replacement string, modifier and other options from class variables.
-        /// In the replacement string (see RegexReplace::setReplaceWith()) `$` is a special character which implies captured group.
-        /// 1. A numbered substring can be referenced with `$n` or `${n}` where n is the group number.
-        /// 2. A named substring can be referenced with `${name}`, where 'name' is the group name.
-        /// 3. A literal `$` can be given as `$$`.
-        /// 4. Bash like features: ${<n>:-<string>} and ${<n>:+<string1>:<string2>}, where <n> is a group number or name.
-        ///
-        ///All options supported by pcre2_substitute is available.
-        ///
-        /// Note: This function calls pcre2_substitute() to do the replacement.
-        ///@return Replaced string
-        String replace(void);
-
-        ///JPCRE2 native replace function.
-        ///A different name is adopted to
-        ///distinguish itself from the regular replace() function which
-        ///uses pcre2_substitute() to do the replacement; contrary to that,
-        ///it will provide a JPCRE2 native way of replacement operation.
-        ///It takes a MatchEvaluator object which provides a callback function that is used
-        ///to generate replacement string on the fly. Any replacement string set with
-        ///`RegexReplace::setReplaceWith()` function will have no effect.
-        ///The string returned by the callback function will be treated as literal and will
-        ///not go through any further processing.
-        ///
-        ///This function works on a copy of the MatchEvaluator, and thus makes no changes
-        ///to the original. The copy is modified as below:
-        ///
-        ///1. Global replacement will set FIND_ALL for match, unset otherwise.
-        ///2. Bad matching options such as `PCRE2_PARTIAL_HARD|PCRE2_PARTIAL_SOFT` will be removed.
-        ///3. subject, start_offset and Regex object will change according to the RegexReplace object.
-        ///4. match context, and match data block will be changed according to the RegexReplace object.
-        ///
-        ///It calls MatchEvaluator::nreplace() on the MatchEvaluator object to perform the replacement.
-        ///
-        ///It always performs a new match.
-        ///@param me A MatchEvaluator object.
-        ///@return The resultant string after replacement.
-        ///@see MatchEvaluator::nreplace()
-        ///@see MatchEvaluator
-        ///@see MatchEvaluatorCallback
-        String nreplace(MatchEvaluator me){
-            return me.setRegexObject(getRegexObject())
-                     .setSubject(getSubject())
-                     .setFindAll((getPcre2Option() & PCRE2_SUBSTITUTE_GLOBAL)!=0)
-                     .setMatchContext(getMatchContext())
-                     .setMatchDataBlock(getMatchDataBlock())
-                     .setStartOffset(getStartOffset())
-                     .nreplace(true, getJpcre2Option(), last_replace_counter);
-        }
+        ///Compile pattern using info from class variables.
+        ///@see Regex::compile(StringView re, Uint po, Uint jo)
+        ///@see Regex::compile(StringView re, Uint po)
+        ///@see Regex::compile(StringView re, Modifier mod)
+        ///@see Regex::compile(StringView re)
+        void compile(void);
 
-        ///PCRE2 compatible replace function that takes a MatchEvaluator.
-        ///String returned by callback function is processed by pcre2_substitute,
-        ///thus all PCRE2 substitute options are supported by this replace function.
-        ///
-        ///It always performs a new match.
-        ///@param me MatchEvaluator instance, (copied and modified according to this object).
-        ///@return resultant string.
-        ///@see replace()
-        String replace(MatchEvaluator me){
-            return me.setRegexObject(getRegexObject())
-                     .setSubject(getSubject())
-                     .setFindAll((getPcre2Option() & PCRE2_SUBSTITUTE_GLOBAL)!=0)
-                     .setMatchContext(getMatchContext())
-                     .setMatchDataBlock(getMatchDataBlock())
-                     .setBufferSize(getBufferSize())
-                     .setStartOffset(getStartOffset())
-                     .replace(true, getPcre2Option(), last_replace_counter);
+        ///@overload
+        ///...
+        /// Set the specified parameters, then compile the pattern using information from class variables.
+        /// @param re Pattern string
+        /// @param po PCRE2 option
+        /// @param jo JPCRE2 option
+        void compile(StringView re, Uint po, Uint jo) {
+            setPattern(re).setPcre2Option(po).setJpcre2Option(jo);
+            compile();
         }
-    };
-
-
-    /** Provides public constructors to create Regex object.
-     * Each regex pattern needs an object of this class and each pattern needs to be compiled.
-     * Pattern compilation can be done using one of its' overloaded constructors or the `Regex::compile()`
-     * member function.
-     *
-     * Examples:
-     *
-     * ```cpp
-     * jp::Regex re; //does not perform a compile
-     * re.compile("pattern", "modifier");
-     * jp::Regex re2("pattern", "modifier"); //performs a compile
-     * ```
-     *
-     */
-    class Regex {
-
-    private:
-
-        friend class RegexMatch;
-        friend class RegexReplace;
-        friend class MatchEvaluator;
-
-        StringView pat_str;
-        Pcre2Code *code;
-        Uint compile_opts;
-        Uint jpcre2_compile_opts;
-        ModifierTable const * modtab;
-
-        CompileContext *ccontext;
-        std::vector<unsigned char> tabv;
-
 
-        constexpr void init_vars() {
-            jpcre2_compile_opts = 0;
-            compile_opts = 0;
-            error_number = 0;
-            error_offset = 0;
-            code = 0;
-            pat_str = {};
-            ccontext = 0;
-            modtab = 0;
+        ///@overload
+        /// @param re Pattern string
+        /// @param po PCRE2 option
+        void compile(StringView re, Uint po) {
+            setPattern(re).setPcre2Option(po);
+            compile();
         }
 
-        void freeRegexMemory(void) {
-            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::code_free(code);
-            code = 0; //we may use it again
+        /// @overload
+        /// @param re Pattern string
+        /// @param mod Modifier string.
+        void compile(StringView re, Modifier const& mod) {
+            setPattern(re).setModifier(mod);
+            compile();
         }
 
-        void freeCompileContext(){
-            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_free(ccontext);
-            ccontext = 0;
+        ///@overload
+        /// @param re Pattern string .
+        void compile(StringView re) {
+            setPattern(re);
+            compile();
         }
 
-        void onlyCopy(Regex const &r){
-            pat_str = r.pat_str;
-            compile_opts = r.compile_opts;
-            jpcre2_compile_opts = r.jpcre2_compile_opts;
-            error_number = r.error_number;
-            error_offset = r.error_offset;
-            modtab = r.modtab;
+        ///Returns a default constructed RegexMatch object by value.
+        ///This object is initialized with the same modifier table
+        ///as this Regex object.
+        ///@return RegexMatch object.
+        RegexMatch initMatch(){
+            RegexMatch rm(this);
+            rm.setModifierTable(modtab);
+            return rm;
         }
 
-        void deepCopy(Regex const &r) {
-            onlyCopy(r);
-
-            //copy tables
-            tabv = r.tabv;
-            //copy ccontext if it's not null
-            freeCompileContext();
-            ccontext = (r.ccontext) ? Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_copy(r.ccontext) : 0;
-            //if tabv is not empty and ccontext is ok (not null) set the table pointer to ccontext
-            if(ccontext  && !tabv.empty()) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
-
-            //table pointer must be updated in the compiled code itself, jit memory copy is not available.
-            //copy is not going to work, we need a recompile.
-            //as all vars are already copied, we can just call compile()
-            r.code ? compile() //compile frees previous memory.
-                   : freeRegexMemory();
+        ///Synonym for initMatch()
+        ///@return RegexMatch object by value.
+        RegexMatch getMatchObject(){
+            return initMatch();
         }
 
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-
-        void deepMove(Regex& r) {
-            onlyCopy(r);
-
-            //steal tables
-            tabv = std::move_if_noexcept(r.tabv);
-
-            //steal ccontext
-            freeCompileContext();
-            ccontext = r.ccontext; r.ccontext = 0; //must set this to 0
-            if(ccontext && !tabv.empty()) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+        /// Perform regex match and return match count using a temporary match object.
+        /// This temporary match object will get available options from this Regex object,
+        /// that includes modifier table.
+        /// @param s Subject string .
+        /// @param mod Modifier string.
+        /// @param start_offset Offset from where matching will start in the subject string.
+        /// @return Match count
+        /// @see RegexMatch::match()
+        SIZE_T match(StringView s, Modifier const& mod, PCRE2_SIZE start_offset=0) {
+            return initMatch().setStartOffset(start_offset).setSubject(s).setModifier(mod).match();
+        }
 
-            //steal the code
-            freeRegexMemory();
-            code = r.code; r.code = 0; //must set this to 0
+        ///@overload
+        ///...
+        /// @param s Subject string .
+        /// @param start_offset Offset from where matching will start in the subject string.
+        /// @return Match count
+        /// @see RegexMatch::match()
+        SIZE_T match(StringView s, PCRE2_SIZE start_offset=0) {
+            return initMatch().setStartOffset(start_offset).setSubject(s).match();
         }
 
-        #endif
+        /// Get a range over all matches (FIND_ALL is implied) that performs them lazily while it is iterated.
+        /// The subject string is not copied, it must outlive the range.
+        /// @param s Subject string.
+        /// @param mod Modifier string.
+        /// @param start_offset Offset from where matching will start in the subject string.
+        /// @return MatchRange object.
+        /// @see RegexMatch::matches()
+        MatchRange matches(StringView s, Modifier const& mod, PCRE2_SIZE start_offset=0) {
+            return initMatch().setStartOffset(start_offset).setSubject(s).setModifier(mod).setFindAll().matches();
+        }
 
-        protected:
+        ///@overload
+        ///...
+        /// @param s Subject string.
+        /// @param start_offset Offset from where matching will start in the subject string.
+        /// @return MatchRange object.
+        MatchRange matches(StringView s, PCRE2_SIZE start_offset=0) {
+            return initMatch().setStartOffset(start_offset).setSubject(s).setFindAll().matches();
+        }
 
-        int error_number;
-        PCRE2_SIZE error_offset;
+        ///Match many subjects with one match setup.
+        ///The modifier is parsed once and one match data block is used for the whole batch (per thread),
+        ///the results are written into columns indexed like the subjects.
+        ///
+        ///```cpp
+        ///std::vector<jp::StringView> rows = ...;
+        ///std::vector<jpcre2::Ush> hit;
+        ///jpcre2::VecOff counts;
+        ///re.matchBatch(rows.data(), rows.size(), &hit, &counts);
+        ///```
+        ///@param subjects Subject strings.
+        ///@param n Number of subjects.
+        ///@param matched Column set to 1 for the subjects that match and 0 for the others, null to not store it.
+        ///@param counts Column of match counts (global match), null to only look for the first match of each subject.
+        ///@param first Column of the first match of each subject (PCRE2_UNSET offsets if none), null to not store it.
+        ///@param mod Match modifier.
+        ///@param threads Number of threads (1 by default, 0 for std::thread::hardware_concurrency()).
+        ///@param error Pointer to store the error of the first subject whose match failed with an error (0 if none),
+        ///null to ignore errors.
+        ///@return Number of subjects that match.
+        SIZE_T matchBatch(StringView const *subjects, SIZE_T n, std::vector<Ush>* matched, VecOff* counts = 0,
+                          std::vector<MatchSpan>* first = 0, Modifier const& mod = Modifier(),
+                          SIZE_T threads = 1, int* error = 0) const;
 
-    public:
+        ///@overload
+        ///...
+        ///@param subjects Vector of subject strings.
+        ///@param matched Column set to 1 for the subjects that match and 0 for the others, null to not store it.
+        ///@param counts Column of match counts (global match), null to only look for the first match of each subject.
+        ///@param first Column of the first match of each subject (PCRE2_UNSET offsets if none), null to not store it.
+        ///@param mod Match modifier.
+        ///@param threads Number of threads (1 by default, 0 for std::thread::hardware_concurrency()).
+        ///@param error Pointer to store the first error (0 if none), null to ignore errors.
+        ///@return Number of subjects that match.
+        SIZE_T matchBatch(std::vector<StringView> const& subjects, std::vector<Ush>* matched, VecOff* counts = 0,
+                          std::vector<MatchSpan>* first = 0, Modifier const& mod = Modifier(),
+                          SIZE_T threads = 1, int* error = 0) const {
+            return matchBatch(subjects.empty() ? 0 : &subjects[0], subjects.size(), matched, counts, first, mod, threads, error);
+        }
 
-        /// Default Constructor.
-        /// Initializes all class variables to defaults.
-        /// Does not perform any pattern compilation.
-        Regex() {
-            init_vars();
+        ///Returns a default constructed RegexReplace object by value.
+        ///This object is initialized with the same modifier table as this Regex object.
+        ///@return RegexReplace object.
+        RegexReplace initReplace(){
+            RegexReplace rr(this);
+            rr.setModifierTable(modtab);
+            return rr;
         }
 
-        ///Compile pattern with initialization.
-        /// @param re Pattern string
-        Regex(StringView re) {
-            init_vars();
-            compile(re);
+        ///Synonym for initReplace()
+        ///@return RegexReplace object.
+        RegexReplace getReplaceObject(){
+            return initReplace();
         }
 
-        ///@overload
-        /// @param re Pattern string .
+        /// Perform regex replace and return the replaced string using a temporary replace object.
+        /// This temporary replace object will get available options from this Regex object,
+        /// that includes modifier table.
+        /// @param mains Subject string.
+        /// @param repl String to replace with
         /// @param mod Modifier string.
-        Regex(StringView re, Modifier const& mod) {
-            init_vars();
-            compile(re, mod);
+        ///@param counter Pointer to a counter to store the number of replacement done.
+        /// @return Resultant string after regex replace
+        /// @see RegexReplace::replace()
+        String replace(StringView mains, StringView repl, Modifier const& mod="", SIZE_T* counter=0) {
+            return initReplace().setSubject(mains).setReplaceWith(repl).setModifier(mod).setReplaceCounter(counter).replace();
         }
+    };
 
-        ///@overload
-        /// @param re Pattern string .
-        /// @param po PCRE2 option value
-        Regex(StringView re, Uint po) {
-            init_vars();
-            compile(re, po);
+    /** Writes many serialized Regex objects into a single bundle.
+     *
+     * The bundle starts with a small header and a table of (offset, size) entries, followed by
+     * the serialized Regex objects aligned to 8 bytes. It is meant to be written to a file
+     * and memory-mapped at startup, then read with RegexBundle without copying the file.
+     *
+     * ```cpp
+     * jp::RegexBundleWriter w;
+     * w.add(re1).add(re2);
+     * std::vector<jpcre2::Ush> bytes = w.getBytes(); // write to a file
+     * ```
+     */
+    class RegexBundleWriter {
+
+        std::vector<Ush> body;
+        VecOff offsets;
+        VecOff sizes;
+        int error_number;
+
+        public:
+
+        ///Default constructor.
+        RegexBundleWriter():error_number(0){}
+
+        ///Serialize a Regex and add it to the bundle.
+        ///If serialization fails, nothing is added and the error number is set.
+        ///@param re Compiled Regex object.
+        ///@return Reference to the calling RegexBundleWriter object.
+        RegexBundleWriter& add(Regex& re){
+            std::vector<Ush> bytes = re.serialize();
+            if(bytes.empty()){
+                error_number = re.getErrorNumber() ? re.getErrorNumber() : (int)PCRE2_ERROR_NULL;
+                return *this;
+            }
+            body.resize((body.size() + 7) & ~(SIZE_T)7); //align to 8
+            offsets.push_back(body.size());
+            sizes.push_back(bytes.size());
+            body.insert(body.end(), bytes.begin(), bytes.end());
+            return *this;
         }
 
-        ///@overload
-        /// @param re Pattern string .
-        /// @param po    PCRE2 option value
-        /// @param jo    JPCRE2 option value
-        Regex(StringView re, Uint po, Uint jo) {
-            init_vars();
-            compile(re, po, jo);
+        ///Get the number of Regex objects added.
+        ///@return count.
+        SIZE_T getCount() const {
+            return offsets.size();
+        }
+
+        ///Get the bundle.
+        ///@return bundle bytes.
+        std::vector<Ush> getBytes() const {
+            uint32_t head[4] = {0x4252504au /*JPRB*/, 1u, (uint32_t)(sizeof(Char_T) * CHAR_BIT), 0u};
+            uint64_t count = offsets.size();
+            SIZE_T table = sizeof(head) + sizeof(count);
+            SIZE_T start = table + offsets.size() * 2 * sizeof(uint64_t);
+            std::vector<Ush> out(start + body.size());
+            std::memcpy(&out[0], head, sizeof(head));
+            std::memcpy(&out[sizeof(head)], &count, sizeof(count));
+            for(SIZE_T i = 0; i < offsets.size(); ++i){
+                uint64_t entry[2] = {(uint64_t)(start + offsets[i]), (uint64_t)sizes[i]};
+                std::memcpy(&out[table + i * sizeof(entry)], entry, sizeof(entry));
+            }
+            if(!body.empty()) std::memcpy(&out[start], &body[0], body.size());
+            return out;
         }
 
-        /// @overload
-        ///...
-        /// Copy constructor.
-        /// A separate and new compile is performed from the copied options.
-        ///
-        /// @param r Constant Regex object reference.
-        Regex(Regex const &r) {
-            init_vars();
-            deepCopy(r);
+        ///Returns the last error number
+        ///@return Last error number
+        int getErrorNumber() const {
+            return error_number;
         }
 
-        /// Overloaded assignment operator.
-        /// @param r Regex const &
-        /// @return *this
-        Regex& operator=(Regex const &r) {
-            if (this == &r) return *this;
-            deepCopy(r);
+        ///Remove all added Regex objects and reset the error.
+        ///@return Reference to the calling RegexBundleWriter object.
+        RegexBundleWriter& clear(){
+            body.clear();
+            offsets.clear();
+            sizes.clear();
+            error_number = 0;
             return *this;
         }
+    };
 
+    /** Reads Regex objects from a bundle created by RegexBundleWriter.
+     *
+     * It doesn't copy the bundle, the memory (e.g a memory-mapped file) must outlive the RegexBundle
+     * object and the Regex objects loaded from it (they refer to the patterns inside the bundle).
+     *
+     * ```cpp
+     * jp::RegexBundle bundle(mapped_bytes, mapped_size);
+     * std::vector<jp::Regex> regexes(bundle.getCount());
+     * for(size_t i = 0; i < bundle.getCount(); ++i) bundle.load(i, regexes[i]);
+     * ```
+     */
+    class RegexBundle {
 
-        #ifdef JPCRE2_USE_MINIMUM_CXX_11
-
+        Ush const* data;
+        SIZE_T length;
+        SIZE_T count;
+        int error_number;
 
-        /// @overload
-        ///...
-        /// Move constructor.
-        ///This constructor steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        /// @param r rvalue reference to a Regex object.
-        Regex(Regex&& r) noexcept {
-            init_vars();
-            deepMove(r);
-        }
+        public:
 
-        ///@overload
-        ///...
-        /// Overloaded move-assignment operator.
-        ///This constructor steals resources from the argument.
-        ///It leaves the argument in a valid but indeterminate sate.
-        ///The indeterminate state can be returned to normal by calling reset() on that object.
-        /// @param r Regex&&
-        /// @return *this
-        Regex& operator=(Regex&& r) noexcept {
-            if (this == &r) return *this;
-            deepMove(r);
+        ///Default constructor.
+        RegexBundle():data(0), length(0), count(0), error_number(0){}
+
+        ///Open a bundle.
+        ///@param bytes pointer to the bundle (should be aligned to 8 bytes).
+        ///@param size size of the bundle.
+        RegexBundle(Ush const* bytes, SIZE_T size):data(0), length(0), count(0), error_number(0){
+            open(bytes, size);
+        }
+
+        ///Open a bundle.
+        ///If the header is not valid, the error number is set and the bundle is empty.
+        ///@param bytes pointer to the bundle (should be aligned to 8 bytes).
+        ///@param size size of the bundle.
+        ///@return Reference to the calling RegexBundle object.
+        RegexBundle& open(Ush const* bytes, SIZE_T size){
+            data = 0; length = 0; count = 0; error_number = 0;
+            uint32_t head[4];
+            uint64_t n;
+            if(!bytes || size < sizeof(head) + sizeof(n)){
+                error_number = PCRE2_ERROR_BADSERIALIZEDDATA;
+                return *this;
+            }
+            std::memcpy(head, bytes, sizeof(head));
+            std::memcpy(&n, bytes + sizeof(head), sizeof(n));
+            if(head[0] != 0x4252504au || head[1] != 1u) error_number = PCRE2_ERROR_BADMAGIC;
+            else if(head[2] != sizeof(Char_T) * CHAR_BIT) error_number = PCRE2_ERROR_BADMODE;
+            else if(n > (size - sizeof(head) - sizeof(n)) / (2 * sizeof(uint64_t))) error_number = PCRE2_ERROR_BADSERIALIZEDDATA;
+            if(error_number) return *this;
+            data = bytes;
+            length = size;
+            count = (SIZE_T) n;
             return *this;
         }
 
-        /// Provides boolean check for the status of the object.
-        /// This overloaded boolean operator needs to be declared
-        /// explicit to prevent implicit conversion and overloading issues.
-        ///
-        /// We will only enable it if >=C++11 is being used, as the explicit keyword
-        /// for a function other than constructor is not supported in older compilers.
-        ///
-        /// If you are dealing with legacy code/compilers use the Double bang trick mentioned
-        /// in Regex::operator!().
-        ///
-        /// This helps us to check the status of the compiled regex like this:
-        ///
-        /// ```
-        /// jpcre2::select<char>::Regex re("pat", "mod");
-        /// if(re) {
-        ///     std::cout<<"Compile success";
-        /// } else {
-        ///     std::cout<<"Compile failed";
-        /// }
-        /// ```
-        ///@return true if regex compiled successfully, false otherwise.
-        ///
-        explicit operator bool() const {
-            return (code != 0);
+        ///Get the number of Regex objects in the bundle.
+        ///@return count.
+        SIZE_T getCount() const {
+            return count;
         }
-        #endif
 
-        /// Provides boolean check for the status of the object.
-        /// This is a safe boolean approach (no implicit conversion  or overloading).
-        /// We don't need the explicit keyword here and thus it's the preferable method
-        /// to check for object status that will work well with older compilers.
-        /// e.g:
-        ///
-        /// ```
-        /// jpcre2::select<char>::Regex re("pat","mod");
-        /// if(!re) {
-        ///     std::cout<<"Compile failed";
-        /// } else {
-        ///     std::cout<<"Compiled successfully";
-        /// }
-        /// ```
-        /// Double bang trick:
-        ///
-        /// ```
-        /// jpcre2::select<char>::Regex re("pat","mod");
-        /// if(!!re) {
-        ///     std::cout<<"Compiled successfully";
-        /// } else {
-        ///     std::cout<<"Compile failed";
-        /// }
-        /// ```
-        /// @return true if regex compile failed, false otherwise.
-        bool operator!() const {
-            return (code == 0);
+        ///Load a Regex object from the bundle (see Regex::deserialize()).
+        ///@param i index of the Regex in the bundle.
+        ///@param re Regex object to load into.
+        ///@return true on success, false otherwise (error is set in `re`).
+        bool load(SIZE_T i, Regex& re) const {
+            uint64_t entry[2] = {0, 0};
+            if(i < count)
+                std::memcpy(entry, data + 4 * sizeof(uint32_t) + sizeof(uint64_t) + i * sizeof(entry), sizeof(entry));
+            if(i >= count || entry[0] > length || entry[1] > length - entry[0]){
+                re.deserialize(0, 0);
+                return false;
+            }
+            return !!re.deserialize(data + entry[0], (SIZE_T) entry[1]);
         }
 
-        virtual ~Regex() {
-            freeRegexMemory();
-            freeCompileContext();
+        ///Returns the last error number
+        ///@return Last error number
+        int getErrorNumber() const {
+            return error_number;
         }
+    };
 
-        ///Reset all class variables to its default (initial) state including memory.
-        ///@return Reference to the calling Regex object.
-        Regex& reset() {
-            freeRegexMemory();
-            freeCompileContext();
-            init_vars();
-            return *this;
+    /** Set of patterns matched against a subject in one pass.
+     * It reports which of the patterns match and, optionally, where each of them matches first.
+     *
+     * compile() compiles each pattern on its own (to check it), then combines the patterns into
+     * one alternation where every branch is an atomic group followed by a callout that records the
+     * pattern id and forces the match to go on, thus one scan of the subject finds all matching patterns.
+     * Scanning stops as soon as every pattern has matched. The first match offsets of each pattern are the
+     * same as its own match() would find.
+     *
+     * Patterns that can't be combined without changing their meaning are matched one by one (see isCombined()):
+     * patterns with back references, subroutine calls or recursion by number (`(?1)`, `(?R)`, `\g`),
+     * conditionals, `\K`, `\Q`, callouts, backtracking verbs and option settings such as `(*UTF)`,
+     * and comments in extended mode.
+     *
+     * The patterns share the same modifiers. Matching is thread safe, compilation is not.
+     *
+     * ```cpp
+     * jp::RegexSet rules;
+     * rules.add("union\\s+select").add("<script").add("\\.\\./");
+     * rules.compile("iS");
+     * std::vector<size_t> ids;
+     * rules.match(request_body, &ids); // ids of the rules that match
+     * ```
+     */
+    class RegexSet {
+
+        friend class RewriteSet;
+
+        //Per call state for the callout, set by match() on the calling thread.
+        struct ScanState {
+            MatchSpan *found;
+            SIZE_T remaining;
+        };
+
+        std::vector<String> patterns;
+        std::vector<Regex> regexes;
+        std::vector<bool> combinable;
+        String combined_pattern;
+        Regex combined;
+        SIZE_T combined_count;
+        MatchContext *mcontext;
+        RegexCache *regex_cache;
+        int error_number;
+        int error_offset;
+        SIZE_T error_index;
+
+        static ScanState*& currentState(){
+            static thread_local ScanState *state = 0;
+            return state;
+        }
+
+        static std::vector<MatchSpan>& getScratch(){
+            static thread_local std::vector<MatchSpan> scratch;
+            return scratch;
+        }
+
+        //Records the pattern whose id is the callout string and makes the match go on.
+        static int callout(CalloutBlock *cb, void*){
+            ScanState *st = currentState();
+            if(!st || !cb->callout_string) return 0;
+            SIZE_T id = 0;
+            for(PCRE2_SIZE i = 0; i < cb->callout_string_length; ++i)
+                id = id * 10 + (cb->callout_string[i] - '0');
+            MatchSpan& f = st->found[id];
+            if(f.start == PCRE2_UNSET){
+                f.start = cb->start_match;
+                f.end = cb->current_position;
+                if(--st->remaining == 0) return PCRE2_ERROR_CALLOUT; //all found, stop
+            }
+            return 1; //fail here, try the other branches and positions
+        }
+
+        //Checks whether a pattern keeps its meaning inside an atomic group of the combined pattern.
+        static bool isCombinable(StringView p, Regex const& re){
+            uint32_t backref_max = 0;
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(re.getPcre2Code(), PCRE2_INFO_BACKREFMAX, &backref_max);
+            if(backref_max > 0) return false;
+            bool extended = (re.getPcre2Option() & PCRE2_EXTENDED) != 0;
+            bool comment = false;
+            for(SIZE_T i = 0; i + 1 < p.size(); ++i){
+                Char_T c = p[i], d = p[i+1];
+                if(c == '\\'){
+                    if(d == 'K' || d == 'Q' || d == 'g') return false;
+                    ++i; //skip the escaped character
+                } else if(c == '(' && d == '*'){
+                    return false;
+                } else if(c == '(' && d == '?' && i + 2 < p.size()){
+                    Char_T e = p[i+2];
+                    if(e == '(' || e == 'R' || e == '&' || e == 'C' || e == 'P' || (e >= '0' && e <= '9')) return false;
+                    //inline options, e.g (?x) or (?i-x:
+                    for(SIZE_T j = i + 2; j < p.size() && p[j] != ')' && p[j] != ':'; ++j)
+                        if(p[j] == 'x') extended = true;
+                }
+            }
+            for(SIZE_T i = 0; i < p.size(); ++i) if(p[i] == '#') comment = true;
+            return !(extended && comment);
         }
 
-        ///Clear all class variables to its default (initial) state (some memory may retain for further use).
-        ///@return Reference to the calling Regex object.
-        Regex& clear() {
-            freeRegexMemory();
-            freeCompileContext();
-            init_vars();
-            return *this;
-        }
+        //not copyable
+        RegexSet(RegexSet const &);
+        RegexSet& operator=(RegexSet const &);
 
-        ///Reset regex compile related errors to zero.
-        ///@return A reference to the Regex object
-        ///@see  RegexReplace::resetErrors()
-        ///@see  RegexMatch::resetErrors()
-        Regex& resetErrors() {
-            error_number = 0;
-            error_offset = 0;
-            return *this;
+        public:
+
+        ///Default constructor.
+        RegexSet():combined_count(0), mcontext(0), regex_cache(0), error_number(0), error_offset(0), error_index(0){}
+
+        ///Destructor.
+        ~RegexSet(){
+            if(mcontext) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_context_free(mcontext);
         }
 
-        /// Recreate character tables used by PCRE2.
-        /// You should call this function after changing the locale to remake the
-        /// character tables according to the new locale.
-        /// These character tables are used to compile the regex and used by match
-        /// and replace operation. A separate call to compile() will be required
-        /// to apply the new character tables.
-        /// @return Reference to the calling Regex object.
-        Regex& resetCharacterTables() {
-            const unsigned char* tables = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::maketables(0); //must pass 0, we are using free() to free the tables.
-            tabv = std::vector<unsigned char>(tables, tables+1088);
-            ::free((void*)tables); //must free memory
-            if(!ccontext)
-                ccontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_create(0);
-            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+        ///Add a pattern, its id is the number of patterns added before it.
+        ///The pattern is copied. compile() must be called after adding patterns.
+        ///@param pattern Pattern string.
+        ///@return Reference to the calling RegexSet object.
+        RegexSet& add(StringView pattern){
+            patterns.push_back(String(pattern));
             return *this;
         }
 
-        ///Get Pcre2 raw compiled code pointer.
-        ///@return pointer to constant pcre2_code or null.
-        Pcre2Code const* getPcre2Code() const{
-            return code;
+        ///Set a RegexCache for the compiled patterns.
+        ///@param cache Pointer to RegexCache object (null to not use one).
+        ///@return Reference to the calling RegexSet object.
+        RegexSet& setRegexCache(RegexCache *cache){
+            regex_cache = cache;
+            return *this;
         }
 
-        /// Get pattern string
-        ///@return pattern string of type jpcre2::select::String
-        StringView getPattern() const  {
-            return pat_str;
-        }
+        ///Compile all patterns with the same modifiers.
+        ///If a pattern fails to compile, the error is set (see getErrorIndex()) and the set has no compiled pattern.
+        ///@param mod Modifier string.
+        ///@return Reference to the calling RegexSet object.
+        RegexSet& compile(Modifier const& mod = Modifier());
 
-        ///Get number of captures from compiled code.
-        ///@return New line option value or 0.
-        Uint getNumCaptures() {
-            if(!code) return 0;
-            Uint numCaptures = 0;
-            int ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_CAPTURECOUNT, &numCaptures);
-            if(ret < 0) error_number = ret;
-            return numCaptures;
-        }
+        ///Match the subject against all patterns.
+        ///A pattern whose match fails with an error (e.g match limit) is not reported as matching,
+        ///pass `error` to be told about it.
+        ///@param subject Subject string.
+        ///@param ids Vector to store the ids of the matching patterns (in ascending order), null to not store them.
+        ///@param spans Vector to store the first match of each pattern in `ids`, null to not store them.
+        ///@param error Pointer to store the first match error (0 if none), null to ignore errors.
+        ///@return Number of matching patterns.
+        SIZE_T match(StringView subject, std::vector<SIZE_T>* ids = 0, std::vector<MatchSpan>* spans = 0, int* error = 0) const;
 
-        /// Calculate modifier string from PCRE2 and JPCRE2 options and return it.
-        ///
-        /// **Mixed or combined modifier**.
-        ///
-        /// Some modifier may include other modifiers i.e they have the same meaning of some modifiers
-        /// combined together. For example, the 'n' modifier includes the 'u' modifier and together they
-        /// are equivalent to `PCRE2_UTF | PCRE2_UCP`. When you set a modifier like this, both options
-        /// get set, and when you remove the 'n' modifier (with `Regex::changeModifier()`), both will get removed.
-        ///@tparam Char_T Character type
-        ///@return Calculated modifier string (std::string)
-        ///@see RegexMatch::getModifier()
-        ///@see RegexReplace::getModifier()
-        std::string getModifier() const {
-            return modtab ? modtab->fromCompileOption(compile_opts, jpcre2_compile_opts)
-                          : MOD::fromCompileOption(compile_opts, jpcre2_compile_opts);
+        ///Get the number of patterns.
+        ///@return Pattern count.
+        SIZE_T size() const {
+            return patterns.size();
         }
 
-        /// Get PCRE2 option
-        /// @return Compile time PCRE2 option value
-        ///@see RegexReplace::getPcre2Option()
-        ///@see RegexMatch::getPcre2Option()
-        Uint getPcre2Option() const  {
-            return compile_opts;
+        ///Get a pattern.
+        ///@param id Pattern id.
+        ///@return Constant reference to the Regex object of the pattern.
+        Regex const& getRegex(SIZE_T id) const {
+            return regexes[id];
         }
 
-        /// Get JPCRE2 option
-        /// @return Compile time JPCRE2 option value
-        ///@see RegexReplace::getJpcre2Option()
-        ///@see RegexMatch::getJpcre2Option()
-        Uint getJpcre2Option() const  {
-            return jpcre2_compile_opts;
+        ///Check whether a pattern is matched in the combined pass.
+        ///@param id Pattern id.
+        ///@return true if it is part of the combined pattern, false if it is matched on its own.
+        bool isCombined(SIZE_T id) const {
+            return id < combinable.size() && combinable[id] && !!combined;
         }
 
-        /// Returns the last error number
-        ///@return Last error number
+        ///Get the error number of the last compile() or match().
+        ///@return Error number.
         int getErrorNumber() const {
             return error_number;
         }
 
-        /// Returns the last error offset
-        ///@return Last error offset
-        int getErrorOffset() const  {
-            return (int)error_offset;
+        ///Get the error offset in the pattern that failed to compile.
+        ///@return Error offset.
+        int getErrorOffset() const {
+            return error_offset;
         }
 
-        /// Returns the last error message
-        ///@return Last error message
-        String getErrorMessage() const  {
+        ///Get the id of the pattern that failed to compile.
+        ///@return Pattern id.
+        SIZE_T getErrorIndex() const {
+            return error_index;
+        }
+
+        ///Get the error message.
+        ///@return Error message.
+        String getErrorMessage() const {
             #ifdef JPCRE2_USE_MINIMUM_CXX_11
             return select<Char, Map>::getErrorMessage(error_number, error_offset);
             #else
             return select<Char>::getErrorMessage(error_number, error_offset);
             #endif
         }
+    };
 
-        ///Get new line convention from compiled code.
-        ///@return New line option value or 0.
-        ///```
-        ///PCRE2_NEWLINE_CR        Carriage return only
-        ///PCRE2_NEWLINE_LF        Linefeed only
-        ///PCRE2_NEWLINE_CRLF      CR followed by LF only
-        ///PCRE2_NEWLINE_ANYCRLF   Any of the above
-        ///PCRE2_NEWLINE_ANY       Any Unicode newline sequence
-        ///```
-        Uint getNewLine() {
-            if(!code) return 0;
-            Uint newline = 0;
-            int ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(code, PCRE2_INFO_NEWLINE, &newline);
-            if(ret < 0) error_number = ret;
-            return newline;
-        }
+    /** Matcher for a subject that arrives in chunks (network streams, big files read piece by piece).
+     *
+     * Each chunk is matched with `PCRE2_PARTIAL_HARD`: a match that could go on in the next chunk is
+     * not reported until it's complete. Only the unconsumed tail of the data is kept between chunks:
+     * the text of a pending partial match and a few characters before it, so that lookbehinds,
+     * `\b` and `^` in multiline mode see the characters that precede the match.
+     * The matches are the same as a global match (RegexMatch::setFindAll()) on the whole stream would find,
+     * their offsets are code unit offsets from the start of the stream.
+     *
+     * The memory used is the size of a chunk plus the tail, unless a partial match stays pending over
+     * many chunks (e.g `a.*b` without a `b`): its text is kept until it completes or fails.
+     * `\G` and `\A` refer to the retained buffer, not to the stream.
+     *
+     * ```cpp
+     * jp::Regex re("ERROR \\d+");
+     * jp::StreamMatcher sm(&re);
+     * std::vector<jpcre2::MatchSpan> found;
+     * while(read_chunk(chunk)) sm.feed(chunk, &found);
+     * sm.finish(&found);
+     * ```
+     */
+    class StreamMatcher {
 
-        ///Get the modifier table that is set,
-        ///@return constant ModifierTable pointer.
-        ModifierTable const* getModifierTable(){
-            return modtab;
-        }
+        Regex const *re;
+        String buf; //retained tail followed by the current chunk
+        SIZE_T buf_base; //stream offset of buf[0]
+        SIZE_T pos; //where matching resumes in buf
+        bool after_empty; //the last match was empty and ended at pos
+        Uint match_opts;
+        MatchContext *mcontext;
+        int error_number;
 
+        //Moves back n characters from i, to the start of a character in UTF mode.
+        static SIZE_T backChars(Char_T const *s, SIZE_T i, SIZE_T n, bool utf){
+            if(!utf) return i > n ? i - n : 0;
+            for(SIZE_T k = 0; k < n && i > 0; ++k){
+                --i;
+                while(i > 0 && isContinuation(s[i])) --i;
+            }
+            return i;
+        }
+
+        static bool isContinuation(Char_T c){
+            if(sizeof( Char_T ) == 1) return ((unsigned char)c & 0xc0) == 0x80;
+            if(sizeof( Char_T ) == 2) return (Uint)c >= 0xdc00 && (Uint)c <= 0xdfff;
+            return false;
+        }
+
+        //Length of the data without a character cut by the end of the chunk, PCRE2 rejects it as invalid UTF.
+        static SIZE_T completeLength(Regex const *re, Char_T const *s, SIZE_T n){
+            bool utf = re->code_ref->utf;
+            if(!utf || n == 0 || sizeof( Char_T ) == 4) return n;
+            SIZE_T last = backChars(s, n, 1, true);
+            Uint c = (Uint) s[last];
+            if(sizeof( Char_T ) == 2) return (c >= 0xd800 && c <= 0xdbff) ? last : n;
+            c &= 0xff;
+            SIZE_T need = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+            return n - last < need ? last : n;
+        }
+
+        //Global match loop over a window of the stream that starts at stream offset base.
+        //Unless final, the window is matched with PCRE2_PARTIAL_HARD and matches that reach its end are left
+        //for the next window. emit(span, text) is called for each match, it returns false to stop.
+        //Returns the offset in the window where matching must resume, pos and after_empty are updated.
+        template<typename Emit>
+        static PCRE2_SIZE scanWindow(Regex const *re, MatchContext *mcontext, Uint options, bool final,
+                                     Char_T const *data, PCRE2_SIZE length, SIZE_T base,
+                                     PCRE2_SIZE& pos, bool& after_empty, int& error_number, Emit emit){
+            CompiledCode const& cc = *re->code_ref;
+            Pcre2Sptr subject = (Pcre2Sptr) data;
+            //the start of the stream is not in the window
+            options |= (base ? PCRE2_NOTBOL : 0) | (final ? 0 : PCRE2_PARTIAL_HARD);
+            MatchData *match_data = MatchDataPool::getLocal().acquire(1);
+            PCRE2_SIZE *ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(match_data);
+            PCRE2_SIZE resume = length;
+
+            while(pos <= length){
+                Uint extra = after_empty ? PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED : 0;
+                int rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match(re->code, subject, length, pos, options | extra,
+                                                                      match_data, mcontext);
+                if(rc >= 0){
+                    MatchSpan span = {base + ovector[0], base + ovector[1]};
+                    after_empty = ovector[0] == ovector[1];
+                    pos = ovector[1];
+                    options |= PCRE2_NO_UTF_CHECK; //checked by the first call
+                    if(!emit(span, StringView(data + ovector[0], ovector[1] - ovector[0]))){
+                        resume = pos;
+                        break;
+                    }
+                    continue;
+                }
+                if(rc == PCRE2_ERROR_PARTIAL){
+                    //keep the partial match, it's matched again with the next window
+                    resume = ovector[0];
+                    if(resume != pos) after_empty = false;
+                    break;
+                }
+                if(rc != PCRE2_ERROR_NOMATCH){
+                    error_number = rc;
+                    resume = pos;
+                    break;
+                }
+                if(!after_empty) break; //nothing can start before the end
+                //no non-empty match where the empty match was: advance one character
+                after_empty = false;
+                if(pos >= length){
+                    resume = pos;
+                    break;
+                }
+                PCRE2_SIZE next = pos + 1;
+                if(cc.crlf_is_newline && pos + 1 < length && subject[pos] == '\r' && subject[pos + 1] == '\n')
+                    next += 1;
+                else if(cc.utf)
+                    while(next < length && isContinuation(data[next])) ++next;
+                if(next >= length && !final){
+                    //the next character may be cut or continue in the next window
+                    resume = pos;
+                    after_empty = true;
+                    break;
+                }
+                pos = next;
+            }
+            MatchDataPool::getLocal().release(match_data);
+            return resume;
+        }
+
+        //Offset in the window before which nothing is needed to resume at resume:
+        //lookbehinds, plus \b and ^ after CRLF see the characters before the resume position.
+        static SIZE_T keepFrom(Regex const *re, Char_T const *data, PCRE2_SIZE resume){
+            uint32_t lookbehind = 0;
+            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(re->code, PCRE2_INFO_MAXLOOKBEHIND, &lookbehind);
+            return backChars(data, resume, lookbehind + 2, re->code_ref->utf);
+        }
+
+        //Appends the spans to a vector.
+        struct SpanSink {
+            std::vector<MatchSpan> *spans;
+            SIZE_T *count;
+            bool operator()(MatchSpan const& span, StringView){
+                if(spans) spans->push_back(span);
+                ++*count;
+                return true;
+            }
+        };
 
-        ///Set new line convention.
-        ///@param value New line option value.
-        ///```
-        ///PCRE2_NEWLINE_CR        Carriage return only
-        ///PCRE2_NEWLINE_LF        Linefeed only
-        ///PCRE2_NEWLINE_CRLF      CR followed by LF only
-        ///PCRE2_NEWLINE_ANYCRLF   Any of the above
-        ///PCRE2_NEWLINE_ANY       Any Unicode newline sequence
-        ///```
-        ///@return Reference to the calling Regex object
-        Regex& setNewLine(Uint value){
-            if(!ccontext)
-                ccontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile_context_create(0);
-            int ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_newline(ccontext, value);
-            if(ret < 0) error_number = ret;
-            return *this;
-        }
+        SIZE_T scan(bool final, std::vector<MatchSpan>* spans);
 
-        /// Set the pattern string to compile
-        /// @param re Pattern string
-        /// @return Reference to the calling Regex object.
-        Regex& setPattern(StringView re) {
-            pat_str = re;
-            return *this;
-        }
+        friend struct select;
 
-        /// set the modifier (resets all JPCRE2 and PCRE2 options) by calling Regex::changeModifier().
-        /// Re-initializes the option bits for PCRE2 and JPCRE2 options, then parses the modifier and sets
-        /// equivalent PCRE2 and JPCRE2 options.
-        /// @param x Modifier string.
-        /// @return Reference to the calling Regex object.
-        /// @see RegexMatch::setModifier()
-        /// @see RegexReplace::setModifier()
-        Regex& setModifier(Modifier const& x) {
-            compile_opts = 0;
-            jpcre2_compile_opts = 0;
-            return changeModifier(x, true);
+        public:
+
+        ///Default constructor.
+        StreamMatcher():re(0), buf_base(0), pos(0), after_empty(false), match_opts(0), mcontext(0), error_number(0){}
+
+        ///Constructor that takes a pointer to a Regex object.
+        ///@param r Constant Regex pointer.
+        explicit StreamMatcher(Regex const *r):re(r), buf_base(0), pos(0), after_empty(false), match_opts(0), mcontext(0), error_number(0){}
+
+        ///Set the associated Regex object and start a new stream.
+        ///@param r Constant Regex pointer.
+        ///@return Reference to the calling StreamMatcher object.
+        StreamMatcher& setRegexObject(Regex const *r){
+            re = r;
+            return reset();
         }
 
-        ///Set a custom modifier table to be used.
-        ///@param mdt pointer to ModifierTable object.
-        /// @return Reference to the calling Regex object.
-        Regex& setModifierTable(ModifierTable const * mdt){
-            modtab = mdt;
+        ///Set the PCRE2 match options (e.g `PCRE2_NOTEMPTY`).
+        ///The partial matching options are set by the StreamMatcher itself.
+        ///@param x PCRE2 option value.
+        ///@return Reference to the calling StreamMatcher object.
+        StreamMatcher& setPcre2Option(Uint x){
+            match_opts = x & ~(Uint)(PCRE2_PARTIAL_HARD | PCRE2_PARTIAL_SOFT);
             return *this;
         }
 
-        /// Set JPCRE2 option for compile (overwrites existing option)
-        /// @param x Option value
-        /// @return Reference to the calling Regex object.
-        /// @see RegexMatch::setJpcre2Option()
-        /// @see RegexReplace::setJpcre2Option()
-        Regex& setJpcre2Option(Uint x) {
-            jpcre2_compile_opts = x;
+        ///Set a match context (e.g for match limits).
+        ///@param match_context Pointer to match context, null to not use one.
+        ///@return Reference to the calling StreamMatcher object.
+        StreamMatcher& setMatchContext(MatchContext *match_context){
+            mcontext = match_context;
             return *this;
         }
 
-        ///  Set PCRE2 option for compile (overwrites existing option)
-        /// @param x Option value
-        /// @return Reference to the calling Regex object.
-        /// @see RegexMatch::setPcre2Option()
-        /// @see RegexReplace::setPcre2Option()
-        Regex& setPcre2Option(Uint x) {
-            compile_opts = x;
+        ///Start a new stream: the retained data is dropped and offsets start from 0 again.
+        ///@return Reference to the calling StreamMatcher object.
+        StreamMatcher& reset(){
+            buf.clear();
+            buf_base = 0;
+            pos = 0;
+            after_empty = false;
+            error_number = 0;
             return *this;
         }
 
-        /// Parse modifier and add/remove equivalent PCRE2 and JPCRE2 options.
-        /// This function does not initialize or re-initialize options.
-        /// If you want to set options from scratch, initialize them to 0 before calling this function.
-        ///
-        /// If invalid modifier is detected, then the error number for the Regex
-        /// object will be jpcre2::ERROR::INVALID_MODIFIER and error offset will be the modifier character.
-        /// You can get the message with Regex::getErrorMessage() function.
-        /// @param mod Modifier string.
-        /// @param x Whether to add or remove option
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::changeModifier()
-        /// @see RegexReplace::changeModifier()
-        Regex& changeModifier(Modifier const& mod, bool x){
-            modtab ? modtab->toCompileOption(mod, x, &compile_opts, &jpcre2_compile_opts, &error_number, &error_offset)
-                   : MOD::toCompileOption(mod, x, &compile_opts, &jpcre2_compile_opts, &error_number, &error_offset);
-            return *this;
+        ///Match the next chunk of the stream.
+        ///The matches that are complete are appended to `spans`, a match that reaches the end of the chunk
+        ///is reported by a later call to feed() or finish().
+        ///@param chunk Next chunk, it's copied after the retained tail.
+        ///@param spans Vector to append the matches to (stream offsets), null to only count them.
+        ///@return Number of matches found, 0 on error (see getErrorNumber()).
+        SIZE_T feed(StringView chunk, std::vector<MatchSpan>* spans){
+            if(!re || !re->code_ref || error_number) return 0;
+            buf.append(chunk.data(), chunk.size());
+            return scan(false, spans);
+        }
+
+        ///End the stream: the retained data is matched as the end of the subject.
+        ///A new stream can be fed afterwards, its offsets continue from the end of this one (see reset()).
+        ///@param spans Vector to append the matches to (stream offsets), null to only count them.
+        ///@return Number of matches found.
+        SIZE_T finish(std::vector<MatchSpan>* spans){
+            SIZE_T count = (re && re->code_ref && !error_number) ? scan(true, spans) : 0;
+            buf_base += buf.size();
+            buf.clear();
+            pos = 0;
+            after_empty = false;
+            return count;
         }
 
-        ///  Add or remove a JPCRE2 option
-        /// @param opt JPCRE2 option value
-        /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::changeJpcre2Option()
-        /// @see RegexReplace::changeJpcre2Option()
-        Regex& changeJpcre2Option(Uint opt, bool x) {
-            jpcre2_compile_opts = x ? jpcre2_compile_opts | opt : jpcre2_compile_opts & ~opt;
-            return *this;
+        ///Get the number of code units fed so far.
+        ///@return Stream offset of the end of the data.
+        SIZE_T getStreamOffset() const {
+            return buf_base + buf.size();
         }
 
-        /// Add or remove a PCRE2 option
-        /// @param opt PCRE2 option value
-        /// @param x Add the option if it's true, remove otherwise.
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::changePcre2Option()
-        /// @see RegexReplace::changePcre2Option()
-        Regex& changePcre2Option(Uint opt, bool x) {
-            compile_opts = x ? compile_opts | opt : compile_opts & ~opt;
-            return *this;
+        ///Get the number of code units retained from the data fed so far.
+        ///@return Size of the retained tail.
+        SIZE_T getRetainedSize() const {
+            return buf.size();
         }
 
-        /// Parse modifier string and add equivalent PCRE2 and JPCRE2 options.
-        /// This is just a wrapper of the original function Regex::changeModifier()
-        /// provided for convenience.
-        /// @param mod Modifier string.
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::addModifier()
-        /// @see RegexReplace::addModifier()
-        Regex& addModifier(Modifier const& mod){
-            return changeModifier(mod, true);
+        ///Get the error number of the last match.
+        ///After an error, feed() does nothing until reset() is called.
+        ///@return Error number.
+        int getErrorNumber() const {
+            return error_number;
         }
+    };
 
-        /// Add option to existing JPCRE2 options for compile
-        /// @param x Option value
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::addJpcre2Option()
-        /// @see RegexReplace::addJpcre2Option()
-        Regex& addJpcre2Option(Uint x) {
-            jpcre2_compile_opts |= x;
+    /** Applies an ordered list of rewrite rules, each a pattern and a replacement string, in one pass.
+     *
+     * compile() compiles each rule on its own (to check it), then combines the rules into one alternation
+     * where every branch starts with a `(*MARK)` that names the rule. One scan of the subject finds, at the
+     * leftmost position where any rule matches, the first rule (in the order they were added) that matches
+     * there; its replacement is appended to the output and the scan goes on after the match.
+     * The subject is copied into the output once, whatever the number of rules.
+     *
+     * This is not the same as calling RegexReplace::replace() for each rule in turn: a rule doesn't see
+     * the output of the rules before it, and where the matches of two rules overlap, the one that starts
+     * first wins (the one added first if they start at the same position). Rules that don't overlap give
+     * the same result either way.
+     *
+     * Rules that can't be combined (see RegexSet) are matched on their own in the same scan: the next match
+     * of each of them is kept and compared with the next match of the combined pattern.
+     *
+     * Replacement strings are compiled with ReplacementTemplate (the pcre2_substitute() syntax without
+     * PCRE2_SUBSTITUTE_EXTENDED), group names and numbers refer to the groups of the rule's own pattern.
+     *
+     * The rules share the same modifiers. Rewriting is thread safe, compilation is not.
+     *
+     * ```cpp
+     * jp::RewriteSet rules;
+     * rules.add("&", "&amp;").add("<", "&lt;").add("(\\w+)@example\\.com", "$1@example.org");
+     * rules.compile();
+     * std::vector<size_t> hits;
+     * jp::String out;
+     * rules.rewrite(document, out, &hits); // hits[i]: number of replacements made by rule i
+     * ```
+     */
+    class RewriteSet {
+
+        //A pattern of the scan (the combined pattern or a rule matched on its own) and its next match.
+        struct Cursor {
+            Regex const *re;
+            MatchData *md;
+            PCRE2_SIZE *ovector;
+            PCRE2_SIZE start; //start of the next match, PCRE2_UNSET if it must be looked for
+            SIZE_T rule; //rule of the next match
+            bool done; //no match after the scan position
+        };
+
+        std::vector<String> patterns;
+        std::vector<String> replacements;
+        std::vector<Regex> regexes;
+        std::vector<ReplacementTemplate> templates;
+        std::vector<bool> combinable;
+        std::vector<uint32_t> group_base; //groups of the combined pattern before the rule's own groups
+        String combined_pattern;
+        Regex combined;
+        SIZE_T combined_count;
+        Uint replace_opts;
+        RegexCache *regex_cache;
+        int error_number;
+        int error_offset;
+        SIZE_T error_index;
+
+        //The rule id in the (*MARK) of a match of the combined pattern.
+        static SIZE_T markedRule(MatchData *md){
+            Pcre2Sptr mark = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_mark(md);
+            SIZE_T id = 0;
+            for(; mark && *mark; ++mark) id = id * 10 + (*mark - '0');
+            return id;
+        }
+
+        //not copyable
+        RewriteSet(RewriteSet const &);
+        RewriteSet& operator=(RewriteSet const &);
+
+        public:
+
+        ///Default constructor.
+        RewriteSet():combined_count(0), replace_opts(0), regex_cache(0), error_number(0), error_offset(0), error_index(0){}
+
+        ///Add a rule, its id is the number of rules added before it.
+        ///The strings are copied. compile() must be called after adding rules.
+        ///@param pattern Pattern string.
+        ///@param replacement Replacement string.
+        ///@return Reference to the calling RewriteSet object.
+        RewriteSet& add(StringView pattern, StringView replacement){
+            patterns.push_back(String(pattern));
+            replacements.push_back(String(replacement));
             return *this;
         }
 
-        ///  Add option to existing PCRE2 options for compile
-        /// @param x Option value
-        /// @return Reference to the calling Regex object
-        /// @see RegexMatch::addPcre2Option()
-        /// @see RegexReplace::addPcre2Option()
-        Regex& addPcre2Option(Uint x) {
-            compile_opts |= x;
+        ///Set a RegexCache for the compiled patterns.
+        ///@param cache Pointer to RegexCache object (null to not use one).
+        ///@return Reference to the calling RewriteSet object.
+        RewriteSet& setRegexCache(RegexCache *cache){
+            regex_cache = cache;
             return *this;
         }
 
-        ///Compile pattern using info from class variables.
-        ///@see Regex::compile(StringView re, Uint po, Uint jo)
-        ///@see Regex::compile(StringView re, Uint po)
-        ///@see Regex::compile(StringView re, Modifier mod)
-        ///@see Regex::compile(StringView re)
-        void compile(void);
+        ///Set the replace options used to expand the replacements.
+        ///PCRE2_SUBSTITUTE_UNSET_EMPTY and PCRE2_SUBSTITUTE_UNKNOWN_UNSET are used, the others are ignored.
+        ///@param ro Replace options.
+        ///@return Reference to the calling RewriteSet object.
+        RewriteSet& setReplaceOption(Uint ro){
+            replace_opts = ro;
+            return *this;
+        }
+
+        ///Compile all rules, the patterns with the same modifiers.
+        ///If a pattern or a replacement fails to compile, the error is set (see getErrorIndex())
+        ///and the set has no compiled rule.
+        ///@param mod Modifier string.
+        ///@return Reference to the calling RewriteSet object.
+        RewriteSet& compile(Modifier const& mod = Modifier());
+
+        ///Rewrite the subject and append the result to `out`.
+        ///On a match or replacement error (e.g match limit, an unset group without PCRE2_SUBSTITUTE_UNSET_EMPTY)
+        ///the subject is appended unmodified, 0 is returned and `hits` is left as it was.
+        ///@param subject Subject string.
+        ///@param out String the result is appended to.
+        ///@param hits Vector the number of replacements of each rule is added to (it's resized to size() if smaller),
+        ///null to not count them.
+        ///@param error Pointer to store the error number (0 if none), null to ignore errors.
+        ///@return Number of replacements.
+        SIZE_T rewrite(StringView subject, String& out, std::vector<SIZE_T>* hits = 0, int* error = 0) const;
 
         ///@overload
         ///...
-        /// Set the specified parameters, then compile the pattern using information from class variables.
-        /// @param re Pattern string
-        /// @param po PCRE2 option
-        /// @param jo JPCRE2 option
-        void compile(StringView re, Uint po, Uint jo) {
-            setPattern(re).setPcre2Option(po).setJpcre2Option(jo);
-            compile();
+        ///@param subject Subject string.
+        ///@param hits Vector the number of replacements of each rule is added to, null to not count them.
+        ///@param error Pointer to store the error number (0 if none), null to ignore errors.
+        ///@return Rewritten string.
+        String rewrite(StringView subject, std::vector<SIZE_T>* hits = 0, int* error = 0) const {
+            String out;
+            rewrite(subject, out, hits, error);
+            return out;
         }
 
-        ///@overload
-        /// @param re Pattern string
-        /// @param po PCRE2 option
-        void compile(StringView re, Uint po) {
-            setPattern(re).setPcre2Option(po);
-            compile();
+        ///Get the number of rules.
+        ///@return Rule count.
+        SIZE_T size() const {
+            return patterns.size();
         }
 
-        /// @overload
-        /// @param re Pattern string
-        /// @param mod Modifier string.
-        void compile(StringView re, Modifier const& mod) {
-            setPattern(re).setModifier(mod);
-            compile();
+        ///Get the pattern of a rule.
+        ///@param id Rule id.
+        ///@return Constant reference to the Regex object of the rule.
+        Regex const& getRegex(SIZE_T id) const {
+            return regexes[id];
         }
 
-        ///@overload
-        /// @param re Pattern string .
-        void compile(StringView re) {
-            setPattern(re);
-            compile();
+        ///Get the replacement of a rule.
+        ///@param id Rule id.
+        ///@return Constant reference to the compiled replacement of the rule.
+        ReplacementTemplate const& getReplacementTemplate(SIZE_T id) const {
+            return templates[id];
         }
 
-        ///Returns a default constructed RegexMatch object by value.
-        ///This object is initialized with the same modifier table
-        ///as this Regex object.
-        ///@return RegexMatch object.
-        RegexMatch initMatch(){
-            RegexMatch rm(this);
-            rm.setModifierTable(modtab);
-            return rm;
+        ///Check whether a rule is matched in the combined pattern.
+        ///@param id Rule id.
+        ///@return true if it is part of the combined pattern, false if it is matched on its own.
+        bool isCombined(SIZE_T id) const {
+            return id < combinable.size() && combinable[id] && combined_count;
         }
 
-        ///Synonym for initMatch()
-        ///@return RegexMatch object by value.
-        RegexMatch getMatchObject(){
-            return initMatch();
+        ///Get the error number of the last compile().
+        ///@return Error number.
+        int getErrorNumber() const {
+            return error_number;
         }
 
-        /// Perform regex match and return match count using a temporary match object.
-        /// This temporary match object will get available options from this Regex object,
-        /// that includes modifier table.
-        /// @param s Subject string .
-        /// @param mod Modifier string.
-        /// @param start_offset Offset from where matching will start in the subject string.
-        /// @return Match count
-        /// @see RegexMatch::match()
-        SIZE_T match(StringView s, Modifier const& mod, PCRE2_SIZE start_offset=0) {
-            return initMatch().setStartOffset(start_offset).setSubject(s).setModifier(mod).match();
+        ///Get the error offset in the pattern or replacement that failed to compile.
+        ///@return Error offset.
+        int getErrorOffset() const {
+            return error_offset;
         }
 
-        ///@overload
-        ///...
-        /// @param s Subject string .
-        /// @param start_offset Offset from where matching will start in the subject string.
-        /// @return Match count
-        /// @see RegexMatch::match()
-        SIZE_T match(StringView s, PCRE2_SIZE start_offset=0) {
-            return initMatch().setStartOffset(start_offset).setSubject(s).match();
+        ///Get the id of the rule that failed to compile.
+        ///@return Rule id.
+        SIZE_T getErrorIndex() const {
+            return error_index;
         }
 
-        ///Returns a default constructed RegexReplace object by value.
-        ///This object is initialized with the same modifier table as this Regex object.
-        ///@return RegexReplace object.
-        RegexReplace initReplace(){
-            RegexReplace rr(this);
-            rr.setModifierTable(modtab);
-            return rr;
+        ///Get the error message.
+        ///@return Error message.
+        String getErrorMessage() const {
+            #ifdef JPCRE2_USE_MINIMUM_CXX_11
+            return select<Char, Map>::getErrorMessage(error_number, error_offset);
+            #else
+            return select<Char>::getErrorMessage(error_number, error_offset);
+            #endif
         }
+    };
 
-        ///Synonym for initReplace()
-        ///@return RegexReplace object.
-        RegexReplace getReplaceObject(){
-            return initReplace();
+    /** Read only window on a file, used by scanFile().
+     *
+     * Where `mmap()` is available (POSIX systems) the window is a read only mapping of the file with a
+     * sequential access hint (`madvise`), nothing is copied. Elsewhere the window is read into a buffer
+     * with `std::fread()` and the part that is still needed is kept when the window moves forward.
+     * The window only moves forward.
+     */
+    class FileWindow {
+        #ifdef JPCRE2_USE_MMAP
+        int fd;
+        void *map;
+        size_t map_len;
+        SIZE_T file_units; //file size in code units
+        #else
+        std::FILE *file;
+        std::vector<Char_T> buf;
+        SIZE_T buf_start; //file offset (code units) of buf[0]
+        bool eof;
+        #endif
+
+        void unmap(){
+            #ifdef JPCRE2_USE_MMAP
+            if(map) ::munmap(map, map_len);
+            map = 0;
+            #endif
         }
 
-        /// Perform regex replace and return the replaced string using a temporary replace object.
-        /// This temporary replace object will get available options from this Regex object,
-        /// that includes modifier table.
-        /// @param mains Subject string.
-        /// @param repl String to replace with
-        /// @param mod Modifier string.
-        ///@param counter Pointer to a counter to store the number of replacement done.
-        /// @return Resultant string after regex replace
-        /// @see RegexReplace::replace()
-        String replace(StringView mains, StringView repl, Modifier const& mod="", SIZE_T* counter=0) {
-            return initReplace().setSubject(mains).setReplaceWith(repl).setModifier(mod).setReplaceCounter(counter).replace();
+        //not copyable
+        FileWindow(FileWindow const &);
+        FileWindow& operator=(FileWindow const &);
+
+        public:
+
+        #ifdef JPCRE2_USE_MMAP
+        FileWindow():fd(-1), map(0), map_len(0), file_units(0){}
+        #else
+        FileWindow():file(0), buf_start(0), eof(false){}
+        #endif
+
+        ~FileWindow(){
+            unmap();
+            #ifdef JPCRE2_USE_MMAP
+            if(fd >= 0) ::close(fd);
+            #else
+            if(file) std::fclose(file);
+            #endif
+        }
+
+        ///Open a file.
+        ///@param path File path.
+        ///@return true on success.
+        bool open(char const *path){
+            #ifdef JPCRE2_USE_MMAP
+            fd = ::open(path, O_RDONLY);
+            struct stat st;
+            if(fd < 0 || ::fstat(fd, &st) != 0) return false;
+            file_units = (SIZE_T) st.st_size / sizeof(Char_T);
+            #else
+            file = std::fopen(path, "rb");
+            if(!file) return false;
+            #endif
+            return true;
+        }
+
+        ///Get the default window size: the whole file if it can be mapped, 16MB otherwise.
+        ///@return Size in code units.
+        SIZE_T getDefaultSize() const {
+            #ifdef JPCRE2_USE_MMAP
+            return file_units ? file_units : 1;
+            #else
+            return ((SIZE_T)1 << 24) / sizeof(Char_T);
+            #endif
+        }
+
+        ///Make a part of the file available. The previous window is released.
+        ///@param start Offset (code units) of the window in the file, not less than the previous one.
+        ///@param n Size (code units) of the window.
+        ///@param got Set to the size of the window, less than n at the end of the file.
+        ///@param last Set to true if the window reaches the end of the file.
+        ///@return Pointer to the window, null on error.
+        Char_T const* get(SIZE_T start, SIZE_T n, SIZE_T& got, bool& last){
+            static const Char_T empty[1] = {0};
+            #ifdef JPCRE2_USE_MMAP
+            unmap();
+            if(start >= file_units){
+                got = 0;
+                last = true;
+                return empty;
+            }
+            got = std::min(n, file_units - start);
+            last = start + got == file_units;
+            //the mapping starts at a page boundary
+            size_t page = (size_t) ::sysconf(_SC_PAGESIZE);
+            size_t offset = start * sizeof(Char_T);
+            size_t delta = offset % page;
+            map_len = got * sizeof(Char_T) + delta;
+            map = ::mmap(0, map_len, PROT_READ, MAP_PRIVATE, fd, (off_t)(offset - delta));
+            if(map == MAP_FAILED){
+                map = 0;
+                return 0;
+            }
+            #ifdef MADV_SEQUENTIAL
+            ::madvise(map, map_len, MADV_SEQUENTIAL);
+            #endif
+            return (Char_T const*)((char const*) map + delta);
+            #else
+            //drop what's before start, read the rest
+            SIZE_T drop = std::min(start - buf_start, (SIZE_T) buf.size());
+            buf.erase(buf.begin(), buf.begin() + drop);
+            buf_start = start;
+            if(buf.size() < n && !eof){
+                SIZE_T have = buf.size();
+                buf.resize(n);
+                SIZE_T r = std::fread(&buf[have], sizeof(Char_T), n - have, file);
+                if(r < n - have){
+                    if(std::ferror(file)) return 0;
+                    eof = true;
+                }
+                buf.resize(have + r);
+            }
+            got = std::min(n, (SIZE_T) buf.size());
+            last = eof && got == buf.size();
+            return buf.empty() ? empty : &buf[0];
+            #endif
         }
     };
 
+    ///Run a global match over a file without reading it into a string.
+    ///The file is mapped read only (see FileWindow) and matched in place, like RegexMatch::match() with
+    ///FIND_ALL does on a subject. Each match is passed to `sink` as its offsets in the file (code units)
+    ///and its text, a view into the mapping that is valid during the call only.
+    ///
+    ///By default the whole file is mapped at once. Pass `window_size` to limit the address space used:
+    ///the file is then matched in windows of that size, matches that cross the end of a window are found
+    ///with partial matching in the next one (see StreamMatcher), a match longer than the window makes it grow.
+    ///
+    ///The file content is taken as code units of `Char_T` (a trailing incomplete code unit is ignored).
+    ///
+    ///```cpp
+    ///jp::Regex re("ERROR \\d+");
+    ///jpcre2::SIZE_T n = jp::scanFile("app.log", re, [](jpcre2::MatchSpan const& m, jp::StringView text){
+    ///    std::cout << m.start << ": " << text << '\n';
+    ///    return true; // false stops the scan
+    ///});
+    ///```
+    ///@param path File path.
+    ///@param re Compiled Regex object.
+    ///@param sink Callable `bool(MatchSpan const&, StringView)` called for each match, it returns false to stop.
+    ///@param window_size Size of the mapped window in bytes, 0 to map the whole file.
+    ///@param error Pointer to store the error number: jpcre2::ERROR::FILE_ERROR if the file can't be opened,
+    ///mapped or read, or the PCRE2 match error. Null to ignore errors.
+    ///@return Number of matches passed to the sink.
+    template<typename Sink>
+    static SIZE_T scanFile(std::string const& path, Regex const& re, Sink sink, SIZE_T window_size = 0, int* error = 0){
+        if(error) *error = 0;
+        if(!re) return 0;
+        FileWindow fw;
+        if(!fw.open(path.c_str())){
+            if(error) *error = (int) ERROR::FILE_ERROR;
+            return 0;
+        }
+        SIZE_T w = window_size ? std::max(window_size / sizeof(Char_T), (SIZE_T) 16) : fw.getDefaultSize();
+        SIZE_T start = 0, count = 0;
+        PCRE2_SIZE pos = 0;
+        bool after_empty = false, stopped = false;
+        int err = 0;
+        for(;;){
+            SIZE_T got;
+            bool last;
+            Char_T const *data = fw.get(start, w, got, last);
+            if(!data){
+                err = (int) ERROR::FILE_ERROR;
+                break;
+            }
+            PCRE2_SIZE length = last ? got : StreamMatcher::completeLength(&re, data, got);
+            PCRE2_SIZE resume = StreamMatcher::scanWindow(&re, 0, 0, last, data, length, start, pos, after_empty, err,
+                    [&](MatchSpan const& span, StringView text){
+                        ++count;
+                        stopped = !sink(span, text);
+                        return !stopped;
+                    });
+            if(last || err || stopped) break;
+            SIZE_T keep = StreamMatcher::keepFrom(&re, data, resume);
+            if(keep == 0) w *= 2; //a pending match fills the window
+            start += keep;
+            pos = resume - keep;
+        }
+        if(error) *error = err;
+        return count;
+    }
+
     private:
     //prevent object instantiation of select class
     select();
@@ -4079,7 +7479,7 @@ struct select{
 
 inline void jpcre2::ModifierTable::parseModifierTable(std::string& tabjs, VecOpt& tabjv,
                                                      std::string& tab_s, VecOpt& tab_v,
-                                                     std::string const& tabs, VecOpt const& tabv){
+                                                     std::string const& tabs, VecOpt const& tabv, Uint jopts){
     SIZE_T n = tabs.length();
     JPCRE2_ASSERT(n == tabv.size(), ("ValueError: Could not set Modifier table.\
     Modifier character and value tables are not of the same size (" + _tostdstring(n) + " == " + _tostdstring(tabv.size()) + ").").c_str());
@@ -4088,13 +7488,124 @@ inline void jpcre2::ModifierTable::parseModifierTable(std::string& tabjs, VecOpt
     tabjv.clear();
     tab_v.clear(); tab_v.reserve(n);
     for(SIZE_T i=0;i<n;++i){
-        switch(tabv[i]){
-            case JIT_COMPILE:
-            case FIND_ALL: //JPCRE2 options are unique, so it's not necessary to check if it's compile or replace or match.
-                tabjs.push_back(tabs[i]); tabjv.push_back(tabv[i]);break;
-            default: tab_s.push_back(tabs[i]); tab_v.push_back(tabv[i]); break;
+        //JPCRE2 option values overlap PCRE2 ones of other tables (JIT_COMPILE is PCRE2_NOTEMPTY in a match table),
+        //so a value is only a JPCRE2 option if it is one of this table's.
+        if(tabv[i] != NONE && (tabv[i] & ~jopts) == 0){
+            tabjs.push_back(tabs[i]); tabjv.push_back(tabv[i]);
+        } else {
+            tab_s.push_back(tabs[i]); tab_v.push_back(tabv[i]);
+        }
+    }
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::Regex::matchBatch(StringView const *subjects, SIZE_T n,
+                                                              std::vector<Ush>* matched, VecOff* counts,
+                                                              std::vector<MatchSpan>* first, Modifier const& mod,
+                                                              SIZE_T threads, int* error) const {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::Regex::matchBatch(StringView const *subjects, SIZE_T n,
+                                                         std::vector<Ush>* matched, VecOff* counts,
+                                                         std::vector<MatchSpan>* first, Modifier const& mod,
+                                                         SIZE_T threads, int* error) const {
+#endif
+    MatchSpan unset = {PCRE2_UNSET, PCRE2_UNSET};
+    if(matched) matched->assign(n, 0);
+    if(counts) counts->assign(n, 0);
+    if(first) first->assign(n, unset);
+    if(error) *error = 0;
+    if(code == 0 || n == 0) return 0;
+    lazyJit();
+
+    if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    //blocks of subjects, taken by the threads one at a time
+    SIZE_T block = std::max((SIZE_T) 64, n / (threads * 8) + 1);
+    SIZE_T nblocks = (n + block - 1) / block;
+    threads = std::min(threads, nblocks);
+    std::atomic<SIZE_T> next(0), total(0);
+    std::vector<std::pair<SIZE_T, int> > errors(threads, std::make_pair(n, 0)); //first error of each thread
+
+    auto work = [&](SIZE_T t){
+        //one setup per thread
+        RegexMatch rm(this);
+        rm.setModifierTable(modtab).setModifier(mod);
+        if(counts) rm.setFindAll();
+        MatchSpan span;
+        VecOff soff, eoff;
+        if(first && counts) rm.setMatchStartOffsetVector(&soff).setMatchEndOffsetVector(&eoff); //the first of all the matches
+        else if(first) rm.setMatchSpanBuffer(&span, 1);
+        MatchData *md = MatchDataPool::getLocal().acquire(code_ref->capture_count + 1);
+        rm.setMatchDataBlock(md);
+        SIZE_T hits = 0;
+        for(SIZE_T b; (b = next.fetch_add(1)) < nblocks;){
+            for(SIZE_T i = b * block, e = std::min(n, i + block); i < e; ++i){
+                SIZE_T c = rm.setSubject(subjects[i]).match();
+                if(rm.getErrorNumber() && i < errors[t].first) errors[t] = std::make_pair(i, rm.getErrorNumber());
+                if(c == 0) continue;
+                ++hits;
+                if(matched) (*matched)[i] = 1;
+                if(counts) (*counts)[i] = c;
+                if(first && counts){
+                    (*first)[i].start = soff[0];
+                    (*first)[i].end = eoff[0];
+                } else if(first) (*first)[i] = span;
+            }
         }
+        MatchDataPool::getLocal().release(md);
+        total += hits;
+    };
+    std::vector<std::thread> pool;
+    for(SIZE_T t = 1; t < threads; ++t) pool.emplace_back(work, t);
+    work(0);
+    for(SIZE_T t = 0; t < pool.size(); ++t) pool[t].join();
+
+    if(error){
+        std::pair<SIZE_T, int> e = *std::min_element(errors.begin(), errors.end());
+        *error = e.second;
+    }
+    return total;
+}
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::CodePtr jpcre2::select<Char_T, Map>::Regex::compileCode(int* err_number, PCRE2_SIZE* err_offset) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::CodePtr jpcre2::select<Char_T>::Regex::compileCode(int* err_number, PCRE2_SIZE* err_offset) {
+#endif
+    std::shared_ptr<CompiledCode> cc(new CompiledCode());
+    //The code keeps a pointer to the character tables, they must live as long as the code.
+    bool own_tables = ccontext && !tabv.empty();
+    if(own_tables){
+        cc->tables = tabv;
+        Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &cc->tables[0]);
+    }
+
+    cc->code = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile(  (Pcre2Sptr)pat_str.data(), /* the pattern */
+                                    pat_str.size(),         /* length of pattern */
+                                    compile_opts,           /* default options */
+                                    err_number,             /* for error number */
+                                    err_offset,             /* for error offset */
+                                    ccontext);              /* use compile context */
+
+    if(own_tables) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_character_tables(ccontext, &tabv[0]);
+
+    if (cc->code == 0) {
+        /* Compilation failed */
+        return CodePtr();
     }
+    cc->loadInfo();
+    cc->loadLiteral(pat_str);
+    if ((jpcre2_compile_opts & JIT_COMPILE) != 0) {
+        ///perform JIT compilation it it's enabled
+        int jit_ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_compile(cc->code, PCRE2_JIT_COMPLETE);
+        if(jit_ret < 0) cc->jit_error = jit_ret;
+        else cc->jit_compiled = true;
+    }
+    return cc;
 }
 
 
@@ -4105,9 +7616,6 @@ void jpcre2::select<Char_T, Map>::Regex::compile() {
 template<typename Char_T>
 void jpcre2::select<Char_T>::Regex::compile() {
 #endif
-    //Get c_str of pattern
-    Pcre2Sptr c_pattern = (Pcre2Sptr)pat_str.data();
-    PCRE2_SIZE patlen = pat_str.size();
     int err_number = 0;
     PCRE2_SIZE err_offset = 0;
 
@@ -4118,58 +7626,371 @@ void jpcre2::select<Char_T>::Regex::compile() {
 
     //first release any previous memory
     freeRegexMemory();
-    code = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::compile(  c_pattern,              /* the pattern */
-                                    patlen,                 /* length of pattern */
-                                    compile_opts,           /* default options */
-                                    &err_number,            /* for error number */
-                                    &err_offset,            /* for error offset */
-                                    ccontext);              /* use compile context */
+    if(regex_cache){
+        typename RegexCache::KeyRef key = {pat_str, compile_opts, jpcre2_compile_opts, newline, tabv.data(), tabv.size()};
+        code_ref = regex_cache->find(key);
+        if(!code_ref){
+            code_ref = compileCode(&err_number, &err_offset);
+            if(code_ref) code_ref = regex_cache->insert(key, code_ref);
+        }
+    } else {
+        code_ref = compileCode(&err_number, &err_offset);
+    }
+
+    if (!code_ref) {
+        /* Compilation failed */
+        //must not free regex memory, the only function has that right is the destructor
+        error_number = err_number;
+        error_offset = err_offset;
+        return;
+    }
+    code = code_ref->code;
+    //report JIT failure, even when the code came from the cache.
+    if(code_ref->jit_error) error_number = code_ref->jit_error;
+    //everything's OK
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+std::vector<jpcre2::Ush> jpcre2::select<Char_T, Map>::Regex::serialize() {
+#else
+template<typename Char_T>
+std::vector<jpcre2::Ush> jpcre2::select<Char_T>::Regex::serialize() {
+#endif
+    std::vector<Ush> out;
+    if(!code) return out;
+    uint8_t *bytes = 0;
+    PCRE2_SIZE size = 0;
+    const Pcre2Code* codes[1] = {code};
+    int32_t ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::serialize_encode(codes, 1, &bytes, &size, 0);
+    if(ret < 0){
+        error_number = ret;
+        return out;
+    }
+    SerializedHeader h = {0x5852504au /*JPRX*/, 1u, (uint32_t)(sizeof(Char_T) * CHAR_BIT),
+                          compile_opts, jpcre2_compile_opts, newline, pat_str.size(), size};
+    SIZE_T pattern_bytes = pat_str.size() * sizeof(Char_T);
+    SIZE_T code_start = (sizeof(h) + pattern_bytes + 7) & ~(SIZE_T)7;
+    out.resize(code_start + size);
+    std::memcpy(&out[0], &h, sizeof(h));
+    if(pattern_bytes) std::memcpy(&out[sizeof(h)], pat_str.data(), pattern_bytes);
+    std::memcpy(&out[code_start], bytes, size);
+    Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::serialize_free(bytes);
+    return out;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::Regex& jpcre2::select<Char_T, Map>::Regex::deserialize(Ush const* bytes, SIZE_T size) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::Regex& jpcre2::select<Char_T>::Regex::deserialize(Ush const* bytes, SIZE_T size) {
+#endif
+    freeRegexMemory();
+    error_number = 0;
+    error_offset = 0;
+    SerializedHeader h;
+    if(!bytes || size < sizeof(h)){
+        error_number = PCRE2_ERROR_BADSERIALIZEDDATA;
+        return *this;
+    }
+    std::memcpy(&h, bytes, sizeof(h));
+    if(h.magic != 0x5852504au || h.version != 1u){
+        error_number = PCRE2_ERROR_BADMAGIC;
+        return *this;
+    }
+    if(h.width != sizeof(Char_T) * CHAR_BIT){
+        error_number = PCRE2_ERROR_BADMODE;
+        return *this;
+    }
+    if(h.pattern_length > (size - sizeof(h)) / sizeof(Char_T)){
+        error_number = PCRE2_ERROR_BADSERIALIZEDDATA;
+        return *this;
+    }
+    SIZE_T code_start = (sizeof(h) + (SIZE_T)h.pattern_length * sizeof(Char_T) + 7) & ~(SIZE_T)7;
+    if(code_start > size || h.code_size > size - code_start){
+        error_number = PCRE2_ERROR_BADSERIALIZEDDATA;
+        return *this;
+    }
+
+    //pcre2_serialize_decode() reads its header in place, it must be aligned.
+    Ush const* code_bytes = bytes + code_start;
+    std::vector<uint64_t> aligned;
+    if(((uintptr_t)code_bytes & 7) != 0){
+        aligned.resize(((SIZE_T)h.code_size + 7) / 8);
+        std::memcpy(&aligned[0], code_bytes, (SIZE_T)h.code_size);
+        code_bytes = (Ush const*) &aligned[0];
+    }
+
+    std::shared_ptr<CompiledCode> cc(new CompiledCode());
+    int32_t ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::serialize_decode(&cc->code, 1, code_bytes, 0);
+    if(ret < 0){
+        cc->code = 0;
+        error_number = ret;
+        return *this;
+    }
+    cc->loadInfo();
+    cc->jit_pending = (h.jo & JIT_COMPILE) != 0;
+    code_ref = cc;
+    code = cc->code;
+
+    compile_opts = h.po;
+    jpcre2_compile_opts = h.jo;
+    if(h.newline) setNewLine(h.newline);
+    //the pattern can only be referred to if it's properly aligned for Char_T
+    Ush const* pattern = bytes + sizeof(h);
+    pat_str = ((uintptr_t)pattern % alignof(Char_T) == 0) ? StringView((Char_T const*)pattern, (SIZE_T)h.pattern_length)
+                                                          : StringView();
+    cc->loadLiteral(pat_str);
+    return *this;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::String jpcre2::select<Char_T, Map>::MatchEvaluator::evaluate(SIZE_T i, SIZE_T mcount) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::MatchEvaluator::evaluate(SIZE_T i, SIZE_T mcount) {
+#endif
+    JPCRE2_UNUSED(mcount);
+    switch(callbackn){
+        case 0: return callback0((void*)0, (void*)0, (void*)0);
+        case 1: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount, "VecNum");
+                return callback1(vec_num[i], (void*)0, (void*)0);
+        case 2: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount, "VecNas");
+                return callback2((void*)0, vec_nas[i], (void*)0);
+        case 3: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount, "VecNum or VecNas");
+                return callback3(vec_num[i], vec_nas[i], (void*)0);
+        case 4: JPCRE2_VECTOR_DATA_ASSERT(vec_ntn.size() == mcount, "VecNtn");
+                return callback4((void*)0, (void*)0, vec_ntn[i]);
+        case 5: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_ntn.size() == mcount, "VecNum or VecNtn");
+                return callback5(vec_num[i], (void*)0, vec_ntn[i]);
+        case 6: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNas or VecNtn");
+                return callback6((void*)0, vec_nas[i], vec_ntn[i]);
+        case 7: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNum\n or VecNas or VecNtn");
+                return callback7(vec_num[i], vec_nas[i], vec_ntn[i]);
+        default: JPCRE2_ASSERT(2 == 1, "Invalid callbackn. Please file a bug report (must include the line number from below)."); break;
+    }
+    return String();
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+bool jpcre2::select<Char_T, Map>::MatchEvaluator::substituteInto(String& out, StringView sv, String const& repl,
+                                                                  Uint replace_opts, MatchData* md, int& ret) {
+#else
+template<typename Char_T>
+bool jpcre2::select<Char_T>::MatchEvaluator::substituteInto(String& out, StringView sv, String const& repl,
+                                                             Uint replace_opts, MatchData* md, int& ret) {
+#endif
+    //A replacement without special characters is the result, there's nothing for pcre2_substitute to do.
+    if(repl.find(Char_T('$')) == String::npos
+       && ((replace_opts & PCRE2_SUBSTITUTE_EXTENDED) == 0 || repl.find(Char_T('\\')) == String::npos)){
+        out += repl;
+        ret = 1;
+        return true;
+    }
+
+    Pcre2Sptr subject = (Pcre2Sptr) sv.data();
+    PCRE2_SIZE subject_length = sv.length();
+
+    ///the string returned from the callback is the replacement string.
+    Pcre2Sptr replace = (Pcre2Sptr) repl.c_str();
+    PCRE2_SIZE replace_length = repl.length();
+
+    //The result for this match is written right after what's already in out, in a room sized by
+    //#buffer_size or a guess (the terminating zero written by pcre2_substitute included).
+    PCRE2_SIZE room = buffer_size ? buffer_size : subject_length + replace_length + 1;
+    SIZE_T pos = out.size();
+    bool retry = true;
+    PCRE2_SIZE outlengthptr;
+
+    while (true) {
+        resizeForOverwrite(out, pos + room);
+        outlengthptr = room;
+        ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::substitute(
+                    RegexMatch::re->code,   /*Points to the compiled pattern*/
+                    subject,                /*Points to the subject string*/
+                    subject_length,         /*Length of the subject string*/
+                    0,                      /*Offset in the subject at which to start matching*/ //must be zero
+                    replace_opts,           /*Option bits*/
+                    md,                     /*Points to a match data block*/
+                    RegexMatch::getActiveMatchContext(), /*Points to a match context, or is NULL*/
+                    replace,                /*Points to the replacement string*/
+                    replace_length,         /*Length of the replacement string*/
+                    (Pcre2Uchar*) &out[pos],/*Points to the output buffer*/
+                    &outlengthptr           /*Points to the length of the output buffer*/
+                    );
+
+        if (ret < 0) {
+            //Handle errors
+            if (ret == (int) PCRE2_ERROR_NOMEMORY && retry) {
+                retry = false;
+                /// If the room wasn't big enough for the result of this match,
+                /// we will try once more with the length pcre2_substitute asked for.
+                room = outlengthptr;
+                continue;
+            } else {
+                RegexMatch::countJitStackLimit(ret);
+                RegexMatch::error_number = ret;
+                out.resize(pos);
+                return false;
+            }
+        }
+        //If everything's ok exit the loop
+        break;
+    }
+    out.resize(pos + outlengthptr);
+    return true;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+bool jpcre2::select<Char_T, Map>::MatchEvaluator::streamStep(void* p, MatchData* md) {
+#else
+template<typename Char_T>
+bool jpcre2::select<Char_T>::MatchEvaluator::streamStep(void* p, MatchData* md) {
+#endif
+    MatchEvaluator& me = *(MatchEvaluator*) p;
+    StreamState& st = *me.stream;
+    SIZE_T mcount = me.vec_soff.size();
+    SIZE_T soff = me.vec_soff[mcount - 1], eoff = me.vec_eoff[mcount - 1];
+    //Matches that use \K to end before they start are not supported.
+    if(soff < st.offset || (st.substitute && eoff < soff)){
+        me.RegexMatch::error_number = PCRE2_ERROR_BADSUBSPATTERN;
+        st.failed = true;
+        return false;
+    }
+    //first copy the unmatched part, then the result for the matched part.
+    st.out->append(st.subject.data() + st.offset, soff - st.offset);
+    String tmp = me.evaluate(mcount - 1, mcount);
+    if(st.substitute){
+        int ret = 0;
+        bool ok;
+        if(st.md) //match the matched part again
+            ok = me.substituteInto(*st.out, st.subject.substr(soff, eoff - soff), tmp, st.replace_opts, st.md, ret);
+        #if defined(PCRE2_SUBSTITUTE_MATCHED) && defined(PCRE2_SUBSTITUTE_REPLACEMENT_ONLY)
+        else //the block holds this match, only the replacement is written.
+            ok = me.substituteInto(*st.out, st.subject, tmp,
+                                   st.replace_opts | PCRE2_SUBSTITUTE_MATCHED | PCRE2_SUBSTITUTE_REPLACEMENT_ONLY, md, ret);
+        #else
+        else ok = false;
+        #endif
+        if(!ok){
+            st.failed = true;
+            return false;
+        }
+        st.count += ret;
+    } else {
+        *st.out += tmp;
+        ++st.count;
+    }
+    st.offset = eoff;
+    if(!st.keep){
+        //nothing is kept for the next match
+        me.vec_num.clear();
+        me.vec_nas.clear();
+        me.vec_ntn.clear();
+        me.vec_soff.clear();
+        me.vec_eoff.clear();
+    }
+    return true;
+}
 
-    if (code == 0) {
-        /* Compilation failed */
-        //must not free regex memory, the only function has that right is the destructor
-        error_number = err_number;
-        error_offset = err_offset;
-        return;
-    } else if ((jpcre2_compile_opts & JIT_COMPILE) != 0) {
-        ///perform JIT compilation it it's enabled
-        int jit_ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::jit_compile(code, PCRE2_JIT_COMPLETE);
-        if(jit_ret < 0) error_number = jit_ret;
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::MatchEvaluator::streamReplace(String& out, Uint replace_opts, bool substitute, bool keep) {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::MatchEvaluator::streamReplace(String& out, Uint replace_opts, bool substitute, bool keep) {
+#endif
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
+    StringView r_subject = RegexMatch::getSubject();
+    Regex const * re = RegexMatch::getRegexObject();
+    // If re or re->code is null, append the subject string unmodified.
+    if (!re || re->code == 0){
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
     }
-    //everything's OK
+    StreamState st = {&out, r_subject, 0, 0, replace_opts, substitute, 0, keep, false};
+    //pcre2_substitute takes the match from the match data block, unless PCRE2 is too old for that
+    //or the block has no captures (DFA matching), then it matches again with a block of its own.
+    #if defined(PCRE2_SUBSTITUTE_MATCHED) && defined(PCRE2_SUBSTITUTE_REPLACEMENT_ONLY)
+    bool rematch = (RegexMatch::getJpcre2Option() & DFA_MATCH) != 0;
+    #else
+    bool rematch = true;
+    #endif
+    if(substitute && rematch) st.md = MatchDataPool::getLocal().acquire(re->code_ref->capture_count + 1);
+    stream = &st;
+    RegexMatch::match_hook = &streamStep;
+    RegexMatch::match_hook_data = this;
+    match();
+    RegexMatch::match_hook = 0;
+    RegexMatch::match_hook_data = 0;
+    stream = 0;
+    if(st.md) MatchDataPool::getLocal().release(st.md);
+    if(!keep){
+        vec_num.clear();
+        vec_nas.clear();
+        vec_ntn.clear();
+        vec_soff.clear();
+        vec_eoff.clear();
+    }
+    if(st.failed){
+        out.resize(base);
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
+    //now copy rest of the string from the end of the last match
+    out.append(r_subject.data() + st.offset, r_subject.size() - st.offset);
+    return st.count;
 }
 
 
 #ifdef JPCRE2_USE_MINIMUM_CXX_11
 template<typename Char_T, template<typename...> class Map>
-typename jpcre2::select<Char_T, Map>::String jpcre2::select<Char_T, Map>::MatchEvaluator::replace(bool do_match, Uint replace_opts, SIZE_T * counter) {
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::MatchEvaluator::replace(String& out, bool do_match, Uint replace_opts) {
 #else
 template<typename Char_T>
-typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::MatchEvaluator::replace(bool do_match, Uint replace_opts, SIZE_T * counter) {
+jpcre2::SIZE_T jpcre2::select<Char_T>::MatchEvaluator::replace(String& out, bool do_match, Uint replace_opts) {
 #endif
-    if(counter) *counter = 0;
+    SIZE_T count = 0;
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
 
     replace_opts |= PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
     replace_opts &= ~PCRE2_SUBSTITUTE_GLOBAL;
+    //a new match is done along with the replacement, pcre2_substitute can use the match data of each match.
+    if(do_match) return streamReplace(out, replace_opts, true, !streaming);
     Regex const * re = RegexMatch::getRegexObject();
-    // If re or re->code is null, return the subject string unmodified.
-    if (!re || re->code == 0)
-        return String(RegexMatch::getSubject());
-
     StringView r_subject = RegexMatch::getSubject();
-    //~ SIZE_T totlen = RegexMatch::getSubjectPointer()->length();
+    // If re or re->code is null, append the subject string unmodified.
+    if (!re || re->code == 0){
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
+    re->lazyJit();
 
     if(do_match) match();
     SIZE_T mcount = vec_soff.size();
-    // if mcount is 0, return the subject string. (there's no need to worry about re)
-    if(!mcount) return String(RegexMatch::getSubject());
+    // if mcount is 0, append the subject string. (there's no need to worry about re)
+    if(!mcount){
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
     SIZE_T current_offset = 0; //needs to be zero, not start_offset, because it's from where unmatched parts will be copied.
-    String res, tmp;
+    //match data block for substitute, taken from the pool if none was set by the user.
+    MatchData* match_data = RegexMatch::mdata ? RegexMatch::mdata : MatchDataPool::getLocal().acquire(re->code_ref->capture_count + 1);
 
     //A check, this check is not fullproof.
     SIZE_T last = vec_eoff.size();
     last = (last>0)?last-1:0;
-    JPCRE2_ASSERT(vec_eoff[last] <= RegexMatch::getSubject().size(), "ValueError: subject string is not of the required size, may be it's changed!!!\
+    JPCRE2_ASSERT(vec_eoff[last] <= r_subject.size(), "ValueError: subject string is not of the required size, may be it's changed!!!\
     If you are using existing match data, try a new match.");
 
     //loop through the matches
@@ -4178,116 +7999,63 @@ typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::MatchEvaluator::
         //Matches that use \K to end before they start are not supported.
         if(vec_soff[i] < current_offset || vec_eoff[i] < vec_soff[i]){
             RegexMatch::error_number = PCRE2_ERROR_BADSUBSPATTERN;
-            return String(RegexMatch::getSubject());
+            if(!RegexMatch::mdata) MatchDataPool::getLocal().release(match_data);
+            out.resize(base);
+            out.append(r_subject.data(), r_subject.size());
+            return 0;
         } else {
-            //~ res += RegexMatch::getSubject().substr(current_offset, vec_soff[i]-current_offset);
-            res += r_subject.substr(current_offset, vec_soff[i] - current_offset);
+            out.append(r_subject.data() + current_offset, vec_soff[i] - current_offset);
         }
         //now process the matched part
-        switch(callbackn){
-            case 0: tmp = callback0((void*)0, (void*)0, (void*)0); break;
-            case 1: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount, "VecNum");
-                    tmp = callback1(vec_num[i], (void*)0, (void*)0); break;
-            case 2: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount, "VecNas");
-                    tmp = callback2((void*)0, vec_nas[i], (void*)0); break;
-            case 3: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount, "VecNum or VecNas");
-                    tmp = callback3(vec_num[i], vec_nas[i], (void*)0); break;
-            case 4: JPCRE2_VECTOR_DATA_ASSERT(vec_ntn.size() == mcount, "VecNtn");
-                    tmp = callback4((void*)0, (void*)0, vec_ntn[i]); break;
-            case 5: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_ntn.size() == mcount, "VecNum or VecNtn");
-                    tmp = callback5(vec_num[i], (void*)0, vec_ntn[i]); break;
-            case 6: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNas or VecNtn");
-                    tmp = callback6((void*)0, vec_nas[i], vec_ntn[i]); break;
-            case 7: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNum\n or VecNas or VecNtn");
-                    tmp = callback7(vec_num[i], vec_nas[i], vec_ntn[i]); break;
-            default: JPCRE2_ASSERT(2 == 1, "Invalid callbackn. Please file a bug report (must include the line number from below)."); break;
-        }
+        String tmp = evaluate(i, mcount);
         //reset the current offset
         current_offset = vec_eoff[i];
 
         //second part
-        ///the matched part is the subject
-        //~ Pcre2Sptr subject = (Pcre2Sptr) RegexMatch::getSubjectPointer()->c_str();
-        //substr(vec_soff[i], vec_eoff[i] - vec_soff[i]).c_str();
-        StringView subject_sv = r_subject.substr(vec_soff[i], vec_eoff[i] - vec_soff[i]);
-        Pcre2Sptr subject = (Pcre2Sptr)subject_sv.data();
-        PCRE2_SIZE subject_length = subject_sv.length();
-
-        ///the string returned from the callback is the replacement string.
-        Pcre2Sptr replace = (Pcre2Sptr) tmp.c_str();
-        PCRE2_SIZE replace_length = tmp.length();
-        bool retry = true;
         int ret = 0;
-        PCRE2_SIZE outlengthptr = 0;
-        Pcre2Uchar* output_buffer = new Pcre2Uchar[outlengthptr + 1]();
-
-        while (true) {
-            ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::substitute(
-                        re->code,               /*Points to the compiled pattern*/
-                        subject,                /*Points to the subject string*/
-                        subject_length,         /*Length of the subject string*/
-                        0,                      /*Offset in the subject at which to start matching*/ //must be zero
-                        replace_opts,           /*Option bits*/
-                        RegexMatch::mdata,      /*Points to a match data block, or is NULL*/
-                        RegexMatch::mcontext,   /*Points to a match context, or is NULL*/
-                        replace,                /*Points to the replacement string*/
-                        replace_length,         /*Length of the replacement string*/
-                        output_buffer,          /*Points to the output buffer*/
-                        &outlengthptr           /*Points to the length of the output buffer*/
-                        );
-
-            if (ret < 0) {
-                //Handle errors
-                if ((replace_opts & PCRE2_SUBSTITUTE_OVERFLOW_LENGTH) != 0
-                        && ret == (int) PCRE2_ERROR_NOMEMORY && retry) {
-                    retry = false;
-                    /// If initial #buffer_size wasn't big enough for resultant string,
-                    /// we will try once more with a new buffer size adjusted to the length of the resultant string.
-                    delete[] output_buffer;
-                    output_buffer = new Pcre2Uchar[outlengthptr + 1]();
-                    // Go and try to perform the substitute again
-                    continue;
-                } else {
-                    RegexMatch::error_number = ret;
-                    delete[] output_buffer;
-                    return String(RegexMatch::getSubject());
-                }
-            }
-            //If everything's ok exit the loop
-            break;
+        if(!substituteInto(out, r_subject.substr(vec_soff[i], vec_eoff[i] - vec_soff[i]), tmp, replace_opts, match_data, ret)){
+            if(!RegexMatch::mdata) MatchDataPool::getLocal().release(match_data);
+            out.resize(base);
+            out.append(r_subject.data(), r_subject.size());
+            return 0;
         }
-        res += String((Char*) output_buffer,(Char*) (output_buffer + outlengthptr) );
-        delete[] output_buffer;
-        if(counter) *counter += ret;
+        count += ret;
         //if FIND_ALL is not set, single match will be performed
         if((RegexMatch::getJpcre2Option() & FIND_ALL) == 0) break;
     }
+    if(!RegexMatch::mdata) MatchDataPool::getLocal().release(match_data);
     //All matched parts have been dealt with.
     //now copy rest of the string from current_offset
-    res += RegexMatch::getSubject().substr(current_offset, String::npos);
-    return res;
+    out.append(r_subject.data() + current_offset, r_subject.size() - current_offset);
+    return count;
 }
 
 
 #ifdef JPCRE2_USE_MINIMUM_CXX_11
 template<typename Char_T, template<typename...> class Map>
-typename jpcre2::select<Char_T, Map>::String jpcre2::select<Char_T, Map>::MatchEvaluator::nreplace(bool do_match, Uint jo, SIZE_T* counter){
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::MatchEvaluator::nreplace(String& out, bool do_match, Uint jo){
 #else
 template<typename Char_T>
-typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::MatchEvaluator::nreplace(bool do_match, Uint jo, SIZE_T* counter){
+jpcre2::SIZE_T jpcre2::select<Char_T>::MatchEvaluator::nreplace(String& out, bool do_match, Uint jo){
 #endif
-    if(counter) *counter = 0;
+    JPCRE2_UNUSED(jo);
+    if(streaming && do_match) return streamReplace(out, 0, false, false);
+    SIZE_T count = 0;
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
+    StringView r_subject = RegexMatch::getSubject();
     if(do_match) match();
     SIZE_T mcount = vec_soff.size();
-    // if mcount is 0, return the subject string. (there's no need to worry about re)
-    if(!mcount) return String(RegexMatch::getSubject());
+    // if mcount is 0, append the subject string. (there's no need to worry about re)
+    if(!mcount){
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
     SIZE_T current_offset = 0; //no need for worrying about start offset, it's handled by match and we get valid offsets out of it.
-    String res;
 
     //A check, this check is not fullproof
     SIZE_T last = vec_eoff.size();
     last = (last>0)?last-1:0;
-    JPCRE2_ASSERT(vec_eoff[last] <= RegexMatch::getSubject().size(), "ValueError: subject string is not of the required size, may be it's changed!!!\
+    JPCRE2_ASSERT(vec_eoff[last] <= r_subject.size(), "ValueError: subject string is not of the required size, may be it's changed!!!\
     If you are using existing match data, try a new match.");
 
     //loop through the matches
@@ -4296,76 +8064,214 @@ typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::MatchEvaluator::
         //Matches that use \K to end before they start are not supported.
         if(vec_soff[i] < current_offset){
             RegexMatch::error_number = PCRE2_ERROR_BADSUBSPATTERN;
-            return String(RegexMatch::getSubject());
+            out.resize(base);
+            out.append(r_subject.data(), r_subject.size());
+            return 0;
         } else {
-            res += RegexMatch::getSubject().substr(current_offset, vec_soff[i]-current_offset);
+            out.append(r_subject.data() + current_offset, vec_soff[i] - current_offset);
         }
         //now process the matched part
-        switch(callbackn){
-            case 0: res += callback0((void*)0, (void*)0, (void*)0); break;
-            case 1: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount, "VecNum");
-                    res += callback1(vec_num[i], (void*)0, (void*)0); break;
-            case 2: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount, "VecNas");
-                    res += callback2((void*)0, vec_nas[i], (void*)0); break;
-            case 3: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount, "VecNum or VecNas");
-                    res += callback3(vec_num[i], vec_nas[i], (void*)0); break;
-            case 4: JPCRE2_VECTOR_DATA_ASSERT(vec_ntn.size() == mcount, "VecNtn");
-                    res += callback4((void*)0, (void*)0, vec_ntn[i]); break;
-            case 5: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_ntn.size() == mcount, "VecNum or VecNtn");
-                    res += callback5(vec_num[i], (void*)0, vec_ntn[i]); break;
-            case 6: JPCRE2_VECTOR_DATA_ASSERT(vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNas or VecNtn");
-                    res += callback6((void*)0, vec_nas[i], vec_ntn[i]); break;
-            case 7: JPCRE2_VECTOR_DATA_ASSERT(vec_num.size() == mcount && vec_nas.size() == mcount && vec_ntn.size() == mcount, "VecNum\n or VecNas or VecNtn");
-                    res += callback7(vec_num[i], vec_nas[i], vec_ntn[i]); break;
-            default: JPCRE2_ASSERT(2 == 1, "Invalid callbackn. Please file a bug report (must include the line number from below)."); break;
-        }
+        out += evaluate(i, mcount);
         //reset the current offset
         current_offset = vec_eoff[i];
-        if(counter) *counter += 1;
+        ++count;
         //if FIND_ALL is not set, single match will be performd
         if((RegexMatch::getJpcre2Option() & FIND_ALL) == 0) break;
     }
     //All matched parts have been dealt with.
     //now copy rest of the string from current_offset
-    res += RegexMatch::getSubject().substr(current_offset, String::npos);
-    return res;
+    out.append(r_subject.data() + current_offset, r_subject.size() - current_offset);
+    return count;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::ReplacementTemplate& jpcre2::select<Char_T, Map>::ReplacementTemplate::compile(Regex const& re, StringView repl) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::ReplacementTemplate& jpcre2::select<Char_T>::ReplacementTemplate::compile(Regex const& re, StringView repl) {
+#endif
+    source = String(repl);
+    literals.clear();
+    parts.clear();
+    groups.clear();
+    error_number = 0;
+    error_offset = 0;
+    code_ref = re.code_ref;
+    if(!code_ref || !re.code){
+        error_number = PCRE2_ERROR_NULL;
+        return *this;
+    }
+    CompiledCode const& cc = *code_ref;
+    SIZE_T n = repl.size(), i = 0;
+    static const Char_T mark_name[] = {'*', 'M', 'A', 'R', 'K'};
+    while(i < n){
+        if(repl[i] != Char_T('$')){
+            SIZE_T j = repl.find(Char_T('$'), i);
+            if(j == StringView::npos) j = n;
+            addLiteral(repl.data() + i, j - i);
+            i = j;
+            continue;
+        }
+        if(++i == n) return fail(i);
+        if(repl[i] == Char_T('$')){
+            addLiteral(repl.data() + i, 1);
+            ++i;
+            continue;
+        }
+        bool brace = repl[i] == Char_T('{');
+        if(brace && ++i == n) return fail(i);
+        if(repl[i] == Char_T('*')){
+            if(repl.substr(i, 5) != StringView(mark_name, 5)) return fail(i);
+            i += 5;
+            addMark();
+        } else if(isDigit(repl[i])){
+            uint32_t num = 0;
+            for(; i < n && isDigit(repl[i]); ++i)
+                if(num < 100000) num = num * 10 + (uint32_t)(repl[i] - Char_T('0'));
+            //group 0 is the whole match, groups beyond the capture count don't exist
+            addGroups(&num, num <= cc.capture_count ? 1 : 0);
+        } else if(isWord(repl[i])){
+            SIZE_T b = i;
+            while(i < n && isWord(repl[i])) ++i;
+            StringView name = repl.substr(b, i - b);
+            std::vector<uint32_t> nums;
+            for(typename std::vector<typename CompiledCode::NameEntry>::const_iterator it = cc.findName(name);
+                it != cc.names.end() && it->name == name; ++it)
+                nums.push_back(it->number);
+            addGroups(nums.empty() ? 0 : &nums[0], nums.size());
+        } else return fail(i);
+        if(brace){
+            if(i == n || repl[i] != Char_T('}')) return fail(i, PCRE2_ERROR_REPMISSINGBRACE);
+            ++i;
+        }
+    }
+    return *this;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+bool jpcre2::select<Char_T, Map>::RegexReplace::templateStep(void* p, MatchData* md) {
+#else
+template<typename Char_T>
+bool jpcre2::select<Char_T>::RegexReplace::templateStep(void* p, MatchData* md) {
+#endif
+    TemplateState& st = *(TemplateState*) p;
+    PCRE2_SIZE *ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(md);
+    uint32_t count = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_count(md);
+    //Matches that use \K to end before they start are not supported, as with pcre2_substitute.
+    if(ovector[1] < ovector[0] || ovector[0] < st.offset){
+        st.error = PCRE2_ERROR_BADSUBSPATTERN;
+        return false;
+    }
+    st.out->append(st.subject.data() + st.offset, ovector[0] - st.offset);
+    st.error = st.rt->expand(*st.out, st.subject, ovector, count,
+                             (Char_T const*) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_mark(md), st.replace_opts);
+    if(st.error) return false;
+    st.offset = ovector[1];
+    ++st.count;
+    return true;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RegexReplace::replaceWithTemplate(String& out) {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::RegexReplace::replaceWithTemplate(String& out) {
+#endif
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
+    //options that only mean something to pcre2_substitute, the rest are match options.
+    Uint substitute_only = PCRE2_SUBSTITUTE_GLOBAL | PCRE2_SUBSTITUTE_EXTENDED | PCRE2_SUBSTITUTE_UNSET_EMPTY
+                         | PCRE2_SUBSTITUTE_UNKNOWN_UNSET | PCRE2_SUBSTITUTE_OVERFLOW_LENGTH;
+    #if defined(PCRE2_SUBSTITUTE_MATCHED) && defined(PCRE2_SUBSTITUTE_REPLACEMENT_ONLY)
+    substitute_only |= PCRE2_SUBSTITUTE_MATCHED | PCRE2_SUBSTITUTE_REPLACEMENT_ONLY;
+    #endif
+    #ifdef PCRE2_SUBSTITUTE_LITERAL
+    substitute_only |= PCRE2_SUBSTITUTE_LITERAL;
+    #endif
+    RegexMatch rm(re);
+    rm.setSubject(r_subject)
+      .setStartOffset(_start_offset)
+      .setPcre2Option(replace_opts & ~substitute_only)
+      .setFindAll((replace_opts & PCRE2_SUBSTITUTE_GLOBAL) != 0)
+      .setMatchContext(mcontext)
+      .setJitStackManager(jit_stack_manager)
+      .setMatchDataBlock(mdata);
+    TemplateState st = {&out, r_subject, 0, 0, rtemplate, replace_opts, 0};
+    rm.match_hook = &templateStep;
+    rm.match_hook_data = &st;
+    rm.match();
+    int err = st.error ? st.error : rm.getErrorNumber();
+    if(err){
+        error_number = err;
+        out.resize(base);
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
+    //now copy rest of the string from the end of the last match
+    out.append(r_subject.data() + st.offset, r_subject.size() - st.offset);
+    *last_replace_counter += st.count;
+    return st.count;
 }
 
 
 #ifdef JPCRE2_USE_MINIMUM_CXX_11
 template<typename Char_T, template<typename...> class Map>
-typename jpcre2::select<Char_T, Map>::String jpcre2::select<Char_T, Map>::RegexReplace::replace() {
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RegexReplace::replace(String& out) {
 #else
 template<typename Char_T>
-typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::RegexReplace::replace() {
+jpcre2::SIZE_T jpcre2::select<Char_T>::RegexReplace::replace(String& out) {
 #endif
     *last_replace_counter = 0;
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
 
-    // If re or re->code is null, return the subject string unmodified.
-    if (!re || re->code == 0)
-        return String(r_subject);
+    // If re or re->code is null, append the subject string unmodified.
+    if (!re || re->code == 0){
+        out.append(r_subject.data(), r_subject.size());
+        return 0;
+    }
+    re->lazyJit();
+
+    StringView replw = r_replw;
+    if(rtemplate){
+        if(rtemplate->isUsable(re, replace_opts)) return replaceWithTemplate(out);
+        replw = rtemplate->source;
+    }
 
     Pcre2Sptr subject = (Pcre2Sptr) r_subject.data();
     PCRE2_SIZE subject_length = r_subject.size();
-    Pcre2Sptr replace = (Pcre2Sptr) r_replw.data();
-    PCRE2_SIZE replace_length = r_replw.size();
-    PCRE2_SIZE outlengthptr = (PCRE2_SIZE) buffer_size;
+    Pcre2Sptr replace = (Pcre2Sptr) replw.data();
+    PCRE2_SIZE replace_length = replw.size();
+    //The result is written right after what's already in out, in a room sized by #buffer_size
+    //or by the predicted output length.
+    PCRE2_SIZE room = predictSize(subject_length);
     bool retry = true;
     int ret = 0;
-    Pcre2Uchar* output_buffer = new Pcre2Uchar[outlengthptr + 1]();
+    PCRE2_SIZE outlengthptr;
+    //match data block for substitute, taken from the pool if none was set by the user.
+    MatchData* match_data = mdata ? mdata : MatchDataPool::getLocal().acquire(re->code_ref->capture_count + 1);
+    //match context set by the user or the one of the JitStackManager for this thread.
+    MatchContext* match_context = (mcontext || !jit_stack_manager) ? mcontext : jit_stack_manager->getMatchContext();
 
     while (true) {
+        resizeForOverwrite(out, base + room);
+        outlengthptr = room;
+        ++substitute_calls;
         ret = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::substitute(
                     re->code,               /*Points to the compiled pattern*/
                     subject,                /*Points to the subject string*/
                     subject_length,         /*Length of the subject string*/
                     _start_offset,          /*Offset in the subject at which to start matching*/
                     replace_opts,           /*Option bits*/
-                    mdata,                  /*Points to a match data block, or is NULL*/
-                    mcontext,               /*Points to a match context, or is NULL*/
+                    match_data,             /*Points to a match data block*/
+                    match_context,          /*Points to a match context, or is NULL*/
                     replace,                /*Points to the replacement string*/
                     replace_length,         /*Length of the replacement string*/
-                    output_buffer,          /*Points to the output buffer*/
+                    (Pcre2Uchar*) &out[base],/*Points to the output buffer*/
                     &outlengthptr           /*Points to the length of the output buffer*/
                     );
 
@@ -4374,25 +8280,29 @@ typename jpcre2::select<Char_T>::String jpcre2::select<Char_T>::RegexReplace::re
             if ((replace_opts & PCRE2_SUBSTITUTE_OVERFLOW_LENGTH) != 0
                     && ret == (int) PCRE2_ERROR_NOMEMORY && retry) {
                 retry = false;
-                /// If initial #buffer_size wasn't big enough for resultant string,
-                /// we will try once more with a new buffer size adjusted to the length of the resultant string.
-                delete[] output_buffer;
-                output_buffer = new Pcre2Uchar[outlengthptr + 1]();
+                /// If the initial room wasn't big enough for resultant string,
+                /// we will try once more with the length pcre2_substitute asked for.
+                room = outlengthptr;
+                ++substitute_retries;
                 // Go and try to perform the substitute again
                 continue;
             } else {
+                if(ret == PCRE2_ERROR_JIT_STACKLIMIT && match_context != mcontext) jit_stack_manager->countStackLimit();
                 error_number = ret;
-                delete[] output_buffer;
-                return String(r_subject);
+                if(!mdata) MatchDataPool::getLocal().release(match_data);
+                out.resize(base);
+                out.append(r_subject.data(), r_subject.size());
+                return 0;
             }
         }
         //If everything's ok exit the loop
         break;
     }
+    if(!mdata) MatchDataPool::getLocal().release(match_data);
+    out.resize(base + outlengthptr);
+    learnSize(subject_length, outlengthptr);
     *last_replace_counter += ret;
-    String result = String((Char*) output_buffer,(Char*) (output_buffer + outlengthptr) );
-    delete[] output_buffer;
-    return result;
+    return (SIZE_T) ret;
 }
 
 
@@ -4403,9 +8313,11 @@ bool jpcre2::select<Char_T, Map>::RegexMatch::getNumberedSubstrings(int rc, Pcre
 template<typename Char_T>
 bool jpcre2::select<Char_T>::RegexMatch::getNumberedSubstrings(int rc, Pcre2Sptr subject, PCRE2_SIZE* ovector, uint32_t ovector_count) {
 #endif
-    NumSub num_sub;
-    uint32_t rcu = rc;
-    num_sub.reserve(rcu); //we know exactly how many elements it will have.
+    JPCRE2_UNUSED(rc);
+    //build the vector in place, no temporary copy.
+    vec_num->emplace_back(); //this function shouldn't be called if this vector is null
+    NumSub& num_sub = vec_num->back();
+    num_sub.reserve(ovector_count); //we know exactly how many elements it will have.
     uint32_t i;
     for (i = 0u; i < ovector_count; i++) {
         if (ovector[2*i] != PCRE2_UNSET)
@@ -4417,45 +8329,37 @@ bool jpcre2::select<Char_T>::RegexMatch::getNumberedSubstrings(int rc, Pcre2Sptr
             num_sub.push_back(StringView());
         #endif
     }
-    vec_num->push_back(num_sub); //this function shouldn't be called if this vector is null
     return true;
 }
 
 
 #ifdef JPCRE2_USE_MINIMUM_CXX_11
 template<typename Char_T, template<typename...> class Map>
-bool jpcre2::select<Char_T, Map>::RegexMatch::getNamedSubstrings(int namecount, int name_entry_size,
-                                                            Pcre2Sptr name_table,
-                                                            Pcre2Sptr subject, PCRE2_SIZE* ovector ) {
+bool jpcre2::select<Char_T, Map>::RegexMatch::getNamedSubstrings(Pcre2Sptr subject, PCRE2_SIZE* ovector) {
 #else
 template<typename Char_T>
-bool jpcre2::select<Char_T>::RegexMatch::getNamedSubstrings(int namecount, int name_entry_size,
-                                                            Pcre2Sptr name_table,
-                                                            Pcre2Sptr subject, PCRE2_SIZE* ovector ) {
+bool jpcre2::select<Char_T>::RegexMatch::getNamedSubstrings(Pcre2Sptr subject, PCRE2_SIZE* ovector) {
 #endif
-    Pcre2Sptr tabptr = name_table;
-    StringView key;
-    MapNas map_nas;
-    MapNtN map_ntn;
-    for (int i = 0; i < namecount; i++) {
-        int n;
-        if(sizeof( Char_T ) * CHAR_BIT == 8){
-            n = (int)((tabptr[0] << 8) | tabptr[1]);
-            key = ((Char*) (tabptr + 2));
-        }
-        else{
-            n = (int)tabptr[0];
-            key = ((Char*) (tabptr + 1));
-        }
-        //Use of tabptr is finished for this iteration, let's increment it now.
-        tabptr += name_entry_size;
-        StringView value((Char*)(subject + ovector[2*n]), ovector[2*n+1] - ovector[2*n]); //n, not i.
-        if(vec_nas) map_nas[key] = value;
-        if(vec_ntn) map_ntn[key] = n;
-    }
-    //push the maps into vectors:
-    if(vec_nas) vec_nas->push_back(map_nas);
-    if(vec_ntn) vec_ntn->push_back(map_ntn);
+    //name table decoded at compile time
+    std::vector<typename CompiledCode::NameEntry> const& names = re->code_ref->names;
+    //the maps are built in place in the vectors, no temporary copy.
+    MapNas* map_nas = 0;
+    MapNtN* map_ntn = 0;
+    if(vec_nas){
+        vec_nas->emplace_back();
+        map_nas = &vec_nas->back();
+    }
+    if(vec_ntn){
+        vec_ntn->emplace_back();
+        map_ntn = &vec_ntn->back();
+    }
+    for (SIZE_T i = 0; i < names.size(); i++) {
+        uint32_t n = names[i].number;
+        StringView value = ovector[2*n] == PCRE2_UNSET ? StringView()
+                         : StringView((Char*)(subject + ovector[2*n]), ovector[2*n+1] - ovector[2*n]); //n, not i.
+        if(map_nas) (*map_nas)[names[i].name] = value;
+        if(map_ntn) (*map_ntn)[names[i].name] = n;
+    }
     return true;
 }
 
@@ -4471,23 +8375,24 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
     // If re or re->code is null, return 0 as the match count
     if (!re || re->code == 0)
         return 0;
+    re->lazyJit();
 
     Pcre2Sptr subject = (Pcre2Sptr)m_subject.data();
-    Pcre2Sptr name_table = 0;
-    int crlf_is_newline = 0;
-    int namecount = 0;
-    int name_entry_size = 0;
+    CompiledCode const& cc = *re->code_ref; //pattern information read at compile time
     int rc = 0;
     uint32_t ovector_count = 0;
-    int utf = 0;
+    bool utf = cc.utf;
+    bool jit = false;
     SIZE_T count = 0;
-    Uint option_bits;
-    Uint newline = 0;
     PCRE2_SIZE *ovector = 0;
     SIZE_T subject_length = 0;
     MatchData *match_data = 0;
     subject_length = m_subject.size();
-    bool mdc = false; //mdata created.
+    bool mdc = false; //match_data taken from the pool.
+    //only the overall match is needed, the ovector doesn't have to hold the captures.
+    //The hook may pass the block on to pcre2_substitute, which needs the captures.
+    bool offsets_only = !vec_num && !vec_nas && !vec_ntn && !match_table && !match_hook;
+    span_more = false;
 
 
     if (vec_num) vec_num->clear();
@@ -4495,29 +8400,35 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
     if (vec_ntn) vec_ntn->clear();
     if(vec_soff) vec_soff->clear();
     if(vec_eoff) vec_eoff->clear();
+    if(match_table) match_table->reset(m_subject.data(), 0, re->code_ref);
 
+    //subjects without the required literal can't match
+    if(!cc.prefilter(m_subject, _start_offset, match_opts)) return count;
 
     /* Using this function ensures that the block is exactly the right size for
      the number of capturing parentheses in the pattern. */
     if(mdata) match_data = mdata;
     else {
-        match_data = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_create_from_pattern(re->code, 0);
+        match_data = MatchDataPool::getLocal().acquire(offsets_only ? 1 : cc.capture_count + 1);
         mdc = true;
     }
 
-    rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match(  re->code,       /* the compiled pattern */
-                                subject,        /* the subject string */
-                                subject_length, /* the length of the subject */
-                                _start_offset,  /* start at offset 'start_offset' in the subject */
-                                match_opts,     /* default options */
-                                match_data,     /* block for storing the result */
-                                mcontext);      /* use default match context */
+    /* pcre2_jit_match() doesn't check UTF validity, the first match goes through pcre2_match()
+     unless the caller vouched for the subject. The subsequent matches are covered by the first check. */
+    jit = cc.jit_compiled;
+
+    rc = pcre2Match(jit && (!utf || (match_opts & PCRE2_NO_UTF_CHECK) != 0),
+                    subject,        /* the subject string */
+                    subject_length, /* the length of the subject */
+                    _start_offset,  /* start at offset 'start_offset' in the subject */
+                    match_opts,     /* default options */
+                    match_data);    /* block for storing the result */
 
     /* Matching failed: handle error cases */
 
     if (rc < 0) {
         if(mdc)
-            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(match_data); /* Release memory used for the match */
+            MatchDataPool::getLocal().release(match_data); /* Give the block back to the pool */
         //must not free code. This function has no right to modify regex
         switch (rc) {
             case PCRE2_ERROR_NOMATCH:
@@ -4531,6 +8442,12 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
         return count;
     }
 
+    if(span_buf && span_cap == 0){
+        span_more = true;
+        if(mdc) MatchDataPool::getLocal().release(match_data);
+        return count;
+    }
+
     ++count; //Increment the counter
     /* Match succeded. Get a pointer to the output vector, where string offsets are
      stored. */
@@ -4546,7 +8463,7 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
     /* The output vector wasn't big enough. This should not happen, because we used
      pcre2_match_data_create_from_pattern() above. */
 
-    if (rc == 0) {
+    if (rc == 0 && !(offsets_only && mdc)) {
         //ovector was not big enough for all the captured substrings;
         error_number = (int)ERROR::INSUFFICIENT_OVECTOR;
         rc = ovector_count;
@@ -4555,47 +8472,34 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
     //match succeeded at offset ovector[0]
     if(vec_soff) vec_soff->push_back(ovector[0]);
     if(vec_eoff) vec_eoff->push_back(ovector[1]);
+    if(span_buf){
+        span_buf[0].start = ovector[0];
+        span_buf[0].end = ovector[1];
+    }
+    if(match_table){
+        match_table->reset(m_subject.data(), ovector_count, re->code_ref);
+        match_table->push(ovector);
+    }
 
     // Get numbered substrings if vec_num isn't null
     if (vec_num) { //must do null check
-        if(!getNumberedSubstrings(rc, subject, ovector, ovector_count))
+        if(!getNumberedSubstrings(rc, subject, ovector, ovector_count)){
+            if(mdc) MatchDataPool::getLocal().release(match_data);
             return count;
+        }
     }
 
     //get named substrings if either vec_nas or vec_ntn is given.
     if (vec_nas || vec_ntn) {
-        /* See if there are any named substrings, and if so, show them by name. First
-         we have to extract the count of named parentheses from the pattern. */
-
-        (void) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info( re->code,               /* the compiled pattern */
-                                            PCRE2_INFO_NAMECOUNT,   /* get the number of named substrings */
-                                            &namecount);            /* where to put the answer */
-
-        if (namecount <= 0); /*No named substrings*/
-
-        else {
-            /* Before we can access the substrings, we must extract the table for
-             translating names to numbers, and the size of each entry in the table. */
-
-            (void) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info( re->code,               /* the compiled pattern */
-                                                PCRE2_INFO_NAMETABLE,   /* address of the table */
-                                                &name_table);           /* where to put the answer */
-
-            (void) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info( re->code,                   /* the compiled pattern */
-                                                PCRE2_INFO_NAMEENTRYSIZE,   /* size of each entry in the table */
-                                                &name_entry_size);          /* where to put the answer */
-
-            /* Now we can scan the table and, for each entry, print the number, the name,
-             and the substring itself. In the 8-bit library the number is held in two
-             bytes, most significant first. */
-
-
-            // Get named substrings if vec_nas isn't null.
-            // Get name to number map if vec_ntn isn't null.
-        }
-        //the following must be outside the above if-else
-        if(!getNamedSubstrings(namecount, name_entry_size, name_table, subject, ovector))
+        if(!getNamedSubstrings(subject, ovector)){
+            if(mdc) MatchDataPool::getLocal().release(match_data);
             return count;
+        }
+    }
+
+    if (match_hook && !match_hook(match_hook_data, match_data)) {
+        if(mdc) MatchDataPool::getLocal().release(match_data);
+        return count;
     }
 
     /***********************************************************************//*
@@ -4629,25 +8533,14 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
 
     if ((jpcre2_match_opts & FIND_ALL) == 0) {
         if(mdc)
-            Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(match_data); /* Release the memory that was used */
+            MatchDataPool::getLocal().release(match_data); /* Give the block back to the pool */
         // Must not free code. This function has no right to modify regex.
         return count; /* Exit the program. */
     }
 
-    /* Before running the loop, check for UTF-8 and whether CRLF is a valid newline
-     sequence. First, find the options with which the regex was compiled and extract
-     the UTF state. */
-
-    (void) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(re->code, PCRE2_INFO_ALLOPTIONS, &option_bits);
-    utf = ((option_bits & PCRE2_UTF) != 0);
-
-    /* Now find the newline convention and see whether CRLF is a valid newline
-     sequence. */
-
-    (void) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::pattern_info(re->code, PCRE2_INFO_NEWLINE, &newline);
-    crlf_is_newline = newline == PCRE2_NEWLINE_ANY
-            || newline == PCRE2_NEWLINE_CRLF
-            || newline == PCRE2_NEWLINE_ANYCRLF;
+    /* CRLF is a valid newline sequence if the newline convention is CRLF, ANYCRLF or ANY.
+     The newline convention was found at compile time. */
+    bool crlf_is_newline = cc.crlf_is_newline;
 
     /** We got the first match. Now loop for second and subsequent matches. */
 
@@ -4655,12 +8548,13 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
 
         Uint options = match_opts; /* Normally no options */
         PCRE2_SIZE start_offset = ovector[1]; /* Start at end of previous match */
+        bool after_empty = ovector[0] == ovector[1];
 
         /* If the previous match was for an empty string, we are finished if we are
          at the end of the subject. Otherwise, arrange to run another match at the
          same point to see if a non-empty match can be found. */
 
-        if (ovector[0] == ovector[1]) {
+        if (after_empty) {
             if (ovector[0] == subject_length)
                 break;
             options |= PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
@@ -4668,13 +8562,12 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
 
         /// Run the next matching operation */
 
-        rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match(  re->code,       /* the compiled pattern */
-                                    subject,        /* the subject string */
-                                    subject_length, /* the length of the subject */
-                                    start_offset,   /* starting offset in the subject */
-                                    options,        /* options */
-                                    match_data,     /* block for storing the result */
-                                    mcontext);      /* use match context */
+        rc = pcre2Match(jit,
+                        subject,        /* the subject string */
+                        subject_length, /* the length of the subject */
+                        start_offset,   /* starting offset in the subject */
+                        options,        /* options */
+                        match_data);    /* block for storing the result */
 
         /* This time, a result of NOMATCH isn't an error. If the value in "options"
          is zero, it just means we have found all possible matches, so the loop ends.
@@ -4690,7 +8583,7 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
          UTF mode. */
 
         if (rc == PCRE2_ERROR_NOMATCH) {
-            if (options == 0)
+            if (!after_empty)
                 break;                          /* All matches found */
             ovector[1] = start_offset + 1; /* Advance one code unit */
             if (crlf_is_newline &&                      /* If CRLF is newline & */
@@ -4712,16 +8605,21 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
 
         if (rc < 0) {
             if(mdc)
-                Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(match_data);
+                MatchDataPool::getLocal().release(match_data); /* Give the block back to the pool */
             // Must not free code. This function has no right to modify regex.
             error_number = rc;
             return count;
         }
 
         /* match succeeded */
+        if(span_buf && count == span_cap){
+            //one match more than the buffer can hold
+            span_more = true;
+            break;
+        }
         ++count; //Increment the counter
 
-        if (rc == 0) {
+        if (rc == 0 && !(offsets_only && mdc)) {
             /* The match succeeded, but the output vector wasn't big enough. This
              should not happen. */
             error_number = (int)ERROR::INSUFFICIENT_OVECTOR;
@@ -4732,32 +8630,598 @@ jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::match() {
         //match succeded at ovector[0]
         if(vec_soff) vec_soff->push_back(ovector[0]);
         if(vec_eoff) vec_eoff->push_back(ovector[1]);
+        if(span_buf){
+            span_buf[count - 1].start = ovector[0];
+            span_buf[count - 1].end = ovector[1];
+        }
+        if(match_table) match_table->push(ovector);
 
         /* As before, get substrings stored in the output vector by number, and then
          also any named substrings. */
 
         // Get numbered substrings if vec_num isn't null
         if (vec_num) { //must do null check
-            if(!getNumberedSubstrings(rc, subject, ovector, ovector_count))
+            if(!getNumberedSubstrings(rc, subject, ovector, ovector_count)){
+                if(mdc) MatchDataPool::getLocal().release(match_data);
                 return count;
+            }
         }
 
         if (vec_nas || vec_ntn) {
             //must call this whether we have named substrings or not:
-            if(!getNamedSubstrings(namecount, name_entry_size, name_table, subject, ovector))
+            if(!getNamedSubstrings(subject, ovector)){
+                if(mdc) MatchDataPool::getLocal().release(match_data);
                 return count;
+            }
+        }
+
+        if (match_hook && !match_hook(match_hook_data, match_data)) {
+            if(mdc) MatchDataPool::getLocal().release(match_data);
+            return count;
         }
     } /* End of loop to find second and subsequent matches */
 
     if(mdc)
-        Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_data_free(match_data);
+        MatchDataPool::getLocal().release(match_data); /* Give the block back to the pool */
     // Must not free code. This function has no right to modify regex.
     return count;
 }
 
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RegexMatch::parallelMatch(SIZE_T threads, Char_T separator, SIZE_T min_chunk) {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::parallelMatch(SIZE_T threads, Char_T separator, SIZE_T min_chunk) {
+#endif
+    if(threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+    SIZE_T length = m_subject.size();
+    SIZE_T start = std::min((SIZE_T) _start_offset, length);
+    //a few chunks per thread, so that the threads that are done early take the rest
+    SIZE_T chunks = std::min(threads * 4, (length - start) / std::max(min_chunk, (SIZE_T) 1));
+    VecOff boundaries;
+    for(SIZE_T i = 1; i < chunks; ++i){
+        SIZE_T target = start + (length - start) / chunks * i;
+        if(!boundaries.empty() && target < boundaries.back()) continue;
+        SIZE_T sep = m_subject.find(separator, target);
+        if(sep == StringView::npos || sep + 1 >= length) break;
+        if(boundaries.empty() || sep + 1 > boundaries.back()) boundaries.push_back(sep + 1);
+    }
+    return parallelMatch(boundaries, threads);
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RegexMatch::parallelMatch(VecOff const& boundaries, SIZE_T threads) {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::RegexMatch::parallelMatch(VecOff const& boundaries, SIZE_T threads) {
+#endif
+    SIZE_T length = m_subject.size();
+    VecOff cuts(1, _start_offset);
+    for(SIZE_T i = 0; i < boundaries.size(); ++i)
+        if(boundaries[i] > cuts.back() && boundaries[i] < length) cuts.push_back(boundaries[i]);
+    if(cuts.size() < 2 || !re || re->code == 0){
+        Uint jo = jpcre2_match_opts;
+        jpcre2_match_opts |= FIND_ALL;
+        SIZE_T count = match();
+        jpcre2_match_opts = jo;
+        return count;
+    }
+    cuts.push_back(length);
+    re->lazyJit();
+
+    //Results of one chunk, matched by a copy of this object that writes into its own vectors.
+    struct Chunk {
+        VecNum num;
+        VecNas nas;
+        VecNtN ntn;
+        VecOff soff, eoff;
+        MatchTable table;
+        SIZE_T count;
+        int error;
+        PCRE2_SIZE cut; //matches that start here or after belong to the next chunk
+        PCRE2_SIZE last_end; //end of the last match of the chunk
+        bool over; //the last match found belongs to the next chunk
+    };
+    SIZE_T nchunks = cuts.size() - 1;
+    std::vector<Chunk> results(nchunks);
+    //Matches a chunk from `from` to the first match that starts at the next cut or after it.
+    //The whole subject is given to PCRE2, so that \Z, \z, $ and lookaheads see the text after the cut.
+    auto run = [&](SIZE_T i, PCRE2_SIZE from){
+        Chunk& c = results[i];
+        c.num.clear(); c.nas.clear(); c.ntn.clear(); c.soff.clear(); c.eoff.clear();
+        c.cut = cuts[i + 1];
+        c.last_end = from;
+        c.over = false;
+        RegexMatch rm(*this);
+        rm.mdata = 0;
+        rm.vec_num = vec_num ? &c.num : 0;
+        rm.vec_nas = vec_nas ? &c.nas : 0;
+        rm.vec_ntn = vec_ntn ? &c.ntn : 0;
+        rm.vec_soff = &c.soff;
+        rm.vec_eoff = &c.eoff;
+        rm.span_buf = 0;
+        rm.match_table = match_table ? &c.table : 0;
+        rm._start_offset = from;
+        rm.jpcre2_match_opts |= FIND_ALL;
+        if(i + 1 < nchunks){
+            rm.match_hook = [](void* p, MatchData* md) -> bool {
+                Chunk& ch = *(Chunk*) p;
+                PCRE2_SIZE const *ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(md);
+                if(ovector[0] >= ch.cut){
+                    ch.over = true;
+                    return false;
+                }
+                ch.last_end = ovector[1];
+                return true;
+            };
+            rm.match_hook_data = &c;
+        }
+        c.count = rm.match();
+        c.error = rm.error_number;
+        if(c.over){
+            --c.count;
+            c.soff.pop_back();
+            c.eoff.pop_back();
+            if(vec_num) c.num.pop_back();
+            if(vec_nas) c.nas.pop_back();
+            if(vec_ntn) c.ntn.pop_back();
+            if(match_table) c.table.offsets.resize(c.table.offsets.size() - 2*c.table.stride);
+        }
+    };
+    std::atomic<SIZE_T> next(0);
+    auto work = [&](){
+        for(SIZE_T i; (i = next.fetch_add(1)) < nchunks;) run(i, cuts[i]);
+    };
+    SIZE_T nthreads = std::min(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u), nchunks);
+    std::vector<std::thread> pool;
+    for(SIZE_T i = 1; i < nthreads; ++i) pool.emplace_back(work);
+    work();
+    for(SIZE_T i = 0; i < pool.size(); ++i) pool[i].join();
+
+    //merge in subject order, up to the first chunk that failed
+    error_number = 0;
+    span_more = false;
+    if(vec_num) vec_num->clear();
+    if(vec_nas) vec_nas->clear();
+    if(vec_ntn) vec_ntn->clear();
+    if(vec_soff) vec_soff->clear();
+    if(vec_eoff) vec_eoff->clear();
+    if(match_table) match_table->reset(m_subject.data(), 0, re->code_ref);
+    SIZE_T count = 0;
+    for(SIZE_T i = 0; i < nchunks; ++i){
+        Chunk& c = results[i];
+        //a match of the previous chunk that goes past the cut: this chunk is matched again from its end
+        if(i && results[i - 1].last_end > cuts[i]){
+            run(i, std::min((SIZE_T) results[i - 1].last_end, (SIZE_T) cuts[i + 1]));
+            if(c.count == 0 && c.error == 0) c.last_end = results[i - 1].last_end;
+        }
+        if(span_buf){
+            for(SIZE_T j = 0; j < c.count && !span_more; ++j){
+                if(count == span_cap){
+                    span_more = true;
+                    break;
+                }
+                span_buf[count].start = c.soff[j];
+                span_buf[count].end = c.eoff[j];
+                ++count;
+            }
+        } else {
+            count += c.count;
+        }
+        if(vec_num) vec_num->insert(vec_num->end(), std::make_move_iterator(c.num.begin()), std::make_move_iterator(c.num.end()));
+        if(vec_nas) vec_nas->insert(vec_nas->end(), std::make_move_iterator(c.nas.begin()), std::make_move_iterator(c.nas.end()));
+        if(vec_ntn) vec_ntn->insert(vec_ntn->end(), std::make_move_iterator(c.ntn.begin()), std::make_move_iterator(c.ntn.end()));
+        if(vec_soff) vec_soff->insert(vec_soff->end(), c.soff.begin(), c.soff.end());
+        if(vec_eoff) vec_eoff->insert(vec_eoff->end(), c.eoff.begin(), c.eoff.end());
+        if(match_table && c.table.stride){
+            match_table->stride = c.table.stride;
+            match_table->offsets.insert(match_table->offsets.end(), c.table.offsets.begin(), c.table.offsets.end());
+        }
+        if(c.error){
+            error_number = c.error;
+            break;
+        }
+        if(span_more) break;
+    }
+    return count;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::MatchRange jpcre2::select<Char_T, Map>::RegexMatch::matches() const {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::MatchRange jpcre2::select<Char_T>::RegexMatch::matches() const {
+#endif
+    return MatchRange(*this);
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+void jpcre2::select<Char_T, Map>::MatchRange::next() {
+#else
+template<typename Char_T>
+void jpcre2::select<Char_T>::MatchRange::next() {
+#endif
+    if(done) return;
+    Regex const *re = rm.re;
+    Pcre2Sptr subject = (Pcre2Sptr) rm.m_subject.data();
+    PCRE2_SIZE subject_length = rm.m_subject.size();
+    int rc;
+
+    if(!match_data){
+        //first match, same as in RegexMatch::match()
+        if(!re || re->code == 0){
+            done = true;
+            return;
+        }
+        re->lazyJit();
+        CompiledCode const& cc = *re->code_ref;
+        if(!cc.prefilter(rm.m_subject, rm._start_offset, rm.match_opts)){
+            done = true;
+            return;
+        }
+        match_data = MatchDataPool::getLocal().acquire(cc.capture_count + 1);
+        ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(match_data);
+        ovector_count = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_count(match_data);
+        utf = cc.utf;
+        crlf_is_newline = cc.crlf_is_newline;
+        jit = re->code_ref->jit_compiled;
+        rc = rm.pcre2Match(jit && (!utf || (rm.match_opts & PCRE2_NO_UTF_CHECK) != 0),
+                           subject, subject_length, rm._start_offset, rm.match_opts, match_data);
+    } else {
+        if((rm.jpcre2_match_opts & FIND_ALL) == 0){
+            done = true;
+            return;
+        }
+        //one step of the loop for second and subsequent matches in RegexMatch::match()
+        Uint options = rm.match_opts;
+        PCRE2_SIZE start_offset = ovector[1];
+        bool after_empty = ovector[0] == ovector[1];
+        if(after_empty){
+            if(ovector[0] == subject_length){
+                done = true;
+                return;
+            }
+            options |= PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+        }
+        for(;;){
+            rc = rm.pcre2Match(jit, subject, subject_length, start_offset, options, match_data);
+            if(rc != PCRE2_ERROR_NOMATCH || !after_empty) break;
+            //no non-empty match where the empty match was: advance one character and match from there
+            PCRE2_SIZE pos = start_offset + 1;
+            if(crlf_is_newline && start_offset < subject_length - 1
+                    && subject[start_offset] == '\r' && subject[start_offset + 1] == '\n')
+                pos += 1;
+            else if(utf){
+                while(pos < subject_length){
+                    if(sizeof( Char_T ) * CHAR_BIT == 8 && (subject[pos] & 0xc0) != 0x80) break;
+                    else if(sizeof( Char_T ) * CHAR_BIT == 16 && (subject[pos] & 0xfc00) != 0xdc00) break;
+                    else if(sizeof( Char_T ) * CHAR_BIT == 32) break; //must be else if
+                    pos += 1;
+                }
+            }
+            start_offset = pos;
+            options = rm.match_opts;
+            after_empty = false;
+        }
+    }
+
+    if(rc < 0){
+        if(rc != PCRE2_ERROR_NOMATCH) error_number = rc;
+        done = true;
+        return;
+    }
+    view.subject = rm.m_subject.data();
+    view.ovector = ovector;
+    view.cc = re->code_ref.get();
+    view.count = rc == 0 ? ovector_count : (SIZE_T) rc;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::RegexSet& jpcre2::select<Char_T, Map>::RegexSet::compile(Modifier const& mod) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::RegexSet& jpcre2::select<Char_T>::RegexSet::compile(Modifier const& mod) {
+#endif
+    error_number = 0;
+    error_offset = 0;
+    error_index = 0;
+    combined_count = 0;
+    combined_pattern.clear();
+    combined = Regex();
+    regexes.assign(patterns.size(), Regex());
+    combinable.assign(patterns.size(), false);
+
+    for(SIZE_T i = 0; i < patterns.size(); ++i){
+        regexes[i].setRegexCache(regex_cache).setPattern(patterns[i]).setModifier(mod).compile();
+        if(!regexes[i]){
+            error_number = regexes[i].getErrorNumber();
+            error_offset = regexes[i].getErrorOffset();
+            error_index = i;
+            regexes.clear();
+            combinable.clear();
+            return *this;
+        }
+        if(!isCombinable(patterns[i], regexes[i])) continue;
+        combinable[i] = true;
+        //(?>pattern)(?C{id})
+        if(combined_count++) combined_pattern += (Char_T)'|';
+        combined_pattern += (Char_T)'(';
+        combined_pattern += (Char_T)'?';
+        combined_pattern += (Char_T)'>';
+        combined_pattern += patterns[i];
+        std::string tail = ")(?C{" + std::to_string(i) + "})";
+        combined_pattern.append(tail.begin(), tail.end());
+    }
+
+    if(combined_count){
+        //the same group name may be used in different patterns
+        combined.setRegexCache(regex_cache).setPattern(combined_pattern).setModifier(mod).addPcre2Option(PCRE2_DUPNAMES).compile();
+        if(!combined){
+            //match them one by one
+            combinable.assign(patterns.size(), false);
+            combined_count = 0;
+        }
+    }
+    if(!mcontext){
+        mcontext = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match_context_create(0);
+        Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::set_callout(mcontext, callout, 0);
+    }
+    return *this;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RegexSet::match(StringView subject, std::vector<SIZE_T>* ids,
+                                                            std::vector<MatchSpan>* spans, int* error) const {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::RegexSet::match(StringView subject, std::vector<SIZE_T>* ids,
+                                                       std::vector<MatchSpan>* spans, int* error) const {
+#endif
+    if(ids) ids->clear();
+    if(spans) spans->clear();
+    if(error) *error = 0;
+    if(regexes.empty()) return 0;
+
+    std::vector<MatchSpan>& found = getScratch();
+    MatchSpan unset = {PCRE2_UNSET, PCRE2_UNSET};
+    found.assign(regexes.size(), unset);
+
+    //combinable patterns whose literal isn't in the subject are not looked for
+    SIZE_T remaining = 0;
+    for(SIZE_T i = 0; combined_count && i < regexes.size(); ++i)
+        if(combinable[i] && regexes[i].code_ref->prefilter(subject, 0, 0)) ++remaining;
+
+    if(remaining){
+        //one scan for all the combinable patterns, the callout records them.
+        ScanState st = {&found[0], remaining};
+        ScanState*& current = currentState();
+        ScanState* prev = current;
+        current = &st;
+        RegexMatch rm(&combined);
+        rm.setMatchContext(mcontext).setSubject(subject).match();
+        current = prev;
+        int rc = rm.getErrorNumber();
+        if(error && rc != 0 && rc != PCRE2_ERROR_CALLOUT) *error = rc;
+    }
+    for(SIZE_T i = 0; i < regexes.size(); ++i){
+        if(combinable[i] && combined_count) continue;
+        RegexMatch rm(&regexes[i]);
+        MatchSpan span;
+        if(rm.setSubject(subject).setMatchSpanBuffer(&span, 1).match() == 1) found[i] = span;
+        else if(error && *error == 0) *error = rm.getErrorNumber();
+    }
+
+    SIZE_T count = 0;
+    for(SIZE_T i = 0; i < found.size(); ++i){
+        if(found[i].start == PCRE2_UNSET) continue;
+        ++count;
+        if(ids) ids->push_back(i);
+        if(spans) spans->push_back(found[i]);
+    }
+    return count;
+}
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::StreamMatcher::scan(bool final, std::vector<MatchSpan>* spans) {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::StreamMatcher::scan(bool final, std::vector<MatchSpan>* spans) {
+#endif
+    SIZE_T count = 0;
+    SpanSink sink = {spans, &count};
+    PCRE2_SIZE length = final ? buf.size() : completeLength(re, buf.data(), buf.size());
+    PCRE2_SIZE resume = scanWindow(re, mcontext, match_opts, final, buf.data(), length, buf_base,
+                                   pos, after_empty, error_number, sink);
+    if(!final){
+        //drop what can't be part of a match anymore
+        SIZE_T keep = keepFrom(re, buf.data(), resume);
+        buf.erase(0, keep);
+        buf_base += keep;
+        pos = resume - keep;
+    }
+    return count;
+}
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+typename jpcre2::select<Char_T, Map>::RewriteSet& jpcre2::select<Char_T, Map>::RewriteSet::compile(Modifier const& mod) {
+#else
+template<typename Char_T>
+typename jpcre2::select<Char_T>::RewriteSet& jpcre2::select<Char_T>::RewriteSet::compile(Modifier const& mod) {
+#endif
+    error_number = 0;
+    error_offset = 0;
+    error_index = 0;
+    combined_count = 0;
+    combined_pattern.clear();
+    combined = Regex();
+    regexes.assign(patterns.size(), Regex());
+    templates.assign(patterns.size(), ReplacementTemplate());
+    combinable.assign(patterns.size(), false);
+    group_base.assign(patterns.size(), 0);
+    uint32_t groups = 0;
+
+    for(SIZE_T i = 0; i < patterns.size(); ++i){
+        regexes[i].setRegexCache(regex_cache).setPattern(patterns[i]).setModifier(mod).compile();
+        if(regexes[i]) templates[i].compile(regexes[i], replacements[i]);
+        if(!regexes[i] || templates[i].getErrorNumber()){
+            error_number = regexes[i] ? templates[i].getErrorNumber() : regexes[i].getErrorNumber();
+            error_offset = regexes[i] ? (int) templates[i].getErrorOffset() : regexes[i].getErrorOffset();
+            error_index = i;
+            regexes.clear();
+            templates.clear();
+            combinable.clear();
+            return *this;
+        }
+        if(!RegexSet::isCombinable(patterns[i], regexes[i])) continue;
+        combinable[i] = true;
+        group_base[i] = groups;
+        groups += regexes[i].code_ref->capture_count;
+        //(*MARK:{id})(?:pattern)
+        if(combined_count++) combined_pattern += (Char_T)'|';
+        std::string head = "(*MARK:" + std::to_string(i) + ")(?:";
+        combined_pattern.append(head.begin(), head.end());
+        combined_pattern += patterns[i];
+        combined_pattern += (Char_T)')';
+    }
+
+    if(combined_count){
+        //the same group name may be used in different rules
+        combined.setRegexCache(regex_cache).setPattern(combined_pattern).setModifier(mod).addPcre2Option(PCRE2_DUPNAMES).compile();
+        //match them one by one
+        if(!combined) combined_count = 0;
+    }
+    return *this;
+}
+
+
+#ifdef JPCRE2_USE_MINIMUM_CXX_11
+template<typename Char_T, template<typename...> class Map>
+jpcre2::SIZE_T jpcre2::select<Char_T, Map>::RewriteSet::rewrite(StringView subject, String& out,
+                                                                std::vector<SIZE_T>* hits, int* error) const {
+#else
+template<typename Char_T>
+jpcre2::SIZE_T jpcre2::select<Char_T>::RewriteSet::rewrite(StringView subject, String& out,
+                                                           std::vector<SIZE_T>* hits, int* error) const {
+#endif
+    if(error) *error = 0;
+    if(regexes.empty()){
+        out.append(subject.data(), subject.size());
+        return 0;
+    }
+    SIZE_T base = out.size(); //everything before it belongs to the caller.
+    MatchDataPool& pool = MatchDataPool::getLocal();
+
+    std::vector<Cursor> cursors;
+    for(SIZE_T i = 0; i <= regexes.size(); ++i){
+        Regex const *re;
+        if(i == regexes.size()) re = combined_count ? &combined : 0;
+        else re = isCombined(i) ? 0 : &regexes[i];
+        if(!re) continue;
+        re->lazyJit();
+        Cursor c = {re, pool.acquire(re->code), 0, PCRE2_UNSET, i, false};
+        c.ovector = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_pointer(c.md);
+        cursors.push_back(c);
+    }
+
+    Pcre2Sptr s = (Pcre2Sptr) subject.data();
+    PCRE2_SIZE length = subject.size();
+    PCRE2_SIZE pos = 0; //end of the last match
+    bool after_empty = false; //the last match was empty
+    Uint options = 0;
+    std::vector<PCRE2_SIZE> local; //ovector of a rule matched in the combined pattern, with its own group numbers
+    std::vector<SIZE_T> found(hits ? regexes.size() : 0); //replacements of each rule
+    SIZE_T count = 0;
+    int rc = 0;
+
+    while(rc == 0){
+        Cursor *next = 0;
+        for(SIZE_T i = 0; i < cursors.size() && rc == 0; ++i){
+            Cursor& c = cursors[i];
+            if(c.done) continue;
+            //a match that overlaps the last one, or an empty match where the last (empty) one was, is looked for again
+            if(c.start == PCRE2_UNSET || c.start < pos || (after_empty && c.start == pos && c.ovector[1] == pos)){
+                rc = Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::match(c.re->code, s, length, pos,
+                                                                  options | (after_empty ? PCRE2_NOTEMPTY_ATSTART : 0), c.md, 0);
+                if(rc == PCRE2_ERROR_NOMATCH){
+                    rc = 0;
+                    c.done = true;
+                    continue;
+                }
+                if(rc < 0) break;
+                rc = 0;
+                options |= PCRE2_NO_UTF_CHECK; //checked by the first call
+                //Matches that use \K to end before they start are not supported, as with pcre2_substitute.
+                if(c.ovector[1] < c.ovector[0] || c.ovector[0] < pos){
+                    rc = PCRE2_ERROR_BADSUBSPATTERN;
+                    break;
+                }
+                c.start = c.ovector[0];
+                if(c.re == &combined) c.rule = markedRule(c.md);
+            }
+            if(!next || c.start < next->start || (c.start == next->start && c.rule < next->rule)) next = &c;
+        }
+        if(rc || !next) break;
+
+        PCRE2_SIZE const *ovector = next->ovector;
+        out.append(subject.data() + pos, ovector[0] - pos);
+        if(next->re == &combined){
+            uint32_t groups = regexes[next->rule].code_ref->capture_count;
+            uint32_t first = group_base[next->rule];
+            local.resize(2 * (groups + 1));
+            local[0] = ovector[0];
+            local[1] = ovector[1];
+            for(uint32_t g = 1; g <= groups; ++g){
+                local[2*g] = ovector[2*(first + g)];
+                local[2*g+1] = ovector[2*(first + g)+1];
+            }
+            rc = templates[next->rule].expand(out, subject, &local[0], groups + 1, 0, replace_opts);
+        } else {
+            rc = templates[next->rule].expand(out, subject, ovector,
+                                              Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_ovector_count(next->md),
+                                              (Char_T const*) Pcre2Func<sizeof( Char_T ) * CHAR_BIT>::get_mark(next->md),
+                                              replace_opts);
+        }
+        if(rc) break;
+        ++count;
+        if(hits) ++found[next->rule];
+        after_empty = ovector[0] == ovector[1];
+        pos = ovector[1];
+        next->start = PCRE2_UNSET;
+    }
+
+    for(SIZE_T i = 0; i < cursors.size(); ++i) pool.release(cursors[i].md);
+    if(rc){
+        if(error) *error = rc;
+        out.resize(base);
+        out.append(subject.data(), subject.size());
+        return 0;
+    }
+    //now copy rest of the string from the end of the last match
+    out.append(subject.data() + pos, length - pos);
+    if(hits){
+        if(hits->size() < regexes.size()) hits->resize(regexes.size(), 0);
+        for(SIZE_T i = 0; i < found.size(); ++i) (*hits)[i] += found[i];
+    }
+    return count;
+}
+
 #undef JPCRE2_VECTOR_DATA_ASSERT
 #undef JPCRE2_UNUSED
 #undef JPCRE2_USE_MINIMUM_CXX_11
+#undef JPCRE2_USE_MMAP
 
 //some macro documentation for doxygen
 
@@ -0,0 +1,78 @@
+/**@file test_dfa_match.cpp
+ *  Test cases for DFA matching (pcre2_dfa_match).
+ * @include test_dfa_match.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(\\w+)|(\\d+)");
+    jp::VecNum vec_num;
+    jpcre2::VecOff vec_soff, vec_eoff;
+
+    // same vectors as the standard matcher, captures are not set
+    assert(re.initMatch().setSubject("ab 12 cd").setNumberedSubstringVector(&vec_num)
+             .setMatchStartOffsetVector(&vec_soff).setMatchEndOffsetVector(&vec_eoff).addModifier("dg").match() == 3);
+    assert(vec_num.size() == 3);
+    assert(vec_num[1].size() == 3);
+    assert(vec_num[1][0] == "12" && vec_num[1][1].empty() && vec_num[1][2].empty());
+    assert(vec_soff[2] == 6 && vec_eoff[2] == 8);
+
+    // the longest match is found, the backtracking matcher takes the first alternative
+    jp::Regex alt("a|ab|abc");
+    assert(alt.initMatch().setSubject("abcd").setNumberedSubstringVector(&vec_num).match() == 1);
+    assert(vec_num[0][0] == "a");
+    assert(alt.initMatch().setSubject("abcd").setNumberedSubstringVector(&vec_num).setDfaMatch().match() == 1);
+    assert(vec_num[0][0] == "abc");
+
+    // offsets only, the ovector can't hold all the alternatives
+    jpcre2::MatchSpan spans[4];
+    assert(alt.initMatch().setSubject("ab abc").setMatchSpanBuffer(spans, 4).setDfaMatch().setFindAll().match() == 2);
+    assert(spans[0].start == 0 && spans[0].end == 2);
+    assert(spans[1].start == 3 && spans[1].end == 6);
+
+    // named groups are unset
+    jp::Regex named("(?<word>[a-z]+)");
+    jp::VecNas vec_nas;
+    assert(named.initMatch().setSubject("xyz").setNamedSubstringVector(&vec_nas).addModifier("d").match() == 1);
+    assert(vec_nas[0].count("word") == 1);
+    assert(vec_nas[0]["word"].empty());
+
+    // empty matches in a global match advance like the standard matcher
+    jp::Regex opt("x*");
+    assert(opt.initMatch().setSubject("axxb").setFindAll().match() == 4);
+    assert(opt.initMatch().setSubject("axxb").setFindAll().setDfaMatch().match() == 4);
+
+    // unsupported items report the PCRE2 error
+    jp::Regex backref("(a)\\1");
+    jp::RegexMatch rm(&backref);
+    assert(rm.setSubject("aa").setDfaMatch().match() == 0);
+    assert(rm.getErrorNumber() == PCRE2_ERROR_DFA_UITEM);
+    assert(rm.setDfaMatch(false).match() == 1);
+
+    // JIT compiled code is matched by the DFA matcher as well
+    jp::Regex jit("a|ab|abc", "S");
+    assert(jit.initMatch().setSubject("abc").setNumberedSubstringVector(&vec_num).setDfaMatch().match() == 1);
+    assert(vec_num[0][0] == "abc");
+
+    // the workspace grows when needed and is reused
+    jpcre2::SIZE_T ws = jp::RegexMatch::getDfaWorkspaceSize();
+    jp::Regex many("(?:a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p){1,300}q");
+    jp::String subject(300, 'a');
+    subject += "q";
+    assert(many.initMatch().setSubject(subject).setDfaMatch().match() == 1);
+    assert(jp::RegexMatch::getDfaWorkspaceSize() > ws);
+
+    // MatchEvaluator gets the whole match
+    jp::MatchEvaluator me([](jp::NumSub const& m, void*, void*){ return "<" + jp::String(m[0]) + ">"; });
+    assert(me.setRegexObject(&alt).setSubject("ab abc").setFindAll().setDfaMatch().nreplace() == "<ab> <abc>");
+
+    // UTF
+    jp::Regex utf("\\x{e9}+|\\w", "u");
+    assert(utf.initMatch().setSubject("\xc3\xa9\xc3\xa9x").setNumberedSubstringVector(&vec_num).setDfaMatch().setFindAll().match() == 2);
+    assert(vec_num[0][0] == "\xc3\xa9\xc3\xa9");
+    return 0;
+}
@@ -0,0 +1,69 @@
+/**@file test_evaluator_substitute.cpp
+ *  Test cases for MatchEvaluator::replace() using the match data of each match for pcre2_substitute.
+ * @include test_evaluator_substitute.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+static int callouts;
+
+static int countCallout(pcre2_callout_block_8*, void*){
+    ++callouts;
+    return 0;
+}
+
+int main(){
+    // the match is not done again on the matched part alone, so lookarounds keep their context
+    jp::Regex lb("(?<=a)(b)");
+    jp::MatchEvaluator me([](void*, void*, void*){ return jp::String("[$1]"); });
+    me.setRegexObject(&lb).setSubject("ab cb ab").setFindAll();
+    jpcre2::SIZE_T n = 0;
+    assert(me.replace(true, 0, &n) == "a[b] cb a[b]" && n == 2);
+    assert(me.setStreaming().replace() == "a[b] cb a[b]");
+    me.setStreaming(false);
+
+    // pcre2_substitute doesn't run the pattern again: as many callouts as a plain match
+    jp::Regex re("(\\w)(?C1)(\\w)");
+    pcre2_match_context_8* mc = pcre2_match_context_create_8(0);
+    pcre2_set_callout_8(mc, countCallout, 0);
+    jp::MatchEvaluator swap([](jp::NumSub const&, void*, void*){ return jp::String("$2$1"); });
+    swap.setRegexObject(&re).setSubject("ab cd ef").setFindAll().setMatchContext(mc);
+    callouts = 0;
+    assert(swap.nreplace() == "$2$1 $2$1 $2$1");
+    int match_callouts = callouts;
+    callouts = 0;
+    assert(swap.replace() == "ba dc fe");
+    assert(callouts == match_callouts);
+    // with existing match data, the matched parts are matched again
+    callouts = 0;
+    assert(swap.replace(false) == "ba dc fe");
+    assert(callouts == 3);
+    pcre2_match_context_free_8(mc);
+
+    // literal replacements, with or without the extended syntax
+    jp::MatchEvaluator lit([](void*, void*, void*){ return jp::String("x\\ty"); });
+    lit.setRegexObject(&re).setSubject("ab cd").setFindAll();
+    assert(lit.replace() == "x\\ty x\\ty");
+    assert(lit.replace(true, PCRE2_SUBSTITUTE_EXTENDED) == "x\ty x\ty");
+
+    // marks and named groups of the match
+    jp::Regex mk("(?<w>\\w+)(*MARK:M)");
+    jp::MatchEvaluator mme([](void*, void*, void*){ return jp::String("${w}${*MARK}"); });
+    assert(mme.setRegexObject(&mk).setSubject("hi there").setFindAll().replace() == "hiM thereM");
+
+    // DFA matching has no captures, the matched part is matched again for them
+    jp::MatchEvaluator dfa([](void*, void*, void*){ return jp::String("<$2>"); });
+    assert(dfa.setRegexObject(&re).setSubject("ab cd").setFindAll().setDfaMatch().replace() == "<b> <d>");
+
+    // a match data block set by the user is left as it was
+    jp::MatchData* md = pcre2_match_data_create_8(3, 0);
+    assert(swap.setMatchDataBlock(md).setMatchContext(0).replace() == "ba dc fe");
+    PCRE2_SIZE* ov = pcre2_get_ovector_pointer_8(md);
+    assert(ov[0] == 6 && ov[1] == 8);
+    pcre2_match_data_free_8(md);
+
+    return 0;
+}
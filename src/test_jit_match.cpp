@@ -0,0 +1,41 @@
+/**@file test_jit_match.cpp
+ *  Test cases for matching with JIT compiled patterns (pcre2_jit_match() fast path).
+ * @include test_jit_match.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("\\d*", "S");
+    if(!re.isJitCompiled()) return 0; //JIT not available on this platform
+    jp::Regex nojit("\\d*");
+    assert(!nojit.isJitCompiled());
+
+    // empty matches in the global loop need anchored matches, which go through pcre2_match()
+    jpcre2::VecOff soff, eoff, soff2, eoff2;
+    const char* subject = "12a\r\n345b";
+    assert(re.initMatch().setSubject(subject).setMatchStartOffsetVector(&soff)
+             .setMatchEndOffsetVector(&eoff).setFindAll().match()
+        == nojit.initMatch().setSubject(subject).setMatchStartOffsetVector(&soff2)
+             .setMatchEndOffsetVector(&eoff2).setFindAll().match());
+    assert(soff == soff2 && eoff == eoff2);
+
+    // the UTF check is kept for the first match
+    jp::Regex utf("\\w+", "uS");
+    jp::RegexMatch rm(&utf);
+    assert(rm.setSubject("ab\xff").match() == 0);
+    assert(rm.getErrorNumber() == PCRE2_ERROR_UTF8_ERR21);
+    assert(rm.resetErrors().setSubject("\xc3\xa9t\xc3\xa9 ok").setFindAll().match() == 2);
+
+    // options pcre2_jit_match() doesn't handle are left to pcre2_match()
+    jp::Regex word("abc", "S");
+    assert(word.initMatch().setSubject("xabc").addPcre2Option(PCRE2_ANCHORED).match() == 0);
+    jp::RegexMatch partial(&word);
+    assert(partial.setSubject("xab").addPcre2Option(PCRE2_PARTIAL_HARD).match() == 0);
+    assert(partial.getErrorNumber() == PCRE2_ERROR_PARTIAL);
+
+    return 0;
+}
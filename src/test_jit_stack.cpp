@@ -0,0 +1,78 @@
+/**@file test_jit_stack.cpp
+ *  Test cases for JIT stacks provided by JitStackManager.
+ * @include test_jit_stack.cpp
+ * */
+
+#include <cassert>
+#include <thread>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+std::string callback(void*, void*, void*){
+    return "y";
+}
+
+int main(){
+    jp::Regex re("(a|b)*c", "S");
+    if(!re.isJitCompiled()) return 0; //JIT not available on this platform
+    std::string subject(200000, 'a');
+    subject += 'c';
+
+    // the default 32K machine stack is not enough
+    jp::RegexMatch rm(&re);
+    assert(rm.setSubject(subject).match() == 0);
+    assert(rm.getErrorNumber() == PCRE2_ERROR_JIT_STACKLIMIT);
+
+    jp::JitStackManager jsm(32 * 1024, 64 * 1024 * 1024);
+    assert(jsm.getStackSize() == 0);
+    assert(rm.resetErrors().setJitStackManager(&jsm).match() == 1);
+    assert(rm.getErrorNumber() == 0);
+    // one stack per thread, it grows up to the maximum size
+    assert(jsm.getStackSize() == 64 * 1024 * 1024);
+    jp::MatchContext* jmc = jsm.getMatchContext();
+    assert(rm.match() == 1 && jsm.getMatchContext() == jmc);
+    assert(jsm.getHighWaterMark() == 64 * 1024 * 1024 && jsm.getStackLimitCount() == 0);
+
+    // a match context set by the user takes precedence
+    jp::MatchContext* mc = pcre2_match_context_create_8(0);
+    assert(rm.setMatchContext(mc).match() == 0);
+    assert(rm.getErrorNumber() == PCRE2_ERROR_JIT_STACKLIMIT);
+    pcre2_match_context_free_8(mc);
+    assert(jsm.getStackLimitCount() == 0);
+
+    // maximum size is respected
+    jp::JitStackManager small(32 * 1024, 64 * 1024);
+    jp::RegexMatch rm2(&re);
+    assert(rm2.setJitStackManager(&small).setSubject(subject).match() == 0);
+    assert(rm2.getErrorNumber() == PCRE2_ERROR_JIT_STACKLIMIT);
+    assert(small.getStackSize() == 64 * 1024);
+    // matches that need more than the maximum size are counted
+    assert(small.getHighWaterMark() == 64 * 1024 && small.getStackLimitCount() == 1);
+    jp::RegexReplace rr2(&re);
+    assert(rr2.setSubject(subject).setReplaceWith("x").setJitStackManager(&small).replace() == subject);
+    assert(rr2.getErrorNumber() == PCRE2_ERROR_JIT_STACKLIMIT);
+    assert(small.getStackLimitCount() == 2);
+    assert(rr2.nreplace(jp::MatchEvaluator(callback)) == subject);
+    assert(small.getStackLimitCount() == 3);
+    small.resetCounters();
+    assert(small.getHighWaterMark() == 0 && small.getStackLimitCount() == 0);
+
+    // replace
+    jp::RegexReplace rr(&re);
+    assert(rr.setSubject(subject).setReplaceWith("x").setJitStackManager(&jsm).replace() == "x");
+    assert(rr.getErrorNumber() == 0);
+    assert(rr.nreplace(jp::MatchEvaluator(callback)) == "y");
+    assert(rr.getErrorNumber() == 0);
+
+    // every thread gets its own stack
+    std::thread t([&](){
+        assert(jsm.getStackSize() == 0);
+        jp::RegexMatch rm3(&re);
+        assert(rm3.setJitStackManager(&jsm).setSubject(subject).match() == 1);
+        assert(jsm.getStackSize() > 32 * 1024);
+    });
+    t.join();
+
+    return 0;
+}
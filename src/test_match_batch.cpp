@@ -0,0 +1,62 @@
+/**@file test_match_batch.cpp
+ *  Test cases for matching many subjects at once (Regex::matchBatch()).
+ * @include test_match_batch.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    std::vector<jp::String> rows;
+    for(int i = 0; i < 5000; ++i)
+        rows.push_back(i % 3 ? "id-" + std::to_string(i) + " id-" + std::to_string(i + 1) : "none");
+    std::vector<jp::StringView> views(rows.begin(), rows.end());
+
+    jp::Regex re("id-(\\d+)");
+    std::vector<jpcre2::Ush> hit;
+    jpcre2::VecOff counts;
+    std::vector<jpcre2::MatchSpan> first;
+
+    // booleans only
+    assert(re.matchBatch(views, &hit) == 3333);
+    assert(hit.size() == 5000 && hit[0] == 0 && hit[1] == 1);
+
+    // counts and first offsets
+    int error = -1;
+    assert(re.matchBatch(views, &hit, &counts, &first, "", 1, &error) == 3333);
+    assert(error == 0);
+    assert(counts[0] == 0 && counts[1] == 2);
+    assert(first[0].start == PCRE2_UNSET);
+    assert(first[2].start == 0 && first[2].end == 4);
+
+    // first offsets without counts
+    assert(re.matchBatch(views.data(), views.size(), 0, 0, &first) == 3333);
+    assert(first[4].start == 0 && first[4].end == 4);
+
+    // threads give the same columns
+    std::vector<jpcre2::Ush> hit4;
+    jpcre2::VecOff counts4;
+    std::vector<jpcre2::MatchSpan> first4;
+    assert(re.matchBatch(views, &hit4, &counts4, &first4, "", 4) == 3333);
+    assert(hit4 == hit && counts4 == counts);
+    for(jpcre2::SIZE_T i = 0; i < first.size(); ++i)
+        assert(first4[i].start == first[i].start && first4[i].end == first[i].end);
+
+    // modifier
+    jp::Regex anchored("\\d");
+    assert(anchored.matchBatch(views, &hit, 0, 0, "A") == 0);
+    assert(anchored.matchBatch(views, &hit) == 3333);
+
+    // errors
+    std::vector<jp::StringView> one(1, "x");
+    assert(re.matchBatch(one, &hit, 0, 0, "z", 1, &error) == 0);
+    assert(error == jpcre2::ERROR::INVALID_MODIFIER);
+
+    // empty batch, uncompiled regex
+    assert(re.matchBatch(std::vector<jp::StringView>(), &hit) == 0 && hit.empty());
+    jp::Regex none;
+    assert(none.matchBatch(views, &hit) == 0 && hit.size() == 5000);
+    return 0;
+}
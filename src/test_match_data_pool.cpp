@@ -0,0 +1,62 @@
+/**@file test_match_data_pool.cpp
+ *  Test cases for the thread local match data pool.
+ * @include test_match_data_pool.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::MatchDataPool& pool = jp::MatchDataPool::getLocal();
+    pool.resetCounters();
+
+    jp::Regex re("(\\d)(\\d)");
+    assert(re.match("12 34", "g") == 2);
+    assert(pool.getMissCount() == 1);
+    assert(pool.getHitCount() == 0);
+
+    // same ovector size, served from the pool
+    assert(re.match("56") == 1);
+    assert(pool.getMissCount() == 1);
+    assert(pool.getHitCount() == 1);
+
+    // different ovector size gets its own bucket,
+    // captures are needed for the substrings only
+    jp::VecNum vec_num;
+    assert(re.initMatch().setSubject("12").setNumberedSubstringVector(&vec_num).match() == 1);
+    assert(pool.getMissCount() == 2);
+    jp::Regex re2("\\d");
+    assert(re2.match("7") == 1);
+    assert(pool.getMissCount() == 2);
+
+    // replace and MatchEvaluator use the pool too
+    assert(re.replace("12", "$2$1") == "21");
+    jp::MatchEvaluator me([](jp::NumSub const& m, void*, void*){ return jp::String(m[2]) + jp::String(m[1]); });
+    assert(me.setRegexObject(&re).setSubject("12 34").setFindAll().replace() == "21 43");
+    assert(pool.getMissCount() == 2);
+
+    // a block set by the user is not taken from the pool
+    jp::MatchData* md = pcre2_match_data_create_8(3, 0);
+    jp::RegexMatch rm(&re);
+    jpcre2::SIZE_T hits = pool.getHitCount();
+    assert(rm.setMatchDataBlock(md).setSubject("12").match() == 1);
+    assert(pool.getHitCount() == hits);
+    pcre2_match_data_free_8(md);
+
+    // bucket size limit
+    pool.clear();
+    pool.setMaxBlocksPerSize(1);
+    jp::MatchData* a = pool.acquire(4);
+    jp::MatchData* b = pool.acquire(4);
+    pool.release(a);
+    pool.release(b); // freed, the bucket is full
+    pool.resetCounters();
+    pool.release(pool.acquire(4));
+    pool.release(pool.acquire(4));
+    assert(pool.getHitCount() == 2 && pool.getMissCount() == 0);
+    pool.setMaxBlocksPerSize(8);
+
+    return 0;
+}
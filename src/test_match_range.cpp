@@ -0,0 +1,74 @@
+/**@file test_match_range.cpp
+ *  Test cases for lazy iteration over matches (MatchRange).
+ * @include test_match_range.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+// compares the range with the offsets found by RegexMatch::match()
+static void check(jp::Regex& re, std::string const& subject){
+    jpcre2::VecOff soff, eoff;
+    jpcre2::SIZE_T count = re.initMatch().setSubject(subject).setMatchStartOffsetVector(&soff)
+                             .setMatchEndOffsetVector(&eoff).setFindAll().match();
+    jpcre2::SIZE_T i = 0;
+    for(jp::MatchView const& m : re.matches(subject)){
+        assert(i < count && m.start() == soff[i] && m.end() == eoff[i]);
+        ++i;
+    }
+    assert(i == count);
+}
+
+int main(){
+    jp::Regex re("(\\w+)@(\\w+)?", "S");
+    std::string subject = "a@b c@ e@f";
+    jp::MatchRange range = re.matches(subject);
+    jp::MatchRange::iterator it = range.begin();
+    assert(it != range.end());
+    assert(it->size() == 3 && (*it)[0] == "a@b" && (*it)[2] == "b");
+    ++it;
+    assert((*it)[1] == "c" && !it->isSet(2) && (*it)[2].empty() && it->start(2) == PCRE2_UNSET);
+    it++;
+    assert(it->start() == 7 && it->end() == 10);
+    assert(++it == range.end() && range.getErrorNumber() == 0);
+
+    // stops early without matching the rest
+    jpcre2::SIZE_T n = 0;
+    for(jp::MatchView const& m : re.matches(subject)){
+        ++n;
+        if(m[1] == "c") break;
+    }
+    assert(n == 2);
+
+    // same positions as match() with empty matches, CRLF and UTF
+    jp::Regex empty("x*");
+    check(empty, "axxb\r\nx");
+    jp::Regex crlf("(*CRLF)x*");
+    check(crlf, "a\r\n\r\nxx");
+    jp::Regex utf("x*", "u");
+    check(utf, "\xc3\xa9x\xe2\x82\xac");
+    jp::Regex none("z");
+    check(none, "abc");
+
+    // without FIND_ALL, at most one match
+    jp::RegexMatch rm(&re);
+    rm.setSubject(subject).setStartOffset(1);
+    n = 0;
+    for(jp::MatchView const& m : rm.matches()){
+        assert(m[0] == "c@");
+        ++n;
+    }
+    assert(n == 1);
+
+    // errors end the iteration
+    jp::Regex bad_utf("\\w", "u");
+    jp::MatchRange r = bad_utf.matches("\xff");
+    assert(r.begin() == r.end() && r.getErrorNumber() == PCRE2_ERROR_UTF8_ERR21);
+    jp::Regex uncompiled;
+    jp::MatchRange r2 = uncompiled.matches("abc");
+    assert(r2.begin() == r2.end());
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**@file test_match_span.cpp
+ *  Test cases for the offsets only match mode (match span buffer).
+ * @include test_match_span.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(\\d)(\\d)*", "S");
+    jpcre2::MatchSpan spans[3];
+    jp::RegexMatch rm(&re);
+    rm.setSubject("1 22 333 4444").setFindAll();
+
+    // the buffer is filled and the remaining matches are reported
+    assert(rm.setMatchSpanBuffer(spans, 3).match() == 3);
+    assert(rm.hasMoreMatches() && rm.getErrorNumber() == 0);
+    assert(spans[0].start == 0 && spans[0].end == 1);
+    assert(spans[2].start == 5 && spans[2].end == 8);
+
+    // big enough buffer
+    jpcre2::MatchSpan all[8];
+    assert(rm.setMatchSpanBuffer(all, 8).match() == 4 && !rm.hasMoreMatches());
+    assert(all[3].start == 9 && all[3].end == 13);
+
+    // same offsets as the offset vectors, also with empty matches
+    jp::Regex empty("x*");
+    jpcre2::VecOff soff, eoff;
+    jp::RegexMatch rm2(&empty);
+    jpcre2::SIZE_T n = rm2.setSubject("axxb\r\nx").setMatchSpanBuffer(all, 8).setMatchStartOffsetVector(&soff)
+                          .setMatchEndOffsetVector(&eoff).setFindAll().match();
+    assert(n == soff.size() && n > 4 && !rm2.hasMoreMatches());
+    for(jpcre2::SIZE_T i = 0; i < n; ++i) assert(all[i].start == soff[i] && all[i].end == eoff[i]);
+
+    // zero capacity only tells whether there is a match
+    assert(rm.setMatchSpanBuffer(spans, 0).match() == 0 && rm.hasMoreMatches());
+    assert(rm.setSubject("none").match() == 0 && !rm.hasMoreMatches());
+
+    // substrings are still available along with the spans
+    jp::VecNum vec_num;
+    assert(rm.setSubject("12 345").setMatchSpanBuffer(spans, 3).setNumberedSubstringVector(&vec_num).match() == 2);
+    assert(vec_num[1][2] == "5" && spans[1].start == 3 && spans[1].end == 6);
+
+    // repeated global matches don't create match data
+    rm.setNumberedSubstringVector(0).setSubject("1 22 333 4444").setMatchSpanBuffer(all, 8);
+    rm.match();
+    jp::MatchDataPool& pool = jp::MatchDataPool::getLocal();
+    jpcre2::SIZE_T misses = pool.getMissCount();
+    for(int i = 0; i < 100; ++i) assert(rm.match() == 4);
+    assert(pool.getMissCount() == misses);
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+/**@file test_match_table.cpp
+ *  Test cases for the flat capture storage (MatchTable).
+ * @include test_match_table.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(\\w+)@([a-w]+)?(x)?", "S");
+    std::string subject = "a@b c@ e@fx";
+    jp::MatchTable table;
+    jp::VecNum vec_num;
+    jp::RegexMatch rm(&re);
+    assert(rm.setSubject(subject).setMatchTable(&table).setNumberedSubstringVector(&vec_num).setFindAll().match() == 3);
+    assert(table.size() == 3 && table.getGroupCount() == 4);
+
+    // same content as the numbered substring vector
+    for(jpcre2::SIZE_T i = 0; i < table.size(); ++i)
+        for(jpcre2::SIZE_T j = 0; j < table.getGroupCount(); ++j)
+            assert(table.get(i, j) == vec_num[i][j]);
+    assert(table.get(2, 0) == "e@fx" && table.start(2) == 7 && table.end(2) == 11);
+    assert(!table.isSet(1, 2) && table.start(1, 2) == PCRE2_UNSET && table.get(1, 2).empty());
+    assert(!table.isSet(0, 3) && table.isSet(2, 3));
+
+    // the table is cleared and its memory reused by the next match
+    rm.setNumberedSubstringVector(0);
+    assert(rm.setSubject("q@r").match() == 1);
+    assert(table.size() == 1 && table.get(0, 1) == "q");
+    assert(rm.setSubject("none").match() == 0 && table.empty() && table.size() == 0);
+
+    // single match
+    assert(re.initMatch().setSubject(subject).setMatchTable(&table).match() == 1);
+    assert(table.size() == 1 && table.get(0, 2) == "b");
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**@file test_modifier_lookup.cpp
+ *  Test cases for modifier parsing with the default and custom modifier tables.
+ * @include test_modifier_lookup.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jpcre2::Uint po = 0, jo = 0;
+    int en = 0;
+    jpcre2::SIZE_T eo = 0;
+
+    // default tables
+    jpcre2::MOD::toCompileOption("imnS", true, &po, &jo, &en, &eo);
+    assert(po == (PCRE2_CASELESS | PCRE2_MULTILINE | PCRE2_UTF | PCRE2_UCP));
+    assert(jo == jpcre2::JIT_COMPILE && en == 0);
+    jpcre2::MOD::toCompileOption("uS", false, &po, &jo, &en, &eo);
+    assert(po == (PCRE2_CASELESS | PCRE2_MULTILINE | PCRE2_UCP) && jo == 0);
+    po = jo = 0;
+    jpcre2::MOD::toReplaceOption("gE", true, &po, &jo, &en, &eo);
+    assert(po == (PCRE2_SUBSTITUTE_GLOBAL | PCRE2_SUBSTITUTE_UNKNOWN_UNSET | PCRE2_SUBSTITUTE_UNSET_EMPTY) && jo == 0);
+    po = jo = 0;
+    jpcre2::MOD::toMatchOption("Ag", true, &po, &jo, &en, &eo);
+    assert(po == PCRE2_ANCHORED && jo == jpcre2::FIND_ALL && en == 0);
+
+    // invalid modifiers, including characters outside ASCII
+    jpcre2::MOD::toMatchOption("g\xe9", true, &po, &jo, &en, &eo);
+    assert(en == (int)jpcre2::ERROR::INVALID_MODIFIER && eo == (jpcre2::SIZE_T)(int)'\xe9');
+    en = 0;
+    jpcre2::MOD::toCompileOption("g", true, &po, &jo, &en, &eo);
+    assert(en == (int)jpcre2::ERROR::INVALID_MODIFIER && eo == 'g');
+
+    // custom table: the first occurrence of a character wins, JPCRE2 options before PCRE2 options
+    jpcre2::ModifierTable mdt;
+    jpcre2::Uint cv[] = {PCRE2_MULTILINE, PCRE2_DOTALL, jpcre2::JIT_COMPILE, PCRE2_UNGREEDY};
+    mdt.setCompileModifierTable("IIMM", cv);
+    po = jo = 0; en = 0;
+    mdt.toCompileOption("IM", true, &po, &jo, &en, &eo);
+    assert(po == PCRE2_MULTILINE && jo == jpcre2::JIT_COMPILE && en == 0);
+    mdt.toCompileOption("i", true, &po, &jo, &en, &eo);
+    assert(en == (int)jpcre2::ERROR::INVALID_MODIFIER && eo == 'i');
+
+    // tables are independent, and follow clear() and reset to default
+    en = 0;
+    mdt.toMatchOption("g", true, &po, &jo, &en, &eo);
+    assert(en == (int)jpcre2::ERROR::INVALID_MODIFIER);
+    mdt.setMatchModifierTableToDefault();
+    en = 0; po = jo = 0;
+    mdt.toMatchOption("g", true, &po, &jo, &en, &eo);
+    assert(en == 0 && jo == jpcre2::FIND_ALL);
+    mdt.clearCompileModifierTable();
+    mdt.toCompileOption("I", true, &po, &jo, &en, &eo);
+    assert(en == (int)jpcre2::ERROR::INVALID_MODIFIER);
+
+    // used by the classes
+    jp::Regex re;
+    re.setModifierTable(&mdt);
+    mdt.setCompileModifierTable("IIMM", cv);
+    re.compile("^b", "I");
+    assert(re && re.getPcre2Option() == PCRE2_MULTILINE);
+    assert(re.match("a\nb") == 1);
+    // a copy keeps its own lookup tables
+    jpcre2::ModifierTable copy = mdt;
+    mdt.resetCompileModifierTable();
+    po = jo = 0; en = 0;
+    copy.toCompileOption("M", true, &po, &jo, &en, &eo);
+    assert(en == 0 && jo == jpcre2::JIT_COMPILE);
+
+    // PCRE2 options are never taken for JPCRE2 ones: the value of JIT_COMPILE is PCRE2_NOTEMPTY for
+    // match, and DFA_MATCH used to be PCRE2_CASELESS and PCRE2_NOTEMPTY_ATSTART
+    jpcre2::Uint ccv[] = {PCRE2_CASELESS};
+    mdt.setCompileModifierTable("I", ccv);
+    po = jo = 0; en = 0;
+    mdt.toCompileOption("I", true, &po, &jo, &en, &eo);
+    assert(en == 0 && po == PCRE2_CASELESS && jo == 0);
+    re.compile("JPCRE2", "I");
+    assert(re && re.match("jpcre2") == 1);
+    jpcre2::Uint mcv[] = {PCRE2_NOTEMPTY_ATSTART, PCRE2_NOTEMPTY};
+    mdt.setMatchModifierTable("NE", mcv);
+    po = jo = 0; en = 0;
+    mdt.toMatchOption("NE", true, &po, &jo, &en, &eo);
+    assert(en == 0 && po == (PCRE2_NOTEMPTY_ATSTART | PCRE2_NOTEMPTY) && jo == 0);
+    re.compile("^a*");
+    assert(re.match("b", "N") == 0 && re.match("b", "E") == 0 && re.match("b") == 1);
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/**@file test_named_groups.cpp
+ *  Test cases for name lookups in the name table of the compiled code.
+ * @include test_named_groups.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(?<year>\\d{4})-(?<month>\\d\\d)(?:-(?<day>\\d\\d))?", "S");
+    assert(re.getGroupNumber("year") == 1 && re.getGroupNumber("day") == 3);
+    assert(re.getGroupNumber("hour") == PCRE2_ERROR_NOSUBSTRING);
+    assert(re.getCompiledCode()->getNameCount() == 3);
+    assert(jp::Regex().getGroupNumber("year") == PCRE2_ERROR_NOSUBSTRING);
+
+    // look up once, index each row
+    std::string subject = "2018-10 2019-11-05";
+    jp::MatchTable table;
+    assert(re.initMatch().setSubject(subject).setMatchTable(&table).setFindAll().match() == 2);
+    int month = re.getGroupNumber("month");
+    assert(table.get(0, month) == "10" && table.get(1, month) == "11");
+    assert(table.get(1, "day") == "05" && table.get(0, "day").empty() && table.get(0, "hour").empty());
+
+    // lazy matches
+    int n = 0;
+    for(jp::MatchView const& m : re.matches(subject)){
+        assert(m["year"] == (n ? "2019" : "2018"));
+        assert(m["nothing"].empty() && m[1] == m["year"]);
+        ++n;
+    }
+    assert(n == 2);
+
+    // duplicate names: the group that is set is used
+    jp::Regex dup("(?J)(?:(?<n>a)|(?<n>b))");
+    assert(dup.getGroupNumber("n") == 1);
+    jp::MatchRange r = dup.matches("b");
+    assert(r.begin()->operator[]("n") == "b");
+
+    // named substring maps are unchanged
+    jp::VecNas vec_nas;
+    jp::VecNtN vec_ntn;
+    assert(re.initMatch().setSubject(subject).setNamedSubstringVector(&vec_nas)
+             .setNameToNumberMapVector(&vec_ntn).setFindAll().match() == 2);
+    assert(vec_nas.size() == 2 && vec_nas[1]["day"] == "05" && vec_nas[0]["day"].empty());
+    assert(vec_ntn[0]["month"] == 2);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/**@file test_parallel_match.cpp
+ *  Test cases for the parallel global match (RegexMatch::parallelMatch()).
+ * @include test_parallel_match.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::String log;
+    for(int i = 0; i < 20000; ++i)
+        log += "2024-01-01 " + std::string(i % 5 ? "INFO" : "ERROR") + " id=" + std::to_string(i) + " user=u" + std::to_string(i % 13) + "\n";
+
+    jp::Regex re("^(?<date>\\S+) (ERROR|WARN) id=(\\d+)", "m");
+    jp::VecNum serial, parallel;
+    jp::VecNas nas;
+    jpcre2::VecOff soff, eoff, psoff, peoff;
+    jpcre2::SIZE_T n = re.initMatch().setSubject(log).setNumberedSubstringVector(&serial)
+                         .setMatchStartOffsetVector(&soff).setMatchEndOffsetVector(&eoff).setFindAll().match();
+    assert(n == 4000);
+
+    // chunks much smaller than the subject, several threads
+    jp::MatchTable table;
+    jp::RegexMatch rm(&re);
+    rm.setSubject(log).setNumberedSubstringVector(&parallel).setNamedSubstringVector(&nas)
+      .setMatchStartOffsetVector(&psoff).setMatchEndOffsetVector(&peoff);
+    assert(rm.parallelMatch(4, '\n', 1000) == n);
+    assert(rm.getErrorNumber() == 0);
+    assert(psoff == soff && peoff == eoff);
+    assert(parallel.size() == n && nas.size() == n);
+    for(jpcre2::SIZE_T i = 0; i < n; ++i){
+        assert(parallel[i][3] == serial[i][3]);
+        assert(nas[i]["date"] == "2024-01-01");
+    }
+
+    // match table
+    jp::RegexMatch rt(&re);
+    assert(rt.setSubject(log).setMatchTable(&table).parallelMatch(3, '\n', 5000) == n);
+    assert(table.size() == n && table.getGroupCount() == 4);
+    assert(table.start(n - 1) == soff[n - 1] && table.get(7, 3) == serial[7][3]);
+
+    // span buffer stops when full
+    jpcre2::MatchSpan spans[10];
+    jp::RegexMatch rs(&re);
+    assert(rs.setSubject(log).setMatchSpanBuffer(spans, 10).parallelMatch(8, '\n', 100) == 10);
+    assert(rs.hasMoreMatches());
+    assert(spans[9].start == soff[9]);
+
+    // caller given boundaries and start offset
+    jpcre2::VecOff bounds;
+    for(jpcre2::SIZE_T i = 0; i < log.size(); i += 777){
+        jpcre2::SIZE_T nl = log.find('\n', i);
+        if(nl != jp::String::npos) bounds.push_back(nl + 1);
+    }
+    jpcre2::SIZE_T from = eoff[100];
+    jpcre2::VecOff bsoff;
+    jp::RegexMatch rb(&re);
+    assert(rb.setSubject(log).setStartOffset(from).setMatchStartOffsetVector(&bsoff).parallelMatch(bounds, 5) == n - 101);
+    assert(bsoff.front() == soff[101] && bsoff.back() == soff[n - 1]);
+
+    // empty matches are not found twice at chunk boundaries, $ doesn't match at a chunk end
+    jp::Regex empty("x*");
+    jp::String lines = "ax\nb\n\nxx\nc\n";
+    for(int i = 0; i < 6; ++i) lines += lines;
+    jpcre2::VecOff es, ps;
+    jpcre2::SIZE_T ne = empty.initMatch().setSubject(lines).setMatchStartOffsetVector(&es).setFindAll().match();
+    assert(empty.initMatch().setSubject(lines).setMatchStartOffsetVector(&ps).parallelMatch(4, '\n', 10) == ne);
+    assert(ps == es);
+    jp::Regex eol("\\w$");
+    ne = eol.initMatch().setSubject(lines).setMatchStartOffsetVector(&es).setFindAll().match();
+    assert(eol.initMatch().setSubject(lines).setMatchStartOffsetVector(&ps).parallelMatch(4, '\n', 10) == ne);
+    assert(ps == es);
+
+    // a chunk end is not the end of the subject, lookaheads see past it
+    jpcre2::VecOff cuts3;
+    cuts3.push_back(3);
+    cuts3.push_back(6);
+    jp::String abc = "aa\nbb\ncc";
+    jp::Regex endz("\\w+\\Z");
+    ne = endz.initMatch().setSubject(abc).setMatchStartOffsetVector(&es).setFindAll().match();
+    assert(ne == 1);
+    assert(endz.initMatch().setSubject(abc).setMatchStartOffsetVector(&ps).parallelMatch(cuts3, 3) == ne);
+    assert(ps == es);
+    jp::Regex ahead("\\w+(?=\\n\\w)");
+    ne = ahead.initMatch().setSubject(abc).setMatchStartOffsetVector(&es).setFindAll().match();
+    assert(ne == 2);
+    assert(ahead.initMatch().setSubject(abc).setMatchStartOffsetVector(&ps).parallelMatch(cuts3, 3) == ne);
+    assert(ps == es);
+
+    // a match that crosses a cut, the next chunk is matched again from its end
+    jp::Regex across("a\\nb|b\\w|\\w");
+    jpcre2::VecOff ee, pe;
+    ne = across.initMatch().setSubject(abc).setMatchStartOffsetVector(&es).setMatchEndOffsetVector(&ee).setFindAll().match();
+    jpcre2::VecOff cuts1(1, 2);
+    cuts1.push_back(3);
+    assert(across.initMatch().setSubject(abc).setMatchStartOffsetVector(&ps).setMatchEndOffsetVector(&pe)
+                 .parallelMatch(cuts1, 2) == ne);
+    assert(ps == es && pe == ee);
+
+    // small subjects are matched on the calling thread, options are kept
+    jp::RegexMatch small(&re);
+    assert(small.setSubject("2024 ERROR id=1\n").parallelMatch() == 1);
+    jp::Regex word("\\w+");
+    assert(word.initMatch().setSubject("ab cd").addPcre2Option(PCRE2_NOTBOL).setFindAll().match() == 2);
+
+    // errors stop the merge
+    jp::MatchContext* mc = pcre2_match_context_create_8(0);
+    pcre2_set_match_limit_8(mc, 1);
+    jp::RegexMatch rl(&re);
+    assert(rl.setSubject(log).setMatchContext(mc).parallelMatch(2, '\n', 1000) == 0);
+    assert(rl.getErrorNumber() == PCRE2_ERROR_MATCHLIMIT);
+    pcre2_match_context_free_8(mc);
+    return 0;
+}
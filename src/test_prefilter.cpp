@@ -0,0 +1,105 @@
+/**@file test_prefilter.cpp
+ *  Test cases for the required literal prefilter.
+ * @include test_prefilter.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+static jp::String literal(jp::String const& pat, jp::String const& mod = ""){
+    jp::Regex re(pat, mod);
+    assert(re);
+    return jp::String(re.getCompiledCode()->getPrefilterLiteral());
+}
+
+int main(){
+    // longest run of literal characters at the top level
+    assert(literal("/api/v\\d+") == "/api/v");
+    assert(literal("GET (\\S+) HTTP/1\\.1") == " HTTP/1.1");
+    assert(literal("ERROR:\\s+(.*)") == "ERROR:");
+    assert(literal("abc*") == "ab");
+    assert(literal("abc{0,2}d") == "ab");
+    assert(literal("ab+c") == "ab");
+    assert(literal("x[abc]yz") == "yz");
+
+    // no literal when it can't be trusted
+    assert(literal("foo|bar") == "");
+    assert(literal("foo", "i") == "");
+    assert(literal("(?i)foo") == "");
+    assert(literal("a(?i:b)cd") == "");
+    assert(literal("f o o", "x") == "");
+    assert(literal("foo(?C1)") == "");
+    assert(literal("(?:a(*ACCEPT))?bc") == "");
+    assert(literal("xyz\\Qa\\E|xb") == "");
+    assert(jp::Regex("xyz\\Qa\\E|xb").match("xb") == 1);
+    assert(literal("\\Qa.b\\E") == "");
+    assert(literal("xyz{|x}") == "");
+    assert(jp::Regex("xyz{|x}").match("x}") == 1);
+    assert(literal("ab{,2}c") == "");
+
+    // POSIX classes don't end the character class
+    assert(literal("[[:digit:]]x") == "x");
+    assert(jp::Regex("[[:digit:]]x").match("5x") == 1);
+    assert(jp::Regex("[a[:alpha:]]b").match("zb") == 1);
+    assert(literal("ab[[:<:]]cd") == "ab");
+    assert(jp::Regex("ab[[:<:]]cd").match("xab cd abcd") == 0);
+    assert(jp::Regex("[[:<:]]cd").match("x cd") == 1);
+
+    // first or last code unit reported by PCRE2
+    assert(literal("\\x41\\d+") == "A");
+
+    jp::Regex re("/api/v(\\d+)");
+    jp::CodePtr cc = re.getCompiledCode();
+    cc->setPrefilterCounting(true);
+    assert(re.match("GET /index.html") == 0);
+    assert(re.match("GET /api/v2/users") == 1);
+    assert(re.match("GET /api/x") == 0);
+    assert(cc->getPrefilterCheckCount() == 3);
+    assert(cc->getPrefilterRejectCount() == 2);
+
+    // the results don't change
+    jp::VecNum vec_num;
+    assert(re.initMatch().setSubject("/api/v1 /api/v22 /api/").setNumberedSubstringVector(&vec_num).setFindAll().match() == 2);
+    assert(vec_num[1][1] == "22");
+    assert(re.initMatch().setSubject("/api/v1 /api/v22").setStartOffset(17).match() == 0);
+    assert(re.matches("none").begin() == re.matches("none").end());
+
+    // partial matching isn't filtered
+    cc->resetPrefilterCounters();
+    assert(re.initMatch().setSubject("GET /ap").addPcre2Option(PCRE2_PARTIAL_HARD).match() == 0);
+    assert(cc->getPrefilterCheckCount() == 0);
+
+    // nothing is counted unless enabled
+    cc->setPrefilterCounting(false);
+    assert(re.match("GET /api/x") == 0);
+    assert(cc->getPrefilterCheckCount() == 0 && cc->getPrefilterRejectCount() == 0);
+
+    // long subjects go through the vector loop
+    jp::String hay(1000, 'x');
+    assert(re.match(hay) == 0);
+    assert(re.match(hay + "/api/v9") == 1);
+    assert(re.match(hay + "/api/v") == 0);
+    assert(re.match("/api/v3" + hay) == 1);
+
+    // RegexSet skips the patterns whose literal is missing
+    jp::RegexSet set;
+    set.add("ERROR \\d+").add("WARN").add("\\d{3}");
+    set.compile();
+    assert(set.getErrorNumber() == 0 && set.isCombined(0) && set.isCombined(1));
+    std::vector<jpcre2::SIZE_T> ids;
+    assert(set.match("WARN 404", &ids) == 2);
+    assert(ids[0] == 1 && ids[1] == 2);
+    assert(set.match("ERROR 5", &ids) == 1);
+    assert(ids[0] == 0);
+    assert(set.match("ok", &ids) == 0);
+
+    // wider characters
+    jpcre2::select<char32_t>::Regex re32(U"id=\\d+");
+    assert(re32.getCompiledCode()->getPrefilterLiteral() == U"id=");
+    assert(re32.match(U"x id=5") == 1);
+    assert(re32.match(U"x id5") == 0);
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+/**@file test_regex_cache.cpp
+ *  Test cases for the compiled pattern cache.
+ * @include test_regex_cache.cpp
+ * */
+
+#include <cassert>
+#include <thread>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::RegexCache cache;
+
+    jp::Regex re1, re2, re3, re4;
+    re1.setRegexCache(&cache).compile("(\\d+)-(\\w+)", "S");
+    re2.setRegexCache(&cache).compile("(\\d+)-(\\w+)", "S");
+    assert(cache.getMissCount() == 1 && cache.getHitCount() == 1);
+    assert(re1.getPcre2Code() == re2.getPcre2Code());
+    assert(re2.match("12-ab 34-cd", "g") == 2);
+
+    // different options, newline or tables make a different key
+    re3.setRegexCache(&cache).compile("(\\d+)-(\\w+)", "i");
+    assert(re3.getPcre2Code() != re1.getPcre2Code());
+    re4.setRegexCache(&cache).setNewLine(PCRE2_NEWLINE_CRLF).compile("(\\d+)-(\\w+)", "S");
+    assert(re4.getPcre2Code() != re1.getPcre2Code());
+    jp::Regex re5;
+    re5.setRegexCache(&cache).resetCharacterTables().compile("(\\d+)-(\\w+)", "S");
+    assert(re5.getPcre2Code() != re1.getPcre2Code());
+    assert(cache.getMissCount() == 4 && cache.getCount() == 4);
+    assert(re5.match("12-ab") == 1);
+
+    // compile errors are not cached
+    jp::Regex bad;
+    bad.setRegexCache(&cache).compile("(");
+    assert(!bad && bad.getErrorNumber() != 0);
+    assert(cache.getCount() == 4);
+
+    // eviction keeps code alive for the users
+    cache.setMaxBytes(cache.getBytes() / 2);
+    assert(cache.getEvictionCount() > 0);
+    assert(cache.getBytes() <= cache.getMaxBytes());
+    assert(re1.match("1-a") == 1);
+    cache.clear();
+    assert(cache.getCount() == 0 && cache.getBytes() == 0);
+    assert(re2.match("1-a") == 1);
+
+    // concurrent use of the global cache
+    jp::RegexCache& global = jp::RegexCache::getGlobal();
+    global.resetCounters();
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t){
+        threads.push_back(std::thread([&global](){
+            for(int i = 0; i < 100; ++i){
+                jp::Regex re;
+                re.setRegexCache(&global).compile(i % 2 ? "[a-z]+" : "\\d+");
+                assert(re.match(i % 2 ? "abc" : "123") == 1);
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    assert(global.getCount() == 2);
+    assert(global.getHitCount() + global.getMissCount() == 400);
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+/**@file test_regex_copy.cpp
+ *  Test cases for copying Regex objects (compiled code is shared).
+ * @include test_regex_copy.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex* re = new jp::Regex();
+    re->resetCharacterTables().compile("(\\w+)@(\\w+)", "iS");
+    jp::Regex copy(*re);
+    assert(copy.getPcre2Code() == re->getPcre2Code());
+    assert(copy.getErrorNumber() == 0);
+
+    jp::Regex assigned;
+    assigned = copy;
+    assert(assigned.getPcre2Code() == re->getPcre2Code());
+
+    // the shared code and its tables outlive the original object
+    delete re;
+    jp::VecNum vec_num;
+    assert(copy.initMatch().setSubject("a@b C@D").setNumberedSubstringVector(&vec_num).setFindAll().match() == 2);
+    assert(vec_num[1][2] == "D");
+
+    // modifying the copy compiles new code for it only
+    jp::Pcre2Code const* shared = copy.getPcre2Code();
+    assigned.setModifier("").compile();
+    assert(assigned.getPcre2Code() != shared);
+    assert(copy.getPcre2Code() == shared);
+    assert(assigned.match("a@b") == 1);
+
+    // move takes the reference
+    jp::Regex moved(std::move(copy));
+    assert(moved.getPcre2Code() == shared && !copy);
+    assert(moved.match("X@Y") == 1);
+
+    // copying an uncompiled Regex
+    jp::Regex empty;
+    jp::Regex empty_copy(empty);
+    assert(!empty_copy);
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+/**@file test_regex_set.cpp
+ *  Test cases for matching a set of patterns in one pass (RegexSet).
+ * @include test_regex_set.cpp
+ * */
+
+#include <cassert>
+#include <thread>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::RegexSet set;
+    set.add("union\\s+select")      // 0
+       .add("<script")              // 1
+       .add("\\.\\./")              // 2
+       .add("(a+)+b")               // 3
+       .add("(\\w)\\1")             // 4 back reference: matched on its own
+       .add("(?<n>id)=(\\d+)")      // 5
+       .add("(?<n>x)y");            // 6 same name as in 5
+    set.compile("iS");
+    assert(set.getErrorNumber() == 0 && set.size() == 7);
+    assert(set.isCombined(0) && set.isCombined(3) && !set.isCombined(4) && set.isCombined(6));
+
+    std::vector<jpcre2::SIZE_T> ids;
+    std::vector<jpcre2::MatchSpan> spans;
+    std::string subject = "GET /../x?id=1 UNION  SELECT <SCRIPT> xy aab";
+    assert(set.match(subject, &ids, &spans) == 7);
+    for(jpcre2::SIZE_T i = 0; i < 7; ++i) assert(ids[i] == i);
+
+    // first match offsets are the same as matching each pattern alone
+    for(jpcre2::SIZE_T i = 0; i < ids.size(); ++i){
+        jpcre2::MatchSpan span;
+        jp::RegexMatch rm(&set.getRegex(ids[i]));
+        assert(rm.setSubject(subject).setMatchSpanBuffer(&span, 1).match() == 1);
+        assert(span.start == spans[i].start && span.end == spans[i].end);
+    }
+
+    assert(set.match("<script> ID=2", &ids) == 2 && ids[0] == 1 && ids[1] == 5);
+    assert(set.match("hello", &ids) == 1 && ids[0] == 4); //"ll"
+    assert(set.match("nothing here") == 0);
+    assert(set.match("") == 0);
+
+    // patterns that would change meaning are matched alone
+    jp::RegexSet unsafe;
+    unsafe.add("a\\Kb").add("(*COMMIT)c").add("(?(?=x)xy|z)").add("(a)(?1)").add("\\Qa)").add("(?x)a # comment").add("d");
+    unsafe.compile();
+    for(jpcre2::SIZE_T i = 0; i < 6; ++i) assert(!unsafe.isCombined(i));
+    assert(unsafe.isCombined(6));
+    assert(unsafe.match("ab c xy aa a) a d", &ids, &spans) == 7);
+    assert(spans[0].start == 1 && spans[0].end == 2); // \K
+
+    // compile errors
+    jp::RegexSet bad;
+    bad.add("ok").add("(").compile();
+    assert(bad.getErrorNumber() != 0 && bad.getErrorIndex() == 1);
+    assert(bad.match("ok") == 0);
+
+    // match errors are reported
+    jp::RegexSet utf;
+    utf.add("\\w").add("x").compile("u");
+    int err = 0;
+    assert(utf.match("\xff", &ids, 0, &err) == 0 && err == PCRE2_ERROR_UTF8_ERR21);
+
+    // concurrent matching
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++t){
+        threads.push_back(std::thread([&set, &subject](){
+            std::vector<jpcre2::SIZE_T> v;
+            for(int i = 0; i < 100; ++i) assert(set.match(subject, &v) == 7);
+        }));
+    }
+    for(jpcre2::SIZE_T t = 0; t < threads.size(); ++t) threads[t].join();
+
+    return 0;
+}
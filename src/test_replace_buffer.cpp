@@ -0,0 +1,69 @@
+/**@file test_replace_buffer.cpp
+ *  Test cases for the internal buffer and the output size prediction of RegexReplace.
+ * @include test_replace_buffer.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(\\w+)");
+    jp::RegexReplace rr(&re);
+    jp::String subject = "alpha beta gamma delta epsilon zeta eta theta iota kappa lambda";
+    rr.setSubject(subject).setReplaceWith("<$1|$1|$1>").setModifier("g");
+
+    // the output is about four times the subject, the first call has to retry
+    jp::String first = rr.replace();
+    assert(rr.getSubstituteCallCount() == 2);
+    assert(rr.getSubstituteRetryCount() == 1);
+
+    // the learned size is used from now on
+    for(int i = 0; i < 10; ++i) assert(rr.replace() == first);
+    assert(rr.getSubstituteCallCount() == 12);
+    assert(rr.getSubstituteRetryCount() == 1);
+
+    // a similar subject still fits
+    jp::String longer = subject + " mu nu xi";
+    rr.setSubject(longer);
+    rr.replace();
+    assert(rr.getSubstituteRetryCount() == 1);
+
+    // shrinking output never retries
+    rr.resetSubstituteCounters();
+    rr.setSubject(subject).setReplaceWith("");
+    for(int i = 0; i < 50; ++i) rr.replace();
+    rr.setReplaceWith("<$1|$1|$1>");
+    rr.replace();
+    assert(rr.getSubstituteCallCount() == 52);
+    assert(rr.getSubstituteRetryCount() == 1);
+
+    // the internal buffer is reused
+    jp::StringView v = rr.replaceBuffered();
+    assert(v == first);
+    const jp::Char* storage = v.data();
+    v = rr.replaceBuffered();
+    assert(v == first && v.data() == storage);
+
+    // copies keep the learned size
+    jp::RegexReplace rr2(rr);
+    rr2.resetSubstituteCounters();
+    rr2.replace();
+    assert(rr2.getSubstituteCallCount() == 1);
+
+    // an explicit buffer size is used as is
+    rr.resetSubstituteCounters();
+    rr.setBufferSize(4);
+    assert(rr.replace() == first);
+    assert(rr.getSubstituteRetryCount() == 1);
+    rr.setBufferSize(0);
+
+    // reset forgets the learned size
+    rr.reset();
+    rr.setRegexObject(&re).setSubject(subject).setReplaceWith("<$1|$1|$1>").setModifier("g");
+    assert(rr.replace() == first);
+    assert(rr.getSubstituteRetryCount() == 1);
+
+    return 0;
+}
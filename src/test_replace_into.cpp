@@ -0,0 +1,76 @@
+/**@file test_replace_into.cpp
+ *  Test cases for the replace functions that write into a caller supplied string or iterator.
+ * @include test_replace_into.cpp
+ * */
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::Regex re("(\\w+) (\\w+)");
+    jp::RegexReplace rr(&re);
+    rr.setSubject("hello world, big apple").setReplaceWith("$2 $1").setModifier("g");
+
+    // the result is appended
+    jp::String out = ">";
+    assert(rr.replace(out) == 2);
+    assert(out == ">world hello, apple big");
+    assert(rr.getLastReplaceCount() == 2);
+    assert(rr.replace() == "world hello, apple big");
+
+    // reused storage, the result grows past the initial guess
+    out.clear();
+    out.reserve(256);
+    const jp::Char* storage = out.data();
+    rr.setReplaceWith("[$2|$2|$1|$1]");
+    assert(rr.replace(out) == 2);
+    assert(out == "[world|world|hello|hello], [apple|apple|big|big]");
+    out.clear();
+    rr.setBufferSize(1);
+    assert(rr.replace(out) == 2);
+    assert(out == "[world|world|hello|hello], [apple|apple|big|big]");
+    assert(out.data() == storage);
+
+    // no match
+    out.clear();
+    assert(rr.setSubject("nomatch").replace(out) == 0);
+    assert(out == "nomatch");
+
+    // error: the subject is appended in place of the result
+    out = "x";
+    assert(rr.setSubject("a b").setReplaceWith("$9").replace(out) == 0);
+    assert(rr.getErrorNumber() < 0);
+    assert(out == "xa b");
+
+    // output iterator
+    std::vector<char> v;
+    rr.setSubject("a b c d").setReplaceWith("$2$1");
+    std::back_insert_iterator<std::vector<char> > it = rr.replaceTo(std::back_inserter(v));
+    *it = '!';
+    assert(jp::String(v.begin(), v.end()) == "ba dc!");
+
+    // MatchEvaluator
+    jp::MatchEvaluator me([](jp::NumSub const& m, void*, void*){ return "<" + jp::String(m[1]) + ">"; });
+    me.setRegexObject(&re).setSubject("one two three four").setFindAll();
+    out = "|";
+    assert(me.nreplace(out) == 2);
+    assert(out == "|<one> <three>");
+    out.clear();
+    assert(me.replace(out, false, PCRE2_SUBSTITUTE_EXTENDED) == 2);
+    assert(out == "<one> <three>");
+    // existing functions stay the same
+    jpcre2::SIZE_T n = 0;
+    assert(me.replace(false, 0, &n) == "<one> <three>" && n == 2);
+    assert(me.nreplace(false, 0, &n) == "<one> <three>" && n == 2);
+    // a replacement larger than the room given by the buffer size
+    out.clear();
+    me.setCallback([](jp::NumSub const& m, void*, void*){ return jp::String(m[0]) + jp::String(m[0]) + jp::String(m[0]); });
+    assert(me.setBufferSize(2).replace(out) == 2);
+    assert(out == "one twoone twoone two three fourthree fourthree four");
+
+    return 0;
+}
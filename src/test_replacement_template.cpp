@@ -0,0 +1,84 @@
+/**@file test_replacement_template.cpp
+ *  Test cases for ReplacementTemplate.
+ * @include test_replacement_template.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+// replace with the template and with pcre2_substitute, both must agree
+static jp::String both(jp::Regex const& re, jp::String const& subject, jp::String const& repl,
+                       jpcre2::Modifier const& mod, int* err = 0){
+    jp::ReplacementTemplate rt(re, repl);
+    jp::RegexReplace rr(&re);
+    rr.setSubject(subject).setReplaceWith(repl).setModifier(mod);
+    jp::String plain = rr.replace();
+    int plain_err = rr.getErrorNumber();
+    jpcre2::SIZE_T plain_count = rr.getLastReplaceCount();
+    rr.resetErrors().resetSubstituteCounters();
+    jp::String fast = rr.setReplacementTemplate(&rt).replace();
+    assert(fast == plain);
+    assert(rr.getErrorNumber() == plain_err);
+    assert(rr.getLastReplaceCount() == plain_count);
+    if(err) *err = plain_err;
+    return fast;
+}
+
+int main(){
+    jp::Regex re("(?<key>\\w+)=(?<value>\\d*)(x)?");
+    jp::String subject = "a=1, bb=22, c=, d=4x end";
+    assert(both(re, subject, "$2:$1", "g") == "1:a, 22:bb, :c, 4:d end");
+    assert(both(re, subject, "${value}${key}$$", "g") == "1a$, 22bb$, c$, 4d$ end");
+    assert(both(re, subject, "[$0]", "") == "[a=1], bb=22, c=, d=4x end");
+    assert(both(re, subject, "$key-$value.", "g") == "a-1., bb-22., c-., d-4. end");
+    assert(both(re, subject, "${1}0", "g") == "a0, bb0, c0, d0 end");
+    assert(both(re, subject, "", "g") == ", , ,  end");
+
+    // unset and unknown groups
+    int err = 0;
+    assert(both(re, subject, "<$3>", "g", &err) == subject && err == PCRE2_ERROR_UNSET);
+    assert(both(re, subject, "<$3>", "ge") == "<>, <>, <>, <x> end");
+    assert(both(re, subject, "<$9>", "ge", &err) == subject && err == PCRE2_ERROR_NOSUBSTRING);
+    assert(both(re, subject, "<$nope>", "gE") == "<>, <>, <>, <> end");
+
+    // marks, duplicate names, empty matches, start offset
+    jp::Regex mk("(?:a(*MARK:A)|b(*MARK:B))");
+    assert(both(mk, "abc", "${*MARK}$*MARK", "g") == "AABBc");
+    jp::Regex dup("(?J)(?<n>a)|(?<n>b)");
+    assert(both(dup, "ab", "<$n>", "g") == "<a><b>");
+    jp::Regex empty("x*");
+    assert(both(empty, "axxb", "-", "g") == "-a--b-");
+    jp::ReplacementTemplate rt(re, "$1");
+    jp::RegexReplace rr(&re);
+    assert(rr.setReplacementTemplate(&rt).setSubject(subject).setStartOffset(5).setModifier("g").replace()
+           == "a=1, bb, c, d end");
+
+    // bad templates fall back to pcre2_substitute and get its error
+    jp::ReplacementTemplate bad(re, "${1");
+    assert(bad.getErrorNumber() == PCRE2_ERROR_REPMISSINGBRACE && bad.getErrorOffset() == 3);
+    assert(bad.getPartCount() == 0);
+    assert(both(re, subject, "${1", "g", &err) == subject && err == PCRE2_ERROR_REPMISSINGBRACE);
+    assert(both(re, subject, "$", "g", &err) == subject && err == PCRE2_ERROR_BADREPLACEMENT);
+    assert(both(re, subject, "$*MAR", "g", &err) == subject && err == PCRE2_ERROR_BADREPLACEMENT);
+
+    // the extended syntax goes through pcre2_substitute
+    assert(both(re, subject, "\\U$1", "gx") == "A, BB, C, D end");
+
+    // the template is tied to the compiled code it was made for
+    jp::Regex re2("(\\w+)=(\\w*)");
+    jp::ReplacementTemplate rt2(re2, "$2");
+    assert(rt2.getPartCount() == 1);
+    rr.setRegexObject(&re2).setReplacementTemplate(&rt2).setStartOffset(0);
+    assert(rr.replace() == "1, 22, , 4x end");
+    re2.compile("(\\w+)-(\\w*)");
+    assert(rr.setSubject("a-b").replace() == "b");
+    assert(rr.setReplacementTemplate(0).setReplaceWith("$1").replace() == "a");
+
+    // not compiled
+    jp::ReplacementTemplate none(jp::Regex(), "$1");
+    assert(none.getErrorNumber() == PCRE2_ERROR_NULL);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+/**@file test_rewrite_set.cpp
+ *  Test cases for RewriteSet.
+ * @include test_rewrite_set.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+int main(){
+    jp::RewriteSet rules;
+    rules.add("&", "&amp;")
+         .add("<", "&lt;")
+         .add("(a)(b)", "$2$1")
+         .add("(?<user>\\w+)@example\\.com", "${user}@example.org")
+         .add("(?<user>\\d+)!", "<${user}>");
+    rules.compile();
+    assert(rules.getErrorNumber() == 0);
+    for(size_t i = 0; i < rules.size(); ++i) assert(rules.isCombined(i));
+
+    // groups and names refer to the rule's own pattern
+    std::vector<size_t> hits;
+    jp::String out = "> ";
+    assert(rules.rewrite("ab & <joe@example.com> 42!", out, &hits) == 5);
+    assert(out == "> ba &amp; &lt;joe@example.org> <42>");
+    assert(hits.size() == 5);
+    assert(hits[0] == 1 && hits[1] == 1 && hits[2] == 1 && hits[3] == 1 && hits[4] == 1);
+    // hits are added up
+    assert(rules.rewrite("&&", &hits) == "&amp;&amp;");
+    assert(hits[0] == 3);
+    assert(rules.rewrite("nothing here") == "nothing here");
+
+    // same result as replacing rule by rule when the matches don't overlap
+    jp::String subject = "a < b && ab <c>";
+    jp::String sequential = subject;
+    for(size_t i = 0; i < rules.size(); ++i)
+        sequential = jp::Regex(rules.getRegex(i).getPattern()).replace(sequential,
+                                rules.getReplacementTemplate(i).getReplacement(), "g");
+    assert(rules.rewrite(subject) == sequential);
+
+    // leftmost match wins, then the first rule at that position
+    jp::RewriteSet order;
+    order.add("b", "B").add("ab", "X").add("abc", "Y").compile();
+    assert(order.rewrite("abc bc") == "Xc Bc");
+
+    // a rule with a back reference is matched on its own in the same scan
+    jp::RewriteSet mixed;
+    mixed.add("(a)\\1", "D").add("a", "A").add("z", "Z").compile();
+    assert(mixed.getErrorNumber() == 0);
+    assert(!mixed.isCombined(0) && mixed.isCombined(1) && mixed.isCombined(2));
+    hits.clear();
+    assert(mixed.rewrite("a aa aaa z", &hits) == "A D DA Z");
+    assert(hits[0] == 2 && hits[1] == 2 && hits[2] == 1);
+
+    // empty matches are handled as pcre2_substitute() does
+    jp::RewriteSet empty;
+    empty.add("x*", "-").compile();
+    assert(empty.rewrite("abc") == jp::Regex("x*").replace("abc", "-", "g"));
+    assert(empty.rewrite("") == "-");
+
+    // unset groups
+    jp::RewriteSet unset;
+    unset.add("(a)|b", "[$1]").compile();
+    int err = 0;
+    hits.clear();
+    out.clear();
+    assert(unset.rewrite("ab", out, &hits, &err) == 0);
+    assert(err == PCRE2_ERROR_UNSET && out == "ab" && hits.empty());
+    unset.setReplaceOption(PCRE2_SUBSTITUTE_UNSET_EMPTY);
+    assert(unset.rewrite("ab", 0, &err) == "[a][]" && err == 0);
+
+    // compile errors
+    jp::RewriteSet bad;
+    bad.add("a", "b").add("(", "x").compile();
+    assert(bad.getErrorNumber() != 0 && bad.getErrorIndex() == 1);
+    assert(bad.rewrite("a") == "a");
+    bad.add("b", "${1").compile();
+    assert(bad.getErrorNumber() != 0 && bad.getErrorIndex() == 1);
+    jp::RewriteSet bad_repl;
+    bad_repl.add("a", "b").add("b", "${1").compile();
+    assert(bad_repl.getErrorNumber() == PCRE2_ERROR_REPMISSINGBRACE && bad_repl.getErrorIndex() == 1);
+
+    // modifiers apply to every rule
+    jp::RewriteSet icase;
+    icase.add("abc", "1").add("d(e)", "$1").compile("i");
+    assert(icase.rewrite("ABC De") == "1 e");
+
+    return 0;
+}
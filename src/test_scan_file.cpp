@@ -0,0 +1,89 @@
+/**@file test_scan_file.cpp
+ *  Test cases for matching a file in place (scanFile).
+ * @include test_scan_file.cpp
+ * */
+
+#include <cassert>
+#include <cstdio>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+static void writeFile(char const* path, jp::String const& s){
+    std::FILE* f = std::fopen(path, "wb");
+    assert(f);
+    std::fwrite(s.data(), 1, s.size(), f);
+    std::fclose(f);
+}
+
+//scans the file with a window size and checks the result against a global match of its content
+static void check(jp::Regex& re, char const* path, jp::String const& content, jpcre2::SIZE_T window){
+    jpcre2::VecOff soff, eoff;
+    jpcre2::SIZE_T count = re.initMatch().setSubject(content).setMatchStartOffsetVector(&soff)
+                             .setMatchEndOffsetVector(&eoff).setFindAll().match();
+    std::vector<jpcre2::MatchSpan> spans;
+    std::vector<jp::String> texts;
+    int error = -1;
+    jpcre2::SIZE_T n = jp::scanFile(path, re, [&](jpcre2::MatchSpan const& m, jp::StringView text){
+        spans.push_back(m);
+        texts.push_back(jp::String(text));
+        return true;
+    }, window, &error);
+    assert(error == 0);
+    assert(n == count && spans.size() == count);
+    for(jpcre2::SIZE_T i = 0; i < count; ++i){
+        assert(spans[i].start == soff[i] && spans[i].end == eoff[i]);
+        assert(texts[i] == content.substr(soff[i], eoff[i] - soff[i]));
+    }
+}
+
+int main(){
+    char const* path = "test_scan_file.tmp";
+    jp::String content;
+    for(int i = 0; i < 3000; ++i){
+        content += "line " + std::to_string(i) + (i % 7 ? " ok\n" : " ERROR 12345 failed\n");
+        if(i % 500 == 0) content += "long " + jp::String(10000, 'x') + " end\n";
+    }
+    writeFile(path, content);
+
+    jp::Regex errors("ERROR \\d+");
+    jp::Regex lines("^line \\d+", "m");
+    jp::Regex longx("x{10000}");
+    jp::Regex look("(?<=ERROR )\\d+");
+    jp::Regex empty("x*");
+    jpcre2::SIZE_T windows[] = {0, 1, 4096, 5000, 65536};
+    for(jpcre2::SIZE_T w : windows){
+        check(errors, path, content, w);
+        check(lines, path, content, w);
+        check(longx, path, content, w); // longer than the window
+        check(look, path, content, w);
+    }
+    check(empty, path, content, 4096);
+
+    // the sink stops the scan
+    jpcre2::SIZE_T seen = 0;
+    assert(jp::scanFile(path, errors, [&](jpcre2::MatchSpan const&, jp::StringView){ return ++seen < 3; }) == 3);
+    assert(seen == 3);
+
+    // empty file
+    writeFile(path, "");
+    check(empty, path, "", 0);
+    check(errors, path, "", 4096);
+
+    // UTF-8 characters across windows
+    jp::String utf;
+    for(int i = 0; i < 5000; ++i) utf += "a\xc3\xa9\xe2\x82\xac ";
+    writeFile(path, utf);
+    jp::Regex chars("[^ ]+", "u");
+    check(chars, path, utf, 4096);
+    check(chars, path, utf, 4099);
+
+    std::remove(path);
+
+    // missing file
+    int error = 0;
+    assert(jp::scanFile("no/such/file", errors, [](jpcre2::MatchSpan const&, jp::StringView){ return true; }, 0, &error) == 0);
+    assert(error == jpcre2::ERROR::FILE_ERROR);
+    assert(jp::getErrorMessage(error, 0) == "could not open, map or read the file");
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**@file test_serialize.cpp
+ *  Test cases for Regex serialization and bundles.
+ * @include test_serialize.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+typedef jpcre2::select<char16_t> jp16;
+
+int main(){
+    jp::Regex re("(?<year>\\d{4})-(\\d\\d)", "iS");
+    std::vector<jpcre2::Ush> bytes = re.serialize();
+    assert(!bytes.empty());
+
+    jp::Regex re2;
+    re2.deserialize(bytes);
+    assert(!!re2 && re2.getErrorNumber() == 0);
+    assert(re2.getPattern() == re.getPattern());
+    assert(re2.getPcre2Option() == re.getPcre2Option());
+    assert(re2.getJpcre2Option() == re.getJpcre2Option());
+    assert(re2.getNumCaptures() == 2);
+
+    jp::VecNum vec_num;
+    jp::VecNas vec_nas;
+    assert(re2.initMatch().setSubject("2018-10 2019-11").setNumberedSubstringVector(&vec_num)
+              .setNamedSubstringVector(&vec_nas).setFindAll().match() == 2);
+    assert(vec_num[1][2] == "11" && vec_nas[0]["year"] == "2018");
+    // JIT was deferred to the first match
+    size_t jit_size = 0;
+    pcre2_pattern_info_8(re2.getPcre2Code(), PCRE2_INFO_JITSIZE, &jit_size);
+    assert(jit_size > 0);
+    assert(re2.replace("2018-10", "$2/${year}") == "10/2018");
+
+    // corrupted or foreign data
+    jp::Regex bad;
+    std::vector<jpcre2::Ush> broken(bytes);
+    broken[0] ^= 0xff;
+    assert(!bad.deserialize(broken) && bad.getErrorNumber() == PCRE2_ERROR_BADMAGIC);
+    broken = bytes;
+    broken.resize(broken.size() / 2);
+    assert(!bad.deserialize(broken) && bad.getErrorNumber() == PCRE2_ERROR_BADSERIALIZEDDATA);
+    jp16::Regex re16;
+    assert(!re16.deserialize(bytes) && re16.getErrorNumber() == PCRE2_ERROR_BADMODE);
+    assert(jp::Regex().serialize().empty());
+
+    // bundle
+    jp::Regex a("a+"), b("[0-9]+", "g"), c(u8"\\w+", "u");
+    jp::RegexBundleWriter writer;
+    writer.add(a).add(b).add(c);
+    assert(writer.getCount() == 3 && writer.getErrorNumber() == 0);
+    jp::Regex uncompiled;
+    writer.add(uncompiled);
+    assert(writer.getCount() == 3 && writer.getErrorNumber() != 0);
+    std::vector<jpcre2::Ush> bundle_bytes = writer.getBytes();
+
+    jp::RegexBundle bundle(bundle_bytes.data(), bundle_bytes.size());
+    assert(bundle.getErrorNumber() == 0 && bundle.getCount() == 3);
+    std::vector<jp::Regex> loaded(bundle.getCount());
+    for(size_t i = 0; i < bundle.getCount(); ++i) assert(bundle.load(i, loaded[i]));
+    assert(loaded[0].getPattern() == "a+" && loaded[0].match("baaa") == 1);
+    assert(loaded[1].match("1 22 333", "g") == 3);
+    assert(loaded[2].getPcre2Option() == PCRE2_UTF);
+    jp::Regex out_of_range;
+    assert(!bundle.load(3, out_of_range));
+
+    jp::RegexBundle bad_bundle(bytes.data(), bytes.size());
+    assert(bad_bundle.getErrorNumber() == PCRE2_ERROR_BADMAGIC && bad_bundle.getCount() == 0);
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/**@file test_stream_matcher.cpp
+ *  Test cases for matching a subject that arrives in chunks (StreamMatcher).
+ * @include test_stream_matcher.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+//matches the subject in chunks of n and checks the result against a global match of the whole subject
+static void check(jp::String const& pat, jp::String const& mod, jp::String const& subject, jpcre2::SIZE_T n){
+    jp::Regex re(pat, mod);
+    assert(re);
+    jpcre2::VecOff soff, eoff;
+    jpcre2::SIZE_T count = re.initMatch().setSubject(subject).setMatchStartOffsetVector(&soff)
+                             .setMatchEndOffsetVector(&eoff).setFindAll().match();
+
+    jp::StreamMatcher sm(&re);
+    std::vector<jpcre2::MatchSpan> spans;
+    jpcre2::SIZE_T found = 0;
+    for(jpcre2::SIZE_T i = 0; i < subject.size(); i += n)
+        found += sm.feed(jp::StringView(subject).substr(i, n), &spans);
+    found += sm.finish(&spans);
+    assert(sm.getErrorNumber() == 0);
+    assert(found == count && spans.size() == count);
+    for(jpcre2::SIZE_T i = 0; i < count; ++i)
+        assert(spans[i].start == soff[i] && spans[i].end == eoff[i]);
+}
+
+int main(){
+    jp::String log = "INFO start\nERROR 404 not found\nWARN x\nERROR 5\nERROR 12345678 end";
+    jpcre2::SIZE_T sizes[] = {1, 2, 3, 5, 7, 16, 1000};
+    for(jpcre2::SIZE_T n : sizes){
+        check("ERROR \\d+", "", log, n);
+        check("\\d+", "", log, n);
+        check("^\\w+", "m", log, n);
+        check("\\w+$", "m", log, n);
+        check("\\bx\\b", "", log, n);
+        check("(?<=ERROR )\\d", "", log, n);
+        check("N.*?E", "", log, n);
+        check("x*", "", "axxbxcc", n);
+        check("\\d*", "", "12a34", n);
+        check("^ERROR", "", log, n);
+        check("\\r?$", "m", "a\r\nb\r\n", n);
+        check("\\x{e9}+|\\w", "u", "a\xc3\xa9\xc3\xa9 b\xc3\xa9", n);
+        check(".", "u", "\xe2\x82\xac\xc3\xa9x", n);
+    }
+
+    // offsets continue over chunks and the tail stays small
+    jp::Regex re("ERROR \\d+");
+    jp::StreamMatcher sm(&re);
+    std::vector<jpcre2::MatchSpan> spans;
+    jp::String line = "INFO all good here\n";
+    for(int i = 0; i < 1000; ++i){
+        sm.feed(line, &spans);
+        assert(sm.getRetainedSize() < 2 * line.size());
+    }
+    assert(sm.feed("ERR", &spans) == 0);
+    assert(sm.feed("OR 42", &spans) == 0); // may continue
+    assert(sm.feed("\n", &spans) == 1);
+    assert(spans.size() == 1 && spans[0].start == 1000 * line.size());
+    assert(spans[0].end == spans[0].start + 8);
+    assert(sm.getStreamOffset() == 1000 * line.size() + 9);
+
+    // a match at the end of the stream is reported by finish()
+    spans.clear();
+    sm.reset();
+    assert(sm.feed("ERROR 1", &spans) == 0);
+    assert(sm.finish(&spans) == 1);
+    assert(spans[0].start == 0 && spans[0].end == 7);
+
+    // errors stop the stream until reset
+    jp::Regex backref("(a)\\1");
+    jp::MatchContext* mc = pcre2_match_context_create_8(0);
+    pcre2_set_match_limit_8(mc, 1);
+    jp::StreamMatcher limited(&backref);
+    limited.setMatchContext(mc);
+    assert(limited.feed("xaa", &spans) == 0);
+    assert(limited.getErrorNumber() == PCRE2_ERROR_MATCHLIMIT);
+    limited.setMatchContext(0).reset();
+    assert(limited.feed("xaa", &spans) == 1);
+    pcre2_match_context_free_8(mc);
+
+    // UTF-16, a surrogate pair cut by the chunk end
+    typedef jpcre2::select<char16_t> jp16;
+    jp16::Regex re16(u".", "u");
+    jp16::StreamMatcher sm16(&re16);
+    std::u16string s16 = u"a\U0001F600b";
+    spans.clear();
+    for(jpcre2::SIZE_T i = 0; i < s16.size(); ++i)
+        sm16.feed(jp16::StringView(s16).substr(i, 1), &spans);
+    sm16.finish(&spans);
+    assert(sm16.getErrorNumber() == 0 && spans.size() == 3);
+    assert(spans[1].start == 1 && spans[1].end == 3);
+
+    // no pattern
+    jp::StreamMatcher empty;
+    assert(empty.feed("abc", 0) == 0 && empty.finish(0) == 0);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/**@file test_streaming_evaluator.cpp
+ *  Test cases for the streaming mode of MatchEvaluator.
+ * @include test_streaming_evaluator.cpp
+ * */
+
+#include <cassert>
+#include "jpcre2.hpp"
+
+typedef jpcre2::select<char> jp;
+
+static jpcre2::SIZE_T seen;
+
+jp::String numbered(jp::NumSub const& m, void*, void*){
+    ++seen;
+    assert(m.size() == 3);
+    return jp::String(m[2]) + "-" + jp::String(m[1]);
+}
+
+jp::String all(jp::NumSub const& m, jp::MapNas const& n, jp::MapNtN const& t){
+    return jp::String(n.at("key")) + "=" + jp::String(m[2]) + "#" + std::to_string(t.at("value"));
+}
+
+int main(){
+    jp::Regex re("(?<key>\\w+):(?<value>\\w*)");
+    jp::String subject = "a:1, b:2, c:, dd:44 end";
+
+    // same results as the non streaming mode
+    jp::MatchEvaluator me(numbered);
+    me.setRegexObject(&re).setSubject(subject).setFindAll();
+    jp::String expected = me.nreplace();
+    jp::String expected_pcre2 = me.replace(true, PCRE2_SUBSTITUTE_EXTENDED);
+    assert(expected == "1-a, 2-b, -c, 44-dd end");
+
+    seen = 0;
+    me.setStreaming();
+    jpcre2::SIZE_T n = 0;
+    assert(me.nreplace(true, 0, &n) == expected && n == 4);
+    assert(seen == 4);
+    assert(me.replace(true, PCRE2_SUBSTITUTE_EXTENDED, &n) == expected_pcre2 && n == 4);
+    jp::String out = ">";
+    assert(me.nreplace(out) == 4 && out == ">" + expected);
+
+    // nothing is kept once done
+    assert(me.nreplace(false) == subject);
+
+    // all three maps
+    jp::MatchEvaluator me3(all);
+    me3.setRegexObject(&re).setSubject(subject).setFindAll();
+    expected = me3.nreplace();
+    assert(me3.setStreaming(true).nreplace() == expected);
+    assert(expected == "a=1#2, b=2#2, c=#2, dd=44#2 end");
+
+    // single match, no match, empty matches
+    me.setFindAll(false);
+    assert(me.nreplace() == "1-a, b:2, c:, dd:44 end");
+    assert(me.setSubject("nothing here").nreplace() == "nothing here");
+    jp::Regex empty("x*");
+    jp::MatchEvaluator mee([](void*, void*, void*){ return jp::String("-"); });
+    mee.setRegexObject(&empty).setSubject("axxb").setFindAll();
+    expected = mee.nreplace();
+    assert(mee.setStreaming().nreplace() == expected);
+    assert(expected == "-a--b-");
+
+    // a match data block set by the user is left to the match
+    jp::MatchData* md = pcre2_match_data_create_8(3, 0);
+    me.setSubject(subject).setFindAll().setMatchDataBlock(md);
+    assert(me.replace() == "1-a, 2-b, -c, 44-dd end");
+    pcre2_match_data_free_8(md);
+
+    // an error in the middle gives back the subject
+    jp::MatchEvaluator mee2([](jp::NumSub const& m, void*, void*){ return jp::String(m[1] == "c" ? "$9" : "ok"); });
+    mee2.setRegexObject(&re).setSubject(subject).setFindAll().setStreaming();
+    out = ">";
+    assert(mee2.replace(out) == 0);
+    assert(out == ">" + subject);
+    assert(mee2.getErrorNumber() == PCRE2_ERROR_NOSUBSTRING);
+
+    // through RegexReplace
+    me.setMatchDataBlock(0).setFindAll(false);
+    assert(re.initReplace().setSubject(subject).setModifier("g").nreplace(me) == "1-a, 2-b, -c, 44-dd end");
+
+    return 0;
+}